@@ -14,7 +14,6 @@ in VS_OUT {
 
 out vec4 fragColor;
 
-uniform vec3 camPos;
 uniform bool useHeightMap;
 uniform float heightMapScale;
 uniform int heightMapMethod;
@@ -55,7 +54,7 @@ vec3 computeNormalFromHeightMap2(in sampler2D heightMap, in vec2 texCoords, in m
 
 void main() {
   // view direction
-  vec3 viewDir = normalize(camPos - fs_in.position);
+  vec3 viewDir = normalize(cameraPosition - fs_in.position);
 
   vec3 normal = fs_in.normal;
   if(useHeightMap) {
@@ -15,8 +15,7 @@ class TangentSpace : public SandboxBase
    private:
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
         scene.setPointLight({glm::vec3(10000), glm::vec3(0, 100, 0), 0});
 
@@ -35,9 +34,10 @@ class TangentSpace : public SandboxBase
             static char modelPath[100] = {"assets/sponza/sponza.obj"};
             ImGui::InputText("Model", modelPath, 100);
             if (ImGui::Button("Load Model")) {
-                scene.setModel(
-                    {std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+                model_load = scene.setModelAsync(
+                    std::string(CMAKE_SOURCE_DIR) + "/" + modelPath);
             }
+            showModelLoadProgress();
 
             ImGui::Separator();
 
@@ -93,12 +93,6 @@ class TangentSpace : public SandboxBase
                              0.0f});
 
         // set uniform variables
-        const glm::mat4 view = camera.computeViewMatrix();
-        const glm::mat4 projection =
-            camera.computeProjectionMatrix(width, height);
-        pipeline.setUniform("view", view);
-        pipeline.setUniform("projection", projection);
-        pipeline.setUniform("camPos", camera.cam_pos);
         pipeline.setUniform("useHeightMap", use_height_map);
         pipeline.setUniform("heightMapMethod", height_map_method);
         pipeline.setUniform("heightMapScale", height_map_scale);
@@ -0,0 +1,7 @@
+// matrices and position of camera, CameraBlock of uniform-blocks.hpp
+layout(std140, binding = 0) uniform CameraBlock {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec3 cameraPosition;
+};
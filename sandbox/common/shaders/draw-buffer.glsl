@@ -0,0 +1,11 @@
+// same layout as GPUDrawData
+struct DrawData {
+  vec4 positionOffset;
+  vec4 positionScale;
+  uint materialID;
+};
+
+// indexed by gl_BaseInstance of each indirect draw
+layout(std430, binding = 1) readonly buffer DrawBuffer {
+  DrawData draws[];
+};
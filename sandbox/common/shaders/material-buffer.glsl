@@ -0,0 +1,62 @@
+#include material.glsl
+
+// same layout as GPUMaterial
+struct MaterialData {
+  vec4 kd;
+  vec4 ks;
+  vec4 ka;
+  vec4 ke;
+  float shininess;
+  uint hasHeightMap;
+  uint hasNormalMap;
+  uint hasDisplacementMap;
+  uint hasLightMap;
+  uvec2 textureMaps[9];
+};
+
+// indexed by DrawData.materialID
+layout(std430, binding = 0) readonly buffer MaterialBuffer {
+  MaterialData materials[];
+};
+
+Material getMaterial(uint materialID) {
+  MaterialData data = materials[materialID];
+
+  Material material;
+  material.kd = data.kd.xyz;
+  material.ks = data.ks.xyz;
+  material.ka = data.ka.xyz;
+  material.ke = data.ke.xyz;
+  material.shininess = data.shininess;
+  material.hasHeightMap = data.hasHeightMap != 0;
+  material.hasNormalMap = data.hasNormalMap != 0;
+  material.hasDisplacementMap = data.hasDisplacementMap != 0;
+  material.hasLightMap = data.hasLightMap != 0;
+  material.textureMaps = data.textureMaps;
+  return material;
+}
+
+#ifdef BINDLESS_MATERIAL_TEXTURES
+// DrawMode::Bindless, shaders enable GL_ARB_bindless_texture right after
+// #version, since it must precede other tokens
+
+// texture arrays of MaterialTextureTable if bindless textures are not
+// supported, bound once per draw of a model
+// units 10..15, so that it fits the 16 units GL guarantees
+layout(binding = 10) uniform sampler2DArray materialTextureArrays[6];
+// are references bindless handles rather than array index plus one and
+// layer?
+uniform bool materialTexturesBindless;
+
+vec4 sampleMaterialMap(Material material, int map, vec2 texCoords) {
+  uvec2 reference = material.textureMaps[map];
+  if (reference == uvec2(0)) { return vec4(0.0); }
+#ifdef GL_ARB_bindless_texture
+  if (materialTexturesBindless) {
+    return texture(sampler2D(reference), texCoords);
+  }
+#endif
+  return texture(materialTextureArrays[reference.x - 1u],
+                 vec3(texCoords, float(reference.y)));
+}
+#endif
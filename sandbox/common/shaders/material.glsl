@@ -0,0 +1,80 @@
+struct Material {
+  vec3 kd;
+  vec3 ks;
+  vec3 ka;
+  vec3 ke;
+  float shininess;
+  bool hasHeightMap;
+  bool hasNormalMap;
+  bool hasDisplacementMap;
+  bool hasLightMap;
+  // references of MaterialTextureTable in DrawMode::Bindless, in order of
+  // TextureType
+  uvec2 textureMaps[9];
+};
+
+// maps of material, same as TextureType
+const int DIFFUSE_MAP = 0;
+const int SPECULAR_MAP = 1;
+const int AMBIENT_MAP = 2;
+const int EMISSIVE_MAP = 3;
+const int HEIGHT_MAP = 4;
+const int NORMAL_MAP = 5;
+const int SHININESS_MAP = 6;
+const int DISPLACEMENT_MAP = 7;
+const int LIGHT_MAP = 8;
+
+layout(binding = 0) uniform sampler2D diffuseMap;
+layout(binding = 1) uniform sampler2D specularMap;
+layout(binding = 2) uniform sampler2D ambientMap;
+layout(binding = 3) uniform sampler2D emissiveMap;
+layout(binding = 4) uniform sampler2D heightMap;
+layout(binding = 5) uniform sampler2D normalMap;
+layout(binding = 6) uniform sampler2D shininessMap;
+layout(binding = 7) uniform sampler2D displacementMap;
+layout(binding = 8) uniform sampler2D lightMap;
+
+// sample a map of material, from texture units bound per draw, or from
+// references of material if BINDLESS_MATERIAL_TEXTURES is defined(see
+// material-buffer.glsl)
+vec4 sampleMaterialMap(Material material, int map, vec2 texCoords);
+
+#ifndef BINDLESS_MATERIAL_TEXTURES
+vec4 sampleMaterialMap(Material material, int map, vec2 texCoords) {
+  switch (map) {
+    case DIFFUSE_MAP:
+      return texture(diffuseMap, texCoords);
+    case SPECULAR_MAP:
+      return texture(specularMap, texCoords);
+    case AMBIENT_MAP:
+      return texture(ambientMap, texCoords);
+    case EMISSIVE_MAP:
+      return texture(emissiveMap, texCoords);
+    case HEIGHT_MAP:
+      return texture(heightMap, texCoords);
+    case NORMAL_MAP:
+      return texture(normalMap, texCoords);
+    case SHININESS_MAP:
+      return texture(shininessMap, texCoords);
+    case DISPLACEMENT_MAP:
+      return texture(displacementMap, texCoords);
+    case LIGHT_MAP:
+      return texture(lightMap, texCoords);
+  }
+  return vec4(0.0);
+}
+#endif
+
+// tangent space normal of normal map
+// z is reconstructed from x and y, since compressed normal maps(BC5) have
+// only red and green channels
+vec3 sampleNormalMap(vec2 texCoords) {
+  vec2 xy = 2.0 * texture(normalMap, texCoords).xy - 1.0;
+  return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
+// sampleNormalMap of the normal map of material
+vec3 sampleNormalMap(Material material, vec2 texCoords) {
+  vec2 xy = 2.0 * sampleMaterialMap(material, NORMAL_MAP, texCoords).xy - 1.0;
+  return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
@@ -0,0 +1,34 @@
+// vertex attributes of any VertexFormat
+// packed attributes have fewer components, missing ones are read as (0, 0, 0, 1)
+layout (location = 0) in vec4 vPosition;
+layout (location = 1) in vec4 vNormal;
+layout (location = 2) in vec2 vTexCoords;
+layout (location = 3) in vec4 vTangent;
+layout (location = 4) in vec4 vDndu;
+layout (location = 5) in vec4 vDndv;
+
+// same as VertexFormat::octahedral_normals_bit
+const uint OCTAHEDRAL_NORMALS_BIT = 1u;
+
+uniform uint vertexFlags;
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  // unfold lower hemisphere
+  float t = max(-v.z, 0.0);
+  v.x += v.x >= 0.0 ? -t : t;
+  v.y += v.y >= 0.0 ? -t : t;
+  return normalize(v);
+}
+
+// normal or tangent
+vec3 decodeDirection(vec4 v) {
+  if ((vertexFlags & OCTAHEDRAL_NORMALS_BIT) != 0u) {
+    return decodeOctahedral(v.xy);
+  }
+  return v.xyz;
+}
+
+vec3 decodePosition(vec3 offset, vec3 scale) {
+  return offset + scale * vPosition.xyz;
+}
@@ -0,0 +1,99 @@
+// software virtual texturing of VirtualTextureCache
+
+// same layout as tables of VirtualTextureCache
+layout(std430, binding = 2) readonly buffer VirtualTextureBuffer {
+  // page size, padded page size, page border, pages per side of physical
+  // texture
+  uvec4 virtualTextureParams;
+  // resolution, number of levels, first level of each texture
+  uvec4 virtualTextures[];
+};
+
+layout(std430, binding = 3) readonly buffer VirtualLevelBuffer {
+  // pages per side, first entry of each level
+  uvec4 virtualLevels[];
+};
+
+layout(std430, binding = 4) readonly buffer VirtualEntryBuffer {
+  // slot(bits 0-15) and level(bits 16-19) of resident page covering each
+  // page, bit 31 is set if the entry is valid
+  uint virtualEntries[];
+};
+
+layout(binding = 9) uniform sampler2D physicalTexture;
+
+// VirtualTextureCache::getFeedbackLodBias in feedback pass
+uniform float virtualTextureLodBias;
+
+const uint VIRTUAL_ENTRY_VALID_BIT = 0x80000000u;
+// cleared value of feedback
+const uint NO_VIRTUAL_TEXTURE_FEEDBACK = 0xffffffffu;
+
+uvec2 getVirtualLevelResolution(uint id, uint level) {
+  return max(virtualTextures[id].xy >> level, uvec2(1));
+}
+
+// level of detail from screen space derivatives, without trilinear blending
+uint getVirtualLevel(uint id, vec2 texCoords) {
+  vec2 resolution = vec2(virtualTextures[id].xy);
+  vec2 dx = dFdx(texCoords) * resolution;
+  vec2 dy = dFdy(texCoords) * resolution;
+  float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) +
+              virtualTextureLodBias;
+  float nLevels = float(virtualTextures[id].z);
+  return uint(clamp(lod, 0.0, nLevels - 1.0));
+}
+
+// page of level containing wrapped texture coordinates
+uvec2 getVirtualPage(uint id, uint level, vec2 uv) {
+  uvec4 levelData = virtualLevels[virtualTextures[id].w + level];
+  vec2 texel = uv * vec2(getVirtualLevelResolution(id, level));
+  uvec2 page = uvec2(texel) / virtualTextureParams.x;
+  return min(page, levelData.xy - 1u);
+}
+
+// value written to feedback buffer, same layout as page keys of
+// VirtualTextureCache
+uint packVirtualTextureFeedback(uint id, vec2 texCoords) {
+  uint level = getVirtualLevel(id, texCoords);
+  uvec2 page = getVirtualPage(id, level, fract(texCoords));
+  return (id << 22) | (level << 18) | (page.y << 9) | page.x;
+}
+
+// level of resident page sampled by sampleVirtualTexture, for debugging
+uint getResidentVirtualLevel(uint id, vec2 texCoords) {
+  uint level = getVirtualLevel(id, texCoords);
+  uvec2 page = getVirtualPage(id, level, fract(texCoords));
+  uvec4 levelData = virtualLevels[virtualTextures[id].w + level];
+  uint entry = virtualEntries[levelData.z + page.y * levelData.x + page.x];
+  return (entry >> 16) & 0xfu;
+}
+
+// bilinear sample of the finest resident page covering texture coordinates
+vec4 sampleVirtualTexture(uint id, vec2 texCoords) {
+  uint level = getVirtualLevel(id, texCoords);
+  vec2 uv = fract(texCoords);
+  uvec2 page = getVirtualPage(id, level, uv);
+  uvec4 levelData = virtualLevels[virtualTextures[id].w + level];
+  uint entry = virtualEntries[levelData.z + page.y * levelData.x + page.x];
+  if ((entry & VIRTUAL_ENTRY_VALID_BIT) == 0u) { return vec4(0.0); }
+
+  // resident page may be coarser than the requested one
+  uint slot = entry & 0xffffu;
+  uint residentLevel = (entry >> 16) & 0xfu;
+  uvec4 residentLevelData =
+      virtualLevels[virtualTextures[id].w + residentLevel];
+  float pageSize = float(virtualTextureParams.x);
+  vec2 texel = uv * vec2(getVirtualLevelResolution(id, residentLevel));
+  vec2 residentPage =
+      min(floor(texel / pageSize), vec2(residentLevelData.xy - 1u));
+  vec2 texelInPage = texel - residentPage * pageSize;
+
+  uint nPages = virtualTextureParams.w;
+  vec2 slotOrigin = vec2(slot % nPages, slot / nPages) *
+                    float(virtualTextureParams.y);
+  vec2 physicalCoords =
+      (slotOrigin + float(virtualTextureParams.z) + texelInPage) /
+      vec2(textureSize(physicalTexture, 0));
+  return textureLod(physicalTexture, physicalCoords, 0.0);
+}
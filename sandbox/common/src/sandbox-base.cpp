@@ -47,6 +47,9 @@ void SandboxBase::initGlad()
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         throw std::runtime_error("failed to initialize glad");
     }
+    // extensions which glad is generated without
+    ogls::loadBindlessTexture((GLADloadproc)glfwGetProcAddress);
+    ogls::loadParallelShaderCompile((GLADloadproc)glfwGetProcAddress);
 }
 
 void SandboxBase::initImGui()
@@ -78,7 +81,7 @@ void SandboxBase::framebufferSizeCallback(GLFWwindow *window, int width,
 {
     this->width = width;
     this->height = height;
-    glViewport(0, 0, width, height);
+    ogls::GLState::setViewport(0, 0, width, height);
 }
 
 void SandboxBase::framebufferSizeCallbackStatic(GLFWwindow *window, int width,
@@ -110,6 +113,16 @@ void SandboxBase::debugMessageCallback(GLenum source, GLenum type, GLuint id,
     }
 }
 
+void SandboxBase::showModelLoadProgress()
+{
+    if (model_load.getStatus() != ogls::ModelLoadStatus::Loading) { return; }
+
+    ImGui::ProgressBar(model_load.getProgress());
+    ImGui::SameLine();
+    if (ImGui::Button("Cancel")) { model_load.cancel(); }
+    ImGui::InputFloat("Upload Budget [ms]", &upload_budget_ms);
+}
+
 void SandboxBase::release()
 {
     ImGui_ImplOpenGL3_Shutdown();
@@ -123,23 +136,64 @@ void SandboxBase::run()
 {
     beforeRender();
 
+    // shaders of beforeRender may still be compiling
+    bool startup_pending = true;
+
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        // attach shaders compiled in the background, and compile shaders
+        // which changed on disk
+        shader_watcher.update();
+        if (ogls::Pipeline::updatePending() == 0 && startup_pending) {
+            const ogls::ProgramCache::Stats& program_stats =
+                ogls::ProgramCache::getStats();
+            spdlog::info("[SandboxBase] program cache: {} hits, {} misses "
+                         "({} rejected), saved {:.1f} ms",
+                         program_stats.n_hits, program_stats.n_misses,
+                         program_stats.n_rejected, program_stats.saved_time);
+            startup_pending = false;
+        }
+
         // start imgui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // regions of frame data are reused after GPU finished them
+        scene.beginFrame();
+
+        uniform_stats = ogls::Pipeline::getUniformStats();
+        ogls::Pipeline::resetUniformStats();
+        state_stats = ogls::GLState::getStats();
+        ogls::GLState::resetStats();
+
         runImGui();
 
         handleInput();
 
+        // upload resources of model loading
+        scene.update(upload_budget_ms);
+
+        scene.selectLods(camera, height, lod_pixel_error);
+        if (meshlet_culling) {
+            scene.cullMeshlets(camera, width, height, backface_culling);
+        } else {
+            scene.resetCulling();
+        }
+
+        // camera block read by shaders of all passes
+        scene.setCamera(camera, width, height);
+
+        ogls::GLState::apply(render_state);
         render();
+        scene.endFrame();
 
         // render imgui
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // imgui sets state without GLState
+        ogls::GLState::invalidate();
 
         glfwSwapBuffers(window);
     }
@@ -29,6 +29,34 @@ class SandboxBase
     ogls::Camera camera;
     ogls::Scene scene;
 
+    // asynchronous model loading
+    ogls::ModelLoadHandle model_load;
+    float upload_budget_ms = 4.0f;
+
+    // projected error of simplification allowed when selecting levels of
+    // detail[pixel]
+    float lod_pixel_error = 1.0f;
+
+    // cull meshlets by the camera before rendering
+    bool meshlet_culling = true;
+    // GL_CULL_FACE is enabled, so meshlets facing away from the camera are
+    // culled too
+    bool backface_culling = false;
+
+    // GL calls of setUniform in the last frame
+    ogls::Pipeline::UniformStats uniform_stats;
+
+    // fixed function state applied before render()
+    ogls::RenderState render_state;
+    // state changes issued and skipped by GLState in the last frame
+    ogls::GLState::Stats state_stats;
+
+    // pipelines are compiled again when their shader files are saved
+    ogls::ShaderWatcher shader_watcher;
+
+    // show progress bar and cancel button of model loading
+    void showModelLoadProgress();
+
    private:
     void initGlfw();
     void initGlad();
@@ -0,0 +1,17 @@
+#version 460 core
+
+in VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoords;
+  vec3 tangent;
+  vec3 dndu;
+  vec3 dndv;
+} fs_in;
+
+out vec4 fragColor;
+
+// drawn while the other shaders compile, cheap enough to compile at once
+void main() {
+  fragColor = vec4(0.5 * normalize(fs_in.normal) + 0.5, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+vec3 computeLayerColor(int layerType, Material material, vec3 position,
+                       vec3 normal, vec2 texCoords, vec3 tangent, vec3 dndu,
+                       vec3 dndv) {
+  vec3 color = vec3(0);
+
+  if(layerType == 0) {
+    color = position;
+  }
+  else if(layerType == 1) {
+    color = 0.5 * normal + 0.5;
+  }
+  else if(layerType == 2) {
+    color = vec3(texCoords, 0.0);
+  }
+  else if(layerType == 3) {
+    color = 0.5 * tangent + 0.5;
+  }
+  else if(layerType == 4) {
+    color = 0.5 * dndu + 0.5;
+  }
+  else if(layerType == 5) {
+    color = 0.5 * dndv + 0.5;
+  }
+  else if(layerType == 6) {
+    color = sampleMaterialMap(material, DIFFUSE_MAP, texCoords).xyz +
+            material.kd;
+    // gamma correction
+    color = pow(color, vec3(1.0 / 2.2));
+  }
+  else if(layerType == 7) {
+    color = sampleMaterialMap(material, SPECULAR_MAP, texCoords).xyz +
+            material.ks;
+  }
+  else if(layerType == 8) {
+    color = sampleMaterialMap(material, AMBIENT_MAP, texCoords).xyz +
+            material.ka;
+    // gamma correction
+    color = pow(color, vec3(1.0 / 2.2));
+  }
+  else if(layerType == 9) {
+    color = sampleMaterialMap(material, EMISSIVE_MAP, texCoords).xyz +
+            material.ke;
+    // gamma correction
+    color = pow(color, vec3(1.0 / 2.2));
+  }
+  else if(layerType == 10) {
+    color = sampleMaterialMap(material, HEIGHT_MAP, texCoords).xxx;
+  }
+  else if(layerType == 11) {
+    color = 0.5 * sampleNormalMap(material, texCoords) + 0.5;
+  }
+  else if(layerType == 12) {
+    color = sampleMaterialMap(material, SHININESS_MAP, texCoords).xxx;
+  }
+  else if(layerType == 13) {
+    color = sampleMaterialMap(material, DISPLACEMENT_MAP, texCoords).xxx;
+  }
+  else if(layerType == 14) {
+    color = sampleMaterialMap(material, LIGHT_MAP, texCoords).xyz;
+  }
+
+  return color;
+}
\ No newline at end of file
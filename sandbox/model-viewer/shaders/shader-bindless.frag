@@ -0,0 +1,30 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : enable
+#define BINDLESS_MATERIAL_TEXTURES
+#include ../../common/shaders/material-buffer.glsl
+#include layers.glsl
+
+in VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoords;
+  vec3 tangent;
+  vec3 dndu;
+  vec3 dndv;
+  flat uint materialID;
+} fs_in;
+
+out vec4 fragColor;
+
+uniform int layerType;
+
+void main() {
+  // textures are referenced by material, nothing is bound per draw
+  Material material = getMaterial(fs_in.materialID);
+
+  vec3 color = computeLayerColor(layerType, material, fs_in.position,
+                                 fs_in.normal, fs_in.texCoords, fs_in.tangent,
+                                 fs_in.dndu, fs_in.dndv);
+
+  fragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 460 core
+#include ../../common/shaders/material-buffer.glsl
+#include layers.glsl
+
+in VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoords;
+  vec3 tangent;
+  vec3 dndu;
+  vec3 dndv;
+  flat uint materialID;
+} fs_in;
+
+out vec4 fragColor;
+
+uniform int layerType;
+
+void main() {
+  Material material = getMaterial(fs_in.materialID);
+
+  vec3 color = computeLayerColor(layerType, material, fs_in.position,
+                                 fs_in.normal, fs_in.texCoords, fs_in.tangent,
+                                 fs_in.dndu, fs_in.dndv);
+
+  fragColor = vec4(color, 1.0);
+}
\ No newline at end of file
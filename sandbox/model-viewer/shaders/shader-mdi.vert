@@ -0,0 +1,33 @@
+#version 460 core
+#include ../../common/shaders/vertex.glsl
+#include ../../common/shaders/draw-buffer.glsl
+#include ../../common/shaders/camera.glsl
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+out VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoords;
+  vec3 tangent;
+  vec3 dndu;
+  vec3 dndv;
+  flat uint materialID;
+} vs_out;
+
+void main() {
+  // base instance of indirect draw command is index of draw data
+  DrawData draw = draws[gl_BaseInstance];
+
+  vec3 position =
+      decodePosition(draw.positionOffset.xyz, draw.positionScale.xyz);
+  gl_Position = viewProjection * vec4(position, 1.0);
+  vs_out.position = position;
+  vs_out.normal = decodeDirection(vNormal);
+  vs_out.texCoords = vTexCoords;
+  vs_out.tangent = decodeDirection(vTangent);
+  vs_out.dndu = vDndu.xyz;
+  vs_out.dndv = vDndv.xyz;
+  vs_out.materialID = draw.materialID;
+}
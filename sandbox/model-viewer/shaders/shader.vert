@@ -1,10 +1,6 @@
 #version 460 core
-layout (location = 0) in vec3 vPosition;
-layout (location = 1) in vec3 vNormal;
-layout (location = 2) in vec2 vTexCoords;
-layout (location = 3) in vec3 vTangent;
-layout (location = 4) in vec3 vDndu;
-layout (location = 5) in vec3 vDndv;
+#include ../../common/shaders/vertex.glsl
+#include ../../common/shaders/camera.glsl
 
 out gl_PerVertex {
   vec4 gl_Position;
@@ -18,15 +14,17 @@ out VS_OUT {
   vec3 dndv;
 } vs_out;
 
-uniform mat4 view;
-uniform mat4 projection;
+// dequantization transform of mesh
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main() {
-  gl_Position = projection * view * vec4(vPosition, 1.0);
-  vs_out.position = vPosition;
-  vs_out.normal = vNormal;
+  vec3 position = decodePosition(positionOffset, positionScale);
+  gl_Position = viewProjection * vec4(position, 1.0);
+  vs_out.position = position;
+  vs_out.normal = decodeDirection(vNormal);
   vs_out.texCoords = vTexCoords;
-  vs_out.tangent = vTangent;
-  vs_out.dndu = vDndu;
-  vs_out.dndv = vDndv;
-}
\ No newline at end of file
+  vs_out.tangent = decodeDirection(vTangent);
+  vs_out.dndu = vDndu.xyz;
+  vs_out.dndv = vDndv.xyz;
+}
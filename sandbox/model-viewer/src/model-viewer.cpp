@@ -1,4 +1,6 @@
 #include <filesystem>
+#include <future>
+#include <optional>
 
 #include "sandbox-base.hpp"
 
@@ -31,15 +33,37 @@ class ModelViewer : public SandboxBase
 
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
-        pipeline.loadVertexShader(
+        fallback_pipeline.loadVertexShader(
             std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
             "shaders/shader.vert");
-        pipeline.loadFragmentShader(
+        fallback_pipeline.loadFragmentShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/fallback.frag");
+
+        // compiled in parallel while fallback_pipeline is drawn
+        pipeline.setFallback(&fallback_pipeline);
+        pipeline.loadVertexShaderAsync(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.vert");
+        pipeline.loadFragmentShaderAsync(
             std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
             "shaders/shader.frag");
+
+        mdi_pipeline.loadVertexShaderAsync(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader-mdi.vert");
+        mdi_pipeline.loadFragmentShaderAsync(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader-mdi.frag");
+
+        bindless_pipeline.loadVertexShaderAsync(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader-mdi.vert");
+        bindless_pipeline.loadFragmentShaderAsync(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader-bindless.frag");
     }
 
     void runImGui() override
@@ -48,9 +72,37 @@ class ModelViewer : public SandboxBase
 
         static char modelPath[100] = {"assets/sponza/sponza.obj"};
         ImGui::InputText("Model", modelPath, 100);
+        ImGui::Checkbox("Quantized Positions",
+                        &vertexFormat.quantized_positions);
+        ImGui::Checkbox("Packed Normals", &vertexFormat.packed_normals);
+        ImGui::Checkbox("Half TexCoords", &vertexFormat.half_texcoords);
+        ImGui::Checkbox("Normal Derivatives", &vertexFormat.normal_derivatives);
+        ImGui::Combo("Geometry Retention",
+                     reinterpret_cast<int *>(&geometryRetention),
+                     "None\0Positions And Indices\0All\0\0");
+        ImGui::Checkbox("Compress Textures", &compressTextures);
         if (ImGui::Button("Load Model")) {
-            scene.setModel({std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+            model_load = scene.setModelAsync(
+                std::string(CMAKE_SOURCE_DIR) + "/" + modelPath, vertexFormat,
+                geometryRetention,
+                compressTextures ? ogls::TextureCompression::BCn
+                                 : ogls::TextureCompression::None);
         }
+        showModelLoadProgress();
+
+        const ogls::Model &model = scene.getModel();
+        const ogls::Model::GeometrySize size = model.getGeometrySize();
+        ImGui::Text("Vertex Stride: %d bytes",
+                    model.getVertexFormat().getStride());
+        ImGui::Text(
+            "Geometry: %.1f MB (saved %.1f MB)",
+            (size.vertex_bytes + size.index_bytes) / (1024.0f * 1024.0f),
+            size.getSavedBytes() / (1024.0f * 1024.0f));
+        ImGui::Text("Retained Geometry: %.1f MB, RSS: %.1f MB",
+                    model.getRetainedGeometrySize() / (1024.0f * 1024.0f),
+                    ogls::getResidentSetSize() / (1024.0f * 1024.0f));
+
+        showTangentFrameBenchmark(modelPath);
 
         ImGui::Separator();
 
@@ -68,9 +120,144 @@ class ModelViewer : public SandboxBase
             "ecular\0Ambient\0Emis"
             "sive\0Height\0NormalMap\0Shininess\0Displacement\0Light\0\0");
 
+        ImGui::Combo("Draw Mode", reinterpret_cast<int *>(&drawMode),
+                     "Per Mesh\0Multi Draw Indirect\0Bindless\0\0");
+        if (pipeline.isPending() || mdi_pipeline.isPending() ||
+            bindless_pipeline.isPending()) {
+            ImGui::Text("  compiling shaders...");
+        }
+        if (drawMode == ogls::DrawMode::Bindless) {
+            ImGui::Text("  material textures: %s",
+                        ogls::MaterialTextureTable::getDefaultBackend() ==
+                                ogls::MaterialTextureTable::Backend::
+                                    BindlessHandles
+                            ? "bindless handles"
+                            : "texture arrays");
+        }
+
+        bool filteringChanged = false;
+        filteringChanged |= ImGui::SliderFloat("Max Anisotropy", &maxAnisotropy,
+                                               1.0f, 16.0f);
+        filteringChanged |= ImGui::SliderFloat(
+            "Texture LOD Bias", &textureLodBias, -4.0f, 4.0f);
+        if (filteringChanged) {
+            model.setTextureFiltering(maxAnisotropy, textureLodBias);
+        }
+
+        ImGui::SliderFloat("LOD Pixel Error", &lod_pixel_error, 0.0f, 16.0f);
+        ImGui::Text("Triangles: %d / %d", model.getNumberOfSelectedFaces(),
+                    model.getNumberOfFaces());
+
+        ImGui::Checkbox("Meshlet Culling", &meshlet_culling);
+        if (ImGui::Checkbox("Backface Culling", &backface_culling)) {
+            render_state = ogls::RenderState::Builder(render_state)
+                               .setCullFace(backface_culling ? GL_BACK
+                                                             : GL_NONE)
+                               .build();
+        }
+        const ogls::Model::CullStats &cullStats = model.getCullStats();
+        ImGui::Text("Meshlets: %zu, frustum culled: %zu, backface culled: %zu",
+                    cullStats.n_meshlets, cullStats.n_frustum_culled,
+                    cullStats.n_backface_culled);
+        ImGui::Text("  culled triangles: %.1f %%, culling: %.2f ms",
+                    100.0f * cullStats.getCulledTriangleRatio(),
+                    cullStats.cull_time);
+        ImGui::Text("Frame Time: %.2f ms", 1000.0f / io->Framerate);
+
+        ImGui::Separator();
+
+        showArenaStats("Vertex Arena",
+                       scene.getGeometryArena()->getVertexStats());
+        showArenaStats("Index Arena",
+                       scene.getGeometryArena()->getIndexStats());
+
+        const ogls::TextureCache::Stats textureStats =
+            scene.getTextureCache()->getStats();
+        ImGui::Text("Texture Cache: %zu textures, %zu hits, %zu misses",
+                    textureStats.n_entries, textureStats.n_hits,
+                    textureStats.n_misses);
+        ImGui::Text("  hit rate: %.1f %%", 100.0f * textureStats.getHitRate());
+
+        const ogls::ProgramCache::Stats &programStats =
+            ogls::ProgramCache::getStats();
+        ImGui::Text("Program Cache: %zu hits, %zu misses (%zu rejected)",
+                    programStats.n_hits, programStats.n_misses,
+                    programStats.n_rejected);
+        ImGui::Text("  hit rate: %.1f %%, compile: %.1f ms, load: %.1f ms, "
+                    "saved: %.1f ms",
+                    100.0f * programStats.getHitRate(),
+                    programStats.compile_time, programStats.load_time,
+                    programStats.saved_time);
+        const ogls::ShaderSourceCache::Stats &sourceStats =
+            ogls::ShaderSourceCache::getStats();
+        const ogls::ShaderWatcher::Stats &watcherStats =
+            shader_watcher.getStats();
+        ImGui::Text("Shader Sources: %zu reads, %zu hits, %zu reloads",
+                    sourceStats.n_reads, sourceStats.n_hits,
+                    watcherStats.n_reloaded_pipelines);
+
+        const ogls::RingBuffer::Stats &frameStats =
+            scene.getFrameData().getStats();
+        ImGui::Text("Frame Data: %.1f KB (peak %.1f KB), failed: %zu",
+                    frameStats.frame_bytes / 1024.0f,
+                    frameStats.peak_frame_bytes / 1024.0f,
+                    frameStats.n_failed_allocations);
+        ImGui::Text("  fence waits: %zu / %zu frames, %.2f ms",
+                    frameStats.n_fence_waits, frameStats.n_frames,
+                    frameStats.fence_wait_time);
+        ImGui::Text("Uniform GL Calls: %zu (%zu without reflection), "
+                    "%zu setUniform",
+                    uniform_stats.n_uniform_writes,
+                    uniform_stats.n_broadcast_calls,
+                    uniform_stats.n_set_uniform);
+        ImGui::Text("GL State Calls: %zu, elided: %zu", state_stats.n_issued,
+                    state_stats.n_elided);
+
         ImGui::End();
     }
 
+    void showTangentFrameBenchmark(const char *modelPath)
+    {
+        if (tangentFrameBenchmark.valid()) {
+            if (tangentFrameBenchmark.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready) {
+                tangentFrameResult = tangentFrameBenchmark.get();
+            } else {
+                ImGui::Text("Benchmarking tangent frames...");
+                return;
+            }
+        }
+
+        // import runs on a worker thread, it takes seconds for large models
+        if (ImGui::Button("Benchmark Tangent Frames")) {
+            const std::filesystem::path filepath =
+                std::string(CMAKE_SOURCE_DIR) + "/" + modelPath;
+            tangentFrameBenchmark =
+                ogls::ThreadPool::getGlobal().submit([filepath]() {
+                    return ogls::Model::benchmarkTangentFrames(filepath);
+                });
+        }
+
+        if (tangentFrameResult) {
+            ImGui::Text("  %zu triangles, assimp: %.1f ms, generator: %.1f "
+                        "ms (%zu threads)",
+                        tangentFrameResult->n_triangles,
+                        tangentFrameResult->assimp_time,
+                        tangentFrameResult->generator_time,
+                        tangentFrameResult->n_threads);
+        }
+    }
+
+    static void showArenaStats(const char* label,
+                               const ogls::RangeAllocator::Stats& stats)
+    {
+        ImGui::Text("%s: %.1f / %.1f MB, %zu allocations", label,
+                    stats.used / (1024.0f * 1024.0f),
+                    stats.capacity / (1024.0f * 1024.0f), stats.n_allocations);
+        ImGui::Text("  free blocks: %zu, fragmentation: %.1f %%",
+                    stats.n_free_blocks, 100.0f * stats.getFragmentation());
+    }
+
     void handleInput() override
     {
         // close application
@@ -100,19 +287,44 @@ class ModelViewer : public SandboxBase
 
     void render() override
     {
+        const ogls::Pipeline *active_pipeline =
+            drawMode == ogls::DrawMode::MultiDrawIndirect ? &mdi_pipeline
+            : drawMode == ogls::DrawMode::Bindless        ? &bindless_pipeline
+                                                          : &pipeline;
+        ogls::DrawMode activeDrawMode = drawMode;
+        // pipelines of other draw modes have no fallback of the same inputs
+        if (!active_pipeline->isReady()) {
+            active_pipeline = &pipeline;
+            activeDrawMode = ogls::DrawMode::PerMesh;
+        }
+
         // set uniform variables
-        pipeline.setUniform("view", camera.computeViewMatrix());
-        pipeline.setUniform("projection",
-                            camera.computeProjectionMatrix(width, height));
-        pipeline.setUniform("layerType", static_cast<GLint>(layerType));
+        active_pipeline->setUniform("layerType",
+                                    static_cast<GLint>(layerType));
 
         // render
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        scene.draw(pipeline);
+        scene.draw(*active_pipeline, activeDrawMode);
     }
 
+    // normals drawn while pipeline is compiling
+    ogls::Pipeline fallback_pipeline;
     ogls::Pipeline pipeline;
+    // pipeline which reads materials from shader storage buffer
+    ogls::Pipeline mdi_pipeline;
+    // pipeline which reads texture references from material buffer
+    ogls::Pipeline bindless_pipeline;
     LayerType layerType = LayerType::Normal;
+    ogls::DrawMode drawMode = ogls::DrawMode::PerMesh;
+    ogls::VertexFormat vertexFormat;
+    ogls::GeometryRetention geometryRetention = ogls::GeometryRetention::All;
+    bool compressTextures = true;
+    float maxAnisotropy = ogls::Model::default_max_anisotropy;
+    float textureLodBias = 0.0f;
+
+    std::future<std::optional<ogls::Model::TangentFrameBenchmark>>
+        tangentFrameBenchmark;
+    std::optional<ogls::Model::TangentFrameBenchmark> tangentFrameResult;
 };
 
 }  // namespace sandbox
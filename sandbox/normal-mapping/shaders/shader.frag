@@ -10,7 +10,6 @@ in VS_OUT {
 
 out vec4 fragColor;
 
-uniform vec3 camPos;
 uniform bool useNormalMap;
 uniform bool showNormal;
 
@@ -28,11 +27,11 @@ void main() {
   // compute normal
   vec3 n = fs_in.normal;
   if(useNormalMap) {
-    n = normalize(fs_in.TBN * (2.0 * texture(normalMap, fs_in.texCoords).xyz - 1.0));
+    n = normalize(fs_in.TBN * sampleNormalMap(fs_in.texCoords));
   }
 
   // view direction
-  vec3 viewDir = normalize(camPos - fs_in.position);
+  vec3 viewDir = normalize(cameraPosition - fs_in.position);
 
   vec3 kd = texture(diffuseMap, fs_in.texCoords).xyz + material.kd;
   vec3 ks = texture(specularMap, fs_in.texCoords).xyz + material.ks;
@@ -1,4 +1,5 @@
 #version 460 core
+#include ../../common/shaders/camera.glsl
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vTexCoords;
@@ -14,11 +15,8 @@ out VS_OUT {
   mat3 TBN;
 } vs_out;
 
-uniform mat4 view;
-uniform mat4 projection;
-
 void main() {
-  gl_Position = projection * view * vec4(vPosition, 1.0);
+  gl_Position = viewProjection * vec4(vPosition, 1.0);
 
   // compute T, B, N
   vec3 T = vTangent;
@@ -15,8 +15,7 @@ class NormalMapping : public SandboxBase
    private:
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
         scene.setPointLight(
             {glm::vec3(1.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f});
@@ -37,9 +36,10 @@ class NormalMapping : public SandboxBase
                 "assets/normalmap_test/normalmap_test.obj"};
             ImGui::InputText("Model", modelPath, 100);
             if (ImGui::Button("Load Model")) {
-                scene.setModel(
-                    {std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+                model_load = scene.setModelAsync(
+                    std::string(CMAKE_SOURCE_DIR) + "/" + modelPath);
             }
+            showModelLoadProgress();
 
             ImGui::Separator();
 
@@ -87,10 +87,6 @@ class NormalMapping : public SandboxBase
     void render() override
     {
         // set uniform variables
-        pipeline.setUniform("view", camera.computeViewMatrix());
-        pipeline.setUniform("projection",
-                            camera.computeProjectionMatrix(width, height));
-        pipeline.setUniform("camPos", camera.cam_pos);
         pipeline.setUniform("useNormalMap", use_normal_map);
         pipeline.setUniform("showNormal", show_normal);
 
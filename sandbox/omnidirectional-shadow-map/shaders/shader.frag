@@ -9,7 +9,6 @@ in VS_OUT {
 
 out vec4 fragColor;
 
-uniform vec3 camPos;
 uniform float shadowBias;
 uniform samplerCube shadowMap;
 uniform float zFar;
@@ -33,7 +32,7 @@ float shadowMapping(in vec3 position) {
 
 void main() {
   // view direction
-  vec3 viewDir = normalize(camPos - fs_in.position);
+  vec3 viewDir = normalize(cameraPosition - fs_in.position);
 
   vec3 kd = texture(diffuseMap, fs_in.texCoords).xyz + material.kd;
   vec3 ks = texture(specularMap, fs_in.texCoords).xyz + material.ks;
@@ -1,4 +1,5 @@
 #version 460 core
+#include ../../common/shaders/camera.glsl
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vTexCoords;
@@ -13,8 +14,6 @@ out VS_OUT {
   vec2 texCoords;
 } vs_out;
 
-uniform mat4 viewProjection;
-
 void main() {
   gl_Position = viewProjection * vec4(vPosition, 1.0);
   vs_out.position = vPosition;
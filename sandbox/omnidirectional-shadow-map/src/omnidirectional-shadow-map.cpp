@@ -22,6 +22,7 @@ int WIDTH = 1600;
 int HEIGHT = 900;
 int SHADOW_MAP_RES = 1024;
 float SHADOW_BIAS = 10.0f;
+float UPLOAD_BUDGET_MS = 4.0f;
 
 void handleInput(GLFWwindow *window, const ImGuiIO &io)
 {
@@ -100,16 +101,16 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
-    // enable depth test
-    glEnable(GL_DEPTH_TEST);
-    // enable MSAA
-    glEnable(GL_MULTISAMPLE);
+    // state of the camera pass
+    const RenderState render_state =
+        RenderState::Builder().setDepthTest(true).build();
 
     // initialize camera
     CAMERA = std::make_unique<Camera>();
 
     // setup scene
     Scene scene;
+    scene.init();
     scene.setPointLight({glm::vec3(10000.0f), glm::vec3(0, 100.0f, 0), 0.0f});
 
     // setup shader
@@ -124,6 +125,7 @@ int main()
 
     // app loop
     float t = 0.0f;
+    ModelLoadHandle model_load;
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
@@ -138,7 +140,14 @@ int main()
         static char modelPath[100] = {"assets/sponza/sponza.obj"};
         ImGui::InputText("Model", modelPath, 100);
         if (ImGui::Button("Load Model")) {
-            scene.setModel({std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+            model_load = scene.setModelAsync(std::string(CMAKE_SOURCE_DIR) +
+                                             "/" + modelPath);
+        }
+        if (model_load.getStatus() == ModelLoadStatus::Loading) {
+            ImGui::ProgressBar(model_load.getProgress());
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) { model_load.cancel(); }
+            ImGui::InputFloat("Upload Budget [ms]", &UPLOAD_BUDGET_MS);
         }
 
         ImGui::Separator();
@@ -160,6 +169,9 @@ int main()
 
         handleInput(window, io);
 
+        // upload resources of model loading
+        scene.update(UPLOAD_BUDGET_MS);
+
         // move point light
         t += io.DeltaTime;
 
@@ -174,23 +186,24 @@ int main()
 
         // render scene with shadow mapping
         // set uniforms
-        pipeline.setUniform("viewProjection",
-                            CAMERA->computeViewProjectionMatrix(WIDTH, HEIGHT));
-        pipeline.setUniform("camPos", CAMERA->cam_pos);
+        scene.setCamera(*CAMERA, WIDTH, HEIGHT);
         pipeline.setUniform("shadowBias", SHADOW_BIAS);
         // TODO: set texture unit number appropriately
-        glBindTextureUnit(10, shadowMap.cubemap);
+        GLState::bindTextureUnit(10, shadowMap.cubemap);
         pipeline.setUniform("shadowMap", 10);
         pipeline.setUniform("zFar", shadowMap.zFar);
 
         // render
-        glViewport(0, 0, WIDTH, HEIGHT);
+        GLState::setViewport(0, 0, WIDTH, HEIGHT);
+        GLState::apply(render_state);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         scene.draw(pipeline);
 
         // render imgui
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // imgui sets state without GLState
+        GLState::invalidate();
 
         glfwSwapBuffers(window);
     }
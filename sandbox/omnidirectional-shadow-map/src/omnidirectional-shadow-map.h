@@ -22,6 +22,12 @@ class OmnidirectionalShadowMap
   GLuint cubemap;
 
   Pipeline pipeline;
+  // depth pass state, faces are not culled like in the camera pass
+  const RenderState render_state =
+      RenderState::Builder().setDepthTest(true).build();
+
+  // shadows don't need as much detail as the camera view
+  static constexpr uint32_t shadow_lod_bias = 1;
 
   OmnidirectionalShadowMap(int width, int height)
       : width(width), height(height), zNear(0.1f), zFar(10000.0f)
@@ -53,17 +59,19 @@ class OmnidirectionalShadowMap
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
     // attach shadow map texture to FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GLState::bindFramebuffer(FBO);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubemap, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
   }
 
   void destroy()
   {
+    GLState::forgetTexture(cubemap);
     glDeleteTextures(1, &cubemap);
+    GLState::forgetFramebuffer(FBO);
     glDeleteFramebuffers(1, &FBO);
   }
 
@@ -88,10 +96,10 @@ class OmnidirectionalShadowMap
   void draw(const Scene& scene) const
   {
     // render to shadow map
-    glViewport(0, 0, width, height);
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GLState::setViewport(0, 0, width, height);
+    GLState::apply(render_state);
+    GLState::bindFramebuffer(FBO);
     glClear(GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);  // prevent peter panning
 
     // set uniforms
     const glm::mat4 projection = glm::perspective(
@@ -131,9 +139,9 @@ class OmnidirectionalShadowMap
     pipeline.setUniform("zFar", zFar);
 
     // render
-    scene.draw(pipeline);
+    // meshlets culled by camera may cast shadows
+    scene.draw(pipeline, DrawMode::PerMesh, shadow_lod_bias, CullMode::None);
 
-    glCullFace(GL_BACK);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(0);
   }
 };
\ No newline at end of file
@@ -8,7 +8,6 @@ in vec4 positionLightSpace;
 
 out vec4 fragColor;
 
-uniform vec3 camPos;
 uniform sampler2DShadow depthMap;
 uniform float depthBias;
 
@@ -75,7 +74,7 @@ float testShadow(in vec4 positionLightSpace) {
 
 void main() {
   // view direction
-  vec3 viewDir = normalize(camPos - position);
+  vec3 viewDir = normalize(cameraPosition - position);
 
   vec3 kd = texture(diffuseMap, texCoords).xyz + material.kd;
   vec3 ks = texture(specularMap, texCoords).xyz + material.ks;
@@ -1,4 +1,5 @@
 #version 460 core
+#include ../../common/shaders/camera.glsl
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vTexCoords;
@@ -12,7 +13,6 @@ out vec3 normal;
 out vec2 texCoords;
 out vec4 positionLightSpace;
 
-uniform mat4 viewProjection;
 uniform mat4 lightSpaceMatrix;
 
 void main() {
@@ -12,6 +12,12 @@ class DepthMap
   ogls::Texture texture;
   ogls::FrameBuffer fbo;
   ogls::Pipeline pipeline;
+  // depth pass state, faces are not culled like in the camera pass
+  const ogls::RenderState render_state =
+      ogls::RenderState::Builder().setDepthTest(true).build();
+
+  // shadows don't need as much detail as the camera view
+  static constexpr uint32_t shadow_lod_bias = 1;
 
  public:
   DepthMap(int width, int height)
@@ -63,12 +69,13 @@ class DepthMap
   void draw(const ogls::Scene& scene) const
   {
     // render to depth map
-    glViewport(0, 0, width, height);
+    ogls::GLState::setViewport(0, 0, width, height);
+    ogls::GLState::apply(render_state);
     fbo.activate();
     glClear(GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);  // prevent peter panning
-    scene.draw(pipeline);
-    glCullFace(GL_BACK);
+    // meshlets culled by camera may cast shadows
+    scene.draw(pipeline, ogls::DrawMode::PerMesh, shadow_lod_bias,
+               ogls::CullMode::None);
     fbo.deactivate();
   }
 };
\ No newline at end of file
@@ -17,8 +17,7 @@ class ShadowMap : public SandboxBase
    private:
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
         scene.setDirectionalLight(
             {glm::vec3(1.0f), glm::normalize(glm::vec3(0.5f, 1.0f, 0.5f))});
@@ -45,8 +44,10 @@ class ShadowMap : public SandboxBase
         static char modelPath[100] = {"assets/sponza/sponza.obj"};
         ImGui::InputText("Model", modelPath, 100);
         if (ImGui::Button("Load Model")) {
-            scene.setModel({std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+            model_load = scene.setModelAsync(std::string(CMAKE_SOURCE_DIR) +
+                                             "/" + modelPath);
         }
+        showModelLoadProgress();
 
         ImGui::Separator();
 
@@ -118,25 +119,23 @@ class ShadowMap : public SandboxBase
 
         // make depth map
         depth_map.draw(scene);
+        ogls::GLState::apply(render_state);
 
         // render scene with shadow mapping
         // set uniforms
-        pipeline.setUniform("viewProjection",
-                            camera.computeViewProjectionMatrix(width, height));
         pipeline.setUniform("lightSpaceMatrix", lightSpaceMatrix);
-        pipeline.setUniform("camPos", camera.cam_pos);
         // TODO: set texture unit number appropriately
         depth_map.getTextureRef().bindToTextureUnit(10);
         pipeline.setUniform("depthMap", 10);
         pipeline.setUniform("depthBias", depth_bias);
 
         // render
-        glViewport(0, 0, width, height);
+        ogls::GLState::setViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         scene.draw(pipeline);
 
         // show depth map
-        glViewport(width - 256, height - 256, 256, 256);
+        ogls::GLState::setViewport(width - 256, height - 256, 256, 256);
         glClear(GL_DEPTH_BUFFER_BIT);
         depth_map.getTextureRef().bindToTextureUnit(10);
         show_depthmap_pipeline.setUniform("depthMap", 10);
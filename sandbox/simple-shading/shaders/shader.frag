@@ -7,8 +7,6 @@ in vec2 texCoords;
 
 out vec4 fragColor;
 
-uniform vec3 camPos;
-
 // Blinn-Phong reflection model
 vec3 blinnPhong(in vec3 viewDir, in vec3 normal, in vec3 lightDir, in vec3 kd, in vec3 ks, in float shininess) {
   vec3 diffuse = max(dot(lightDir, normal), 0.0) * kd;
@@ -21,7 +19,7 @@ vec3 blinnPhong(in vec3 viewDir, in vec3 normal, in vec3 lightDir, in vec3 kd, i
 
 void main() {
   // view direction
-  vec3 viewDir = normalize(camPos - position);
+  vec3 viewDir = normalize(cameraPosition - position);
 
   vec3 kd = texture(diffuseMap, texCoords).xyz + material.kd;
   vec3 ks = texture(specularMap, texCoords).xyz + material.ks;
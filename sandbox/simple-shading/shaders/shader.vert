@@ -1,4 +1,5 @@
 #version 460 core
+#include ../../common/shaders/camera.glsl
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vTexCoords;
@@ -10,11 +11,8 @@ out vec3 position;
 out vec3 normal;
 out vec2 texCoords;
 
-uniform mat4 view;
-uniform mat4 projection;
-
 void main() {
-  gl_Position = projection * view * vec4(vPosition, 1.0);
+  gl_Position = viewProjection * vec4(vPosition, 1.0);
   position = vPosition;
   normal = vNormal;
   texCoords = vTexCoords;
@@ -15,8 +15,7 @@ class SimpleShading : public SandboxBase
    private:
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
         scene.setPointLight(
             {glm::vec3(10000.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f});
@@ -36,8 +35,10 @@ class SimpleShading : public SandboxBase
         static char modelPath[100] = {"assets/sponza/sponza.obj"};
         ImGui::InputText("Model", modelPath, 100);
         if (ImGui::Button("Load Model")) {
-            scene.setModel({std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+            model_load = scene.setModelAsync(std::string(CMAKE_SOURCE_DIR) +
+                                             "/" + modelPath);
         }
+        showModelLoadProgress();
 
         ImGui::InputFloat("FOV", &camera.fov);
         ImGui::InputFloat("Movement Speed", &camera.movement_speed);
@@ -84,12 +85,6 @@ class SimpleShading : public SandboxBase
              glm::vec3(100.0f * std::cos(t), 100.0f, 100.0f * std::sin(t)),
              0.0f});
 
-        // set uniform variables
-        pipeline.setUniform("view", camera.computeViewMatrix());
-        pipeline.setUniform("projection",
-                            camera.computeProjectionMatrix(width, height));
-        pipeline.setUniform("camPos", camera.cam_pos);
-
         // render
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         scene.draw(pipeline);
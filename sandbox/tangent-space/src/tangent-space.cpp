@@ -14,8 +14,7 @@ class TangentSpace : public SandboxBase
    private:
     void beforeRender() override
     {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
 
         pipeline.loadVertexShader(
             std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
@@ -42,9 +41,10 @@ class TangentSpace : public SandboxBase
             static char modelPath[100] = {"assets/sponza/sponza.obj"};
             ImGui::InputText("Model", modelPath, 100);
             if (ImGui::Button("Load Model")) {
-                scene.setModel(
-                    {std::string(CMAKE_SOURCE_DIR) + "/" + modelPath});
+                model_load = scene.setModelAsync(
+                    std::string(CMAKE_SOURCE_DIR) + "/" + modelPath);
             }
+            showModelLoadProgress();
 
             ImGui::Separator();
 
@@ -91,13 +91,6 @@ class TangentSpace : public SandboxBase
     void render() override
     {
         // set uniform variables
-        const glm::mat4 view = camera.computeViewMatrix();
-        const glm::mat4 projection =
-            camera.computeProjectionMatrix(width, height);
-        pipeline.setUniform("view", view);
-        pipeline.setUniform("projection", projection);
-        tangent_space_pipeline.setUniform("view", view);
-        tangent_space_pipeline.setUniform("projection", projection);
         tangent_space_pipeline.setUniform("lineLength", line_length);
 
         // render
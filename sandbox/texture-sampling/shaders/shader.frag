@@ -0,0 +1,15 @@
+#version 460 core
+in vec2 texCoords;
+
+out vec4 fragColor;
+
+layout(binding = 0) uniform sampler2D image;
+
+void main() {
+  vec3 color = texture(image, texCoords).xyz;
+
+  // gamma correction
+  color = pow(color, vec3(1.0 / 2.2));
+
+  fragColor = vec4(color, 1.0);
+}
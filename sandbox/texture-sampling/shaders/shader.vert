@@ -0,0 +1,21 @@
+#version 460 core
+#include ../../common/shaders/camera.glsl
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec2 vTexCoords;
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+out vec2 texCoords;
+
+// half size of the ground plane
+uniform float extent;
+// repeats of texture over the plane
+uniform float repeat;
+
+void main() {
+  // unit quad on xy plane is laid on the ground below the camera
+  vec3 position = vec3(extent * vPosition.x, -1.0, extent * vPosition.y);
+  gl_Position = viewProjection * vec4(position, 1.0);
+  texCoords = repeat * vTexCoords;
+}
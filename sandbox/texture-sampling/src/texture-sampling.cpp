@@ -0,0 +1,295 @@
+#include <array>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include "sandbox-base.hpp"
+
+namespace sandbox
+{
+
+// measure cost of sampling a minified texture on a ground plane receding to
+// the horizon, with and without mipmaps and anisotropic filtering
+class TextureSampling : public SandboxBase
+{
+   public:
+    TextureSampling(uint32_t width, uint32_t height)
+        : SandboxBase(width, height)
+    {
+    }
+
+    ~TextureSampling()
+    {
+        // GL context is destroyed by SandboxBase
+        glDeleteQueries(n_queries, time_queries.data());
+        glDeleteQueries(n_queries, sample_queries.data());
+    }
+
+   private:
+    struct Settings {
+        const char *name;
+        bool mipmaps;
+        float max_anisotropy;
+    };
+
+    // settings compared by the benchmark
+    static constexpr std::array<Settings, 3> presets = {{
+        {"Single Level", false, 1.0f},
+        {"Mip Chain", true, 1.0f},
+        {"Mip Chain + 16x Anisotropy", true, 16.0f},
+    }};
+
+    struct Result {
+        float gpu_ms = 0.0f;
+        float frame_ms = 0.0f;
+        uint64_t n_fragments = 0;
+
+        // textured fragments per second[G/s]
+        float getFillRate() const
+        {
+            return gpu_ms > 0.0f ? n_fragments / (gpu_ms * 1e6f) : 0.0f;
+        }
+    };
+
+    static constexpr uint32_t image_size = 2048;
+    // queries are read some frames later to avoid stalling
+    static constexpr std::size_t n_queries = 4;
+    static constexpr uint32_t n_warmup_frames = 30;
+    static constexpr uint32_t n_measured_frames = 120;
+
+    void beforeRender() override
+    {
+        // layers of the same depth are drawn on top of each other
+        render_state = ogls::RenderState::Builder()
+                           .setDepthTest(true)
+                           .setDepthFunc(GL_LEQUAL)
+                           .build();
+
+        image = createImage();
+        createTexture();
+
+        glCreateQueries(GL_TIME_ELAPSED, n_queries, time_queries.data());
+        glCreateQueries(GL_SAMPLES_PASSED, n_queries, sample_queries.data());
+
+        pipeline.loadVertexShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.vert");
+        pipeline.loadFragmentShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.frag");
+    }
+
+    void runImGui() override
+    {
+        ImGui::Begin("UI");
+
+        bool changed = false;
+        changed |= ImGui::Checkbox("Mipmaps", &settings.mipmaps);
+        changed |= ImGui::SliderFloat("Max Anisotropy",
+                                      &settings.max_anisotropy, 1.0f, 16.0f);
+        changed |= ImGui::SliderFloat("LOD Bias", &lod_bias, -4.0f, 4.0f);
+        if (changed && benchmark_preset < 0) { createTexture(); }
+
+        ImGui::SliderInt("Layers", &n_layers, 1, 32);
+        ImGui::SliderFloat("Repeat", &repeat, 1.0f, 2000.0f);
+
+        ImGui::Text("Levels: %d", texture.getNumberOfLevels());
+        ImGui::Text("GPU Time: %.3f ms, Frame Time: %.3f ms", current.gpu_ms,
+                    current.frame_ms);
+        ImGui::Text("Fragments: %llu, Fill Rate: %.2f G/s",
+                    static_cast<unsigned long long>(current.n_fragments),
+                    current.getFillRate());
+
+        ImGui::Separator();
+
+        if (benchmark_preset >= 0) {
+            ImGui::Text("Running %s...", presets[benchmark_preset].name);
+        } else if (ImGui::Button("Run Benchmark")) {
+            startPreset(0);
+        }
+        for (std::size_t i = 0; i < presets.size(); ++i) {
+            if (results[i].gpu_ms == 0.0f) { continue; }
+            ImGui::Text("%s: GPU %.3f ms, Frame %.3f ms, %.2f G/s",
+                        presets[i].name, results[i].gpu_ms,
+                        results[i].frame_ms, results[i].getFillRate());
+        }
+
+        ImGui::Separator();
+
+        ImGui::InputFloat("FOV", &camera.fov);
+        ImGui::InputFloat("Movement Speed", &camera.movement_speed);
+        ImGui::InputFloat("Look Around Speed", &camera.look_around_speed);
+
+        if (ImGui::Button("Reset Camera")) { camera.reset(); }
+
+        ImGui::End();
+    }
+
+    void handleInput() override
+    {
+        // close application
+        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+
+        // camera movement
+        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::FORWARD, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::LEFT, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::BACKWARD, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::RIGHT, io->DeltaTime);
+        }
+
+        // camera look around
+        if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+            camera.lookAround(io->MouseDelta.x, io->MouseDelta.y);
+        }
+    }
+
+    void render() override
+    {
+        pipeline.setUniform("extent", 1000.0f);
+        pipeline.setUniform("repeat", repeat);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // layers are drawn on top of each other, so that every layer is
+        // shaded and sampling dominates the frame
+        const std::size_t query = frame % n_queries;
+        glBeginQuery(GL_TIME_ELAPSED, time_queries[query]);
+        glBeginQuery(GL_SAMPLES_PASSED, sample_queries[query]);
+        texture.bindToTextureUnit(0);
+        for (int i = 0; i < n_layers; ++i) { quad.draw(pipeline); }
+        glEndQuery(GL_SAMPLES_PASSED);
+        glEndQuery(GL_TIME_ELAPSED);
+
+        // read the oldest queries, which are done by now
+        if (frame + 1 >= n_queries) {
+            const std::size_t oldest = (frame + 1) % n_queries;
+            GLuint64 elapsed = 0;
+            GLuint64 n_samples = 0;
+            glGetQueryObjectui64v(time_queries[oldest], GL_QUERY_RESULT,
+                                  &elapsed);
+            glGetQueryObjectui64v(sample_queries[oldest], GL_QUERY_RESULT,
+                                  &n_samples);
+            updateResult(elapsed * 1e-6f, io->DeltaTime * 1e3f, n_samples);
+        }
+        frame++;
+    }
+
+    // noisy checkerboard, which aliases badly without mipmaps
+    static std::vector<uint8_t> createImage()
+    {
+        std::mt19937 rng(0);
+        std::uniform_int_distribution<int> noise(0, 63);
+
+        std::vector<uint8_t> ret(3 * image_size * image_size);
+        for (uint32_t y = 0; y < image_size; ++y) {
+            for (uint32_t x = 0; x < image_size; ++x) {
+                const bool checker = ((x / 16) + (y / 16)) % 2 == 0;
+                uint8_t *p = &ret[3 * (y * image_size + x)];
+                p[0] = (checker ? 192 : 32) + noise(rng);
+                p[1] = (checker ? 160 : 64) + noise(rng);
+                p[2] = (checker ? 96 : 128) + noise(rng);
+            }
+        }
+        return ret;
+    }
+
+    void createTexture()
+    {
+        texture = ogls::Texture::TextureBuilder(glm::vec2(image_size))
+                      .setInternalFormat(GL_SRGB8)
+                      .setMagFilter(GL_LINEAR)
+                      .setMinFilter(settings.mipmaps ? GL_LINEAR_MIPMAP_LINEAR
+                                                     : GL_LINEAR)
+                      .setGenerateMipmap(settings.mipmaps)
+                      .setMaxAnisotropy(settings.max_anisotropy)
+                      .setLodBias(lod_bias)
+                      .setImage(image.data())
+                      .build();
+    }
+
+    void startPreset(int preset)
+    {
+        benchmark_preset = preset;
+        benchmark_frame = 0;
+        benchmark_sum = Result();
+        settings = presets[preset];
+        createTexture();
+    }
+
+    void updateResult(float gpu_ms, float frame_ms, uint64_t n_fragments)
+    {
+        // smoothed values shown in UI
+        constexpr float alpha = 0.05f;
+        current.gpu_ms += alpha * (gpu_ms - current.gpu_ms);
+        current.frame_ms += alpha * (frame_ms - current.frame_ms);
+        current.n_fragments = n_fragments;
+
+        if (benchmark_preset < 0) { return; }
+
+        // queries of frames before the switch are still in flight
+        benchmark_frame++;
+        if (benchmark_frame <= n_warmup_frames) { return; }
+
+        benchmark_sum.gpu_ms += gpu_ms;
+        benchmark_sum.frame_ms += frame_ms;
+        benchmark_sum.n_fragments += n_fragments;
+        if (benchmark_frame < n_warmup_frames + n_measured_frames) { return; }
+
+        Result &result = results[benchmark_preset];
+        result.gpu_ms = benchmark_sum.gpu_ms / n_measured_frames;
+        result.frame_ms = benchmark_sum.frame_ms / n_measured_frames;
+        result.n_fragments = benchmark_sum.n_fragments / n_measured_frames;
+        spdlog::info(
+            "[TextureSampling] {}: GPU {:.3f} ms, frame {:.3f} ms, {} "
+            "fragments, {:.2f} G/s",
+            presets[benchmark_preset].name, result.gpu_ms, result.frame_ms,
+            result.n_fragments, result.getFillRate());
+
+        if (benchmark_preset + 1 < static_cast<int>(presets.size())) {
+            startPreset(benchmark_preset + 1);
+        } else {
+            benchmark_preset = -1;
+        }
+    }
+
+    ogls::Pipeline pipeline;
+    ogls::Quad quad;
+    ogls::Texture texture;
+    std::vector<uint8_t> image;
+
+    Settings settings = presets[1];
+    float lod_bias = 0.0f;
+    int n_layers = 8;
+    float repeat = 1000.0f;
+
+    std::array<GLuint, n_queries> time_queries{};
+    std::array<GLuint, n_queries> sample_queries{};
+    std::size_t frame = 0;
+    Result current;
+
+    // index of preset being measured, -1 if benchmark is not running
+    int benchmark_preset = -1;
+    uint32_t benchmark_frame = 0;
+    Result benchmark_sum;
+    std::array<Result, presets.size()> results;
+};
+
+}  // namespace sandbox
+
+int main()
+{
+    sandbox::TextureSampling app(1280, 720);
+
+    app.run();
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#version 460 core
+#include ../../common/shaders/virtual-texture.glsl
+
+in VS_OUT {
+  vec3 normal;
+  vec2 texCoords;
+} fs_in;
+
+layout(location = 0) out uint feedback;
+
+// index of diffuse map in VirtualTextureCache, -1 if it's not virtual
+uniform int diffuseVirtualTexture;
+
+void main() {
+  // meshes without virtual textures still occlude the ones behind them
+  feedback = diffuseVirtualTexture < 0
+                 ? NO_VIRTUAL_TEXTURE_FEEDBACK
+                 : packVirtualTextureFeedback(uint(diffuseVirtualTexture),
+                                              fs_in.texCoords);
+}
@@ -0,0 +1,40 @@
+#version 460 core
+#include ../../common/shaders/uniforms.glsl
+#include ../../common/shaders/virtual-texture.glsl
+
+in VS_OUT {
+  vec3 normal;
+  vec2 texCoords;
+} fs_in;
+
+out vec4 fragColor;
+
+// index of diffuse map in VirtualTextureCache, -1 if it's not virtual
+uniform int diffuseVirtualTexture;
+// tint by the level of resident pages
+uniform bool showResidentLevels;
+
+const vec3 levelColors[6] = vec3[](vec3(1.0, 0.2, 0.2), vec3(1.0, 0.6, 0.2),
+                                   vec3(1.0, 1.0, 0.2), vec3(0.2, 1.0, 0.2),
+                                   vec3(0.2, 0.6, 1.0), vec3(0.6, 0.2, 1.0));
+
+void main() {
+  vec3 kd = material.kd;
+  if (diffuseVirtualTexture >= 0) {
+    uint id = uint(diffuseVirtualTexture);
+    kd += sampleVirtualTexture(id, fs_in.texCoords).xyz;
+    if (showResidentLevels) {
+      uint level = getResidentVirtualLevel(id, fs_in.texCoords);
+      kd *= levelColors[min(level, 5u)];
+    }
+  } else {
+    kd += texture(diffuseMap, fs_in.texCoords).xyz;
+  }
+
+  // fixed light from above, so that geometry is readable
+  vec3 normal = normalize(fs_in.normal);
+  float diffuse = max(dot(normal, normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  vec3 color = kd * (0.3 + 0.7 * diffuse);
+
+  fragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 460 core
+#include ../../common/shaders/vertex.glsl
+#include ../../common/shaders/camera.glsl
+
+out gl_PerVertex {
+  vec4 gl_Position;
+};
+out VS_OUT {
+  vec3 normal;
+  vec2 texCoords;
+} vs_out;
+
+// dequantization transform of mesh
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+void main() {
+  vec3 position = decodePosition(positionOffset, positionScale);
+  gl_Position = viewProjection * vec4(position, 1.0);
+  vs_out.normal = decodeDirection(vNormal);
+  vs_out.texCoords = vTexCoords;
+}
@@ -0,0 +1,178 @@
+#include <filesystem>
+#include <memory>
+
+#include "sandbox-base.hpp"
+
+namespace sandbox
+{
+
+class VirtualTexturing : public SandboxBase
+{
+   public:
+    VirtualTexturing(uint32_t width, uint32_t height)
+        : SandboxBase(width, height)
+    {
+    }
+
+   private:
+    void beforeRender() override
+    {
+        render_state = ogls::RenderState::Builder().setDepthTest(true).build();
+
+        pipeline.loadVertexShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.vert");
+        pipeline.loadFragmentShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.frag");
+
+        feedback_pipeline.loadVertexShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/shader.vert");
+        feedback_pipeline.loadFragmentShader(
+            std::filesystem::path(CMAKE_CURRENT_SOURCE_DIR) /
+            "shaders/feedback.frag");
+
+        cache = std::make_unique<ogls::VirtualTextureCache>(
+            GL_SRGB8, static_cast<uint32_t>(physicalPages));
+    }
+
+    void runImGui() override
+    {
+        ImGui::Begin("UI");
+
+        static char modelPath[100] = {"assets/sponza/sponza.obj"};
+        ImGui::InputText("Model", modelPath, 100);
+        // the physical texture is recreated on load
+        ImGui::SliderInt("Physical Pages Per Side", &physicalPages, 4, 64);
+        if (ImGui::Button("Load Model")) {
+            loadModel(std::filesystem::path(CMAKE_SOURCE_DIR) / modelPath);
+        }
+
+        ImGui::Separator();
+
+        ImGui::InputFloat("FOV", &camera.fov);
+        ImGui::InputFloat("Movement Speed", &camera.movement_speed);
+        ImGui::InputFloat("Look Around Speed", &camera.look_around_speed);
+
+        if (ImGui::Button("Reset Camera")) { camera.reset(); }
+
+        ImGui::Separator();
+
+        ImGui::SliderInt("Feedback Downscale", &feedbackDownscale, 1, 16);
+        ImGui::SliderFloat("Feedback LOD Bias", &feedbackLodBias, -2.0f,
+                           2.0f);
+        int maxUploads = static_cast<int>(cache->max_uploads_per_frame);
+        if (ImGui::SliderInt("Max Uploads Per Frame", &maxUploads, 1, 64)) {
+            cache->max_uploads_per_frame = maxUploads;
+        }
+        int maxPending = static_cast<int>(cache->max_pending_pages);
+        if (ImGui::SliderInt("Max Pending Pages", &maxPending, 1, 256)) {
+            cache->max_pending_pages = maxPending;
+        }
+        ImGui::Checkbox("Show Resident Levels", &showResidentLevels);
+
+        const ogls::VirtualTextureCache::Stats& stats = cache->getStats();
+        ImGui::Text("Virtual Textures: %zu", stats.n_textures);
+        ImGui::Text("Resident Pages: %zu / %zu", stats.n_resident_pages,
+                    stats.n_physical_pages);
+        ImGui::Text("Requested: %zu, pending: %zu", stats.n_requested_pages,
+                    stats.n_pending_pages);
+        ImGui::Text("Uploaded: %zu, evicted: %zu", stats.n_uploaded_pages,
+                    stats.n_evicted_pages);
+        ImGui::Text("Texture Memory: %.1f MB (virtual %.1f MB)",
+                    stats.physical_bytes / (1024.0f * 1024.0f),
+                    stats.virtual_bytes / (1024.0f * 1024.0f));
+        ImGui::Text("Frame Time: %.2f ms", 1000.0f / io->Framerate);
+
+        ImGui::End();
+    }
+
+    void loadModel(const std::filesystem::path& filepath)
+    {
+        // model refers to textures of the previous cache
+        scene.setModel(ogls::Model());
+        cache = std::make_unique<ogls::VirtualTextureCache>(
+            GL_SRGB8, static_cast<uint32_t>(physicalPages));
+
+        ogls::Model model(scene.getGeometryArena());
+        model.loadModel(filepath, ogls::TextureCompression::BCn, cache.get(),
+                        scene.getTextureCache().get());
+        scene.setModel(std::move(model));
+    }
+
+    void handleInput() override
+    {
+        // close application
+        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+
+        // camera movement
+        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::FORWARD, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::LEFT, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::BACKWARD, io->DeltaTime);
+        }
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+            camera.move(ogls::CameraMovement::RIGHT, io->DeltaTime);
+        }
+
+        // camera look around
+        if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+            camera.lookAround(io->MouseDelta.x, io->MouseDelta.y);
+        }
+    }
+
+    void render() override
+    {
+        // feedback of pages seen by the camera, read back by a later update
+        const glm::uvec2 resolution(width, height);
+        const glm::uvec2 feedbackResolution = glm::max(
+            resolution / static_cast<uint32_t>(feedbackDownscale),
+            glm::uvec2(1));
+        cache->beginFeedback(feedbackResolution);
+        feedback_pipeline.setUniform(
+            "virtualTextureLodBias",
+            cache->getFeedbackLodBias(resolution) + feedbackLodBias);
+        scene.draw(feedback_pipeline);
+        cache->endFeedback();
+
+        // stream pages and update indirection tables
+        cache->update();
+        cache->bind();
+
+        // set uniform variables
+        pipeline.setUniform("virtualTextureLodBias", 0.0f);
+        pipeline.setUniform("showResidentLevels", showResidentLevels);
+
+        // render
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.draw(pipeline);
+    }
+
+    ogls::Pipeline pipeline;
+    // pipeline which writes requested pages instead of colors
+    ogls::Pipeline feedback_pipeline;
+    std::unique_ptr<ogls::VirtualTextureCache> cache;
+    int physicalPages = 32;
+    int feedbackDownscale = 8;
+    // positive bias requests coarser pages than the ones sampled
+    float feedbackLodBias = 0.0f;
+    bool showResidentLevels = false;
+};
+
+}  // namespace sandbox
+
+int main()
+{
+    sandbox::VirtualTexturing app(1280, 720);
+
+    app.run();
+
+    return 0;
+}
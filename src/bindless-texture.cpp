@@ -0,0 +1,82 @@
+#include "bindless-texture.hpp"
+
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+using GetTextureSamplerHandleProc = GLuint64(APIENTRYP)(GLuint, GLuint);
+using MakeTextureHandleResidentProc = void(APIENTRYP)(GLuint64);
+using MakeTextureHandleNonResidentProc = void(APIENTRYP)(GLuint64);
+
+GetTextureSamplerHandleProc get_texture_sampler_handle = nullptr;
+MakeTextureHandleResidentProc make_texture_handle_resident = nullptr;
+MakeTextureHandleNonResidentProc make_texture_handle_non_resident = nullptr;
+
+bool hasExtension(const char* name)
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i) {
+        const char* extension = reinterpret_cast<const char*>(
+            glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension && std::strcmp(extension, name) == 0) { return true; }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool loadBindlessTexture(GLADloadproc load)
+{
+    get_texture_sampler_handle = nullptr;
+    make_texture_handle_resident = nullptr;
+    make_texture_handle_non_resident = nullptr;
+    if (!hasExtension("GL_ARB_bindless_texture")) {
+        spdlog::info("[BindlessTexture] ARB_bindless_texture is not supported");
+        return false;
+    }
+
+    get_texture_sampler_handle = reinterpret_cast<GetTextureSamplerHandleProc>(
+        load("glGetTextureSamplerHandleARB"));
+    make_texture_handle_resident =
+        reinterpret_cast<MakeTextureHandleResidentProc>(
+            load("glMakeTextureHandleResidentARB"));
+    make_texture_handle_non_resident =
+        reinterpret_cast<MakeTextureHandleNonResidentProc>(
+            load("glMakeTextureHandleNonResidentARB"));
+    if (!isBindlessTextureSupported()) {
+        spdlog::warn("[BindlessTexture] failed to load ARB_bindless_texture");
+        get_texture_sampler_handle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool isBindlessTextureSupported()
+{
+    return get_texture_sampler_handle && make_texture_handle_resident &&
+           make_texture_handle_non_resident;
+}
+
+GLuint64 getTextureSamplerHandle(GLuint texture, GLuint sampler)
+{
+    return get_texture_sampler_handle(texture, sampler);
+}
+
+void makeTextureHandleResident(GLuint64 handle)
+{
+    make_texture_handle_resident(handle);
+}
+
+void makeTextureHandleNonResident(GLuint64 handle)
+{
+    make_texture_handle_non_resident(handle);
+}
+
+}  // namespace ogls
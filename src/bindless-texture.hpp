@@ -0,0 +1,23 @@
+#pragma once
+#include "glad/glad.h"
+
+namespace ogls
+{
+
+// entry points of ARB_bindless_texture, which glad of this repo is generated
+// without
+// loadBindlessTexture should be called after gladLoadGLLoader with the same
+// loader, the other functions must not be called if it returns false
+
+// returns whether the extension is supported by the current context
+bool loadBindlessTexture(GLADloadproc load);
+bool isBindlessTextureSupported();
+
+// handle of texture sampled with the state of sampler
+// state of both objects can't be changed after a handle is created
+GLuint64 getTextureSamplerHandle(GLuint texture, GLuint sampler);
+// handles must be resident while shaders sample them
+void makeTextureHandleResident(GLuint64 handle);
+void makeTextureHandleNonResident(GLuint64 handle);
+
+}  // namespace ogls
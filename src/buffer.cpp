@@ -44,7 +44,40 @@ GLuint Buffer::getName() const { return buffer; }
 
 uint32_t Buffer::getLength() const { return size; }
 
+void Buffer::bindToUniformBuffer(GLuint binding_point_index) const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding_point_index, buffer);
+}
+
+void Buffer::bindRangeToUniformBuffer(GLuint binding_point_index,
+                                      std::size_t offset,
+                                      std::size_t size) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding_point_index, buffer, offset,
+                      size);
+}
+
 void Buffer::bindToShaderStorageBuffer(GLuint binding_point_index) const
 {
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding_point_index, buffer);
-}
\ No newline at end of file
+}
+
+void Buffer::bindToDrawIndirectBuffer() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+}
+
+void Buffer::unbindFromDrawIndirectBuffer() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Buffer::bindToPixelPackBuffer() const
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+}
+
+void Buffer::unbindFromPixelPackBuffer() const
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
@@ -43,7 +43,37 @@ class Buffer
         this->size = data.size();
     }
 
+    // allocate immutable storage, the buffer can't be resized after this
+    template <typename T>
+    void setStorage(const T* data, uint32_t n, GLbitfield flags)
+    {
+        glNamedBufferStorage(this->buffer, sizeof(T) * n, data, flags);
+        this->size = n;
+    }
+
+    // overwrite n elements from element offset, the buffer is not resized
+    template <typename T>
+    void setSubData(const T* data, uint32_t offset, uint32_t n)
+    {
+        glNamedBufferSubData(this->buffer, sizeof(T) * offset, sizeof(T) * n,
+                             data);
+    }
+
+    void bindToUniformBuffer(GLuint binding_point_index) const;
+    // bind size bytes from offset, offset must be a multiple of
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    void bindRangeToUniformBuffer(GLuint binding_point_index,
+                                  std::size_t offset, std::size_t size) const;
+
     void bindToShaderStorageBuffer(GLuint binding_point_index) const;
+
+    // source of glMultiDrawElementsIndirect commands
+    void bindToDrawIndirectBuffer() const;
+    void unbindFromDrawIndirectBuffer() const;
+
+    // destination of pixels read back by glGetTextureImage
+    void bindToPixelPackBuffer() const;
+    void unbindFromPixelPackBuffer() const;
 };
 
 }  // namespace ogls
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "framebuffer.hpp"
 
+#include "gl-state.hpp"
+
 using namespace ogls;
 
 FrameBuffer::FrameBuffer(const std::vector<GLenum>& attachments)
@@ -39,6 +41,7 @@ void FrameBuffer::release()
     if (framebuffer) {
         spdlog::debug("[FrameBuffer] release framebuffer {:x}", framebuffer);
 
+        GLState::forgetFramebuffer(framebuffer);
         glDeleteFramebuffers(1, &framebuffer);
         this->framebuffer = 0;
     }
@@ -63,7 +66,7 @@ void FrameBuffer::bindTexture(const Texture& texture,
 
 void FrameBuffer::activate() const
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GLState::bindFramebuffer(framebuffer);
 }
 
-void FrameBuffer::deactivate() const { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
\ No newline at end of file
+void FrameBuffer::deactivate() const { GLState::bindFramebuffer(0); }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "geometry-arena.hpp"
+
+#include <algorithm>
+
+#include "vertex-format.hpp"
+
+using namespace ogls;
+
+float RangeAllocator::Stats::getFragmentation() const
+{
+    const std::size_t free_size = capacity - used;
+    if (free_size == 0) { return 0.0f; }
+    return 1.0f - static_cast<float>(largest_free_block) / free_size;
+}
+
+RangeAllocator::RangeAllocator() : capacity{0}, used{0}, n_allocations{0} {}
+
+RangeAllocator::RangeAllocator(std::size_t capacity) : RangeAllocator()
+{
+    grow(capacity);
+}
+
+std::optional<std::size_t> RangeAllocator::allocate(std::size_t size,
+                                                    std::size_t alignment)
+{
+    for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it) {
+        const std::size_t block_offset = it->first;
+        const std::size_t block_size = it->second;
+
+        const std::size_t offset =
+            (block_offset + alignment - 1) / alignment * alignment;
+        const std::size_t padding = offset - block_offset;
+        if (padding + size > block_size) { continue; }
+
+        // split block into [padding][allocation][rest]
+        free_blocks.erase(it);
+        if (padding > 0) { free_blocks.emplace(block_offset, padding); }
+        const std::size_t rest = block_size - padding - size;
+        if (rest > 0) { free_blocks.emplace(offset + size, rest); }
+
+        used += size;
+        n_allocations++;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::free(std::size_t offset, std::size_t size)
+{
+    used -= size;
+    n_allocations--;
+
+    auto it = free_blocks.emplace(offset, size).first;
+
+    // merge with next block
+    const auto next = std::next(it);
+    if (next != free_blocks.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        free_blocks.erase(next);
+    }
+
+    // merge with previous block
+    if (it != free_blocks.begin()) {
+        const auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            free_blocks.erase(it);
+        }
+    }
+}
+
+void RangeAllocator::grow(std::size_t new_capacity)
+{
+    if (new_capacity <= capacity) { return; }
+
+    const std::size_t old_capacity = capacity;
+    capacity = new_capacity;
+
+    // account the new space as allocated, then free it to merge with the last
+    // free block
+    used += new_capacity - old_capacity;
+    n_allocations++;
+    free(old_capacity, new_capacity - old_capacity);
+}
+
+std::size_t RangeAllocator::getCapacity() const { return capacity; }
+
+RangeAllocator::Stats RangeAllocator::getStats() const
+{
+    Stats ret;
+    ret.capacity = capacity;
+    ret.used = used;
+    ret.n_allocations = n_allocations;
+    ret.n_free_blocks = free_blocks.size();
+    for (const auto& [offset, size] : free_blocks) {
+        ret.largest_free_block = std::max(ret.largest_free_block, size);
+    }
+    return ret;
+}
+
+GeometryArena::Allocation::Allocation()
+    : vertex_offset{0},
+      vertex_size{0},
+      vertex_stride{1},
+      index_offset{0},
+      index_size{0},
+      index_stride{1}
+{
+}
+
+GeometryArena::Allocation::Allocation(Allocation&& other)
+    : arena(std::move(other.arena)),
+      vertex_offset(other.vertex_offset),
+      vertex_size(other.vertex_size),
+      vertex_stride(other.vertex_stride),
+      index_offset(other.index_offset),
+      index_size(other.index_size),
+      index_stride(other.index_stride)
+{
+    other.arena = nullptr;
+}
+
+GeometryArena::Allocation::~Allocation() { release(); }
+
+GeometryArena::Allocation& GeometryArena::Allocation::operator=(
+    Allocation&& other)
+{
+    if (this != &other) {
+        release();
+
+        arena = std::move(other.arena);
+        vertex_offset = other.vertex_offset;
+        vertex_size = other.vertex_size;
+        vertex_stride = other.vertex_stride;
+        index_offset = other.index_offset;
+        index_size = other.index_size;
+        index_stride = other.index_stride;
+
+        other.arena = nullptr;
+    }
+
+    return *this;
+}
+
+GeometryArena::Allocation::operator bool() const { return arena != nullptr; }
+
+GLint GeometryArena::Allocation::getBaseVertex() const
+{
+    return vertex_offset / vertex_stride;
+}
+
+std::size_t GeometryArena::Allocation::getIndexOffset() const
+{
+    return index_offset;
+}
+
+GLuint GeometryArena::Allocation::getFirstIndex() const
+{
+    return index_offset / index_stride;
+}
+
+std::size_t GeometryArena::Allocation::getVertexSize() const
+{
+    return vertex_size;
+}
+
+std::size_t GeometryArena::Allocation::getIndexSize() const
+{
+    return index_size;
+}
+
+void GeometryArena::Allocation::release()
+{
+    if (arena) {
+        arena->free(*this);
+        arena = nullptr;
+    }
+}
+
+GeometryArena::GeometryArena(std::size_t vertex_capacity,
+                             std::size_t index_capacity)
+    : vertex_allocator(vertex_capacity), index_allocator(index_capacity)
+{
+    constexpr GLbitfield flags = GL_DYNAMIC_STORAGE_BIT;
+    vertex_buffer.setStorage<uint8_t>(nullptr, vertex_capacity, flags);
+    index_buffer.setStorage<uint8_t>(nullptr, index_capacity, flags);
+
+    getVertexArrayObject(VertexFormat());
+
+    spdlog::debug("[GeometryArena] created arena (vertex: {} bytes, index: {} "
+                  "bytes)",
+                  vertex_capacity, index_capacity);
+}
+
+std::shared_ptr<GeometryArena> GeometryArena::create(
+    std::size_t vertex_capacity, std::size_t index_capacity)
+{
+    auto ret =
+        std::make_shared<GeometryArena>(vertex_capacity, index_capacity);
+    ret->self = ret;
+    return ret;
+}
+
+GeometryArena::Allocation GeometryArena::allocate(std::size_t vertex_size,
+                                                  std::size_t vertex_stride,
+                                                  std::size_t index_size,
+                                                  std::size_t index_stride)
+{
+    Allocation ret;
+    ret.vertex_size = vertex_size;
+    ret.vertex_stride = vertex_stride;
+    ret.index_size = index_size;
+    ret.index_stride = index_stride;
+
+    // vertex offset has to be multiple of stride to use base vertex
+    auto vertex_offset = vertex_allocator.allocate(vertex_size, vertex_stride);
+    if (!vertex_offset) {
+        growBuffer(vertex_buffer, vertex_allocator,
+                   vertex_size + vertex_stride);
+        setupVertexArrayObjects();
+        vertex_offset = vertex_allocator.allocate(vertex_size, vertex_stride);
+    }
+
+    auto index_offset = index_allocator.allocate(index_size, index_stride);
+    if (!index_offset) {
+        growBuffer(index_buffer, index_allocator, index_size + index_stride);
+        setupVertexArrayObjects();
+        index_offset = index_allocator.allocate(index_size, index_stride);
+    }
+
+    ret.arena = self.lock();
+    ret.vertex_offset = vertex_offset.value();
+    ret.index_offset = index_offset.value();
+
+    return ret;
+}
+
+void GeometryArena::write(const Allocation& allocation, const void* vertices,
+                          const void* indices, StagingBuffer* staging) const
+{
+    if (!staging ||
+        !staging->copy(vertices, allocation.vertex_size,
+                       vertex_buffer.getName(), allocation.vertex_offset)) {
+        glNamedBufferSubData(vertex_buffer.getName(), allocation.vertex_offset,
+                             allocation.vertex_size, vertices);
+    }
+
+    if (!staging ||
+        !staging->copy(indices, allocation.index_size, index_buffer.getName(),
+                       allocation.index_offset)) {
+        glNamedBufferSubData(index_buffer.getName(), allocation.index_offset,
+                             allocation.index_size, indices);
+    }
+}
+
+const VertexArrayObject& GeometryArena::getVertexArrayObject(
+    const VertexFormat& format)
+{
+    auto it = vaos.find(format.getKey());
+    if (it == vaos.end()) {
+        it = vaos.emplace(format.getKey(),
+                          std::make_pair(format, VertexArrayObject()))
+                 .first;
+        const auto& [vao_format, vao] = it->second;
+        vao_format.setupVertexArrayObject(vao, vertex_buffer);
+        vao.bindElementBuffer(index_buffer);
+    }
+    return it->second.second;
+}
+
+RangeAllocator::Stats GeometryArena::getVertexStats() const
+{
+    return vertex_allocator.getStats();
+}
+
+RangeAllocator::Stats GeometryArena::getIndexStats() const
+{
+    return index_allocator.getStats();
+}
+
+void GeometryArena::free(const Allocation& allocation)
+{
+    vertex_allocator.free(allocation.vertex_offset, allocation.vertex_size);
+    index_allocator.free(allocation.index_offset, allocation.index_size);
+}
+
+void GeometryArena::growBuffer(Buffer& buffer, RangeAllocator& allocator,
+                               std::size_t required_size)
+{
+    const std::size_t old_capacity = allocator.getCapacity();
+    std::size_t new_capacity = std::max(old_capacity, std::size_t(1));
+    while (new_capacity - old_capacity < required_size) { new_capacity *= 2; }
+
+    Buffer new_buffer;
+    new_buffer.setStorage<uint8_t>(nullptr, new_capacity,
+                                   GL_DYNAMIC_STORAGE_BIT);
+    if (old_capacity > 0) {
+        glCopyNamedBufferSubData(buffer.getName(), new_buffer.getName(), 0, 0,
+                                 old_capacity);
+    }
+    buffer = std::move(new_buffer);
+    allocator.grow(new_capacity);
+
+    spdlog::debug("[GeometryArena] grow buffer {} -> {} bytes", old_capacity,
+                  new_capacity);
+}
+
+void GeometryArena::setupVertexArrayObjects()
+{
+    for (const auto& [key, value] : vaos) {
+        const auto& [format, vao] = value;
+        format.setupVertexArrayObject(vao, vertex_buffer);
+        vao.bindElementBuffer(index_buffer);
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <optional>
+
+#include "glad/glad.h"
+#include "spdlog/spdlog.h"
+//
+#include "staging-buffer.hpp"
+#include "vertex-array-object.hpp"
+#include "vertex-format.hpp"
+
+namespace ogls
+{
+
+// first-fit free list over a range of bytes
+class RangeAllocator
+{
+   public:
+    struct Stats {
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+        std::size_t n_allocations = 0;
+        std::size_t n_free_blocks = 0;
+        std::size_t largest_free_block = 0;
+
+        // 1 - largest free block / total free size
+        float getFragmentation() const;
+    };
+
+    RangeAllocator();
+    RangeAllocator(std::size_t capacity);
+
+    // returns offset of allocated range
+    std::optional<std::size_t> allocate(std::size_t size,
+                                        std::size_t alignment);
+
+    void free(std::size_t offset, std::size_t size);
+
+    // append free space at the end
+    void grow(std::size_t new_capacity);
+
+    std::size_t getCapacity() const;
+
+    Stats getStats() const;
+
+   private:
+    std::size_t capacity;
+    std::size_t used;
+    std::size_t n_allocations;
+    // offset -> size
+    std::map<std::size_t, std::size_t> free_blocks;
+};
+
+// vertex and index ranges of meshes sub-allocated from large shared buffers,
+// all of them are drawn through VAO of their VertexFormat with base vertex and
+// index offset.
+class GeometryArena
+{
+   public:
+    // vertex and index ranges, freed on destruction
+    class Allocation
+    {
+       public:
+        Allocation();
+        Allocation(const Allocation& other) = delete;
+        Allocation(Allocation&& other);
+        ~Allocation();
+
+        Allocation& operator=(const Allocation& other) = delete;
+        Allocation& operator=(Allocation&& other);
+
+        operator bool() const;
+
+        // value of basevertex of glDrawElementsBaseVertex
+        GLint getBaseVertex() const;
+        // byte offset of the first index in index buffer
+        std::size_t getIndexOffset() const;
+        // index of the first index in index buffer
+        GLuint getFirstIndex() const;
+        // allocated sizes in bytes
+        std::size_t getVertexSize() const;
+        std::size_t getIndexSize() const;
+
+       private:
+        std::shared_ptr<GeometryArena> arena;
+        std::size_t vertex_offset;
+        std::size_t vertex_size;
+        std::size_t vertex_stride;
+        std::size_t index_offset;
+        std::size_t index_size;
+        std::size_t index_stride;
+
+        void release();
+
+        friend class GeometryArena;
+    };
+
+    GeometryArena(std::size_t vertex_capacity, std::size_t index_capacity);
+    GeometryArena(const GeometryArena& other) = delete;
+    ~GeometryArena() = default;
+
+    GeometryArena& operator=(const GeometryArena& other) = delete;
+
+    // arena has to be owned by std::shared_ptr, since allocations refer it
+    static std::shared_ptr<GeometryArena> create(std::size_t vertex_capacity,
+                                                 std::size_t index_capacity);
+
+    // buffers are grown if there is not enough space
+    template <typename V, typename I>
+    Allocation allocate(std::size_t n_vertices, std::size_t n_indices)
+    {
+        return allocate(sizeof(V) * n_vertices, sizeof(V),
+                        sizeof(I) * n_indices, sizeof(I));
+    }
+
+    Allocation allocate(std::size_t vertex_size, std::size_t vertex_stride,
+                        std::size_t index_size, std::size_t index_stride);
+
+    // copy data into allocated ranges
+    // data is copied through staging buffer if it's given and has enough space
+    void write(const Allocation& allocation, const void* vertices,
+               const void* indices, StagingBuffer* staging = nullptr) const;
+
+    // VAO is created when the format is used for the first time
+    const VertexArrayObject& getVertexArrayObject(
+        const VertexFormat& format = VertexFormat());
+
+    RangeAllocator::Stats getVertexStats() const;
+    RangeAllocator::Stats getIndexStats() const;
+
+   private:
+    Buffer vertex_buffer;
+    Buffer index_buffer;
+    // VertexFormat key -> VAO
+    std::map<uint32_t, std::pair<VertexFormat, VertexArrayObject>> vaos;
+
+    RangeAllocator vertex_allocator;
+    RangeAllocator index_allocator;
+
+    std::weak_ptr<GeometryArena> self;
+
+    void free(const Allocation& allocation);
+
+    // replace buffer with larger one and copy its contents
+    static void growBuffer(Buffer& buffer, RangeAllocator& allocator,
+                           std::size_t required_size);
+
+    // bind buffers to all VAOs
+    void setupVertexArrayObjects();
+};
+
+}  // namespace ogls
@@ -0,0 +1,181 @@
+#include "gl-state.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace ogls
+{
+
+namespace
+{
+
+// std::nullopt is unknown state, set by the next call
+struct CachedState {
+    std::optional<GLuint> program_pipeline;
+    std::optional<GLuint> vertex_array;
+    std::optional<GLuint> framebuffer;
+    std::vector<std::optional<GLuint>> texture_units;
+    std::optional<glm::ivec4> viewport;
+    std::optional<RenderState> render_state;
+};
+
+CachedState cached;
+GLState::Stats stats;
+
+// true if value differs from cached, which is updated
+template <typename T>
+bool update(std::optional<T>& cached_value, const T& value)
+{
+    if (cached_value && *cached_value == value) {
+        stats.n_elided++;
+        return false;
+    }
+    cached_value = value;
+    stats.n_issued++;
+    return true;
+}
+
+// same as update, for each field of RenderState
+template <typename T>
+bool updateField(bool known, const T& cached_value, const T& value)
+{
+    if (known && cached_value == value) {
+        stats.n_elided++;
+        return false;
+    }
+    stats.n_issued++;
+    return true;
+}
+
+void setCapability(GLenum capability, bool enabled)
+{
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void forget(std::optional<GLuint>& cached_value, GLuint name)
+{
+    if (cached_value && *cached_value == name) { cached_value = 0; }
+}
+
+}  // namespace
+
+void GLState::bindProgramPipeline(GLuint pipeline)
+{
+    if (update(cached.program_pipeline, pipeline)) {
+        glBindProgramPipeline(pipeline);
+    }
+}
+
+void GLState::bindVertexArray(GLuint array)
+{
+    if (update(cached.vertex_array, array)) { glBindVertexArray(array); }
+}
+
+void GLState::bindTextureUnit(GLuint unit, GLuint texture)
+{
+    if (unit >= cached.texture_units.size()) {
+        cached.texture_units.resize(unit + 1);
+    }
+    if (update(cached.texture_units[unit], texture)) {
+        glBindTextureUnit(unit, texture);
+    }
+}
+
+void GLState::bindFramebuffer(GLuint framebuffer)
+{
+    if (update(cached.framebuffer, framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+void GLState::setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (update(cached.viewport, glm::ivec4(x, y, width, height))) {
+        glViewport(x, y, width, height);
+    }
+}
+
+glm::ivec4 GLState::getViewport()
+{
+    if (!cached.viewport) {
+        glm::ivec4 viewport;
+        glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+        cached.viewport = viewport;
+    }
+    return *cached.viewport;
+}
+
+void GLState::apply(const RenderState& state)
+{
+    const bool known = cached.render_state.has_value();
+    const RenderState current = known ? *cached.render_state : RenderState();
+
+    if (updateField(known, current.getDepthTest(), state.getDepthTest())) {
+        setCapability(GL_DEPTH_TEST, state.getDepthTest());
+    }
+    if (updateField(known, current.getDepthWrite(), state.getDepthWrite())) {
+        glDepthMask(state.getDepthWrite() ? GL_TRUE : GL_FALSE);
+    }
+    if (updateField(known, current.getDepthFunc(), state.getDepthFunc())) {
+        glDepthFunc(state.getDepthFunc());
+    }
+
+    // culled face is kept while culling is disabled
+    const bool cull = state.getCullFace() != GL_NONE;
+    if (updateField(known, current.getCullFace() != GL_NONE, cull)) {
+        setCapability(GL_CULL_FACE, cull);
+    }
+    if (cull && updateField(known && current.getCullFace() != GL_NONE,
+                            current.getCullFace(), state.getCullFace())) {
+        glCullFace(state.getCullFace());
+    }
+
+    if (updateField(known, current.getBlend(), state.getBlend())) {
+        setCapability(GL_BLEND, state.getBlend());
+    }
+    if (state.getBlend() &&
+        updateField(known && current.getBlend(),
+                    glm::uvec2(current.getBlendSrc(), current.getBlendDst()),
+                    glm::uvec2(state.getBlendSrc(), state.getBlendDst()))) {
+        glBlendFunc(state.getBlendSrc(), state.getBlendDst());
+    }
+
+    if (updateField(known, current.getMultisample(),
+                    state.getMultisample())) {
+        setCapability(GL_MULTISAMPLE, state.getMultisample());
+    }
+
+    cached.render_state = state;
+}
+
+void GLState::forgetProgramPipeline(GLuint pipeline)
+{
+    forget(cached.program_pipeline, pipeline);
+}
+
+void GLState::forgetVertexArray(GLuint array)
+{
+    forget(cached.vertex_array, array);
+}
+
+void GLState::forgetTexture(GLuint texture)
+{
+    for (auto& unit : cached.texture_units) { forget(unit, texture); }
+}
+
+void GLState::forgetFramebuffer(GLuint framebuffer)
+{
+    forget(cached.framebuffer, framebuffer);
+}
+
+void GLState::invalidate() { cached = CachedState(); }
+
+const GLState::Stats& GLState::getStats() { return stats; }
+
+void GLState::resetStats() { stats = Stats(); }
+
+}  // namespace ogls
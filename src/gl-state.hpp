@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+namespace ogls
+{
+
+// fixed function state of a pass, declared once and applied as a whole by
+// GLState::apply
+class RenderState
+{
+   public:
+    class Builder;
+
+    // initial state of a GL context
+    RenderState() = default;
+
+    bool getDepthTest() const { return depth_test; }
+    bool getDepthWrite() const { return depth_write; }
+    GLenum getDepthFunc() const { return depth_func; }
+    GLenum getCullFace() const { return cull_face; }
+    bool getBlend() const { return blend; }
+    GLenum getBlendSrc() const { return blend_src; }
+    GLenum getBlendDst() const { return blend_dst; }
+    bool getMultisample() const { return multisample; }
+
+   private:
+    bool depth_test = false;
+    bool depth_write = true;
+    GLenum depth_func = GL_LESS;
+    GLenum cull_face = GL_NONE;
+    bool blend = false;
+    GLenum blend_src = GL_ONE;
+    GLenum blend_dst = GL_ZERO;
+    bool multisample = true;
+};
+
+class RenderState::Builder
+{
+   private:
+    RenderState state;
+
+   public:
+    Builder() = default;
+    // start from the values of state
+    Builder(const RenderState& state) : state(state) {}
+
+    Builder setDepthTest(bool depth_test)
+    {
+        state.depth_test = depth_test;
+        return *this;
+    }
+
+    Builder setDepthWrite(bool depth_write)
+    {
+        state.depth_write = depth_write;
+        return *this;
+    }
+
+    Builder setDepthFunc(GLenum depth_func)
+    {
+        state.depth_func = depth_func;
+        return *this;
+    }
+
+    // GL_FRONT, GL_BACK, or GL_NONE which disables face culling
+    Builder setCullFace(GLenum cull_face)
+    {
+        state.cull_face = cull_face;
+        return *this;
+    }
+
+    // blending is enabled with the factors of glBlendFunc
+    Builder setBlend(GLenum src, GLenum dst)
+    {
+        state.blend = true;
+        state.blend_src = src;
+        state.blend_dst = dst;
+        return *this;
+    }
+
+    Builder setMultisample(bool multisample)
+    {
+        state.multisample = multisample;
+        return *this;
+    }
+
+    RenderState build() const { return state; }
+};
+
+// shadow of bindings and fixed function state of the GL context, calls which
+// don't change it are skipped
+// all code changing the tracked state has to go through this, otherwise
+// invalidate() must be called afterwards. deleted objects are forgotten by
+// their release(), since GL reuses names.
+class GLState
+{
+   public:
+    struct Stats {
+        // GL calls made
+        std::size_t n_issued = 0;
+        // calls skipped since the state was already set
+        std::size_t n_elided = 0;
+    };
+
+    static void bindProgramPipeline(GLuint pipeline);
+    static void bindVertexArray(GLuint array);
+    static void bindTextureUnit(GLuint unit, GLuint texture);
+    // binds GL_FRAMEBUFFER, 0 is the default framebuffer
+    static void bindFramebuffer(GLuint framebuffer);
+    static void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    // queried from GL if it's not known
+    static glm::ivec4 getViewport();
+
+    // set fields of state which differ from the current state
+    static void apply(const RenderState& state);
+
+    // objects are unbound by GL when deleted
+    static void forgetProgramPipeline(GLuint pipeline);
+    static void forgetVertexArray(GLuint array);
+    static void forgetTexture(GLuint texture);
+    static void forgetFramebuffer(GLuint framebuffer);
+
+    // forget all state, the next calls are issued
+    static void invalidate();
+
+    static const Stats& getStats();
+    static void resetStats();
+};
+
+}  // namespace ogls
@@ -0,0 +1,136 @@
+#include "mapped-file.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+using namespace ogls;
+
+#ifdef _WIN32
+MappedFile::MappedFile()
+    : data{nullptr}, size{0}, file_handle{nullptr}, mapping_handle{nullptr}
+{
+}
+#else
+MappedFile::MappedFile() : data{nullptr}, size{0} {}
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& filepath) : MappedFile()
+{
+#ifdef _WIN32
+    HANDLE file =
+        CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return; }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return;
+    }
+
+    const void* ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    data = static_cast<const uint8_t*>(ptr);
+    size = file_size.QuadPart;
+#else
+    const int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) { return; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping keeps the file alive
+    close(fd);
+    if (ptr == MAP_FAILED) { return; }
+
+    data = static_cast<const uint8_t*>(ptr);
+    size = st.st_size;
+#endif
+
+    spdlog::debug("[MappedFile] mapped {} ({} bytes)", filepath.string(), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) : data(other.data), size(other.size)
+{
+#ifdef _WIN32
+    file_handle = other.file_handle;
+    mapping_handle = other.mapping_handle;
+    other.file_handle = nullptr;
+    other.mapping_handle = nullptr;
+#endif
+    other.data = nullptr;
+    other.size = 0;
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other) {
+        release();
+
+        data = other.data;
+        size = other.size;
+#ifdef _WIN32
+        file_handle = other.file_handle;
+        mapping_handle = other.mapping_handle;
+        other.file_handle = nullptr;
+        other.mapping_handle = nullptr;
+#endif
+
+        other.data = nullptr;
+        other.size = 0;
+    }
+
+    return *this;
+}
+
+MappedFile::operator bool() const { return data != nullptr; }
+
+const uint8_t* MappedFile::getData() const { return data; }
+
+std::size_t MappedFile::getSize() const { return size; }
+
+void MappedFile::release()
+{
+    if (data) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        file_handle = nullptr;
+        mapping_handle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace ogls
+{
+
+// read only memory mapping of a whole file
+class MappedFile
+{
+   public:
+    MappedFile();
+    MappedFile(const std::filesystem::path& filepath);
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other);
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile& other) = delete;
+    MappedFile& operator=(MappedFile&& other);
+
+    // is file mapped?
+    operator bool() const;
+
+    const uint8_t* getData() const;
+    std::size_t getSize() const;
+
+   private:
+    const uint8_t* data;
+    std::size_t size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#endif
+
+    void release();
+};
+
+}  // namespace ogls
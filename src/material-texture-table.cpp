@@ -0,0 +1,252 @@
+#include "material-texture-table.hpp"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "bindless-texture.hpp"
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+MaterialTextureTable::MaterialTextureTable()
+    : backend{Backend::TextureArrays}
+{
+}
+
+MaterialTextureTable::MaterialTextureTable(
+    const std::vector<std::shared_ptr<Texture>>& textures, Backend backend)
+    : backend{backend}, references(textures.size(), glm::uvec2(0))
+{
+    if (backend == Backend::BindlessHandles) {
+        createHandles(textures);
+    } else {
+        createArrays(textures);
+    }
+}
+
+MaterialTextureTable::MaterialTextureTable(MaterialTextureTable&& other)
+    : backend(other.backend),
+      references(std::move(other.references)),
+      samplers(std::move(other.samplers)),
+      views(std::move(other.views)),
+      handles(std::move(other.handles)),
+      arrays(std::move(other.arrays))
+{
+    other.samplers.clear();
+    other.views.clear();
+    other.handles.clear();
+}
+
+MaterialTextureTable::~MaterialTextureTable() { release(); }
+
+MaterialTextureTable& MaterialTextureTable::operator=(
+    MaterialTextureTable&& other)
+{
+    if (this != &other) {
+        release();
+
+        backend = other.backend;
+        references = std::move(other.references);
+        samplers = std::move(other.samplers);
+        views = std::move(other.views);
+        handles = std::move(other.handles);
+        arrays = std::move(other.arrays);
+
+        other.samplers.clear();
+        other.views.clear();
+        other.handles.clear();
+    }
+
+    return *this;
+}
+
+MaterialTextureTable::Backend MaterialTextureTable::getDefaultBackend()
+{
+    return isBindlessTextureSupported() ? Backend::BindlessHandles
+                                        : Backend::TextureArrays;
+}
+
+MaterialTextureTable::Backend MaterialTextureTable::getBackend() const
+{
+    return backend;
+}
+
+glm::uvec2 MaterialTextureTable::getReference(TextureID texture_id) const
+{
+    return texture_id < references.size() ? references[texture_id]
+                                          : glm::uvec2(0);
+}
+
+void MaterialTextureTable::bind() const
+{
+    for (std::size_t i = 0; i < arrays.size(); ++i) {
+        arrays[i].bindToTextureUnit(first_array_unit + i);
+    }
+}
+
+std::size_t MaterialTextureTable::getNumberOfArrays() const
+{
+    return arrays.size();
+}
+
+void MaterialTextureTable::createHandles(
+    const std::vector<std::shared_ptr<Texture>>& textures)
+{
+    // a texture shared by several TextureIDs has one view, and one handle
+    // per sampler, which must be made resident only once
+    std::map<std::pair<float, float>, GLuint> filtering_samplers;
+    std::unordered_map<GLuint, GLuint> texture_views;
+    std::unordered_set<GLuint64> resident;
+    for (std::size_t i = 0; i < textures.size(); ++i) {
+        const auto& texture = textures[i];
+        if (!texture || !*texture) { continue; }
+
+        const std::pair<float, float> filtering = {texture->getMaxAnisotropy(),
+                                                   texture->getLodBias()};
+        auto it = filtering_samplers.find(filtering);
+        if (it == filtering_samplers.end()) {
+            GLuint sampler = 0;
+            glCreateSamplers(1, &sampler);
+            glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER,
+                                GL_LINEAR_MIPMAP_LINEAR);
+            glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY,
+                                filtering.first);
+            glSamplerParameterf(sampler, GL_TEXTURE_LOD_BIAS,
+                                filtering.second);
+            samplers.push_back(sampler);
+            it = filtering_samplers.emplace(filtering, sampler).first;
+        }
+
+        // the view shares storage of the texture, but not its parameters,
+        // so only the view is locked by the handle
+        auto view_it = texture_views.find(texture->getTextureName());
+        if (view_it == texture_views.end()) {
+            GLuint view = 0;
+            glGenTextures(1, &view);
+            glTextureView(view, GL_TEXTURE_2D, texture->getTextureName(),
+                          texture->getInternalFormat(), 0,
+                          texture->getNumberOfLevels(), 0, 1);
+            views.push_back(view);
+            view_it =
+                texture_views.emplace(texture->getTextureName(), view).first;
+        }
+
+        const GLuint64 handle =
+            getTextureSamplerHandle(view_it->second, it->second);
+        if (resident.insert(handle).second) {
+            makeTextureHandleResident(handle);
+            handles.push_back(handle);
+        }
+        references[i] = glm::uvec2(static_cast<uint32_t>(handle),
+                                   static_cast<uint32_t>(handle >> 32));
+    }
+
+    spdlog::debug("[MaterialTextureTable] made {} handles of {} views "
+                  "resident with {} samplers",
+                  handles.size(), views.size(), samplers.size());
+}
+
+void MaterialTextureTable::createArrays(
+    const std::vector<std::shared_ptr<Texture>>& textures)
+{
+    // textures can share an array if their storage is the same
+    using ArrayKey = std::tuple<uint32_t, uint32_t, GLint, GLsizei>;
+    std::map<ArrayKey, std::vector<TextureID>> groups;
+    for (std::size_t i = 0; i < textures.size(); ++i) {
+        const auto& texture = textures[i];
+        if (!texture || !*texture) { continue; }
+        const glm::uvec2 resolution = texture->getResolution();
+        groups[{resolution.x, resolution.y, texture->getInternalFormat(),
+                texture->getNumberOfLevels()}]
+            .push_back(i);
+    }
+
+    // largest groups get arrays first if there are more groups than units
+    std::vector<std::pair<ArrayKey, std::vector<TextureID>>> sorted(
+        groups.begin(), groups.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto& a, const auto& b) {
+                         return a.second.size() > b.second.size();
+                     });
+
+    GLint max_layers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    GLint max_units = 16;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+    const std::size_t max_supported_arrays = std::min<std::size_t>(
+        max_arrays, std::max<GLint>(max_units - first_array_unit, 0));
+
+    std::size_t n_dropped = 0;
+    for (const auto& [key, texture_ids] : sorted) {
+        for (std::size_t first = 0; first < texture_ids.size();
+             first += max_layers) {
+            const std::size_t n_layers =
+                std::min<std::size_t>(max_layers, texture_ids.size() - first);
+            if (arrays.size() == max_supported_arrays) {
+                n_dropped += n_layers;
+                continue;
+            }
+
+            const auto& [width, height, internal_format, levels] = key;
+            const Texture& front = *textures[texture_ids[first]];
+            Texture array =
+                Texture::TextureBuilder(glm::uvec2(width, height))
+                    .setInternalFormat(internal_format)
+                    .setMagFilter(GL_LINEAR)
+                    .setMinFilter(GL_LINEAR_MIPMAP_LINEAR)
+                    .setMaxAnisotropy(front.getMaxAnisotropy())
+                    .setLodBias(front.getLodBias())
+                    .setLevels(levels)
+                    .setLayers(n_layers)
+                    .build();
+
+            // copies stay on GPU, compressed blocks are copied as they are
+            for (std::size_t layer = 0; layer < n_layers; ++layer) {
+                const TextureID texture_id = texture_ids[first + layer];
+                const GLuint src = textures[texture_id]->getTextureName();
+                for (GLsizei level = 0; level < levels; ++level) {
+                    glCopyImageSubData(src, GL_TEXTURE_2D, level, 0, 0, 0,
+                                       array.getTextureName(),
+                                       GL_TEXTURE_2D_ARRAY, level, 0, 0,
+                                       layer, std::max(width >> level, 1u),
+                                       std::max(height >> level, 1u), 1);
+                }
+                references[texture_id] =
+                    glm::uvec2(arrays.size() + 1, layer);
+            }
+            arrays.push_back(std::move(array));
+        }
+    }
+
+    if (n_dropped > 0) {
+        spdlog::warn("[MaterialTextureTable] {} textures don't fit in {} "
+                     "texture arrays, they are treated as missing",
+                     n_dropped, max_supported_arrays);
+    }
+    spdlog::debug("[MaterialTextureTable] copied textures into {} arrays",
+                  arrays.size());
+}
+
+void MaterialTextureTable::release()
+{
+    for (const auto handle : handles) { makeTextureHandleNonResident(handle); }
+    handles.clear();
+    if (!views.empty()) {
+        glDeleteTextures(views.size(), views.data());
+        views.clear();
+    }
+    if (!samplers.empty()) {
+        glDeleteSamplers(samplers.size(), samplers.data());
+        samplers.clear();
+    }
+    arrays.clear();
+}
+
+}  // namespace ogls
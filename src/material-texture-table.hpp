@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+//
+#include "mesh.hpp"
+#include "texture.hpp"
+
+namespace ogls
+{
+
+// references to material textures stored in the material table, so that
+// shaders sample them without textures being bound per draw
+// - with ARB_bindless_texture, a reference is a 64 bit handle of a view of
+//   the texture and a sampler of the table, resident while the table is
+//   alive. creating a handle makes its texture immutable for good, so
+//   handles are made of views owned by the table, and textures shared with
+//   other models can still change their filtering. samplers repeat and
+//   filter trilinearly like textures of Model, with anisotropy and lod bias
+//   of each texture
+// - otherwise textures of same resolution, internal format and number of
+//   levels are copied into layers of 2D texture arrays, and a reference is
+//   the index of the array plus one and the layer. this doubles GPU memory
+//   of the textures, since they may be shared with other models
+// a reference of (0, 0) means the texture has no reference
+// references are layout of uvec2 textureMaps of material-buffer.glsl
+class MaterialTextureTable
+{
+   public:
+    enum class Backend {
+        BindlessHandles,
+        TextureArrays,
+    };
+
+    MaterialTextureTable();
+    // textures are indexed by TextureID, nullptr textures get no reference
+    MaterialTextureTable(const std::vector<std::shared_ptr<Texture>>& textures,
+                         Backend backend = getDefaultBackend());
+    MaterialTextureTable(const MaterialTextureTable& other) = delete;
+    MaterialTextureTable(MaterialTextureTable&& other);
+    ~MaterialTextureTable();
+
+    MaterialTextureTable& operator=(const MaterialTextureTable& other) =
+        delete;
+    MaterialTextureTable& operator=(MaterialTextureTable&& other);
+
+    // BindlessHandles if ARB_bindless_texture is loaded
+    static Backend getDefaultBackend();
+    Backend getBackend() const;
+
+    glm::uvec2 getReference(TextureID texture_id) const;
+
+    // bind texture arrays to units from first_array_unit, this does nothing
+    // for bindless handles
+    // this is called once per draw of a model instead of per mesh
+    void bind() const;
+
+    std::size_t getNumberOfArrays() const;
+
+    // units of sampler2DArray materialTextureArrays[max_arrays]
+    // GL guarantees only 16 units per stage and units below
+    // first_array_unit are taken, so the array of shaders always links
+    static constexpr GLuint first_array_unit = 10;
+    static constexpr std::size_t max_arrays = 16 - first_array_unit;
+
+   private:
+    Backend backend;
+    std::vector<glm::uvec2> references;
+
+    // samplers of handles, one for each different filtering of textures
+    std::vector<GLuint> samplers;
+    // views of textures which handles are made of, one for each texture
+    std::vector<GLuint> views;
+    std::vector<GLuint64> handles;
+
+    std::vector<Texture> arrays;
+
+    void createHandles(const std::vector<std::shared_ptr<Texture>>& textures);
+    void createArrays(const std::vector<std::shared_ptr<Texture>>& textures);
+
+    void release();
+};
+
+}  // namespace ogls
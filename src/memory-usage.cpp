@@ -0,0 +1,47 @@
+#include "memory-usage.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+//
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+
+#include <fstream>
+#endif
+
+namespace ogls
+{
+
+std::size_t getResidentSetSize()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                              sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&info),
+                  &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    // second field is resident pages
+    std::ifstream statm("/proc/self/statm");
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    if (!(statm >> size >> resident)) { return 0; }
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+}  // namespace ogls
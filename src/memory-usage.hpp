@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+
+namespace ogls
+{
+
+// resident set size of this process in bytes, 0 if it's not available
+std::size_t getResidentSetSize();
+
+}  // namespace ogls
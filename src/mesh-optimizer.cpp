@@ -0,0 +1,385 @@
+#include "mesh-optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <optional>
+
+namespace ogls
+{
+
+namespace
+{
+
+// parameters of Forsyth's algorithm
+constexpr std::size_t forsyth_cache_size = 32;
+constexpr float cache_decay_power = 1.5f;
+constexpr float last_triangle_score = 0.75f;
+constexpr float valence_boost_scale = 2.0f;
+constexpr float valence_boost_power = 0.5f;
+
+// vertices with few remaining triangles are preferred, so that they can be
+// evicted from cache early
+float computeVertexScore(int cache_position, uint32_t n_remaining)
+{
+    if (n_remaining == 0) { return -1.0f; }
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // vertices of the last triangle are fixed, so that the next
+            // triangle doesn't use them too much
+            score = last_triangle_score;
+        } else {
+            const float scaler = 1.0f / (forsyth_cache_size - 3.0f);
+            score = std::pow(1.0f - (cache_position - 3) * scaler,
+                             cache_decay_power);
+        }
+    }
+
+    score += valence_boost_scale *
+             std::pow(static_cast<float>(n_remaining), -valence_boost_power);
+    return score;
+}
+
+// FIFO cache simulated with timestamps of when vertices entered it
+class FIFOCache
+{
+   public:
+    FIFOCache(std::size_t n_vertices, std::size_t cache_size)
+        : timestamps(n_vertices, 0), cache_size(cache_size), time(0)
+    {
+        flush();
+    }
+
+    // returns number of cache misses
+    std::size_t add(uint32_t v0, uint32_t v1, uint32_t v2)
+    {
+        return add(v0) + add(v1) + add(v2);
+    }
+
+    void flush() { time += cache_size + 1; }
+
+   private:
+    std::vector<std::size_t> timestamps;
+    std::size_t cache_size;
+    std::size_t time;
+
+    std::size_t add(uint32_t v)
+    {
+        if (time - timestamps[v] > cache_size) {
+            timestamps[v] = time++;
+            return 1;
+        }
+        return 0;
+    }
+};
+
+}  // namespace
+
+float MeshOptimizer::CacheStats::getACMR() const
+{
+    return n_triangles > 0 ? static_cast<float>(n_misses) / n_triangles : 0.0f;
+}
+
+float MeshOptimizer::CacheStats::getATVR() const
+{
+    return n_vertices > 0 ? static_cast<float>(n_misses) / n_vertices : 0.0f;
+}
+
+MeshOptimizer::CacheStats& MeshOptimizer::CacheStats::operator+=(
+    const CacheStats& other)
+{
+    n_triangles += other.n_triangles;
+    n_vertices += other.n_vertices;
+    n_misses += other.n_misses;
+    return *this;
+}
+
+void MeshOptimizer::optimize(MeshData& mesh)
+{
+    if (mesh.indices.empty()) { return; }
+
+    mesh.indices = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    mesh.indices = optimizeOverdraw(mesh.vertices, mesh.indices);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(
+    const std::vector<uint32_t>& indices, std::size_t n_vertices,
+    std::size_t cache_size)
+{
+    CacheStats ret;
+    ret.n_triangles = indices.size() / 3;
+
+    std::vector<bool> referenced(n_vertices, false);
+    FIFOCache cache(n_vertices, cache_size);
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        ret.n_misses += cache.add(indices[i], indices[i + 1], indices[i + 2]);
+        for (std::size_t k = 0; k < 3; ++k) {
+            if (!referenced[indices[i + k]]) {
+                referenced[indices[i + k]] = true;
+                ret.n_vertices++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(
+    const std::vector<uint32_t>& indices, std::size_t n_vertices)
+{
+    const std::size_t n_triangles = indices.size() / 3;
+
+    // remaining triangles of each vertex, stored in
+    // adjacency[offsets[v], offsets[v] + n_remaining[v])
+    std::vector<uint32_t> n_remaining(n_vertices, 0);
+    for (const auto index : indices) { n_remaining[index]++; }
+
+    std::vector<uint32_t> offsets(n_vertices + 1, 0);
+    for (std::size_t v = 0; v < n_vertices; ++v) {
+        offsets[v + 1] = offsets[v] + n_remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> heads(offsets.begin(), offsets.end() - 1);
+        for (std::size_t t = 0; t < n_triangles; ++t) {
+            for (std::size_t k = 0; k < 3; ++k) {
+                adjacency[heads[indices[3 * t + k]]++] = t;
+            }
+        }
+    }
+
+    std::vector<float> vertex_scores(n_vertices);
+    for (std::size_t v = 0; v < n_vertices; ++v) {
+        vertex_scores[v] = computeVertexScore(-1, n_remaining[v]);
+    }
+
+    std::vector<float> triangle_scores(n_triangles);
+    for (std::size_t t = 0; t < n_triangles; ++t) {
+        triangle_scores[t] = vertex_scores[indices[3 * t]] +
+                             vertex_scores[indices[3 * t + 1]] +
+                             vertex_scores[indices[3 * t + 2]];
+    }
+
+    std::vector<bool> emitted(n_triangles, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> new_cache;
+    cache.reserve(forsyth_cache_size + 3);
+    new_cache.reserve(forsyth_cache_size + 3);
+
+    std::vector<uint32_t> ret;
+    ret.reserve(3 * n_triangles);
+
+    std::size_t cursor = 0;
+    std::optional<uint32_t> best_triangle;
+
+    for (std::size_t i = 0; i < n_triangles; ++i) {
+        // no triangle uses cached vertices, take next one in input order
+        if (!best_triangle) {
+            while (emitted[cursor]) { cursor++; }
+            best_triangle = cursor;
+        }
+
+        const uint32_t t = best_triangle.value();
+        emitted[t] = true;
+
+        // emit triangle, and remove it from remaining triangles
+        new_cache.clear();
+        for (std::size_t k = 0; k < 3; ++k) {
+            const uint32_t v = indices[3 * t + k];
+            ret.push_back(v);
+
+            const auto begin = adjacency.begin() + offsets[v];
+            const auto end = begin + n_remaining[v];
+            std::iter_swap(std::find(begin, end, t), end - 1);
+            n_remaining[v]--;
+
+            if (std::find(new_cache.begin(), new_cache.end(), v) ==
+                new_cache.end()) {
+                new_cache.push_back(v);
+            }
+        }
+
+        // vertices of the triangle go to the front of LRU cache
+        for (const auto v : cache) {
+            if (std::find(new_cache.begin(), new_cache.end(), v) ==
+                new_cache.end()) {
+                new_cache.push_back(v);
+            }
+        }
+
+        // update scores of vertices which are or were in cache
+        for (std::size_t j = 0; j < new_cache.size(); ++j) {
+            const uint32_t v = new_cache[j];
+            const int position =
+                j < forsyth_cache_size ? static_cast<int>(j) : -1;
+
+            const float score = computeVertexScore(position, n_remaining[v]);
+            const float delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+            for (uint32_t a = 0; a < n_remaining[v]; ++a) {
+                triangle_scores[adjacency[offsets[v] + a]] += delta;
+            }
+        }
+
+        if (new_cache.size() > forsyth_cache_size) {
+            new_cache.resize(forsyth_cache_size);
+        }
+        std::swap(cache, new_cache);
+
+        // next triangle is the best one which uses cached vertices
+        best_triangle = std::nullopt;
+        float best_score = -std::numeric_limits<float>::max();
+        for (const auto v : cache) {
+            for (uint32_t a = 0; a < n_remaining[v]; ++a) {
+                const uint32_t candidate = adjacency[offsets[v] + a];
+                if (triangle_scores[candidate] > best_score) {
+                    best_score = triangle_scores[candidate];
+                    best_triangle = candidate;
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeOverdraw(
+    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+    float threshold)
+{
+    constexpr std::size_t cache_size = 16;
+    const std::size_t n_triangles = indices.size() / 3;
+    if (n_triangles == 0) { return indices; }
+
+    // hard boundaries are where cache misses all vertices of triangle
+    std::vector<std::size_t> hard_boundaries;
+    {
+        FIFOCache cache(vertices.size(), cache_size);
+        for (std::size_t t = 0; t < n_triangles; ++t) {
+            const std::size_t n_misses = cache.add(
+                indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]);
+            if (t == 0 || n_misses == 3) { hard_boundaries.push_back(t); }
+        }
+        hard_boundaries.push_back(n_triangles);
+    }
+
+    // split clusters further while their ACMR is within threshold of the
+    // original cluster
+    std::vector<std::size_t> clusters;
+    FIFOCache cache(vertices.size(), cache_size);
+    for (std::size_t c = 0; c + 1 < hard_boundaries.size(); ++c) {
+        const std::size_t begin = hard_boundaries[c];
+        const std::size_t end = hard_boundaries[c + 1];
+
+        cache.flush();
+        std::size_t cluster_misses = 0;
+        for (std::size_t t = begin; t < end; ++t) {
+            cluster_misses += cache.add(indices[3 * t], indices[3 * t + 1],
+                                        indices[3 * t + 2]);
+        }
+        const float cluster_threshold =
+            threshold * cluster_misses / static_cast<float>(end - begin);
+
+        cache.flush();
+        clusters.push_back(begin);
+        std::size_t running_misses = 0;
+        std::size_t running_triangles = 0;
+        for (std::size_t t = begin; t < end; ++t) {
+            running_misses += cache.add(indices[3 * t], indices[3 * t + 1],
+                                        indices[3 * t + 2]);
+            running_triangles++;
+
+            if (t + 1 < end &&
+                running_misses <= cluster_threshold * running_triangles) {
+                cache.flush();
+                clusters.push_back(t + 1);
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+    }
+    clusters.push_back(n_triangles);
+
+    // area weighted centroid of mesh
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    std::vector<glm::vec3> cluster_centroids(clusters.size() - 1);
+    std::vector<glm::vec3> cluster_normals(clusters.size() - 1);
+    for (std::size_t c = 0; c + 1 < clusters.size(); ++c) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (std::size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3& p0 = vertices[indices[3 * t]].position;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+
+            // length of cross product is twice the area
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float a = glm::length(n);
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        mesh_centroid += centroid;
+        mesh_area += area;
+
+        cluster_centroids[c] = area > 0.0f ? centroid / area : centroid;
+        const float normal_length = glm::length(normal);
+        cluster_normals[c] =
+            normal_length > 0.0f ? normal / normal_length : normal;
+    }
+    if (mesh_area > 0.0f) { mesh_centroid /= mesh_area; }
+
+    // clusters facing away from the center are likely to occlude others, so
+    // they are drawn first
+    std::vector<float> sort_keys(clusters.size() - 1);
+    for (std::size_t c = 0; c < sort_keys.size(); ++c) {
+        sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid,
+                                cluster_normals[c]);
+    }
+
+    std::vector<std::size_t> order(sort_keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&sort_keys](std::size_t a, std::size_t b) {
+                         return sort_keys[a] > sort_keys[b];
+                     });
+
+    std::vector<uint32_t> ret;
+    ret.reserve(indices.size());
+    for (const auto c : order) {
+        ret.insert(ret.end(), indices.begin() + 3 * clusters[c],
+                   indices.begin() + 3 * clusters[c + 1]);
+    }
+
+    return ret;
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices,
+                                        std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), unused);
+
+    std::vector<Vertex> ret;
+    ret.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = ret.size();
+            ret.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(ret);
+}
+
+}  // namespace ogls
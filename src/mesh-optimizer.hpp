@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "model-data.hpp"
+
+namespace ogls
+{
+
+// reorder triangles and vertices of meshes for GPU efficiency
+// 1. triangles for post-transform vertex cache(Forsyth's algorithm)
+// 2. clusters of triangles for less overdraw(Sander et al. 2007)
+// 3. vertices in order of first use for vertex fetch
+class MeshOptimizer
+{
+   public:
+    // statistics of simulated FIFO post-transform cache
+    struct CacheStats {
+        std::size_t n_triangles = 0;
+        std::size_t n_vertices = 0;
+        std::size_t n_misses = 0;
+
+        // average cache miss ratio, transformed vertices per triangle
+        float getACMR() const;
+        // average transformed to vertex ratio, 1 is optimal
+        float getATVR() const;
+
+        CacheStats& operator+=(const CacheStats& other);
+    };
+
+    // run all optimizations, unreferenced vertices are removed
+    static void optimize(MeshData& mesh);
+
+    static CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices,
+                                         std::size_t n_vertices,
+                                         std::size_t cache_size = 16);
+
+    static std::vector<uint32_t> optimizeVertexCache(
+        const std::vector<uint32_t>& indices, std::size_t n_vertices);
+
+    // indices should be optimized for vertex cache beforehand
+    // clusters may be up to threshold times worse in ACMR
+    static std::vector<uint32_t> optimizeOverdraw(
+        const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices, float threshold = 1.05f);
+
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices,
+                                    std::vector<uint32_t>& indices);
+};
+
+}  // namespace ogls
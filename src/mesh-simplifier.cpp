@@ -0,0 +1,529 @@
+#include "mesh-simplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "mesh-optimizer.hpp"
+
+namespace ogls
+{
+
+namespace
+{
+
+constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+// edge quadrics keep borders and seams in place, relative to face quadrics
+constexpr double seam_weight = 10.0;
+
+// collapses are rejected if a triangle normal rotates more than this
+constexpr double min_normal_cosine = 0.25;
+
+// the chain ends if a level can't be reached in this number of passes, which
+// happens when most vertices are locked
+constexpr std::size_t max_passes_per_lod = 32;
+
+// symmetric 4x4 matrix of squared distances to planes, weighted by area
+struct Quadric {
+    double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+    double ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+    // sum of triangle areas, error is normalized by this
+    double area = 0;
+
+    static Quadric fromPlane(const glm::dvec3& n, double d, double weight)
+    {
+        Quadric ret;
+        ret.a2 = weight * n.x * n.x;
+        ret.b2 = weight * n.y * n.y;
+        ret.c2 = weight * n.z * n.z;
+        ret.d2 = weight * d * d;
+        ret.ab = weight * n.x * n.y;
+        ret.ac = weight * n.x * n.z;
+        ret.ad = weight * n.x * d;
+        ret.bc = weight * n.y * n.z;
+        ret.bd = weight * n.y * d;
+        ret.cd = weight * n.z * d;
+        return ret;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        a2 += other.a2;
+        b2 += other.b2;
+        c2 += other.c2;
+        d2 += other.d2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        bc += other.bc;
+        bd += other.bd;
+        cd += other.cd;
+        area += other.area;
+        return *this;
+    }
+
+    // root mean squared distance of p to the planes
+    float getError(const glm::dvec3& p) const
+    {
+        const double e = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+                         2 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+                         2 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+        return std::sqrt(std::max(e, 0.0) / std::max(area, 1e-30));
+    }
+};
+
+enum class VertexKind {
+    // interior vertex without attribute seams, can collapse to anything
+    Manifold,
+    // on an open edge loop, can collapse along the loop
+    Border,
+    // two wedges on an attribute seam, can collapse along the seam
+    Seam,
+    // everything else, never collapsed
+    Locked
+};
+
+// topology of current triangles
+// vertices at the same position are wedges of the position, positions are
+// identified by their first vertex
+struct Topology {
+    // per position
+    std::vector<VertexKind> kinds;
+    std::vector<std::array<uint32_t, 2>> wedges;
+    std::vector<uint32_t> border_next;
+    std::vector<uint32_t> border_prev;
+    // per vertex
+    std::vector<uint32_t> seam_next;
+    std::vector<uint32_t> seam_prev;
+    // directed edges on borders or seams, with their triangles
+    std::vector<std::array<uint32_t, 3>> open_edges;
+};
+
+uint64_t makeEdgeKey(uint32_t a, uint32_t b)
+{
+    return static_cast<uint64_t>(a) << 32 | b;
+}
+
+Topology classify(const std::vector<uint32_t>& indices,
+                  const std::vector<uint32_t>& positions)
+{
+    const std::size_t n = positions.size();
+
+    std::vector<uint64_t> edges;
+    std::vector<uint64_t> position_edges;
+    edges.reserve(indices.size());
+    position_edges.reserve(indices.size());
+    for (std::size_t c = 0; c < indices.size(); ++c) {
+        const uint32_t a = indices[c];
+        const uint32_t b = indices[c - c % 3 + (c + 1) % 3];
+        edges.push_back(makeEdgeKey(a, b));
+        position_edges.push_back(makeEdgeKey(positions[a], positions[b]));
+    }
+    std::sort(edges.begin(), edges.end());
+    std::sort(position_edges.begin(), position_edges.end());
+
+    const auto count = [](const std::vector<uint64_t>& sorted, uint64_t key) {
+        const auto [first, last] =
+            std::equal_range(sorted.begin(), sorted.end(), key);
+        return last - first;
+    };
+
+    Topology ret;
+    ret.kinds.assign(n, VertexKind::Manifold);
+    ret.wedges.assign(n, {invalid_index, invalid_index});
+    ret.border_next.assign(n, invalid_index);
+    ret.border_prev.assign(n, invalid_index);
+    ret.seam_next.assign(n, invalid_index);
+    ret.seam_prev.assign(n, invalid_index);
+
+    std::vector<uint8_t> locked(n, 0);
+    std::vector<uint8_t> border_out(n, 0), border_in(n, 0);
+    std::vector<uint8_t> seam_out(n, 0), seam_in(n, 0);
+
+    for (const uint32_t v : indices) {
+        auto& wedges = ret.wedges[positions[v]];
+        if (wedges[0] == invalid_index || wedges[0] == v) {
+            wedges[0] = v;
+        } else if (wedges[1] == invalid_index || wedges[1] == v) {
+            wedges[1] = v;
+        } else {
+            // more than 2 wedges
+            locked[positions[v]] = 1;
+        }
+    }
+
+    for (std::size_t c = 0; c < indices.size(); ++c) {
+        const uint32_t a = indices[c];
+        const uint32_t b = indices[c - c % 3 + (c + 1) % 3];
+        const uint32_t pa = positions[a];
+        const uint32_t pb = positions[b];
+
+        // non-manifold edge
+        if (count(position_edges, makeEdgeKey(pa, pb)) > 1) {
+            locked[pa] = locked[pb] = 1;
+            continue;
+        }
+
+        if (count(position_edges, makeEdgeKey(pb, pa)) == 0) {
+            border_out[pa]++;
+            border_in[pb]++;
+            ret.border_next[pa] = pb;
+            ret.border_prev[pb] = pa;
+            ret.open_edges.push_back({a, b, static_cast<uint32_t>(c / 3)});
+        } else if (count(edges, makeEdgeKey(b, a)) == 0) {
+            seam_out[a]++;
+            seam_in[b]++;
+            ret.seam_next[a] = b;
+            ret.seam_prev[b] = a;
+            ret.open_edges.push_back({a, b, static_cast<uint32_t>(c / 3)});
+        }
+    }
+
+    for (std::size_t p = 0; p < n; ++p) {
+        const auto& wedges = ret.wedges[p];
+        if (wedges[0] == invalid_index) { continue; }
+
+        const auto is_seam_wedge = [&](uint32_t w) {
+            return seam_out[w] == 1 && seam_in[w] == 1;
+        };
+        const auto has_no_seam = [&](uint32_t w) {
+            return seam_out[w] == 0 && seam_in[w] == 0;
+        };
+
+        VertexKind kind = VertexKind::Locked;
+        if (locked[p]) {
+            kind = VertexKind::Locked;
+        } else if (wedges[1] == invalid_index && has_no_seam(wedges[0])) {
+            if (border_out[p] == 0 && border_in[p] == 0) {
+                kind = VertexKind::Manifold;
+            } else if (border_out[p] == 1 && border_in[p] == 1) {
+                kind = VertexKind::Border;
+            }
+        } else if (wedges[1] != invalid_index && border_out[p] == 0 &&
+                   border_in[p] == 0 && is_seam_wedge(wedges[0]) &&
+                   is_seam_wedge(wedges[1])) {
+            kind = VertexKind::Seam;
+        }
+        ret.kinds[p] = kind;
+    }
+
+    return ret;
+}
+
+// seam neighbor of wedge w at position p
+uint32_t getSeamNeighbor(const Topology& topology,
+                         const std::vector<uint32_t>& positions, uint32_t w,
+                         uint32_t p)
+{
+    for (const uint32_t neighbor :
+         {topology.seam_next[w], topology.seam_prev[w]}) {
+        if (neighbor != invalid_index && positions[neighbor] == p) {
+            return neighbor;
+        }
+    }
+    return invalid_index;
+}
+
+struct Collapse {
+    // wedges of position of v move to u
+    std::array<uint32_t, 2> from = {invalid_index, invalid_index};
+    std::array<uint32_t, 2> to = {invalid_index, invalid_index};
+    float error = 0.0f;
+};
+
+// collapse of vertex v into u, returns false if it's not allowed
+bool getCollapse(const Topology& topology,
+                 const std::vector<uint32_t>& positions, uint32_t v,
+                 uint32_t u, Collapse& collapse)
+{
+    const uint32_t pv = positions[v];
+    const uint32_t pu = positions[u];
+
+    switch (topology.kinds[pv]) {
+        case VertexKind::Manifold:
+            collapse.from = {v, invalid_index};
+            collapse.to = {u, invalid_index};
+            return true;
+        case VertexKind::Border:
+            if (topology.border_next[pv] != pu &&
+                topology.border_prev[pv] != pu) {
+                return false;
+            }
+            collapse.from = {v, invalid_index};
+            collapse.to = {u, invalid_index};
+            return true;
+        case VertexKind::Seam: {
+            // both wedges move along the seam
+            const auto& wedges = topology.wedges[pv];
+            const uint32_t u0 =
+                getSeamNeighbor(topology, positions, wedges[0], pu);
+            const uint32_t u1 =
+                getSeamNeighbor(topology, positions, wedges[1], pu);
+            if (u0 == invalid_index || u1 == invalid_index) { return false; }
+            collapse.from = wedges;
+            collapse.to = {u0, u1};
+            return true;
+        }
+        case VertexKind::Locked:
+            return false;
+    }
+    return false;
+}
+
+// weld vertices with same attributes, and give each vertex the id of the
+// first vertex at its position
+void weld(const std::vector<Vertex>& vertices, std::vector<uint32_t>& remap,
+          std::vector<uint32_t>& positions)
+{
+    struct Hash {
+        std::size_t operator()(const std::array<float, 11>& key) const
+        {
+            uint64_t ret = 14695981039346656037ULL;
+            for (const float f : key) {
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                ret = (ret ^ bits) * 1099511628211ULL;
+            }
+            return ret;
+        }
+    };
+
+    std::unordered_map<std::array<float, 11>, uint32_t, Hash> attribute_ids;
+    std::unordered_map<std::array<float, 11>, uint32_t, Hash> position_ids;
+    attribute_ids.reserve(vertices.size());
+    position_ids.reserve(vertices.size());
+
+    remap.resize(vertices.size());
+    positions.resize(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        const std::array<float, 11> attributes = {
+            v.position.x, v.position.y, v.position.z,  v.normal.x,
+            v.normal.y,   v.normal.z,   v.texcoords.x, v.texcoords.y,
+            v.tangent.x,  v.tangent.y,  v.tangent.z};
+        const std::array<float, 11> position = {v.position.x, v.position.y,
+                                                v.position.z};
+        remap[i] = attribute_ids.try_emplace(attributes, i).first->second;
+        positions[i] = position_ids.try_emplace(position, i).first->second;
+    }
+}
+
+}  // namespace
+
+std::vector<MeshLod> MeshSimplifier::buildLodChain(
+    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<MeshLod> ret;
+    if (indices.size() / 3 < 2 * min_lod_triangles) { return ret; }
+
+    std::vector<uint32_t> remap;
+    std::vector<uint32_t> positions;
+    weld(vertices, remap, positions);
+
+    const auto get_position = [&](uint32_t v) {
+        return glm::dvec3(vertices[v].position);
+    };
+    const auto get_normal = [&](uint32_t a, uint32_t b, uint32_t c) {
+        return glm::cross(get_position(b) - get_position(a),
+                          get_position(c) - get_position(a));
+    };
+
+    // welded triangles without degenerate ones
+    std::vector<uint32_t> current;
+    current.reserve(indices.size());
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t a = remap[indices[i]];
+        const uint32_t b = remap[indices[i + 1]];
+        const uint32_t c = remap[indices[i + 2]];
+        if (positions[a] == positions[b] || positions[b] == positions[c] ||
+            positions[c] == positions[a]) {
+            continue;
+        }
+        current.insert(current.end(), {a, b, c});
+    }
+
+    // quadrics of faces and of edges on borders and seams
+    std::vector<Quadric> quadrics(vertices.size());
+    for (std::size_t i = 0; i < current.size(); i += 3) {
+        const glm::dvec3 n = get_normal(current[i], current[i + 1],
+                                        current[i + 2]);
+        const double length = glm::length(n);
+        if (length == 0.0) { continue; }
+
+        const glm::dvec3 unit = n / length;
+        Quadric q = Quadric::fromPlane(
+            unit, -glm::dot(unit, get_position(current[i])), 0.5 * length);
+        q.area = 0.5 * length;
+        for (std::size_t k = 0; k < 3; ++k) {
+            quadrics[positions[current[i + k]]] += q;
+        }
+    }
+    for (const auto& [a, b, t] : classify(current, positions).open_edges) {
+        const glm::dvec3 edge = get_position(b) - get_position(a);
+        const glm::dvec3 n = glm::cross(
+            edge, get_normal(current[3 * t], current[3 * t + 1],
+                             current[3 * t + 2]));
+        const double length = glm::length(n);
+        if (length == 0.0) { continue; }
+
+        const glm::dvec3 unit = n / length;
+        const Quadric q = Quadric::fromPlane(
+            unit, -glm::dot(unit, get_position(a)),
+            seam_weight * glm::dot(edge, edge));
+        quadrics[positions[a]] += q;
+        quadrics[positions[b]] += q;
+    }
+
+    std::size_t target = current.size() / 3 / 2;
+    float max_error = 0.0f;
+    std::vector<uint32_t> collapse_remap(vertices.size());
+    std::vector<uint8_t> pass_locked(vertices.size());
+    std::size_t n_passes = 0;
+
+    while (ret.size() < max_lods && target >= min_lod_triangles &&
+           n_passes++ < max_passes_per_lod) {
+        const Topology topology = classify(current, positions);
+
+        // pick the cheaper direction of each edge
+        std::vector<Collapse> collapses;
+        collapses.reserve(current.size());
+        for (std::size_t c = 0; c < current.size(); ++c) {
+            const uint32_t a = current[c];
+            const uint32_t b = current[c - c % 3 + (c + 1) % 3];
+
+            Collapse best;
+            best.error = std::numeric_limits<float>::max();
+            for (const auto& [v, u] : {std::pair(a, b), std::pair(b, a)}) {
+                Collapse collapse;
+                if (!getCollapse(topology, positions, v, u, collapse)) {
+                    continue;
+                }
+                collapse.error =
+                    quadrics[positions[v]].getError(get_position(u));
+                if (collapse.error < best.error) { best = collapse; }
+            }
+            if (best.from[0] != invalid_index) { collapses.push_back(best); }
+        }
+        if (collapses.empty()) { break; }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& a, const Collapse& b) {
+                      return a.error < b.error;
+                  });
+
+        // triangles around each position
+        std::vector<uint32_t> offsets(vertices.size() + 1, 0);
+        for (const uint32_t v : current) { offsets[positions[v] + 1]++; }
+        for (std::size_t p = 0; p < vertices.size(); ++p) {
+            offsets[p + 1] += offsets[p];
+        }
+        std::vector<uint32_t> triangles(current.size());
+        {
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (std::size_t c = 0; c < current.size(); ++c) {
+                triangles[cursor[positions[current[c]]]++] = c / 3;
+            }
+        }
+
+        // each collapse removes about 2 triangles
+        const std::size_t n_triangles = current.size() / 3;
+        const std::size_t max_collapses =
+            std::max<std::size_t>((n_triangles - target + 1) / 2, 1);
+
+        for (std::size_t v = 0; v < vertices.size(); ++v) {
+            collapse_remap[v] = v;
+        }
+        std::fill(pass_locked.begin(), pass_locked.end(), 0);
+
+        std::size_t n_collapses = 0;
+        for (const auto& collapse : collapses) {
+            if (n_collapses >= max_collapses) { break; }
+
+            const uint32_t pv = positions[collapse.from[0]];
+            const uint32_t pu = positions[collapse.to[0]];
+            if (pass_locked[pv] || pass_locked[pu]) { continue; }
+
+            // reject collapses which flip triangles
+            const glm::dvec3 target_position = get_position(collapse.to[0]);
+            bool flipped = false;
+            for (uint32_t i = offsets[pv]; i < offsets[pv + 1] && !flipped;
+                 ++i) {
+                const uint32_t t = triangles[i];
+                std::array<glm::dvec3, 3> p;
+                bool has_pu = false;
+                for (std::size_t k = 0; k < 3; ++k) {
+                    const uint32_t pk = positions[current[3 * t + k]];
+                    has_pu |= pk == pu;
+                    p[k] = pk == pv ? target_position
+                                    : get_position(current[3 * t + k]);
+                }
+                // this triangle degenerates
+                if (has_pu) { continue; }
+
+                const glm::dvec3 before = get_normal(
+                    current[3 * t], current[3 * t + 1], current[3 * t + 2]);
+                const glm::dvec3 after =
+                    glm::cross(p[1] - p[0], p[2] - p[0]);
+                flipped = glm::dot(before, after) <=
+                          min_normal_cosine * glm::length(before) *
+                              glm::length(after);
+            }
+            if (flipped) { continue; }
+
+            for (std::size_t k = 0; k < 2; ++k) {
+                if (collapse.from[k] != invalid_index) {
+                    collapse_remap[collapse.from[k]] = collapse.to[k];
+                }
+            }
+            quadrics[pu] += quadrics[pv];
+
+            // triangles around pv are changed, so neighbors wait for the
+            // next pass
+            for (uint32_t i = offsets[pv]; i < offsets[pv + 1]; ++i) {
+                for (std::size_t k = 0; k < 3; ++k) {
+                    pass_locked[positions[current[3 * triangles[i] + k]]] = 1;
+                }
+            }
+
+            max_error = std::max(max_error, collapse.error);
+            n_collapses++;
+        }
+        if (n_collapses == 0) { break; }
+
+        // remove triangles degenerated by collapses
+        std::vector<uint32_t> next;
+        next.reserve(current.size());
+        for (std::size_t i = 0; i < current.size(); i += 3) {
+            const uint32_t a = collapse_remap[current[i]];
+            const uint32_t b = collapse_remap[current[i + 1]];
+            const uint32_t c = collapse_remap[current[i + 2]];
+            if (positions[a] == positions[b] || positions[b] == positions[c] ||
+                positions[c] == positions[a]) {
+                continue;
+            }
+            next.insert(next.end(), {a, b, c});
+        }
+        current = std::move(next);
+
+        if (current.size() / 3 <= target) {
+            MeshLod lod;
+            lod.indices = current;
+            lod.error = max_error;
+            ret.push_back(std::move(lod));
+            target = current.size() / 3 / 2;
+            n_passes = 0;
+        }
+    }
+
+    for (auto& lod : ret) {
+        lod.indices =
+            MeshOptimizer::optimizeVertexCache(lod.indices, vertices.size());
+    }
+
+    return ret;
+}
+
+}  // namespace ogls
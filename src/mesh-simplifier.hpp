@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "model-data.hpp"
+
+namespace ogls
+{
+
+// chain of levels of detail by edge collapse with quadric error metrics
+// (Garland and Heckbert 1997)
+// vertices are only removed, so simplified index buffers share the vertices
+// of the mesh
+// vertices on UV and normal seams and on borders are only collapsed along
+// them, so seams and silhouettes of open meshes are preserved
+class MeshSimplifier
+{
+   public:
+    // each level has about half the triangles of the previous one, and is
+    // simplified further from it with the accumulated quadrics
+    // indices of levels are optimized for vertex cache
+    static std::vector<MeshLod> buildLodChain(
+        const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices);
+
+    // the chain ends when a level would have fewer triangles than this
+    static constexpr std::size_t min_lod_triangles = 32;
+    // number of levels excluding the original indices
+    static constexpr std::size_t max_lods = 6;
+};
+
+}  // namespace ogls
@@ -1,174 +1,329 @@
 #include "mesh.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace ogls
 {
 
-Mesh::Mesh() {}
+Material getResidentMaterial(
+    const Material& material,
+    const std::vector<std::shared_ptr<Texture>>& textures)
+{
+    Material ret = material;
+    for (const auto map : material_texture_maps) {
+        if ((ret.*map) && !textures[(ret.*map).value()]) {
+            ret.*map = std::nullopt;
+        }
+    }
+    return ret;
+}
+
+Mesh::Mesh()
+    : n_vertices{0},
+      n_indices{0},
+      bounding_center{0.0f},
+      bounding_radius{0.0f},
+      retention{GeometryRetention::None},
+      material_id{0},
+      index_type{GL_UNSIGNED_INT},
+      position_offset{0.0f},
+      position_scale{1.0f}
+{
+}
 
 Mesh::Mesh(const std::vector<Vertex>& vertices,
-           const std::vector<unsigned int>& indices, MaterialID material_id)
-    : vertices{vertices}, indices{indices}, material_id{material_id}
-{
-    // TODO: maybe this is bad, because we are sending all the model data to the
-    // GPU. This is consuming a lot of VRAM.
-    vertex_buffer.setData(vertices, GL_STATIC_DRAW);
-    index_buffer.setData(indices, GL_STATIC_DRAW);
-
-    vao.bindVertexBuffer(vertex_buffer, 0, 0, sizeof(Vertex));
-    vao.bindElementBuffer(index_buffer);
-
-    // position
-    vao.activateVertexAttribution(0, 0, 3, GL_FLOAT, 0);
-    // normal
-    vao.activateVertexAttribution(0, 1, 3, GL_FLOAT, offsetof(Vertex, normal));
-    // texcoords
-    vao.activateVertexAttribution(0, 2, 2, GL_FLOAT,
-                                  offsetof(Vertex, texcoords));
-    // tangent
-    vao.activateVertexAttribution(0, 3, 3, GL_FLOAT, offsetof(Vertex, tangent));
-    // dndu
-    vao.activateVertexAttribution(0, 4, 3, GL_FLOAT, offsetof(Vertex, dndu));
-    // dndv
-    vao.activateVertexAttribution(0, 5, 3, GL_FLOAT, offsetof(Vertex, dndv));
+           const std::vector<unsigned int>& indices,
+           const std::vector<MeshLod>& lods,
+           const std::vector<Meshlet>& meshlets, MaterialID material_id,
+           const VertexFormat& format, GeometryArena& arena,
+           StagingBuffer* staging, GeometryRetention retention)
+    : n_vertices(vertices.size()),
+      n_indices(indices.size()),
+      meshlets(meshlets),
+      bounding_center{0.0f},
+      bounding_radius{0.0f},
+      retention{retention},
+      material_id{material_id}
+{
+    // bounding sphere around center of bounding box
+    if (!vertices.empty()) {
+        glm::vec3 p_min(std::numeric_limits<float>::max());
+        glm::vec3 p_max(std::numeric_limits<float>::lowest());
+        for (const auto& vertex : vertices) {
+            p_min = glm::min(p_min, vertex.position);
+            p_max = glm::max(p_max, vertex.position);
+        }
+        bounding_center = 0.5f * (p_min + p_max);
+        for (const auto& vertex : vertices) {
+            bounding_radius =
+                std::max(bounding_radius,
+                         glm::length(vertex.position - bounding_center));
+        }
+    }
+
+    // all levels of detail are stored in one index buffer
+    std::vector<uint32_t> all_indices = indices;
+    this->lods.push_back({{0, n_indices}, 0.0f});
+    for (const auto& lod : lods) {
+        this->lods.push_back({{static_cast<uint32_t>(all_indices.size()),
+                               static_cast<uint32_t>(lod.indices.size())},
+                              lod.error});
+        all_indices.insert(all_indices.end(), lod.indices.begin(),
+                           lod.indices.end());
+    }
+
+    switch (retention) {
+        case GeometryRetention::None:
+            break;
+        case GeometryRetention::PositionsAndIndices:
+            this->positions.reserve(vertices.size());
+            for (const auto& vertex : vertices) {
+                this->positions.push_back(vertex.position);
+            }
+            this->indices = indices;
+            break;
+        case GeometryRetention::All:
+            this->vertices = vertices;
+            this->indices = indices;
+            break;
+    }
+
+    const std::vector<uint8_t> packed_vertices =
+        format.pack(vertices, position_offset, position_scale);
+
+    if (vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+        index_type = GL_UNSIGNED_SHORT;
+        const std::vector<uint16_t> short_indices(all_indices.begin(),
+                                                  all_indices.end());
+        allocation = arena.allocate(packed_vertices.size(), format.getStride(),
+                                    sizeof(uint16_t) * short_indices.size(),
+                                    sizeof(uint16_t));
+        arena.write(allocation, packed_vertices.data(), short_indices.data(),
+                    staging);
+    } else {
+        index_type = GL_UNSIGNED_INT;
+        allocation = arena.allocate(packed_vertices.size(), format.getStride(),
+                                    sizeof(uint32_t) * all_indices.size(),
+                                    sizeof(uint32_t));
+        arena.write(allocation, packed_vertices.data(), all_indices.data(),
+                    staging);
+    }
 }
 
 Mesh::Mesh(Mesh&& other)
 {
+    n_vertices = other.n_vertices;
+    n_indices = other.n_indices;
+    lods = std::move(other.lods);
+    meshlets = std::move(other.meshlets);
+    bounding_center = other.bounding_center;
+    bounding_radius = other.bounding_radius;
+    retention = other.retention;
     vertices = std::move(other.vertices);
+    positions = std::move(other.positions);
     indices = std::move(other.indices);
     material_id = std::move(other.material_id);
-    vertex_buffer = std::move(other.vertex_buffer);
-    index_buffer = std::move(other.index_buffer);
-    vao = std::move(other.vao);
+    index_type = other.index_type;
+    position_offset = other.position_offset;
+    position_scale = other.position_scale;
+    allocation = std::move(other.allocation);
 }
 
 Mesh& Mesh::operator=(Mesh&& other)
 {
     if (this == &other) return *this;
+    n_vertices = other.n_vertices;
+    n_indices = other.n_indices;
+    lods = std::move(other.lods);
+    meshlets = std::move(other.meshlets);
+    bounding_center = other.bounding_center;
+    bounding_radius = other.bounding_radius;
+    retention = other.retention;
     vertices = std::move(other.vertices);
+    positions = std::move(other.positions);
     indices = std::move(other.indices);
     material_id = std::move(other.material_id);
-    vertex_buffer = std::move(other.vertex_buffer);
-    index_buffer = std::move(other.index_buffer);
-    vao = std::move(other.vao);
+    index_type = other.index_type;
+    position_offset = other.position_offset;
+    position_scale = other.position_scale;
+    allocation = std::move(other.allocation);
     return *this;
 }
 
 void Mesh::draw(const Pipeline& pipeline, const Material& material,
-                const std::vector<Texture>& textures) const
+                const std::vector<std::shared_ptr<Texture>>& textures,
+                uint32_t lod) const
+{
+    draw(pipeline, material, textures, {lods.at(lod).range});
+}
+
+void Mesh::draw(const Pipeline& pipeline, const Material& material,
+                const std::vector<std::shared_ptr<Texture>>& textures,
+                const std::vector<IndexRange>& ranges) const
 {
-    // set texture uniform
+    if (ranges.empty()) { return; }
+
+    bindMaterial(material, textures);
+
+    // draw mesh
+    // pipeline is left bound, so GLState skips binding it for the next mesh
+    const std::size_t index_size =
+        index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    pipeline.activate();
+    if (ranges.size() == 1) {
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, ranges.front().n_indices, index_type,
+            reinterpret_cast<const void*>(allocation.getIndexOffset() +
+                                          index_size *
+                                              ranges.front().first_index),
+            allocation.getBaseVertex());
+    } else {
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+        counts.reserve(ranges.size());
+        offsets.reserve(ranges.size());
+        for (const auto& range : ranges) {
+            counts.push_back(range.n_indices);
+            offsets.push_back(reinterpret_cast<const void*>(
+                allocation.getIndexOffset() + index_size * range.first_index));
+        }
+        const std::vector<GLint> base_vertices(ranges.size(),
+                                               allocation.getBaseVertex());
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), index_type,
+                                      offsets.data(), ranges.size(),
+                                      base_vertices.data());
+    }
+}
+
+void Mesh::bindMaterial(
+    const Material& mesh_material,
+    const std::vector<std::shared_ptr<Texture>>& textures) const
+{
+    // maps whose textures are not uploaded yet are treated as missing
+    const Material material = getResidentMaterial(mesh_material, textures);
+
+    // bind textures
     if (material.diffuse_map) {
-        const Texture& tex = textures[material.diffuse_map.value()];
+        const Texture& tex = *textures[material.diffuse_map.value()];
         tex.bindToTextureUnit(0);
     }
 
     if (material.specular_map) {
-        const Texture& tex = textures[material.specular_map.value()];
+        const Texture& tex = *textures[material.specular_map.value()];
         tex.bindToTextureUnit(1);
     }
 
     if (material.ambient_map) {
-        const Texture& tex = textures[material.ambient_map.value()];
+        const Texture& tex = *textures[material.ambient_map.value()];
         tex.bindToTextureUnit(2);
     }
 
     if (material.emissive_map) {
-        const Texture& tex = textures[material.emissive_map.value()];
+        const Texture& tex = *textures[material.emissive_map.value()];
         tex.bindToTextureUnit(3);
     }
 
     if (material.height_map) {
-        const Texture& tex = textures[material.height_map.value()];
+        const Texture& tex = *textures[material.height_map.value()];
         tex.bindToTextureUnit(4);
-
-        // TODO: remove this
-        pipeline.setUniform("material.hasHeightMap", true);
-    } else {
-        pipeline.setUniform("material.hasHeightMap", false);
     }
 
     if (material.normal_map) {
-        const Texture& tex = textures[material.normal_map.value()];
+        const Texture& tex = *textures[material.normal_map.value()];
         tex.bindToTextureUnit(5);
-
-        // TODO: remove this
-        // maybe we can use default normal map texture instead of this
-        pipeline.setUniform("material.hasNormalMap", true);
-    } else {
-        pipeline.setUniform("material.hasNormalMap", false);
     }
 
     if (material.shininess_map) {
-        const Texture& tex = textures[material.shininess_map.value()];
+        const Texture& tex = *textures[material.shininess_map.value()];
         tex.bindToTextureUnit(6);
     }
 
     if (material.displacement_map) {
-        const Texture& tex = textures[material.displacement_map.value()];
+        const Texture& tex = *textures[material.displacement_map.value()];
         tex.bindToTextureUnit(7);
-
-        // TODO: remove this
-        pipeline.setUniform("material.hasDisplacementMap", true);
-    } else {
-        pipeline.setUniform("material.hasDisplacementMap", false);
     }
 
     if (material.light_map) {
-        const Texture& tex = textures[material.light_map.value()];
+        const Texture& tex = *textures[material.light_map.value()];
         tex.bindToTextureUnit(8);
-
-        // TODO: remove this
-        pipeline.setUniform("material.hasLightMap", true);
-    } else {
-        pipeline.setUniform("material.hasLightMap", false);
     }
+}
 
-    // set material
-    if (material.diffuse_map) {
-        pipeline.setUniform("material.kd", glm::vec3(0));
-    } else {
-        pipeline.setUniform("material.kd", material.kd);
-    }
+DrawElementsIndirectCommand Mesh::getDrawCommand(GLuint base_instance,
+                                                 uint32_t lod) const
+{
+    return getDrawCommand(base_instance, lods.at(lod).range);
+}
 
-    if (material.specular_map) {
-        pipeline.setUniform("material.ks", glm::vec3(0));
-    } else {
-        pipeline.setUniform("material.ks", material.ks);
-    }
+DrawElementsIndirectCommand Mesh::getDrawCommand(GLuint base_instance,
+                                                 const IndexRange& range) const
+{
+    DrawElementsIndirectCommand command;
+    command.count = range.n_indices;
+    command.instance_count = 1;
+    command.first_index = allocation.getFirstIndex() + range.first_index;
+    command.base_vertex = allocation.getBaseVertex();
+    command.base_instance = base_instance;
+    return command;
+}
 
-    if (material.ambient_map) {
-        pipeline.setUniform("material.ka", glm::vec3(0));
-    } else {
-        pipeline.setUniform("material.ka", material.ka);
-    }
+uint32_t Mesh::getNumberOfVertices() const { return n_vertices; }
 
-    if (material.emissive_map) {
-        pipeline.setUniform("material.ke", glm::vec3(0));
-    } else {
-        pipeline.setUniform("material.ke", material.ke);
-    }
+uint32_t Mesh::getNumberOfFaces(uint32_t lod) const
+{
+    return lods.empty() ? 0 : lods.at(lod).range.n_indices / 3;
+}
 
-    pipeline.setUniform("material.shininess", material.shininess);
+uint32_t Mesh::getNumberOfIndices() const
+{
+    if (lods.empty()) { return 0; }
+    return lods.back().range.first_index + lods.back().range.n_indices;
+}
 
-    // draw mesh
-    pipeline.activate();
-    vao.activate();
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    vao.deactivate();
-    pipeline.deactivate();
-
-    // reset texture uniforms
-    pipeline.setUniform("material.hasHeightMap", false);
-    pipeline.setUniform("material.hasNormalMap", false);
-    pipeline.setUniform("material.hasDisplacementMap", false);
-    pipeline.setUniform("material.hasLightMap", false);
+uint32_t Mesh::getMaterialID() const { return material_id; }
+
+uint32_t Mesh::getNumberOfLods() const { return lods.size(); }
+
+float Mesh::getLodError(uint32_t lod) const { return lods.at(lod).error; }
+
+IndexRange Mesh::getLodRange(uint32_t lod) const { return lods.at(lod).range; }
+
+const std::vector<Meshlet>& Mesh::getMeshlets() const { return meshlets; }
+
+glm::vec3 Mesh::getBoundingCenter() const { return bounding_center; }
+
+float Mesh::getBoundingRadius() const { return bounding_radius; }
+
+GeometryRetention Mesh::getRetention() const { return retention; }
+
+const std::vector<Vertex>& Mesh::getVertices() const { return vertices; }
+
+const std::vector<glm::vec3>& Mesh::getPositions() const { return positions; }
+
+const std::vector<uint32_t>& Mesh::getIndices() const { return indices; }
+
+std::size_t Mesh::getRetainedSize() const
+{
+    return sizeof(Vertex) * vertices.capacity() +
+           sizeof(glm::vec3) * positions.capacity() +
+           sizeof(uint32_t) * indices.capacity();
 }
 
-uint32_t Mesh::getNumberOfVertices() const { return vertices.size(); }
+GLenum Mesh::getIndexType() const { return index_type; }
 
-uint32_t Mesh::getNumberOfFaces() const { return indices.size() / 3; }
+glm::vec3 Mesh::getPositionOffset() const { return position_offset; }
 
-uint32_t Mesh::getMaterialID() const { return material_id; }
+glm::vec3 Mesh::getPositionScale() const { return position_scale; }
+
+std::size_t Mesh::getVertexBufferSize() const
+{
+    return allocation.getVertexSize();
+}
+
+std::size_t Mesh::getIndexBufferSize() const
+{
+    return allocation.getIndexSize();
+}
 
 }  // namespace ogls
\ No newline at end of file
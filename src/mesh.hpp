@@ -1,14 +1,17 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 //
-#include "buffer.hpp"
+#include "geometry-arena.hpp"
 #include "shader.hpp"
+#include "staging-buffer.hpp"
 #include "texture.hpp"
-#include "vertex-array-object.hpp"
+#include "vertex-format.hpp"
 
 namespace ogls
 {
@@ -49,15 +52,95 @@ struct Material {
     Material() {}
 };
 
-struct Vertex {
-    glm::vec3 position = glm::vec3(0.0f);   // vertex position
-    glm::vec3 normal = glm::vec3(0.0f);     // vertex normal
-    glm::vec2 texcoords = glm::vec3(0.0f);  // texture coordinates
-    glm::vec3 tangent = glm::vec3(0.0f);    // tangent vector(dp/du)
-    glm::vec3 dndu = glm::vec3(0.0f);  // differential of normal by texcoords
-    glm::vec3 dndv = glm::vec3(0.0f);  // differential of normal by texcoords
+// texture maps of Material, in order of TextureType
+inline constexpr std::optional<TextureID> Material::*material_texture_maps[] = {
+    &Material::diffuse_map,   &Material::specular_map,
+    &Material::ambient_map,   &Material::emissive_map,
+    &Material::height_map,    &Material::normal_map,
+    &Material::shininess_map, &Material::displacement_map,
+    &Material::light_map};
 
-    Vertex() {}
+// copy of material whose maps are cleared if their textures are not uploaded
+// yet
+Material getResidentMaterial(
+    const Material& material,
+    const std::vector<std::shared_ptr<Texture>>& textures);
+
+// element of material table used by multi draw indirect
+// layout of MaterialData in material-buffer.glsl(std430)
+struct GPUMaterial {
+    glm::vec4 kd = glm::vec4(0.0f);
+    glm::vec4 ks = glm::vec4(0.0f);
+    glm::vec4 ka = glm::vec4(0.0f);
+    glm::vec4 ke = glm::vec4(0.0f);
+    float shininess = 0.0f;
+    uint32_t has_height_map = 0;
+    uint32_t has_normal_map = 0;
+    uint32_t has_displacement_map = 0;
+    uint32_t has_light_map = 0;
+    uint32_t padding = 0;
+    // MaterialTextureTable references of maps in order of TextureType, used
+    // by DrawMode::Bindless
+    glm::uvec2 texture_maps[9];
+};
+static_assert(sizeof(GPUMaterial) == 160);
+
+// element of per draw table used by multi draw indirect, indexed by
+// gl_BaseInstance
+// layout of DrawData in draw-buffer.glsl(std430)
+struct GPUDrawData {
+    glm::vec4 position_offset = glm::vec4(0.0f);
+    glm::vec4 position_scale = glm::vec4(1.0f);
+    uint32_t material_id = 0;
+    uint32_t padding[3] = {0, 0, 0};
+};
+static_assert(sizeof(GPUDrawData) == 48);
+
+// same layout as glMultiDrawElementsIndirect expects
+struct DrawElementsIndirectCommand {
+    GLuint count = 0;
+    GLuint instance_count = 0;
+    GLuint first_index = 0;
+    GLint base_vertex = 0;
+    GLuint base_instance = 0;
+};
+
+// simplified index buffer of a mesh
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    // object space distance from the original surface
+    float error = 0.0f;
+};
+
+// cluster of triangles of a mesh, culled by its bounds
+struct Meshlet {
+    // range of indices of level of detail 0
+    uint32_t first_index = 0;
+    uint32_t n_indices = 0;
+    // bounding sphere
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    // normal cone, all triangles face away from viewers at p if
+    // dot(center - p, cone_axis) >= cone_cutoff * |center - p| + radius
+    // cone_cutoff is 1 if the cone is too wide to be culled
+    glm::vec3 cone_axis = glm::vec3(0.0f);
+    float cone_cutoff = 1.0f;
+};
+
+// range of indices of a mesh, relative to its first index
+struct IndexRange {
+    uint32_t first_index = 0;
+    uint32_t n_indices = 0;
+};
+
+// CPU side geometry kept by Mesh after upload
+enum class GeometryRetention {
+    // nothing is kept
+    None,
+    // positions and indices are kept, for picking and culling
+    PositionsAndIndices,
+    // all vertex attributes and indices are kept
+    All
 };
 
 // TODO: maybe this class should be data class and all the methods should be
@@ -67,8 +150,21 @@ class Mesh
 {
    public:
     Mesh();
+    // vertices and indices are sub-allocated from arena
+    // indices of lods follow the original indices in the same allocation
+    // vertices are packed in format, and indices are stored as 16 bit if
+    // possible
+    // data is copied through staging buffer if it's given and has enough space
+    // CPU side copy of geometry is kept according to retention, lods are not
+    // kept
+    // meshlets are ranges of the original indices, and always kept
     Mesh(const std::vector<Vertex>& vertices,
-         const std::vector<unsigned int>& indices, MaterialID material_index);
+         const std::vector<unsigned int>& indices,
+         const std::vector<MeshLod>& lods,
+         const std::vector<Meshlet>& meshlets, MaterialID material_index,
+         const VertexFormat& format, GeometryArena& arena,
+         StagingBuffer* staging = nullptr,
+         GeometryRetention retention = GeometryRetention::All);
     Mesh(const Mesh& other) = delete;
     Mesh(Mesh&& other);
     ~Mesh() = default;
@@ -76,23 +172,98 @@ class Mesh
     Mesh& operator=(const Mesh& other) = delete;
     Mesh& operator=(Mesh&& other);
 
+    // VAO of the arena for the format has to be bound before calling this
     // TODO: should be placed in Model class
+    // level of detail 0 is the original indices
     void draw(const Pipeline& pipeline, const Material& material,
-              const std::vector<Texture>& textures) const;
+              const std::vector<std::shared_ptr<Texture>>& textures,
+              uint32_t lod = 0) const;
+    // draw ranges of indices by one call, e.g. visible meshlets
+    void draw(const Pipeline& pipeline, const Material& material,
+              const std::vector<std::shared_ptr<Texture>>& textures,
+              const std::vector<IndexRange>& ranges) const;
+
+    // indirect draw command of this mesh
+    // base_instance is exposed to shaders as gl_BaseInstance
+    DrawElementsIndirectCommand getDrawCommand(GLuint base_instance,
+                                               uint32_t lod = 0) const;
+    DrawElementsIndirectCommand getDrawCommand(GLuint base_instance,
+                                               const IndexRange& range) const;
 
     uint32_t getNumberOfVertices() const;
-    uint32_t getNumberOfFaces() const;
+    uint32_t getNumberOfFaces(uint32_t lod = 0) const;
+    // indices of all levels of detail
+    uint32_t getNumberOfIndices() const;
     MaterialID getMaterialID() const;
 
+    // levels of detail including the original indices
+    uint32_t getNumberOfLods() const;
+    // object space distance from the original surface, 0 for level 0
+    float getLodError(uint32_t lod) const;
+    IndexRange getLodRange(uint32_t lod) const;
+
+    // empty if meshlets are not built
+    const std::vector<Meshlet>& getMeshlets() const;
+
+    // bounding sphere in object space
+    glm::vec3 getBoundingCenter() const;
+    float getBoundingRadius() const;
+
+    GeometryRetention getRetention() const;
+    // empty unless retention is GeometryRetention::All
+    const std::vector<Vertex>& getVertices() const;
+    // empty unless retention is GeometryRetention::PositionsAndIndices
+    const std::vector<glm::vec3>& getPositions() const;
+    // empty if retention is GeometryRetention::None
+    const std::vector<uint32_t>& getIndices() const;
+
+    // bytes of CPU side geometry
+    std::size_t getRetainedSize() const;
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum getIndexType() const;
+
+    // dequantization transform of positions
+    glm::vec3 getPositionOffset() const;
+    glm::vec3 getPositionScale() const;
+
+    // size of vertices and indices in GPU buffer
+    std::size_t getVertexBufferSize() const;
+    std::size_t getIndexBufferSize() const;
+
    private:
+    // range of indices of a level of detail
+    struct LodRange {
+        IndexRange range;
+        float error = 0.0f;
+    };
+
+    uint32_t n_vertices;
+    uint32_t n_indices;
+    std::vector<LodRange> lods;
+    std::vector<Meshlet> meshlets;
+
+    glm::vec3 bounding_center;
+    float bounding_radius;
+
+    GeometryRetention retention;
     std::vector<Vertex> vertices;
+    std::vector<glm::vec3> positions;
     std::vector<uint32_t> indices;
     // TODO: remove this field, this is only used in Model class
     MaterialID material_id;
 
-    VertexArrayObject vao;
-    Buffer vertex_buffer;
-    Buffer index_buffer;
+    GLenum index_type;
+    glm::vec3 position_offset;
+    glm::vec3 position_scale;
+
+    GeometryArena::Allocation allocation;
+
+    // bind textures of material, values of material are read from
+    // MaterialBlock and the dequantization transform is set by Model
+    void bindMaterial(const Material& material,
+                      const std::vector<std::shared_ptr<Texture>>& textures)
+        const;
 };
 
 }  // namespace ogls
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "meshlet-builder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "mesh-optimizer.hpp"
+
+namespace ogls
+{
+
+namespace
+{
+
+// weight of normal deviation against new vertices when choosing the next
+// triangle, larger values make tighter normal cones
+constexpr float cone_weight = 0.5f;
+// unused triangles searched for the nearest one when a meshlet has no
+// adjacent triangles left
+constexpr std::size_t seed_search_window = 64;
+// normal cones wider than this are never culled, as they face almost every
+// direction
+constexpr float min_cone_cosine = 0.1f;
+
+// meshes are not welded, so triangles are connected by position
+std::vector<uint32_t> weldPositions(const std::vector<Vertex>& vertices)
+{
+    struct Hash {
+        std::size_t operator()(const std::array<float, 3>& key) const
+        {
+            uint64_t ret = 14695981039346656037ULL;
+            for (const float f : key) {
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                ret = (ret ^ bits) * 1099511628211ULL;
+            }
+            return ret;
+        }
+    };
+
+    std::unordered_map<std::array<float, 3>, uint32_t, Hash> ids;
+    ids.reserve(vertices.size());
+
+    std::vector<uint32_t> ret(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        const glm::vec3& p = vertices[i].position;
+        ret[i] = ids.try_emplace({p.x, p.y, p.z}, ids.size()).first->second;
+    }
+    return ret;
+}
+
+// growing meshlets breaks the vertex cache order of triangles, so triangles
+// of the meshlet indices[first_index, first_index + n_indices) are ordered
+// again on its at most max_vertices vertices
+// local_ids has to be none for all vertices, and is left so
+void optimizeMeshletVertexCache(std::vector<uint32_t>& indices,
+                                const Meshlet& meshlet,
+                                std::vector<uint32_t>& local_ids)
+{
+    constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+    const auto begin = indices.begin() + meshlet.first_index;
+    const auto end = begin + meshlet.n_indices;
+
+    std::vector<uint32_t> global_ids;
+    std::vector<uint32_t> local_indices;
+    local_indices.reserve(meshlet.n_indices);
+    for (auto it = begin; it != end; ++it) {
+        if (local_ids[*it] == none) {
+            local_ids[*it] = global_ids.size();
+            global_ids.push_back(*it);
+        }
+        local_indices.push_back(local_ids[*it]);
+    }
+
+    local_indices =
+        MeshOptimizer::optimizeVertexCache(local_indices, global_ids.size());
+    std::transform(local_indices.begin(), local_indices.end(), begin,
+                   [&](uint32_t index) { return global_ids[index]; });
+
+    for (const auto v : global_ids) { local_ids[v] = none; }
+}
+
+}  // namespace
+
+void MeshletBuilder::build(MeshData& mesh)
+{
+    mesh.meshlets.clear();
+
+    const std::vector<Vertex>& vertices = mesh.vertices;
+    const std::vector<uint32_t>& indices = mesh.indices;
+    const std::size_t n_triangles = indices.size() / 3;
+    if (n_triangles == 0) { return; }
+
+    // triangles sharing each position, in CSR layout
+    const std::vector<uint32_t> positions = weldPositions(vertices);
+    const uint32_t n_positions =
+        *std::max_element(positions.begin(), positions.end()) + 1;
+    std::vector<uint32_t> offsets(n_positions + 1, 0);
+    for (std::size_t c = 0; c < 3 * n_triangles; ++c) {
+        offsets[positions[indices[c]] + 1]++;
+    }
+    for (uint32_t p = 0; p < n_positions; ++p) {
+        offsets[p + 1] += offsets[p];
+    }
+    std::vector<uint32_t> adjacency(3 * n_triangles);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t c = 0; c < 3 * n_triangles; ++c) {
+            adjacency[fill[positions[indices[c]]]++] = c / 3;
+        }
+    }
+
+    std::vector<glm::vec3> normals(n_triangles);
+    std::vector<glm::vec3> centroids(n_triangles);
+    for (std::size_t t = 0; t < n_triangles; ++t) {
+        const glm::vec3& p0 = vertices[indices[3 * t]].position;
+        const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+        const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+        centroids[t] = (p0 + p1 + p2) / 3.0f;
+    }
+
+    // state of the meshlet being built
+    constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> vertex_meshlet(vertices.size(), none);
+    std::vector<uint32_t> position_meshlet(n_positions, none);
+    std::vector<uint32_t> meshlet_positions;
+    std::size_t n_meshlet_vertices = 0;
+    std::size_t n_meshlet_triangles = 0;
+    glm::vec3 normal_sum(0.0f);
+    glm::vec3 centroid_sum(0.0f);
+
+    std::vector<bool> used(n_triangles, false);
+    std::size_t cursor = 0;
+
+    std::vector<uint32_t> ret;
+    ret.reserve(indices.size());
+    uint32_t meshlet_id = 0;
+
+    const auto count_new_vertices = [&](std::size_t t) {
+        std::size_t count = 0;
+        for (std::size_t k = 0; k < 3; ++k) {
+            if (vertex_meshlet[indices[3 * t + k]] != meshlet_id) { count++; }
+        }
+        // repeated indices of degenerate triangles
+        if (indices[3 * t] == indices[3 * t + 1] ||
+            indices[3 * t] == indices[3 * t + 2]) {
+            count -= vertex_meshlet[indices[3 * t]] != meshlet_id;
+        }
+        if (indices[3 * t + 1] == indices[3 * t + 2]) {
+            count -= vertex_meshlet[indices[3 * t + 1]] != meshlet_id;
+        }
+        return count;
+    };
+
+    const auto finish_meshlet = [&]() {
+        const uint32_t n_indices = 3 * n_meshlet_triangles;
+        mesh.meshlets.push_back(computeBounds(
+            vertices, ret, static_cast<uint32_t>(ret.size()) - n_indices,
+            n_indices));
+
+        meshlet_id++;
+        meshlet_positions.clear();
+        n_meshlet_vertices = 0;
+        n_meshlet_triangles = 0;
+        normal_sum = glm::vec3(0.0f);
+        centroid_sum = glm::vec3(0.0f);
+    };
+
+    for (std::size_t n_added = 0; n_added < n_triangles; ++n_added) {
+        // prefer adjacent triangles adding few vertices and bending the normal
+        // cone little
+        std::size_t best = none;
+        float best_score = std::numeric_limits<float>::max();
+        const float normal_length = glm::length(normal_sum);
+        const glm::vec3 axis = normal_length > 0.0f
+                                   ? normal_sum / normal_length
+                                   : glm::vec3(0.0f);
+        for (const auto p : meshlet_positions) {
+            for (uint32_t i = offsets[p]; i < offsets[p + 1]; ++i) {
+                const uint32_t t = adjacency[i];
+                if (used[t]) { continue; }
+
+                const std::size_t n_new = count_new_vertices(t);
+                if (n_meshlet_vertices + n_new > max_vertices) { continue; }
+
+                const float score =
+                    n_new + cone_weight * (1.0f - glm::dot(normals[t], axis));
+                if (score < best_score) {
+                    best = t;
+                    best_score = score;
+                }
+            }
+        }
+
+        // otherwise continue with the nearest of the next unused triangles,
+        // which are likely close in vertex cache order
+        if (best == none) {
+            while (used[cursor]) { cursor++; }
+
+            if (n_meshlet_triangles > 0 &&
+                n_meshlet_vertices + 3 > max_vertices) {
+                finish_meshlet();
+            }
+
+            const glm::vec3 centroid =
+                n_meshlet_triangles > 0
+                    ? centroid_sum / static_cast<float>(n_meshlet_triangles)
+                    : centroids[cursor];
+            float best_distance = std::numeric_limits<float>::max();
+            std::size_t n_searched = 0;
+            for (std::size_t t = cursor;
+                 t < n_triangles && n_searched < seed_search_window; ++t) {
+                if (used[t]) { continue; }
+                n_searched++;
+
+                const glm::vec3 d = centroids[t] - centroid;
+                const float distance = glm::dot(d, d);
+                if (distance < best_distance) {
+                    best = t;
+                    best_distance = distance;
+                }
+            }
+        }
+
+        // add triangle to the meshlet
+        used[best] = true;
+        for (std::size_t k = 0; k < 3; ++k) {
+            const uint32_t v = indices[3 * best + k];
+            ret.push_back(v);
+            if (vertex_meshlet[v] != meshlet_id) {
+                vertex_meshlet[v] = meshlet_id;
+                n_meshlet_vertices++;
+            }
+            if (position_meshlet[positions[v]] != meshlet_id) {
+                position_meshlet[positions[v]] = meshlet_id;
+                meshlet_positions.push_back(positions[v]);
+            }
+        }
+        n_meshlet_triangles++;
+        normal_sum += normals[best];
+        centroid_sum += centroids[best];
+
+        if (n_meshlet_triangles == max_triangles ||
+            n_meshlet_vertices == max_vertices) {
+            finish_meshlet();
+        }
+    }
+    if (n_meshlet_triangles > 0) { finish_meshlet(); }
+
+    // bounds don't depend on the order of triangles in a meshlet
+    std::fill(vertex_meshlet.begin(), vertex_meshlet.end(), none);
+    for (const auto& meshlet : mesh.meshlets) {
+        optimizeMeshletVertexCache(ret, meshlet, vertex_meshlet);
+    }
+
+    mesh.indices = std::move(ret);
+    MeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+Meshlet MeshletBuilder::computeBounds(const std::vector<Vertex>& vertices,
+                                      const std::vector<uint32_t>& indices,
+                                      uint32_t first_index, uint32_t n_indices)
+{
+    Meshlet ret;
+    ret.first_index = first_index;
+    ret.n_indices = n_indices;
+    if (n_indices == 0) { return ret; }
+
+    // bounding sphere around center of bounding box
+    glm::vec3 p_min(std::numeric_limits<float>::max());
+    glm::vec3 p_max(std::numeric_limits<float>::lowest());
+    for (uint32_t i = first_index; i < first_index + n_indices; ++i) {
+        p_min = glm::min(p_min, vertices[indices[i]].position);
+        p_max = glm::max(p_max, vertices[indices[i]].position);
+    }
+    ret.center = 0.5f * (p_min + p_max);
+    for (uint32_t i = first_index; i < first_index + n_indices; ++i) {
+        ret.radius = std::max(
+            ret.radius,
+            glm::length(vertices[indices[i]].position - ret.center));
+    }
+
+    // normal cone around average normal
+    std::vector<glm::vec3> normals;
+    normals.reserve(n_indices / 3);
+    glm::vec3 normal_sum(0.0f);
+    for (uint32_t i = first_index; i + 2 < first_index + n_indices; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].position;
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(n);
+        if (length == 0.0f) { continue; }
+
+        normals.push_back(n / length);
+        normal_sum += normals.back();
+    }
+
+    const float axis_length = glm::length(normal_sum);
+    if (normals.empty() || axis_length == 0.0f) { return ret; }
+
+    const glm::vec3 axis = normal_sum / axis_length;
+    float min_cosine = 1.0f;
+    for (const auto& n : normals) {
+        min_cosine = std::min(min_cosine, glm::dot(n, axis));
+    }
+    if (min_cosine <= min_cone_cosine) { return ret; }
+
+    // sine of the cone angle, triangles face away from viewers within
+    // 90 degrees - angle of the axis
+    ret.cone_axis = axis;
+    ret.cone_cutoff = std::sqrt(1.0f - min_cosine * min_cosine);
+    return ret;
+}
+
+}  // namespace ogls
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "model-data.hpp"
+
+namespace ogls
+{
+
+// split meshes into meshlets, small clusters of triangles which are culled
+// separately by their bounding spheres and normal cones
+// triangles of a meshlet are contiguous in the index buffer, so a mesh is
+// drawn by ranges of indices of its visible meshlets
+class MeshletBuilder
+{
+   public:
+    // reorder triangles of mesh.indices into meshlets and fill mesh.meshlets
+    // meshlets are grown greedily over triangles sharing vertices, starting
+    // from the existing order, so indices should be optimized for vertex
+    // cache beforehand. triangles of each meshlet are then optimized for
+    // vertex cache again, and vertices are reordered for vertex fetch
+    static void build(MeshData& mesh);
+
+    // limits of a meshlet, same as the common limits of mesh shaders
+    static constexpr std::size_t max_vertices = 64;
+    static constexpr std::size_t max_triangles = 124;
+
+    // bounds of triangles indices[first_index, first_index + n_indices)
+    static Meshlet computeBounds(const std::vector<Vertex>& vertices,
+                                 const std::vector<uint32_t>& indices,
+                                 uint32_t first_index, uint32_t n_indices);
+};
+
+}  // namespace ogls
@@ -0,0 +1,380 @@
+#include "mip-generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "thread-pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OGLS_MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ogls
+{
+
+namespace
+{
+
+// rows of the next level per chunk of ThreadPool::parallelFor
+constexpr std::size_t row_grain_size = 16;
+// entries of the table converting linear values to sRGB
+constexpr std::size_t srgb_table_size = 16384;
+// shape of Kaiser window, larger values have smaller side lobes
+constexpr float kaiser_alpha = 4.0f;
+// source texels read on each side of a destination texel by the kernels
+constexpr int padding = 2;
+constexpr float pi = 3.14159265358979f;
+
+#ifdef OGLS_MIP_GENERATOR_SSE2
+// 4 floats processed at once
+struct Lanes {
+    static constexpr std::size_t width = 4;
+    __m128 v;
+
+    static Lanes load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Lanes broadcast(float x) { return {_mm_set1_ps(x)}; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    static Lanes sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+    static Lanes min(Lanes a, Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+    static Lanes max(Lanes a, Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+};
+#else
+// scalar fallback
+struct Lanes {
+    static constexpr std::size_t width = 1;
+    float v;
+
+    static Lanes load(const float* p) { return {*p}; }
+    static Lanes broadcast(float x) { return {x}; }
+    void store(float* p) const { *p = v; }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {a.v + b.v}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {a.v * b.v}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {a.v / b.v}; }
+
+    static Lanes sqrt(Lanes a) { return {std::sqrt(a.v)}; }
+    static Lanes min(Lanes a, Lanes b) { return {std::min(a.v, b.v)}; }
+    static Lanes max(Lanes a, Lanes b) { return {std::max(a.v, b.v)}; }
+};
+#endif
+
+// weights of source texels 2 * x + first + k for destination texel x
+struct Kernel {
+    int first = 0;
+    std::vector<float> weights;
+
+    int size() const { return static_cast<int>(weights.size()); }
+};
+
+// modified Bessel function of the first kind of order 0
+float besselI0(float x)
+{
+    float ret = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        ret += term;
+        if (term < 1e-8f * ret) { break; }
+    }
+    return ret;
+}
+
+const Kernel& getKernel(MipFilter filter)
+{
+    static const Kernel box = {0, {0.5f, 0.5f}};
+    static const Kernel kaiser = []() {
+        // source texels are at -2.5, ..., 2.5 from the center of destination
+        // texel, which are -1.25, ..., 1.25 in destination texels
+        constexpr float window = 1.5f;
+        Kernel ret;
+        ret.first = -2;
+        float sum = 0.0f;
+        for (int k = 0; k < 6; ++k) {
+            const float t = 0.5f * (k - 2.5f);
+            const float sinc = std::sin(pi * t) / (pi * t);
+            const float r = t / window;
+            const float kaiser =
+                besselI0(kaiser_alpha * std::sqrt(1.0f - r * r)) /
+                besselI0(kaiser_alpha);
+            ret.weights.push_back(sinc * kaiser);
+            sum += ret.weights.back();
+        }
+        for (auto& weight : ret.weights) { weight /= sum; }
+        return ret;
+    }();
+    return filter == MipFilter::Box ? box : kaiser;
+}
+
+bool isSRGB(TextureType type)
+{
+    return type == TextureType::Diffuse || type == TextureType::Ambient ||
+           type == TextureType::Emissive;
+}
+
+const std::array<float, 256>& getSRGBToLinearTable()
+{
+    static const std::array<float, 256> table = []() {
+        std::array<float, 256> ret;
+        for (int i = 0; i < 256; ++i) {
+            const float c = i / 255.0f;
+            ret[i] = c <= 0.04045f ? c / 12.92f
+                                   : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return ret;
+    }();
+    return table;
+}
+
+const std::vector<uint8_t>& getLinearToSRGBTable()
+{
+    static const std::vector<uint8_t> table = []() {
+        std::vector<uint8_t> ret(srgb_table_size);
+        for (std::size_t i = 0; i < srgb_table_size; ++i) {
+            const float c = static_cast<float>(i) / (srgb_table_size - 1);
+            const float s = c <= 0.0031308f
+                                ? 12.92f * c
+                                : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            ret[i] = static_cast<uint8_t>(255.0f * s + 0.5f);
+        }
+        return ret;
+    }();
+    return table;
+}
+
+uint8_t quantize(float v)
+{
+    return static_cast<uint8_t>(std::clamp(255.0f * v + 0.5f, 0.0f, 255.0f));
+}
+
+}  // namespace
+
+MipChain MipGenerator::generate(const uint8_t* image,
+                                const glm::uvec2& resolution,
+                                TextureType type, MipFilter filter)
+{
+    MipChain ret;
+
+    // layout of levels
+    glm::uvec2 level_resolution = resolution;
+    std::size_t size = 0;
+    while (true) {
+        MipChain::Level level;
+        level.resolution = level_resolution;
+        level.offset = size;
+        level.size = 3 * level_resolution.x * level_resolution.y;
+        ret.levels.push_back(level);
+        size += level.size;
+
+        if (level_resolution.x == 1 && level_resolution.y == 1) { break; }
+        level_resolution = glm::uvec2(std::max(level_resolution.x / 2, 1u),
+                                      std::max(level_resolution.y / 2, 1u));
+    }
+    ret.data.resize(size);
+
+    std::memcpy(ret.data.data(), image, ret.levels[0].size);
+    if (ret.levels.size() == 1) { return ret; }
+
+    Planes planes = decode(image, resolution, type);
+    for (std::size_t i = 1; i < ret.levels.size(); ++i) {
+        planes = downsample(planes, type, filter);
+        encode(planes, type, ret.data.data() + ret.levels[i].offset);
+    }
+
+    return ret;
+}
+
+MipGenerator::Planes MipGenerator::decode(const uint8_t* image,
+                                          const glm::uvec2& resolution,
+                                          TextureType type)
+{
+    const std::array<float, 256>& to_linear = getSRGBToLinearTable();
+
+    Planes ret;
+    ret.resolution = resolution;
+    const std::size_t n_texels = resolution.x * resolution.y;
+    for (auto& channel : ret.channels) { channel.resize(n_texels); }
+
+    ThreadPool::getGlobal().parallelFor(
+        resolution.y, row_grain_size, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin * resolution.x; i < end * resolution.x;
+                 ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    const uint8_t v = image[3 * i + c];
+                    if (isSRGB(type)) {
+                        ret.channels[c][i] = to_linear[v];
+                    } else if (type == TextureType::Normal) {
+                        ret.channels[c][i] = v / 127.5f - 1.0f;
+                    } else {
+                        ret.channels[c][i] = v / 255.0f;
+                    }
+                }
+            }
+        });
+
+    return ret;
+}
+
+MipGenerator::Planes MipGenerator::downsample(const Planes& planes,
+                                              TextureType type,
+                                              MipFilter filter)
+{
+    const Kernel& kernel = getKernel(filter);
+    const glm::uvec2 src = planes.resolution;
+
+    Planes ret;
+    ret.resolution =
+        glm::uvec2(std::max(src.x / 2, 1u), std::max(src.y / 2, 1u));
+    const std::size_t width = ret.resolution.x;
+    for (auto& channel : ret.channels) {
+        channel.resize(width * ret.resolution.y);
+    }
+
+    // rows are processed in whole lanes, so scratch rows are rounded up
+    const std::size_t n_lanes = (width + Lanes::width - 1) / Lanes::width;
+    const std::size_t padded_width = n_lanes * Lanes::width;
+
+    ThreadPool::getGlobal().parallelFor(
+        ret.resolution.y, row_grain_size,
+        [&](std::size_t begin, std::size_t end) {
+            // filtered columns, even and odd texels of them with clamped
+            // padding on both sides, and filtered rows
+            std::vector<float> column(src.x + Lanes::width);
+            std::vector<float> even(padded_width + 2 * padding);
+            std::vector<float> odd(padded_width + 2 * padding);
+            std::array<std::vector<float>, 3> rows;
+            for (auto& row : rows) { row.resize(padded_width); }
+
+            for (std::size_t y = begin; y < end; ++y) {
+                for (int c = 0; c < 3; ++c) {
+                    // vertical pass
+                    std::fill(column.begin(), column.end(), 0.0f);
+                    for (int k = 0; k < kernel.size(); ++k) {
+                        const int64_t sy = std::clamp<int64_t>(
+                            2 * static_cast<int64_t>(y) + kernel.first + k, 0,
+                            src.y - 1);
+                        const float* src_row =
+                            planes.channels[c].data() + sy * src.x;
+                        const Lanes weight =
+                            Lanes::broadcast(kernel.weights[k]);
+                        std::size_t x = 0;
+                        for (; x + Lanes::width <= src.x; x += Lanes::width) {
+                            (Lanes::load(&column[x]) +
+                             weight * Lanes::load(src_row + x))
+                                .store(&column[x]);
+                        }
+                        for (; x < src.x; ++x) {
+                            column[x] += kernel.weights[k] * src_row[x];
+                        }
+                    }
+
+                    // split into even and odd texels
+                    for (std::size_t i = 0; i < even.size(); ++i) {
+                        const int64_t x = static_cast<int64_t>(i) - padding;
+                        even[i] = column[std::clamp<int64_t>(2 * x, 0,
+                                                             src.x - 1)];
+                        odd[i] = column[std::clamp<int64_t>(2 * x + 1, 0,
+                                                            src.x - 1)];
+                    }
+
+                    // horizontal pass
+                    float* row = rows[c].data();
+                    for (std::size_t x = 0; x < padded_width;
+                         x += Lanes::width) {
+                        Lanes sum = Lanes::broadcast(0.0f);
+                        for (int k = 0; k < kernel.size(); ++k) {
+                            // source texel 2 * x + offset
+                            const int offset = kernel.first + k;
+                            const int shift =
+                                (offset - (offset & 1)) / 2 + padding;
+                            const float* source =
+                                (offset & 1) ? odd.data() : even.data();
+                            sum = sum + Lanes::broadcast(kernel.weights[k]) *
+                                            Lanes::load(source + x + shift);
+                        }
+                        sum.store(row + x);
+                    }
+                }
+
+                float* dst[3];
+                for (int c = 0; c < 3; ++c) {
+                    dst[c] = ret.channels[c].data() + y * width;
+                }
+
+                if (type == TextureType::Normal) {
+                    // renormalize, zero vectors point along z
+                    for (std::size_t x = 0; x < padded_width;
+                         x += Lanes::width) {
+                        const Lanes nx = Lanes::load(&rows[0][x]);
+                        const Lanes ny = Lanes::load(&rows[1][x]);
+                        const Lanes nz = Lanes::load(&rows[2][x]);
+                        const Lanes length = Lanes::max(
+                            Lanes::sqrt(nx * nx + ny * ny + nz * nz),
+                            Lanes::broadcast(1e-6f));
+                        (nx / length).store(&rows[0][x]);
+                        (ny / length).store(&rows[1][x]);
+                        (nz / length).store(&rows[2][x]);
+                    }
+                    for (std::size_t x = 0; x < width; ++x) {
+                        if (rows[0][x] == 0.0f && rows[1][x] == 0.0f &&
+                            rows[2][x] == 0.0f) {
+                            rows[2][x] = 1.0f;
+                        }
+                    }
+                } else {
+                    // negative lobes of Kaiser overshoot
+                    const Lanes zero = Lanes::broadcast(0.0f);
+                    const Lanes one = Lanes::broadcast(1.0f);
+                    for (int c = 0; c < 3; ++c) {
+                        for (std::size_t x = 0; x < padded_width;
+                             x += Lanes::width) {
+                            Lanes::min(Lanes::max(Lanes::load(&rows[c][x]),
+                                                  zero),
+                                       one)
+                                .store(&rows[c][x]);
+                        }
+                    }
+                }
+
+                for (int c = 0; c < 3; ++c) {
+                    std::memcpy(dst[c], rows[c].data(), sizeof(float) * width);
+                }
+            }
+        });
+
+    return ret;
+}
+
+void MipGenerator::encode(const Planes& planes, TextureType type,
+                          uint8_t* dst)
+{
+    const std::vector<uint8_t>& to_srgb = getLinearToSRGBTable();
+    const glm::uvec2 resolution = planes.resolution;
+
+    ThreadPool::getGlobal().parallelFor(
+        resolution.y, row_grain_size, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin * resolution.x; i < end * resolution.x;
+                 ++i) {
+                for (int c = 0; c < 3; ++c) {
+                    const float v = planes.channels[c][i];
+                    if (isSRGB(type)) {
+                        dst[3 * i + c] = to_srgb[static_cast<std::size_t>(
+                            v * (srgb_table_size - 1) + 0.5f)];
+                    } else if (type == TextureType::Normal) {
+                        dst[3 * i + c] = quantize(0.5f * v + 0.5f);
+                    } else {
+                        dst[3 * i + c] = quantize(v);
+                    }
+                }
+            }
+        });
+}
+
+}  // namespace ogls
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+//
+#include "texture.hpp"
+
+namespace ogls
+{
+
+enum class MipFilter {
+    // average of 2x2 texels
+    Box,
+    // Kaiser windowed sinc over 6x6 texels, sharper than box
+    Kaiser
+};
+
+// RGB8 mip chain, levels are stored back to back in data, level 0 first
+struct MipChain {
+    struct Level {
+        glm::uvec2 resolution = glm::uvec2(0);
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    std::vector<uint8_t> data;
+    std::vector<Level> levels;
+};
+
+// build mip chains on the CPU instead of glGenerateTextureMipmap, so that
+// they are built on worker threads and filtered the same on every driver
+// - diffuse, ambient and emissive maps(sRGB) are filtered in linear space
+// - normal maps are renormalized after filtering
+// - other maps are filtered as they are
+// levels are filtered from the previous level in float, the filter is
+// separable and its kernels are SIMD, and rows are split across threads of
+// the global ThreadPool
+class MipGenerator
+{
+   public:
+    // full chain down to 1x1, level 0 is a copy of image
+    static MipChain generate(const uint8_t* image,
+                             const glm::uvec2& resolution, TextureType type,
+                             MipFilter filter = MipFilter::Kaiser);
+
+   private:
+    // channels of a level in separate planes, so that rows are SIMD friendly
+    struct Planes {
+        glm::uvec2 resolution = glm::uvec2(0);
+        std::vector<float> channels[3];
+    };
+
+    static Planes decode(const uint8_t* image, const glm::uvec2& resolution,
+                         TextureType type);
+    static Planes downsample(const Planes& planes, TextureType type,
+                             MipFilter filter);
+    static void encode(const Planes& planes, TextureType type, uint8_t* dst);
+};
+
+}  // namespace ogls
@@ -0,0 +1,610 @@
+#include "model-cache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "mapped-file.hpp"
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+// bump this when layout of the cache file or Vertex changes
+constexpr uint32_t cache_version = 5;
+constexpr char cache_magic[8] = {'O', 'G', 'L', 'S', 'M', 'D', 'L', '\0'};
+// every section starts at this alignment
+constexpr std::size_t section_alignment = 16;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertex_size;
+    uint64_t key;
+    uint32_t import_flags;
+    uint32_t process_flags;
+    uint32_t n_meshes;
+    uint32_t n_materials;
+    uint32_t n_textures;
+    uint64_t n_lods;
+    uint64_t n_meshlets;
+    uint64_t n_vertices;
+    // including indices of levels of detail
+    uint64_t n_indices;
+    uint64_t meshes_offset;
+    uint64_t lods_offset;
+    uint64_t meshlets_offset;
+    uint64_t materials_offset;
+    uint64_t textures_offset;
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+    uint64_t strings_offset;
+    uint64_t file_size;
+};
+
+struct MeshRecord {
+    uint64_t first_vertex;
+    uint64_t n_vertices;
+    uint64_t first_index;
+    uint64_t n_indices;
+    uint32_t material_id;
+    uint32_t n_lods;
+    uint64_t first_lod;
+    uint64_t first_meshlet;
+    uint32_t n_meshlets;
+    uint32_t padding;
+};
+
+// indices of levels of detail follow indices of all meshes
+struct LodRecord {
+    uint64_t first_index;
+    uint64_t n_indices;
+    float error;
+    uint32_t padding;
+};
+
+struct MeshletRecord {
+    uint32_t first_index;
+    uint32_t n_indices;
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+};
+
+struct MaterialRecord {
+    float kd[3];
+    float ks[3];
+    float ka[3];
+    float ke[3];
+    float shininess;
+    // in order of material_texture_maps, -1 if there is no map
+    int32_t maps[9];
+};
+
+struct TextureRecord {
+    uint32_t type;
+    uint32_t path_length;
+    uint64_t path_offset;
+};
+
+// is [first, first + count) in [0, total)? this doesn't overflow
+bool isRange(uint64_t first, uint64_t count, uint64_t total)
+{
+    return count <= total && first <= total - count;
+}
+
+// files assimp reads besides the source file, material libraries of .obj and
+// buffers of .gltf. textures are not included, they are loaded separately
+std::vector<std::filesystem::path> findSideFiles(
+    const std::filesystem::path& filepath, const MappedFile& file)
+{
+    const std::string_view text(reinterpret_cast<const char*>(file.getData()),
+                                file.getSize());
+    std::string extension = filepath.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    std::vector<std::filesystem::path> ret;
+    if (extension == ".obj") {
+        // the rest of the line is the name, like assimp reads it
+        constexpr std::string_view mtllib = "mtllib";
+        std::size_t begin = 0;
+        while (begin < text.size()) {
+            std::size_t end = text.find('\n', begin);
+            if (end == std::string_view::npos) { end = text.size(); }
+            std::string_view line = text.substr(begin, end - begin);
+            begin = end + 1;
+
+            if (!line.starts_with(mtllib)) { continue; }
+            line.remove_prefix(mtllib.size());
+            const std::size_t first = line.find_first_not_of(" \t");
+            const std::size_t last = line.find_last_not_of(" \t\r");
+            if (first == std::string_view::npos) { continue; }
+            ret.push_back(filepath.parent_path() /
+                          std::string(line.substr(first, last - first + 1)));
+        }
+    } else if (extension == ".gltf") {
+        constexpr std::string_view uri_key = "\"uri\"";
+        for (std::size_t pos = text.find(uri_key);
+             pos != std::string_view::npos;
+             pos = text.find(uri_key, pos + uri_key.size())) {
+            const std::size_t open = text.find('"', pos + uri_key.size());
+            if (open == std::string_view::npos) { break; }
+            const std::size_t close = text.find('"', open + 1);
+            if (close == std::string_view::npos) { break; }
+
+            // data URIs are embedded, and images are textures
+            const std::string_view uri =
+                text.substr(open + 1, close - open - 1);
+            if (uri.ends_with(".bin")) {
+                ret.push_back(filepath.parent_path() / std::string(uri));
+            }
+        }
+    }
+    return ret;
+}
+
+std::size_t align(std::size_t offset)
+{
+    return (offset + section_alignment - 1) & ~(section_alignment - 1);
+}
+
+MeshletRecord toRecord(const Meshlet& meshlet)
+{
+    MeshletRecord ret;
+    ret.first_index = meshlet.first_index;
+    ret.n_indices = meshlet.n_indices;
+    std::memcpy(ret.center, &meshlet.center, sizeof(ret.center));
+    ret.radius = meshlet.radius;
+    std::memcpy(ret.cone_axis, &meshlet.cone_axis, sizeof(ret.cone_axis));
+    ret.cone_cutoff = meshlet.cone_cutoff;
+    return ret;
+}
+
+Meshlet fromRecord(const MeshletRecord& record)
+{
+    Meshlet ret;
+    ret.first_index = record.first_index;
+    ret.n_indices = record.n_indices;
+    ret.center =
+        glm::vec3(record.center[0], record.center[1], record.center[2]);
+    ret.radius = record.radius;
+    ret.cone_axis = glm::vec3(record.cone_axis[0], record.cone_axis[1],
+                              record.cone_axis[2]);
+    ret.cone_cutoff = record.cone_cutoff;
+    return ret;
+}
+
+MaterialRecord toRecord(const Material& material)
+{
+    MaterialRecord ret;
+    std::memcpy(ret.kd, &material.kd, sizeof(ret.kd));
+    std::memcpy(ret.ks, &material.ks, sizeof(ret.ks));
+    std::memcpy(ret.ka, &material.ka, sizeof(ret.ka));
+    std::memcpy(ret.ke, &material.ke, sizeof(ret.ke));
+    ret.shininess = material.shininess;
+    for (std::size_t i = 0; i < 9; ++i) {
+        const auto& map = material.*material_texture_maps[i];
+        ret.maps[i] = map ? static_cast<int32_t>(map.value()) : -1;
+    }
+    return ret;
+}
+
+Material fromRecord(const MaterialRecord& record)
+{
+    Material ret;
+    ret.kd = glm::vec3(record.kd[0], record.kd[1], record.kd[2]);
+    ret.ks = glm::vec3(record.ks[0], record.ks[1], record.ks[2]);
+    ret.ka = glm::vec3(record.ka[0], record.ka[1], record.ka[2]);
+    ret.ke = glm::vec3(record.ke[0], record.ke[1], record.ke[2]);
+    ret.shininess = record.shininess;
+    for (std::size_t i = 0; i < 9; ++i) {
+        if (record.maps[i] >= 0) {
+            ret.*material_texture_maps[i] =
+                static_cast<TextureID>(record.maps[i]);
+        }
+    }
+    return ret;
+}
+
+}  // namespace
+
+uint64_t ModelCache::computeHash(const void* data, std::size_t size,
+                                 uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::optional<uint64_t> ModelCache::computeKey(
+    const std::filesystem::path& filepath, uint32_t import_flags,
+    uint32_t process_flags)
+{
+    const MappedFile file(filepath);
+    if (!file) { return std::nullopt; }
+
+    uint64_t key = computeHash(file.getData(), file.getSize());
+    // side files are hashed by content too, missing ones by name, so that
+    // creating them changes the key as well
+    for (const auto& side_path : findSideFiles(filepath, file)) {
+        const std::string name = side_path.generic_string();
+        key = computeHash(name.data(), name.size(), key);
+        const MappedFile side_file(side_path);
+        if (side_file) {
+            key = computeHash(side_file.getData(), side_file.getSize(), key);
+        }
+    }
+    key = computeHash(&import_flags, sizeof(import_flags), key);
+    key = computeHash(&process_flags, sizeof(process_flags), key);
+    key = computeHash(&cache_version, sizeof(cache_version), key);
+    return key;
+}
+
+std::filesystem::path ModelCache::getCachePath(
+    const std::filesystem::path& filepath, uint64_t key)
+{
+    return filepath.parent_path() / ".ogls-cache" /
+           fmt::format("{}.{:016x}.bin", filepath.filename().string(), key);
+}
+
+std::optional<ModelData> ModelCache::load(const std::filesystem::path& filepath,
+                                          uint32_t import_flags,
+                                          uint32_t process_flags)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::optional<uint64_t> key =
+        computeKey(filepath, import_flags, process_flags);
+    if (!key) { return std::nullopt; }
+
+    const std::filesystem::path cache_path = getCachePath(filepath, *key);
+    const MappedFile file(cache_path);
+    if (!file) { return std::nullopt; }
+
+    // validate header
+    const uint8_t* base = file.getData();
+    if (file.getSize() < sizeof(CacheHeader)) { return std::nullopt; }
+    CacheHeader header;
+    std::memcpy(&header, base, sizeof(CacheHeader));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version ||
+        header.vertex_size != sizeof(Vertex) || header.key != *key ||
+        header.import_flags != import_flags ||
+        header.process_flags != process_flags ||
+        header.file_size != file.getSize()) {
+        spdlog::warn("[ModelCache] ignoring invalid cache {}",
+                     cache_path.string());
+        return std::nullopt;
+    }
+
+    // nothing read from the file is trusted, sections, indices and strings
+    // are checked before they are read
+    const auto reject = [&]() {
+        spdlog::warn("[ModelCache] ignoring corrupted cache {}",
+                     cache_path.string());
+        return std::nullopt;
+    };
+    const auto fits = [&](uint64_t offset, uint64_t count,
+                          std::size_t element_size) {
+        return offset <= file.getSize() &&
+               count <= (file.getSize() - offset) / element_size;
+    };
+    if (!fits(header.meshes_offset, header.n_meshes, sizeof(MeshRecord)) ||
+        !fits(header.lods_offset, header.n_lods, sizeof(LodRecord)) ||
+        !fits(header.meshlets_offset, header.n_meshlets,
+              sizeof(MeshletRecord)) ||
+        !fits(header.materials_offset, header.n_materials,
+              sizeof(MaterialRecord)) ||
+        !fits(header.textures_offset, header.n_textures,
+              sizeof(TextureRecord)) ||
+        !fits(header.vertices_offset, header.n_vertices, sizeof(Vertex)) ||
+        !fits(header.indices_offset, header.n_indices, sizeof(uint32_t)) ||
+        header.strings_offset > file.getSize()) {
+        return reject();
+    }
+    const uint64_t strings_size = file.getSize() - header.strings_offset;
+
+    const MeshRecord* mesh_records =
+        reinterpret_cast<const MeshRecord*>(base + header.meshes_offset);
+    const LodRecord* lod_records =
+        reinterpret_cast<const LodRecord*>(base + header.lods_offset);
+    const MeshletRecord* meshlet_records =
+        reinterpret_cast<const MeshletRecord*>(base + header.meshlets_offset);
+    const MaterialRecord* material_records =
+        reinterpret_cast<const MaterialRecord*>(base +
+                                                header.materials_offset);
+    const TextureRecord* texture_records =
+        reinterpret_cast<const TextureRecord*>(base + header.textures_offset);
+    const Vertex* vertices =
+        reinterpret_cast<const Vertex*>(base + header.vertices_offset);
+    const uint32_t* indices =
+        reinterpret_cast<const uint32_t*>(base + header.indices_offset);
+    const char* strings =
+        reinterpret_cast<const char*>(base + header.strings_offset);
+
+    ModelData ret;
+
+    ret.meshes.resize(header.n_meshes);
+    for (std::size_t i = 0; i < header.n_meshes; ++i) {
+        const MeshRecord& record = mesh_records[i];
+        if (!isRange(record.first_vertex, record.n_vertices,
+                     header.n_vertices) ||
+            !isRange(record.first_index, record.n_indices, header.n_indices) ||
+            !isRange(record.first_lod, record.n_lods, header.n_lods) ||
+            !isRange(record.first_meshlet, record.n_meshlets,
+                     header.n_meshlets) ||
+            record.material_id >= header.n_materials) {
+            return reject();
+        }
+
+        // indices are read on CPU by culling and simplification too
+        const auto is_index_valid = [&](uint32_t index) {
+            return index < record.n_vertices;
+        };
+
+        MeshData& mesh = ret.meshes[i];
+        mesh.vertices.assign(
+            vertices + record.first_vertex,
+            vertices + record.first_vertex + record.n_vertices);
+        mesh.indices.assign(indices + record.first_index,
+                            indices + record.first_index + record.n_indices);
+        if (!std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                         is_index_valid)) {
+            return reject();
+        }
+        mesh.material_id = record.material_id;
+
+        mesh.lods.resize(record.n_lods);
+        for (std::size_t j = 0; j < record.n_lods; ++j) {
+            const LodRecord& lod_record = lod_records[record.first_lod + j];
+            if (!isRange(lod_record.first_index, lod_record.n_indices,
+                         header.n_indices)) {
+                return reject();
+            }
+
+            MeshLod& lod = mesh.lods[j];
+            lod.indices.assign(
+                indices + lod_record.first_index,
+                indices + lod_record.first_index + lod_record.n_indices);
+            if (!std::all_of(lod.indices.begin(), lod.indices.end(),
+                             is_index_valid)) {
+                return reject();
+            }
+            lod.error = lod_record.error;
+        }
+
+        mesh.meshlets.reserve(record.n_meshlets);
+        for (std::size_t j = 0; j < record.n_meshlets; ++j) {
+            const Meshlet meshlet =
+                fromRecord(meshlet_records[record.first_meshlet + j]);
+            if (!isRange(meshlet.first_index, meshlet.n_indices,
+                         record.n_indices)) {
+                return reject();
+            }
+            mesh.meshlets.push_back(meshlet);
+        }
+    }
+
+    ret.materials.reserve(header.n_materials);
+    for (std::size_t i = 0; i < header.n_materials; ++i) {
+        const MaterialRecord& record = material_records[i];
+        for (const int32_t map : record.maps) {
+            if (map >= 0 && static_cast<uint32_t>(map) >= header.n_textures) {
+                return reject();
+            }
+        }
+        ret.materials.push_back(fromRecord(record));
+    }
+
+    ret.textures.reserve(header.n_textures);
+    for (std::size_t i = 0; i < header.n_textures; ++i) {
+        const TextureRecord& record = texture_records[i];
+        if (!isRange(record.path_offset, record.path_length, strings_size) ||
+            record.type > static_cast<uint32_t>(TextureType::Light)) {
+            return reject();
+        }
+
+        TextureReference texture;
+        // paths are stored relative to the model
+        texture.filepath =
+            filepath.parent_path() /
+            std::string(strings + record.path_offset, record.path_length);
+        texture.type = static_cast<TextureType>(record.type);
+        ret.textures.push_back(std::move(texture));
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::info("[ModelCache] loaded {} ({} bytes) in {:.1f} ms",
+                 cache_path.string(), file.getSize(), elapsed.count());
+
+    return ret;
+}
+
+void ModelCache::save(const std::filesystem::path& filepath,
+                      uint32_t import_flags, uint32_t process_flags,
+                      const ModelData& data)
+{
+    const std::optional<uint64_t> key =
+        computeKey(filepath, import_flags, process_flags);
+    if (!key) { return; }
+
+    // build tables
+    std::vector<MeshRecord> mesh_records;
+    uint64_t n_vertices = 0;
+    uint64_t n_indices = 0;
+    for (const auto& mesh : data.meshes) {
+        MeshRecord record{};
+        record.first_vertex = n_vertices;
+        record.n_vertices = mesh.vertices.size();
+        record.first_index = n_indices;
+        record.n_indices = mesh.indices.size();
+        record.material_id = mesh.material_id;
+        record.n_lods = mesh.lods.size();
+        mesh_records.push_back(record);
+
+        n_vertices += mesh.vertices.size();
+        n_indices += mesh.indices.size();
+    }
+
+    std::vector<LodRecord> lod_records;
+    for (std::size_t i = 0; i < data.meshes.size(); ++i) {
+        mesh_records[i].first_lod = lod_records.size();
+        for (const auto& lod : data.meshes[i].lods) {
+            LodRecord record{};
+            record.first_index = n_indices;
+            record.n_indices = lod.indices.size();
+            record.error = lod.error;
+            lod_records.push_back(record);
+
+            n_indices += lod.indices.size();
+        }
+    }
+
+    std::vector<MeshletRecord> meshlet_records;
+    for (std::size_t i = 0; i < data.meshes.size(); ++i) {
+        mesh_records[i].first_meshlet = meshlet_records.size();
+        mesh_records[i].n_meshlets = data.meshes[i].meshlets.size();
+        for (const auto& meshlet : data.meshes[i].meshlets) {
+            meshlet_records.push_back(toRecord(meshlet));
+        }
+    }
+
+    std::vector<MaterialRecord> material_records;
+    for (const auto& material : data.materials) {
+        material_records.push_back(toRecord(material));
+    }
+
+    std::vector<TextureRecord> texture_records;
+    std::string strings;
+    for (const auto& texture : data.textures) {
+        const std::string path =
+            texture.filepath.lexically_relative(filepath.parent_path())
+                .generic_string();
+        TextureRecord record{};
+        record.type = static_cast<uint32_t>(texture.type);
+        record.path_length = path.size();
+        record.path_offset = strings.size();
+        texture_records.push_back(record);
+        strings += path;
+    }
+
+    // layout sections
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.vertex_size = sizeof(Vertex);
+    header.key = *key;
+    header.import_flags = import_flags;
+    header.process_flags = process_flags;
+    header.n_meshes = mesh_records.size();
+    header.n_materials = material_records.size();
+    header.n_textures = texture_records.size();
+    header.n_lods = lod_records.size();
+    header.n_meshlets = meshlet_records.size();
+    header.n_vertices = n_vertices;
+    header.n_indices = n_indices;
+    header.meshes_offset = align(sizeof(CacheHeader));
+    header.lods_offset =
+        align(header.meshes_offset + sizeof(MeshRecord) * mesh_records.size());
+    header.meshlets_offset =
+        align(header.lods_offset + sizeof(LodRecord) * lod_records.size());
+    header.materials_offset = align(header.meshlets_offset +
+                                    sizeof(MeshletRecord) *
+                                        meshlet_records.size());
+    header.textures_offset = align(header.materials_offset +
+                                   sizeof(MaterialRecord) *
+                                       material_records.size());
+    header.vertices_offset = align(header.textures_offset +
+                                   sizeof(TextureRecord) *
+                                       texture_records.size());
+    header.indices_offset =
+        align(header.vertices_offset + sizeof(Vertex) * n_vertices);
+    header.strings_offset =
+        align(header.indices_offset + sizeof(uint32_t) * n_indices);
+    header.file_size = header.strings_offset + strings.size();
+
+    // write to temporary file first, so that readers never see partial file
+    const std::filesystem::path cache_path = getCachePath(filepath, *key);
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        spdlog::warn("[ModelCache] failed to create {}", temp_path.string());
+        return;
+    }
+
+    const auto write_at = [&](uint64_t offset, const void* src,
+                              std::size_t size) {
+        // pad up to the section offset
+        static const char zeros[section_alignment] = {};
+        const uint64_t position = stream.tellp();
+        stream.write(zeros, offset - position);
+        stream.write(static_cast<const char*>(src), size);
+    };
+
+    write_at(0, &header, sizeof(header));
+    write_at(header.meshes_offset, mesh_records.data(),
+             sizeof(MeshRecord) * mesh_records.size());
+    write_at(header.lods_offset, lod_records.data(),
+             sizeof(LodRecord) * lod_records.size());
+    write_at(header.meshlets_offset, meshlet_records.data(),
+             sizeof(MeshletRecord) * meshlet_records.size());
+    write_at(header.materials_offset, material_records.data(),
+             sizeof(MaterialRecord) * material_records.size());
+    write_at(header.textures_offset, texture_records.data(),
+             sizeof(TextureRecord) * texture_records.size());
+    write_at(header.vertices_offset, nullptr, 0);
+    for (const auto& mesh : data.meshes) {
+        stream.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                     sizeof(Vertex) * mesh.vertices.size());
+    }
+    write_at(header.indices_offset, nullptr, 0);
+    for (const auto& mesh : data.meshes) {
+        stream.write(reinterpret_cast<const char*>(mesh.indices.data()),
+                     sizeof(uint32_t) * mesh.indices.size());
+    }
+    for (const auto& mesh : data.meshes) {
+        for (const auto& lod : mesh.lods) {
+            stream.write(reinterpret_cast<const char*>(lod.indices.data()),
+                         sizeof(uint32_t) * lod.indices.size());
+        }
+    }
+    write_at(header.strings_offset, strings.data(), strings.size());
+    stream.close();
+
+    if (!stream) {
+        spdlog::warn("[ModelCache] failed to write {}", temp_path.string());
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        spdlog::warn("[ModelCache] failed to write {}: {}",
+                     cache_path.string(), ec.message());
+        return;
+    }
+
+    spdlog::info("[ModelCache] saved {} ({} bytes)", cache_path.string(),
+                 header.file_size);
+}
+
+}  // namespace ogls
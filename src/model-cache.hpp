@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include "model-data.hpp"
+
+namespace ogls
+{
+
+// on-disk cache of imported models
+// cache files are stored in .ogls-cache/ next to the source file and keyed on
+// content hash of the source file and the files assimp reads with it(.mtl of
+// .obj and .bin of .gltf), assimp import flags and flags of ogls post
+// processing.
+class ModelCache
+{
+   public:
+    // returns std::nullopt if there is no valid cache
+    static std::optional<ModelData> load(const std::filesystem::path& filepath,
+                                         uint32_t import_flags,
+                                         uint32_t process_flags);
+
+    static void save(const std::filesystem::path& filepath,
+                     uint32_t import_flags, uint32_t process_flags,
+                     const ModelData& data);
+
+    // 64bit FNV-1a hash
+    static uint64_t computeHash(const void* data, std::size_t size,
+                                uint64_t seed = 0xcbf29ce484222325ULL);
+
+   private:
+    static std::optional<uint64_t> computeKey(
+        const std::filesystem::path& filepath, uint32_t import_flags,
+        uint32_t process_flags);
+
+    static std::filesystem::path getCachePath(
+        const std::filesystem::path& filepath, uint64_t key);
+};
+
+}  // namespace ogls
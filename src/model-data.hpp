@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "mesh.hpp"
+#include "texture.hpp"
+
+namespace ogls
+{
+
+// CPU side geometry of a mesh
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    MaterialID material_id = 0;
+    // coarser levels of detail, sharing vertices
+    std::vector<MeshLod> lods;
+    // clusters of triangles of indices, empty if they are not built
+    std::vector<Meshlet> meshlets;
+};
+
+// image file referenced by materials
+struct TextureReference {
+    std::filesystem::path filepath;
+    TextureType type = TextureType::Diffuse;
+};
+
+// everything needed to create a Model, without any GL objects
+struct ModelData {
+    std::vector<MeshData> meshes;
+    std::vector<Material> materials;
+    // indexed by TextureID
+    std::vector<TextureReference> textures;
+};
+
+}  // namespace ogls
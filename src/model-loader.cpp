@@ -0,0 +1,373 @@
+#include "model-loader.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "memory-usage.hpp"
+#include "spdlog/spdlog.h"
+#include "thread-pool.hpp"
+
+namespace ogls
+{
+
+struct DecodedImage {
+    TextureID texture_id = 0;
+    // set if image is decoded and uploaded uncompressed with its mip chain
+    std::optional<MipChain> mips;
+    // set if image is compressed
+    std::optional<CompressedImage> compressed;
+    // set if image is replaced by KTX2 or DDS file
+    std::optional<TextureContainer> container;
+
+    // std::nullopt if texture cache is not used
+    std::optional<TextureCache::Key> key;
+    // image is not decoded since texture is alive in cache
+    bool cached = false;
+
+    // layout of compressed levels, nullptr if image is not compressed
+    const CompressedImage* getCompressedImage() const
+    {
+        if (container) { return &container->getImage(); }
+        return compressed ? &compressed.value() : nullptr;
+    }
+
+    // bytes uploaded to texture
+    const uint8_t* getData() const
+    {
+        if (container) { return container->getData(); }
+        if (compressed) { return compressed->data.data(); }
+        return mips ? mips->data.data() : nullptr;
+    }
+
+    std::size_t getSize() const
+    {
+        if (container) { return container->getSize(); }
+        if (compressed) { return compressed->data.size(); }
+        return mips ? mips->data.size() : 0;
+    }
+};
+
+struct ModelLoadHandle::State {
+    std::atomic<ModelLoadStatus> status{ModelLoadStatus::Loading};
+    std::atomic<bool> cancelled{false};
+
+    // parse + decode textures + upload meshes and textures
+    std::atomic<uint32_t> n_total_work{0};
+    std::atomic<uint32_t> n_done_work{0};
+
+    // guarded by mutex
+    std::mutex mutex;
+    std::optional<ModelData> data;
+    std::deque<DecodedImage> decoded_images;
+};
+
+ModelLoadHandle::ModelLoadHandle() {}
+
+ModelLoadHandle::ModelLoadHandle(const std::shared_ptr<State>& state)
+    : state(state)
+{
+}
+
+ModelLoadHandle::operator bool() const { return state != nullptr; }
+
+ModelLoadStatus ModelLoadHandle::getStatus() const
+{
+    return state ? state->status.load() : ModelLoadStatus::Done;
+}
+
+float ModelLoadHandle::getProgress() const
+{
+    if (!state) { return 1.0f; }
+
+    const uint32_t n_total = state->n_total_work;
+    // still parsing
+    if (n_total == 0) { return 0.0f; }
+
+    return static_cast<float>(state->n_done_work) / n_total;
+}
+
+void ModelLoadHandle::cancel() const
+{
+    if (state) { state->cancelled = true; }
+}
+
+void ModelLoader::submitDecode(
+    const std::shared_ptr<ModelLoadHandle::State>& state, TextureID texture_id,
+    const TextureReference& reference, TextureCompression compression,
+    const std::shared_ptr<TextureCache>& texture_cache, bool use_cache)
+{
+    ThreadPool::getGlobal().submit([state, texture_id, reference, compression,
+                                    texture_cache, use_cache]() {
+        if (state->cancelled) { return; }
+
+        DecodedImage decoded;
+        decoded.texture_id = texture_id;
+        // the work is counted as done whatever fails, or the load never
+        // finishes
+        try {
+            // precompressed files are preferred over compressing images
+            const std::optional<std::filesystem::path> container_path =
+                TextureContainer::find(reference.filepath);
+            if (texture_cache) {
+                decoded.key =
+                    container_path
+                        ? TextureCache::makeKey(container_path.value(),
+                                                reference.type)
+                        : TextureCache::makeKey(reference.filepath,
+                                                reference.type, compression);
+                decoded.cached = use_cache && decoded.key &&
+                                 texture_cache->contains(decoded.key.value());
+            }
+
+            if (!decoded.cached && container_path) {
+                decoded.container = TextureContainer::load(
+                    container_path.value(), reference.type);
+                // fall back to the image
+                if (!decoded.container && texture_cache) {
+                    decoded.key = TextureCache::makeKey(
+                        reference.filepath, reference.type, compression);
+                }
+            }
+
+            if (!decoded.cached && !decoded.container &&
+                compression == TextureCompression::BCn) {
+                decoded.compressed = TextureCompressor::load(
+                    reference.filepath, reference.type);
+            }
+
+            if (!decoded.cached && !decoded.container && !decoded.compressed) {
+                glm::vec2 resolution;
+                const std::vector<uint8_t> image =
+                    Model::loadImage(reference.filepath, resolution);
+                decoded.mips = MipGenerator::generate(
+                    image.data(), glm::uvec2(resolution), reference.type);
+            }
+        } catch (const std::exception& e) {
+            // texture is treated as missing
+            spdlog::warn("[ModelLoader] failed to decode {}: {}",
+                         reference.filepath.string(), e.what());
+            decoded = DecodedImage();
+            decoded.texture_id = texture_id;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->decoded_images.push_back(std::move(decoded));
+        }
+        state->n_done_work++;
+    });
+}
+
+ModelLoader::ModelLoader(const std::filesystem::path& filepath,
+                         const VertexFormat& format,
+                         GeometryRetention retention,
+                         TextureCompression compression,
+                         const std::shared_ptr<TextureCache>& texture_cache)
+    : state{std::make_shared<ModelLoadHandle::State>()},
+      format{format},
+      retention{retention},
+      compression{compression},
+      texture_cache{texture_cache},
+      n_uploaded_meshes{0},
+      start_time{std::chrono::steady_clock::now()},
+      start_rss{getResidentSetSize()}
+{
+    ThreadPool& pool = ThreadPool::getGlobal();
+
+    // tasks hold state, so that they can outlive the loader
+    pool.submit([state = this->state, filepath, compression, texture_cache]() {
+        if (state->cancelled) { return; }
+
+        std::optional<ModelData> data = Model::loadModelData(filepath);
+        if (!data) {
+            state->status = ModelLoadStatus::Failed;
+            return;
+        }
+
+        const std::vector<TextureReference> references = data->textures;
+        state->n_total_work =
+            1 + 2 * references.size() + data->meshes.size();
+        state->n_done_work = 1;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->data = std::move(data);
+        }
+
+        // decode images
+        for (std::size_t i = 0; i < references.size(); ++i) {
+            submitDecode(state, i, references[i], compression, texture_cache,
+                         true);
+        }
+    });
+
+    spdlog::debug("[ModelLoader] start loading {}", filepath.string());
+}
+
+ModelLoader::~ModelLoader()
+{
+    // stop worker tasks
+    if (state->status == ModelLoadStatus::Loading) { state->cancelled = true; }
+}
+
+ModelLoadHandle ModelLoader::getHandle() const
+{
+    return ModelLoadHandle(state);
+}
+
+void ModelLoader::processUploads(Model& model,
+                                 const std::shared_ptr<GeometryArena>& arena,
+                                 StagingBuffer& staging, float budget_ms)
+{
+    if (state->status != ModelLoadStatus::Loading) { return; }
+
+    if (state->cancelled) {
+        // discard partially loaded model
+        if (data) { model = Model(); }
+        previous_textures.clear();
+        state->status = ModelLoadStatus::Cancelled;
+        spdlog::debug("[ModelLoader] loading cancelled");
+        return;
+    }
+
+    // wait until model is parsed
+    if (!data) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->data) { return; }
+        data = std::move(state->data);
+
+        previous_textures = model.getTextures();
+        model = Model(arena, format, retention);
+        model.setMaterials(data->materials, data->textures.size());
+    }
+
+    // GPU is still reading staging buffer of previous frame
+    if (!staging.begin()) { return; }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool uploaded = false;
+    // upload at least one item per frame, so that loading always progresses
+    const auto can_upload = [&](std::size_t size) {
+        if (!uploaded) { return true; }
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count() < budget_ms &&
+               size <= staging.getAvailableSize();
+    };
+
+    // upload meshes first, so that geometry shows up as soon as possible
+    while (n_uploaded_meshes < data->meshes.size()) {
+        MeshData& mesh = data->meshes[n_uploaded_meshes];
+        std::size_t n_indices = mesh.indices.size();
+        for (const auto& lod : mesh.lods) { n_indices += lod.indices.size(); }
+        const std::size_t size = format.getStride() * mesh.vertices.size() +
+                                 sizeof(uint32_t) * n_indices + 32;
+        if (!can_upload(size)) { break; }
+
+        model.addMesh(mesh, &staging);
+
+        // CPU side data is not needed anymore
+        mesh = MeshData();
+
+        n_uploaded_meshes++;
+        state->n_done_work++;
+        uploaded = true;
+    }
+
+    // upload decoded images
+    while (true) {
+        DecodedImage decoded;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->decoded_images.empty()) { break; }
+            if (!can_upload(state->decoded_images.front().getSize())) {
+                break;
+            }
+            decoded = std::move(state->decoded_images.front());
+            state->decoded_images.pop_front();
+        }
+
+        if (decoded.cached) {
+            auto texture = texture_cache->find(decoded.key.value());
+            if (!texture) {
+                // texture was freed after the lookup, decode it again
+                submitDecode(state, decoded.texture_id,
+                             data->textures[decoded.texture_id], compression,
+                             texture_cache, false);
+                continue;
+            }
+            model.setTexture(decoded.texture_id, texture);
+        } else if (decoded.getSize() > 0) {
+            const TextureType type = data->textures[decoded.texture_id].type;
+            const auto offset =
+                staging.write(decoded.getData(), decoded.getSize(), 4);
+            const void* source =
+                offset ? reinterpret_cast<const void*>(offset.value())
+                       : decoded.getData();
+
+            Texture texture;
+            if (offset) { staging.bindToPixelUnpackBuffer(); }
+            if (const CompressedImage* compressed =
+                    decoded.getCompressedImage()) {
+                texture = Model::createTexture(*compressed, source);
+            } else {
+                texture = Model::createTexture(type, *decoded.mips, source);
+            }
+            if (offset) { staging.unbindFromPixelUnpackBuffer(); }
+
+            if (decoded.key) {
+                model.setTexture(
+                    decoded.texture_id,
+                    texture_cache->insert(decoded.key.value(),
+                                          std::move(texture)));
+            } else {
+                model.setTexture(decoded.texture_id,
+                                 std::make_shared<Texture>(std::move(texture)));
+            }
+        } else {
+            spdlog::error(
+                "[ModelLoader] failed to load image {}",
+                data->textures[decoded.texture_id].filepath.string());
+        }
+
+        state->n_done_work++;
+        uploaded = true;
+    }
+
+    staging.end();
+
+    if (state->n_done_work == state->n_total_work) {
+        state->status = ModelLoadStatus::Done;
+        previous_textures.clear();
+
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        spdlog::info("[ModelLoader] loaded {} meshes and {} textures in {:.1f} "
+                     "ms",
+                     data->meshes.size(), data->textures.size(),
+                     elapsed.count());
+
+        const Model::GeometrySize size = model.getGeometrySize();
+        spdlog::info("[ModelLoader] geometry: {} bytes, saved {} bytes by "
+                     "packing",
+                     size.vertex_bytes + size.index_bytes,
+                     size.getSavedBytes());
+
+        if (texture_cache) {
+            const TextureCache::Stats stats = texture_cache->getStats();
+            spdlog::info("[ModelLoader] texture cache: {} hits, {} misses, "
+                         "{} textures",
+                         stats.n_hits, stats.n_misses, stats.n_entries);
+        }
+
+        data.reset();
+        const std::size_t rss = getResidentSetSize();
+        spdlog::info("[ModelLoader] retained geometry: {} bytes, RSS: {} -> {} "
+                     "bytes ({:+} bytes)",
+                     model.getRetainedGeometrySize(), start_rss, rss,
+                     static_cast<int64_t>(rss) -
+                         static_cast<int64_t>(start_rss));
+    }
+}
+
+}  // namespace ogls
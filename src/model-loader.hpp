@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+#include "model-data.hpp"
+#include "model.hpp"
+#include "staging-buffer.hpp"
+#include "texture-cache.hpp"
+#include "texture-container.hpp"
+
+namespace ogls
+{
+
+enum class ModelLoadStatus { Loading, Done, Cancelled, Failed };
+
+// handle of asynchronous model loading
+class ModelLoadHandle
+{
+   public:
+    ModelLoadHandle();
+
+    // is this handle associated with loading?
+    operator bool() const;
+
+    ModelLoadStatus getStatus() const;
+
+    // progress of loading in [0, 1]
+    float getProgress() const;
+
+    // stop loading, meshes which are already uploaded are discarded
+    void cancel() const;
+
+   private:
+    struct State;
+    std::shared_ptr<State> state;
+
+    ModelLoadHandle(const std::shared_ptr<State>& state);
+
+    friend class ModelLoader;
+};
+
+// parse model and decode its images on worker threads, and upload them on the
+// render thread
+class ModelLoader
+{
+   public:
+    // vertices are stored in format, and CPU side geometry of meshes is kept
+    // according to retention
+    // images are compressed on worker threads according to compression,
+    // unless KTX2 or DDS files are found next to them, and uncompressed
+    // images get their mip chains on worker threads too
+    // images found in texture_cache are not decoded and uploaded again
+    ModelLoader(const std::filesystem::path& filepath,
+                const VertexFormat& format = VertexFormat(),
+                GeometryRetention retention = GeometryRetention::All,
+                TextureCompression compression = TextureCompression::BCn,
+                const std::shared_ptr<TextureCache>& texture_cache = nullptr);
+    ModelLoader(const ModelLoader& other) = delete;
+    ~ModelLoader();
+
+    ModelLoader& operator=(const ModelLoader& other) = delete;
+
+    ModelLoadHandle getHandle() const;
+
+    // upload resources which are ready into model within the time budget[ms]
+    // model is replaced when the first upload happens, and its meshes are
+    // sub-allocated from arena
+    // this must be called on the thread which has GL context
+    void processUploads(Model& model,
+                        const std::shared_ptr<GeometryArena>& arena,
+                        StagingBuffer& staging, float budget_ms);
+
+   private:
+    std::shared_ptr<ModelLoadHandle::State> state;
+    VertexFormat format;
+    GeometryRetention retention;
+    TextureCompression compression;
+    std::shared_ptr<TextureCache> texture_cache;
+
+    // data taken from worker threads
+    std::optional<ModelData> data;
+    std::size_t n_uploaded_meshes;
+
+    // textures of the replaced model are kept until loading finishes, so
+    // that the new model can share them through the cache
+    std::vector<std::shared_ptr<Texture>> previous_textures;
+
+    std::chrono::steady_clock::time_point start_time;
+    std::size_t start_rss;
+
+    // decode image of texture on worker thread, unless it's alive in cache
+    static void submitDecode(
+        const std::shared_ptr<ModelLoadHandle::State>& state,
+        TextureID texture_id, const TextureReference& reference,
+        TextureCompression compression,
+        const std::shared_ptr<TextureCache>& texture_cache, bool use_cache);
+};
+
+}  // namespace ogls
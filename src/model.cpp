@@ -1,14 +1,27 @@
 #include "model.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <iostream>
 
 #include "assimp/Importer.hpp"
 #include "assimp/material.h"
 #include "assimp/postprocess.h"
+#include "memory-usage.hpp"
+#include "mesh-optimizer.hpp"
+#include "mesh-simplifier.hpp"
 #include "mesh.hpp"
+#include "meshlet-builder.hpp"
+#include "model-cache.hpp"
 #include "spdlog/spdlog.h"
+#include "tangent-frame-generator.hpp"
+#include "texture-container.hpp"
 #include "texture.hpp"
+#include "thread-pool.hpp"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -41,27 +54,55 @@ GLuint Model::getTextureInternalFormat(const TextureType& type)
     }
 }
 
-Model::Model() {}
+Model::Model() : retention(GeometryRetention::All) {}
 
-Model::Model(const std::filesystem::path& filepath) { loadModel(filepath); }
+Model::Model(const std::shared_ptr<GeometryArena>& arena,
+             const VertexFormat& format, GeometryRetention retention)
+    : arena(arena), vertex_format(format), retention(retention)
+{
+}
+
+Model::Model(const std::filesystem::path& filepath,
+             const std::shared_ptr<GeometryArena>& arena,
+             const VertexFormat& format, GeometryRetention retention,
+             TextureCompression compression)
+    : arena(arena), vertex_format(format), retention(retention)
+{
+    loadModel(filepath, compression);
+}
 
 Model::Model(Model&& other)
-    : meshes(std::move(other.meshes)),
+    : arena(std::move(other.arena)),
+      vertex_format(other.vertex_format),
+      retention(other.retention),
+      meshes(std::move(other.meshes)),
       materials(std::move(other.materials)),
       textures(std::move(other.textures)),
-      loaded_materials(std::move(other.loaded_materials)),
-      loaded_textures(std::move(other.loaded_textures))
+      virtual_textures(std::move(other.virtual_textures)),
+      lod_levels(std::move(other.lod_levels)),
+      visibility(std::move(other.visibility)),
+      cull_stats(other.cull_stats),
+      indirect(std::move(other.indirect)),
+      material_blocks(std::move(other.material_blocks))
 {
 }
 
 Model& Model::operator=(Model&& other)
 {
     if (this == &other) return *this;
+    // bindless handles are released before the textures they refer to
+    indirect = std::move(other.indirect);
+    material_blocks = std::move(other.material_blocks);
+    arena = std::move(other.arena);
+    vertex_format = other.vertex_format;
+    retention = other.retention;
     meshes = std::move(other.meshes);
     materials = std::move(other.materials);
     textures = std::move(other.textures);
-    loaded_materials = std::move(other.loaded_materials);
-    loaded_textures = std::move(other.loaded_textures);
+    virtual_textures = std::move(other.virtual_textures);
+    lod_levels = std::move(other.lod_levels);
+    visibility = std::move(other.visibility);
+    cull_stats = other.cull_stats;
     return *this;
 }
 
@@ -85,26 +126,100 @@ uint32_t Model::getNumberOfFaces() const
     return n_faces;
 }
 
+uint32_t Model::getNumberOfSelectedFaces() const
+{
+    uint32_t n_faces = 0;
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        n_faces += meshes[i].getNumberOfFaces(lod_levels[i]);
+    }
+    return n_faces;
+}
+
 uint32_t Model::getNumberOfTextures() const { return textures.size(); }
 
-void Model::loadModel(const std::filesystem::path& filepath)
+const std::vector<std::shared_ptr<Texture>>& Model::getTextures() const
 {
-    // load model with assimp
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(
-        filepath.generic_string().c_str(),
-        aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals |
-            aiProcess_CalcTangentSpace);
+    return textures;
+}
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
-        !scene->mRootNode) {
-        spdlog::error(importer.GetErrorString());
-        return;
+void Model::setTextureFiltering(float max_anisotropy, float lod_bias) const
+{
+    for (const auto& texture : textures) {
+        if (!texture) { continue; }
+        texture->setMaxAnisotropy(max_anisotropy);
+        texture->setLodBias(lod_bias);
     }
+    if (indirect && indirect->mode == DrawMode::Bindless) { indirect.reset(); }
+}
 
-    // process scene graph
-    const std::filesystem::path ps(filepath);
-    processAssimpNode(scene->mRootNode, scene, ps.parent_path());
+const VertexFormat& Model::getVertexFormat() const { return vertex_format; }
+
+GeometryRetention Model::getRetention() const { return retention; }
+
+std::size_t Model::getRetainedGeometrySize() const
+{
+    std::size_t ret = 0;
+    for (const auto& mesh : meshes) { ret += mesh.getRetainedSize(); }
+    return ret;
+}
+
+std::size_t Model::GeometrySize::getSavedBytes() const
+{
+    return unpacked_vertex_bytes + unpacked_index_bytes - vertex_bytes -
+           index_bytes;
+}
+
+Model::GeometrySize Model::getGeometrySize() const
+{
+    GeometrySize ret;
+    for (const auto& mesh : meshes) {
+        ret.vertex_bytes += mesh.getVertexBufferSize();
+        ret.index_bytes += mesh.getIndexBufferSize();
+        ret.unpacked_vertex_bytes +=
+            sizeof(Vertex) * mesh.getNumberOfVertices();
+        ret.unpacked_index_bytes +=
+            sizeof(uint32_t) * mesh.getNumberOfIndices();
+    }
+    return ret;
+}
+
+void Model::loadModel(const std::filesystem::path& filepath,
+                      TextureCompression compression,
+                      VirtualTextureCache* virtual_textures,
+                      TextureCache* texture_cache)
+{
+    const std::size_t rss_before = getResidentSetSize();
+
+    std::optional<ModelData> data = loadModelData(filepath);
+    if (!data) { return; }
+
+    // load all textures before creating meshes
+    loadTextures(data->textures, compression, virtual_textures, texture_cache);
+
+    // create arena which fits all meshes
+    if (!arena) {
+        std::size_t n_vertices = 0;
+        std::size_t n_indices = 0;
+        for (const auto& mesh : data->meshes) {
+            n_vertices += mesh.vertices.size();
+            n_indices += mesh.indices.size();
+            for (const auto& lod : mesh.lods) {
+                n_indices += lod.indices.size();
+            }
+        }
+        // 16 and 32 bit index ranges may need padding between them
+        // buffers can't be empty, a model without meshes still gets 1 byte
+        arena = GeometryArena::create(
+            std::max<std::size_t>(vertex_format.getStride() * n_vertices, 1),
+            std::max<std::size_t>(
+                sizeof(uint32_t) * (n_indices + data->meshes.size()), 1));
+    }
+
+    // create meshes
+    for (const auto& mesh : data->meshes) { addMesh(mesh); }
+    materials = std::move(data->materials);
+    indirect.reset();
+    material_blocks.reset();
 
     // show info
     spdlog::debug("[Model] " + filepath.string() + " loaded.");
@@ -117,35 +232,956 @@ void Model::loadModel(const std::filesystem::path& filepath)
     spdlog::debug("[Model] number of materials: {}", materials.size());
     spdlog::debug("[Model] number of textures: " +
                   std::to_string(getNumberOfTextures()));
+
+    const GeometrySize size = getGeometrySize();
+    spdlog::info("[Model] geometry: {} bytes, saved {} bytes by packing",
+                 size.vertex_bytes + size.index_bytes, size.getSavedBytes());
+
+    // loaded data is not needed anymore
+    data.reset();
+    const std::size_t rss_after = getResidentSetSize();
+    spdlog::info("[Model] retained geometry: {} bytes, RSS: {} -> {} bytes "
+                 "({:+} bytes)",
+                 getRetainedGeometrySize(), rss_before, rss_after,
+                 static_cast<int64_t>(rss_after) -
+                     static_cast<int64_t>(rss_before));
+}
+
+std::optional<ModelData> Model::loadModelData(
+    const std::filesystem::path& filepath, uint32_t process_flags)
+{
+    // use cache if the model is already imported
+    std::optional<ModelData> data =
+        ModelCache::load(filepath, import_flags, process_flags);
+    if (!data) {
+        data = importModel(filepath, process_flags);
+        if (data) {
+            ModelCache::save(filepath, import_flags, process_flags, *data);
+        }
+    }
+    return data;
+}
+
+std::optional<ModelData> Model::importModel(
+    const std::filesystem::path& filepath, uint32_t process_flags)
+{
+    const bool generate_frames =
+        process_flags & process_generate_tangent_frames;
+
+    // load model with assimp
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(
+        filepath.generic_string().c_str(), import_flags & ~tangent_frame_flags);
+
+    const auto frame_start = std::chrono::steady_clock::now();
+    if (scene && !generate_frames) {
+        scene = importer.ApplyPostProcessing(tangent_frame_flags);
+    }
+    const std::chrono::duration<float, std::milli> assimp_frame_time =
+        std::chrono::steady_clock::now() - frame_start;
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
+        !scene->mRootNode) {
+        spdlog::error(importer.GetErrorString());
+        return std::nullopt;
+    }
+
+    const std::filesystem::path ps(filepath);
+
+    ModelData ret;
+    TextureIndex texture_index;
+    ret.textures =
+        getTexturesFromAssimp(scene, ps.parent_path(), texture_index);
+
+    // load all materials, MaterialID is same as assimp material index
+    for (std::size_t i = 0; i < scene->mNumMaterials; ++i) {
+        ret.materials.push_back(loadMaterialFromAssimp(
+            scene->mMaterials[i], ps.parent_path(), texture_index));
+    }
+
+    // process scene graph
+    processAssimpNode(scene->mRootNode, scene, ret);
+
+    if (generate_frames) {
+        generateTangentFrames(ret);
+    } else {
+        const auto start = std::chrono::steady_clock::now();
+        computeNormalDerivatives(ret);
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        spdlog::info("[Model] generated tangent frames by assimp in {:.1f} ms",
+                     assimp_frame_time.count() + elapsed.count());
+    }
+
+    // meshlets reorder triangles, and levels of detail don't depend on order
+    // vertex cache is measured on the final order, after meshlets
+    const MeshOptimizer::CacheStats before = analyzeVertexCache(ret);
+    if (process_flags & process_optimize_meshes) { optimizeMeshes(ret); }
+    if (process_flags & process_build_meshlets) { buildMeshlets(ret); }
+    if (process_flags & (process_optimize_meshes | process_build_meshlets)) {
+        const MeshOptimizer::CacheStats after = analyzeVertexCache(ret);
+        spdlog::info("[Model] vertex cache ACMR: {:.3f} -> {:.3f}, ATVR: "
+                     "{:.3f} -> {:.3f}",
+                     before.getACMR(), after.getACMR(), before.getATVR(),
+                     after.getATVR());
+    }
+    if (process_flags & process_generate_lods) { generateLods(ret); }
+
+    return ret;
+}
+
+void Model::optimizeMeshes(ModelData& data)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto& mesh : data.meshes) { MeshOptimizer::optimize(mesh); }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::info("[Model] optimized {} meshes in {:.1f} ms",
+                 data.meshes.size(), elapsed.count());
+}
+
+MeshOptimizer::CacheStats Model::analyzeVertexCache(const ModelData& data)
+{
+    MeshOptimizer::CacheStats ret;
+    for (const auto& mesh : data.meshes) {
+        ret += MeshOptimizer::analyzeVertexCache(mesh.indices,
+                                                 mesh.vertices.size());
+    }
+    return ret;
+}
+
+void Model::generateTangentFrames(ModelData& data)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    ThreadPool& pool = ThreadPool::getGlobal();
+    pool.parallelFor(data.meshes.size(), 1,
+                     [&](std::size_t begin, std::size_t end) {
+                         for (std::size_t i = begin; i < end; ++i) {
+                             TangentFrameGenerator::generate(data.meshes[i]);
+                         }
+                     });
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::info("[Model] generated tangent frames of {} meshes in {:.1f} ms "
+                 "with {} threads",
+                 data.meshes.size(), elapsed.count(),
+                 pool.getNumberOfThreads());
+}
+
+void Model::generateLods(ModelData& data)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    ThreadPool::getGlobal().parallelFor(
+        data.meshes.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                MeshData& mesh = data.meshes[i];
+                mesh.lods =
+                    MeshSimplifier::buildLodChain(mesh.vertices, mesh.indices);
+            }
+        });
+
+    std::size_t n_lods = 0;
+    for (const auto& mesh : data.meshes) { n_lods += mesh.lods.size(); }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::info("[Model] generated {} levels of detail of {} meshes in "
+                 "{:.1f} ms",
+                 n_lods, data.meshes.size(), elapsed.count());
+}
+
+void Model::buildMeshlets(ModelData& data)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    ThreadPool::getGlobal().parallelFor(
+        data.meshes.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                MeshletBuilder::build(data.meshes[i]);
+            }
+        });
+
+    std::size_t n_meshlets = 0;
+    std::size_t n_triangles = 0;
+    for (const auto& mesh : data.meshes) {
+        n_meshlets += mesh.meshlets.size();
+        n_triangles += mesh.indices.size() / 3;
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::info("[Model] built {} meshlets of {} meshes in {:.1f} ms, {:.1f} "
+                 "triangles per meshlet",
+                 n_meshlets, data.meshes.size(), elapsed.count(),
+                 n_meshlets > 0 ? static_cast<float>(n_triangles) / n_meshlets
+                                : 0.0f);
+}
+
+void Model::computeNormalDerivatives(ModelData& data)
+{
+    for (auto& mesh : data.meshes) {
+        std::vector<Vertex>& vertices = mesh.vertices;
+        const std::vector<uint32_t>& indices = mesh.indices;
+
+        // compute dn/dp, dn/dv
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            const unsigned int idx1 = indices[i];
+            const unsigned int idx2 = indices[i + 1];
+            const unsigned int idx3 = indices[i + 2];
+
+            const glm::vec3 dn1 =
+                vertices[idx2].normal - vertices[idx1].normal;
+            const glm::vec3 dn2 =
+                vertices[idx3].normal - vertices[idx1].normal;
+            const float du1 =
+                vertices[idx2].texcoords.x - vertices[idx1].texcoords.x;
+            const float du2 =
+                vertices[idx3].texcoords.x - vertices[idx1].texcoords.x;
+            const float dv1 =
+                vertices[idx2].texcoords.y - vertices[idx1].texcoords.y;
+            const float dv2 =
+                vertices[idx3].texcoords.y - vertices[idx1].texcoords.y;
+
+            const float invDeterminant = 1.0f / (du1 * dv2 - dv1 * du2);
+
+            const glm::vec3 dndu = invDeterminant * (dv2 * dn1 - dv1 * dn2);
+            const glm::vec3 dndv = invDeterminant * (-du2 * dn1 + du1 * dn2);
+
+            vertices[idx1].dndu = dndu;
+            vertices[idx2].dndu = dndu;
+            vertices[idx3].dndu = dndu;
+            vertices[idx1].dndv = dndv;
+            vertices[idx2].dndv = dndv;
+            vertices[idx3].dndv = dndv;
+        }
+    }
+}
+
+std::optional<Model::TangentFrameBenchmark> Model::benchmarkTangentFrames(
+    const std::filesystem::path& filepath)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(
+        filepath.generic_string().c_str(), import_flags & ~tangent_frame_flags);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
+        !scene->mRootNode) {
+        spdlog::error(importer.GetErrorString());
+        return std::nullopt;
+    }
+
+    // extract meshes before assimp modifies the scene
+    ModelData generated;
+    processAssimpNode(scene->mRootNode, scene, generated);
+
+    TangentFrameBenchmark ret;
+    for (const auto& mesh : generated.meshes) {
+        ret.n_triangles += mesh.indices.size() / 3;
+    }
+    ret.n_threads = ThreadPool::getGlobal().getNumberOfThreads();
+
+    // copying meshes out of the scene is not timed, as generator is given
+    // copied meshes
+    using Duration = std::chrono::duration<float, std::milli>;
+    const auto assimp_start = std::chrono::steady_clock::now();
+    scene = importer.ApplyPostProcessing(tangent_frame_flags);
+    const Duration post_process_time =
+        std::chrono::steady_clock::now() - assimp_start;
+    if (!scene) {
+        spdlog::error(importer.GetErrorString());
+        return std::nullopt;
+    }
+
+    ModelData assimp;
+    processAssimpNode(scene->mRootNode, scene, assimp);
+
+    const auto derivative_start = std::chrono::steady_clock::now();
+    computeNormalDerivatives(assimp);
+    const Duration derivative_time =
+        std::chrono::steady_clock::now() - derivative_start;
+    ret.assimp_time = post_process_time.count() + derivative_time.count();
+
+    const auto generator_start = std::chrono::steady_clock::now();
+    generateTangentFrames(generated);
+    const Duration generator_time =
+        std::chrono::steady_clock::now() - generator_start;
+    ret.generator_time = generator_time.count();
+
+    spdlog::info("[Model] tangent frames of {} triangles, assimp: {:.1f} ms, "
+                 "generator: {:.1f} ms with {} threads",
+                 ret.n_triangles, ret.assimp_time, ret.generator_time,
+                 ret.n_threads);
+
+    return ret;
+}
+
+void Model::setMaterials(const std::vector<Material>& materials,
+                         uint32_t n_textures)
+{
+    indirect.reset();
+    material_blocks.reset();
+    this->materials = materials;
+    textures.clear();
+    textures.resize(n_textures);
+    virtual_textures.clear();
 }
 
-void Model::draw(const Pipeline& pipeline, const Texture& null_texture) const
+void Model::addMesh(const MeshData& mesh, StagingBuffer* staging)
 {
+    meshes.emplace_back(mesh.vertices, mesh.indices, mesh.lods, mesh.meshlets,
+                        mesh.material_id, vertex_format, *arena, staging,
+                        retention);
+    lod_levels.push_back(0);
+    visibility.emplace_back();
+    indirect.reset();
+}
+
+void Model::selectLods(const LodView& view)
+{
+    // projected size of object space length 1 at distance 1[pixel]
+    const float pixels_per_unit =
+        0.5f * view.framebuffer_height /
+        std::tan(0.5f * glm::radians(view.fov));
+
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = meshes[i];
+        const float distance = std::max(
+            glm::length(mesh.getBoundingCenter() - view.camera_position) -
+                mesh.getBoundingRadius(),
+            1e-3f);
+        const auto get_pixel_error = [&](uint32_t lod) {
+            return mesh.getLodError(lod) * pixels_per_unit / distance;
+        };
+
+        // refine while the error is visible, and coarsen only if the next
+        // level is well below the threshold, so that levels don't flicker
+        uint32_t& lod = lod_levels[i];
+        lod = std::min(lod, mesh.getNumberOfLods() - 1);
+        while (lod > 0 && get_pixel_error(lod) > view.pixel_error) { lod--; }
+        while (lod + 1 < mesh.getNumberOfLods() &&
+               get_pixel_error(lod + 1) <=
+                   (1.0f - lod_hysteresis) * view.pixel_error) {
+            lod++;
+        }
+    }
+}
+
+void Model::resetLods() { std::fill(lod_levels.begin(), lod_levels.end(), 0); }
+
+uint32_t Model::getLod(std::size_t mesh_index, uint32_t lod_bias) const
+{
+    return std::min(lod_levels[mesh_index] + lod_bias,
+                    meshes[mesh_index].getNumberOfLods() - 1);
+}
+
+float Model::CullStats::getCulledTriangleRatio() const
+{
+    return n_triangles > 0 ? static_cast<float>(n_culled_triangles) /
+                                 n_triangles
+                           : 0.0f;
+}
+
+void Model::cullMeshlets(const CullView& view)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // planes of view frustum(Gribb and Hartmann 2001), points p inside
+    // satisfy dot(plane.xyz, p) + plane.w >= 0
+    const glm::mat4 m = glm::transpose(view.view_projection);
+    std::array<glm::vec4, 6> planes = {m[3] + m[0], m[3] - m[0], m[3] + m[1],
+                                       m[3] - m[1], m[3] + m[2], m[3] - m[2]};
+    for (auto& plane : planes) { plane /= glm::length(glm::vec3(plane)); }
+
+    const auto is_outside = [&](const glm::vec3& center, float radius) {
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    cull_stats = CullStats();
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = meshes[i];
+        const uint32_t lod = lod_levels[i];
+        const uint32_t n_triangles = mesh.getNumberOfFaces(lod);
+        const std::vector<Meshlet>& meshlets = mesh.getMeshlets();
+        Visibility& result = visibility[i];
+        result.ranges.clear();
+        cull_stats.n_triangles += n_triangles;
+
+        result.visible = !is_outside(mesh.getBoundingCenter(),
+                                     mesh.getBoundingRadius());
+        if (!result.visible) {
+            cull_stats.n_culled_triangles += n_triangles;
+            if (lod == 0) {
+                cull_stats.n_meshlets += meshlets.size();
+                cull_stats.n_frustum_culled += meshlets.size();
+            }
+            continue;
+        }
+        if (lod != 0 || meshlets.empty()) { continue; }
+
+        cull_stats.n_meshlets += meshlets.size();
+        for (const auto& meshlet : meshlets) {
+            bool culled = false;
+            if (is_outside(meshlet.center, meshlet.radius)) {
+                cull_stats.n_frustum_culled++;
+                culled = true;
+            } else if (view.cull_backfaces) {
+                const glm::vec3 d = meshlet.center - view.camera_position;
+                if (glm::dot(d, meshlet.cone_axis) >=
+                    meshlet.cone_cutoff * glm::length(d) + meshlet.radius) {
+                    cull_stats.n_backface_culled++;
+                    culled = true;
+                }
+            }
+            if (culled) {
+                cull_stats.n_culled_triangles += meshlet.n_indices / 3;
+                continue;
+            }
+
+            // adjacent meshlets are drawn as one range
+            if (!result.ranges.empty() &&
+                result.ranges.back().first_index +
+                        result.ranges.back().n_indices ==
+                    meshlet.first_index) {
+                result.ranges.back().n_indices += meshlet.n_indices;
+            } else {
+                result.ranges.push_back(
+                    {meshlet.first_index, meshlet.n_indices});
+            }
+        }
+        result.visible = !result.ranges.empty();
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    cull_stats.cull_time = elapsed.count();
+}
+
+void Model::resetCulling()
+{
+    for (auto& result : visibility) { result = Visibility(); }
+    cull_stats = CullStats();
+}
+
+const Model::CullStats& Model::getCullStats() const { return cull_stats; }
+
+void Model::getDrawRanges(std::size_t mesh_index, uint32_t lod_bias,
+                          CullMode cull_mode,
+                          std::vector<IndexRange>& ranges) const
+{
+    const uint32_t lod = getLod(mesh_index, lod_bias);
+    if (cull_mode == CullMode::Meshlets) {
+        const Visibility& result = visibility[mesh_index];
+        if (!result.visible) { return; }
+        if (lod == 0 && !result.ranges.empty()) {
+            ranges.insert(ranges.end(), result.ranges.begin(),
+                          result.ranges.end());
+            return;
+        }
+    }
+    ranges.push_back(meshes[mesh_index].getLodRange(lod));
+}
+
+void Model::setTexture(TextureID texture_id,
+                       const std::shared_ptr<Texture>& texture)
+{
+    indirect.reset();
+    material_blocks.reset();
+    textures.at(texture_id) = texture;
+}
+
+void Model::draw(const Pipeline& pipeline, const Texture& null_texture,
+                 DrawMode mode, uint32_t lod_bias, CullMode cull_mode,
+                 RingBuffer* frame_data) const
+{
+    if (mode != DrawMode::PerMesh) {
+        drawIndirect(pipeline, null_texture, mode, lod_bias, cull_mode,
+                     frame_data);
+        return;
+    }
+
+    // all meshes share the VAO of the arena
+    const VertexArrayObject& vao = arena->getVertexArrayObject(vertex_format);
+    vao.activate();
+    pipeline.setUniform("vertexFlags", vertex_format.getShaderFlags());
+
+    if (!material_blocks) { buildMaterialBlocks(); }
+
+    // uniforms set per mesh are resolved once per draw
+    const auto position_offset =
+        pipeline.getUniformHandle<glm::vec3>("positionOffset");
+    const auto position_scale =
+        pipeline.getUniformHandle<glm::vec3>("positionScale");
+    const auto diffuse_virtual_texture =
+        pipeline.getUniformHandle<GLint>("diffuseVirtualTexture");
+
     // draw all meshes
+    std::vector<IndexRange> ranges;
     for (std::size_t i = 0; i < meshes.size(); i++) {
-        // reset textures
-        for (int j = 0; j < 10; ++j) { null_texture.bindToTextureUnit(j); }
+        ranges.clear();
+        getDrawRanges(i, lod_bias, cull_mode, ranges);
+        if (ranges.empty()) { continue; }
 
         const Mesh& mesh = meshes[i];
-        mesh.draw(pipeline, materials[mesh.getMaterialID()], textures);
+        const Material& material = materials[mesh.getMaterialID()];
+
+        // units of maps the material doesn't have sample the null texture,
+        // the others are bound by Mesh::draw
+        const Material resident = getResidentMaterial(material, textures);
+        for (std::size_t j = 0; j < std::size(material_texture_maps); ++j) {
+            if (!(resident.*material_texture_maps[j])) {
+                null_texture.bindToTextureUnit(j);
+            }
+        }
+        if (!virtual_textures.empty()) {
+            const std::optional<uint32_t> diffuse =
+                material.diffuse_map
+                    ? virtual_textures[material.diffuse_map.value()]
+                    : std::nullopt;
+            pipeline.setUniform(diffuse_virtual_texture,
+                                diffuse ? static_cast<GLint>(diffuse.value())
+                                        : -1);
+        }
+        pipeline.setUniform(position_offset, mesh.getPositionOffset());
+        pipeline.setUniform(position_scale, mesh.getPositionScale());
+        material_blocks->buffer.bindRangeToUniformBuffer(
+            MaterialBlock::binding,
+            material_blocks->stride * mesh.getMaterialID(),
+            sizeof(MaterialBlock));
+        mesh.draw(pipeline, material, textures, ranges);
+    }
+
+    vao.deactivate();
+}
+
+void Model::buildMaterialBlocks() const
+{
+    material_blocks = std::make_unique<MaterialBlockData>();
+
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    material_blocks->stride = (sizeof(MaterialBlock) + alignment - 1) /
+                              alignment * alignment;
+
+    // maps whose textures are not uploaded yet are treated as missing, as
+    // Mesh::draw does for textures it binds
+    std::vector<uint8_t> data(
+        material_blocks->stride * std::max<std::size_t>(materials.size(), 1));
+    for (std::size_t i = 0; i < materials.size(); ++i) {
+        const Material material = getResidentMaterial(materials[i], textures);
+
+        MaterialBlock block;
+        block.kd = material.diffuse_map ? glm::vec3(0) : material.kd;
+        block.ks = material.specular_map ? glm::vec3(0) : material.ks;
+        block.ka = material.ambient_map ? glm::vec3(0) : material.ka;
+        block.ke = material.emissive_map ? glm::vec3(0) : material.ke;
+        block.shininess = material.shininess;
+        block.has_height_map = material.height_map.has_value();
+        block.has_normal_map = material.normal_map.has_value();
+        block.has_displacement_map = material.displacement_map.has_value();
+        block.has_light_map = material.light_map.has_value();
+
+        std::memcpy(data.data() + material_blocks->stride * i, &block,
+                    sizeof(MaterialBlock));
     }
+    material_blocks->buffer.setStorage(data.data(), data.size(), 0);
+}
+
+void Model::buildIndirectDrawData(DrawMode mode) const
+{
+    indirect = std::make_unique<IndirectDrawData>();
+    indirect->mode = mode;
+    if (mode == DrawMode::Bindless) {
+        indirect->texture_table = MaterialTextureTable(textures);
+    }
+
+    // material table, same values as MaterialBlock of DrawMode::PerMesh
+    std::vector<GPUMaterial> gpu_materials;
+    gpu_materials.reserve(materials.size());
+    for (const auto& m : materials) {
+        const Material material = getResidentMaterial(m, textures);
+
+        GPUMaterial gpu_material;
+        gpu_material.kd = glm::vec4(
+            material.diffuse_map ? glm::vec3(0) : material.kd, 0.0f);
+        gpu_material.ks = glm::vec4(
+            material.specular_map ? glm::vec3(0) : material.ks, 0.0f);
+        gpu_material.ka = glm::vec4(
+            material.ambient_map ? glm::vec3(0) : material.ka, 0.0f);
+        gpu_material.ke = glm::vec4(
+            material.emissive_map ? glm::vec3(0) : material.ke, 0.0f);
+        gpu_material.shininess = material.shininess;
+        gpu_material.has_height_map = material.height_map.has_value();
+        gpu_material.has_normal_map = material.normal_map.has_value();
+        gpu_material.has_displacement_map =
+            material.displacement_map.has_value();
+        gpu_material.has_light_map = material.light_map.has_value();
+        for (std::size_t j = 0; j < std::size(material_texture_maps); ++j) {
+            const auto& map = material.*material_texture_maps[j];
+            gpu_material.texture_maps[j] =
+                map && mode == DrawMode::Bindless
+                    ? indirect->texture_table.getReference(map.value())
+                    : glm::uvec2(0);
+        }
+
+        gpu_materials.push_back(gpu_material);
+    }
+
+    // group meshes by index type and textures they sample, -1 means no
+    // texture. DrawMode::Bindless groups by index type only
+    using TextureSet = std::array<int64_t, std::size(material_texture_maps)>;
+    std::map<std::pair<GLenum, TextureSet>, std::vector<std::size_t>> groups;
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        const Material material = getResidentMaterial(
+            materials[meshes[i].getMaterialID()], textures);
+
+        TextureSet texture_set;
+        texture_set.fill(-1);
+        if (mode != DrawMode::Bindless) {
+            for (std::size_t j = 0; j < texture_set.size(); ++j) {
+                const auto& map = material.*material_texture_maps[j];
+                texture_set[j] =
+                    map ? static_cast<int64_t>(map.value()) : -1;
+            }
+        }
+        groups[{meshes[i].getIndexType(), texture_set}].push_back(i);
+    }
+
+    // index of per draw table is passed as base instance
+    std::vector<GPUDrawData> draws;
+    draws.reserve(meshes.size());
+    indirect->base_instances.resize(meshes.size());
+    for (const auto& [key, mesh_indices] : groups) {
+        IndirectDrawData::Batch batch;
+        batch.material_id = meshes[mesh_indices.front()].getMaterialID();
+        batch.index_type = key.first;
+        batch.mesh_indices = mesh_indices;
+        indirect->batches.push_back(std::move(batch));
+
+        for (const auto i : mesh_indices) {
+            indirect->base_instances[i] = draws.size();
+
+            GPUDrawData draw;
+            draw.position_offset =
+                glm::vec4(meshes[i].getPositionOffset(), 0.0f);
+            draw.position_scale = glm::vec4(meshes[i].getPositionScale(), 0.0f);
+            draw.material_id = meshes[i].getMaterialID();
+            draws.push_back(draw);
+        }
+    }
+
+    indirect->material_buffer.setData(gpu_materials, GL_STATIC_DRAW);
+    indirect->draw_buffer.setData(draws, GL_STATIC_DRAW);
+
+    spdlog::debug("[Model] built indirect draw data of {} meshes in {} "
+                  "batches",
+                  draws.size(), indirect->batches.size());
+}
+
+void Model::updateIndirectCommands(uint32_t lod_bias,
+                                   CullMode cull_mode) const
+{
+    std::vector<DrawElementsIndirectCommand> commands;
+    commands.reserve(indirect->commands.size());
+    std::vector<IndexRange> ranges;
+    for (auto& batch : indirect->batches) {
+        batch.first_command = commands.size();
+        for (const auto i : batch.mesh_indices) {
+            ranges.clear();
+            getDrawRanges(i, lod_bias, cull_mode, ranges);
+            for (const auto& range : ranges) {
+                commands.push_back(meshes[i].getDrawCommand(
+                    indirect->base_instances[i], range));
+            }
+        }
+        batch.n_commands = commands.size() - batch.first_command;
+    }
+
+    // commands change only when levels of detail or visibility change
+    const bool changed =
+        commands.size() != indirect->commands.size() ||
+        std::memcmp(commands.data(), indirect->commands.data(),
+                    sizeof(DrawElementsIndirectCommand) * commands.size()) !=
+            0;
+    if (changed) { indirect->commands_uploaded = false; }
+    indirect->commands = std::move(commands);
+}
+
+void Model::drawIndirect(const Pipeline& pipeline, const Texture& null_texture,
+                         DrawMode mode, uint32_t lod_bias, CullMode cull_mode,
+                         RingBuffer* frame_data) const
+{
+    if (!indirect || indirect->mode != mode) { buildIndirectDrawData(mode); }
+    updateIndirectCommands(lod_bias, cull_mode);
+    if (indirect->commands.empty()) { return; }
+
+    // commands are streamed without reallocating the command buffer, or
+    // uploaded to it when they have changed
+    std::optional<std::size_t> command_offset;
+    if (frame_data) {
+        command_offset = frame_data->write(
+            indirect->commands, alignof(DrawElementsIndirectCommand));
+    }
+    const bool streamed = command_offset.has_value();
+    if (streamed) {
+        frame_data->bindToDrawIndirectBuffer();
+    } else {
+        if (!indirect->commands_uploaded) {
+            indirect->command_buffer.setData(indirect->commands,
+                                             GL_DYNAMIC_DRAW);
+            indirect->commands_uploaded = true;
+        }
+        indirect->command_buffer.bindToDrawIndirectBuffer();
+        command_offset = 0;
+    }
+
+    const VertexArrayObject& vao = arena->getVertexArrayObject(vertex_format);
+    vao.activate();
+    pipeline.setUniform("vertexFlags", vertex_format.getShaderFlags());
+    // virtual textures are only sampled in DrawMode::PerMesh, a pipeline
+    // shared with it must not keep the index of its last mesh
+    pipeline.setUniform("diffuseVirtualTexture", GLint(-1));
+    indirect->material_buffer.bindToShaderStorageBuffer(
+        material_buffer_binding);
+    indirect->draw_buffer.bindToShaderStorageBuffer(draw_buffer_binding);
+    if (mode == DrawMode::Bindless) {
+        indirect->texture_table.bind();
+        pipeline.setUniform("materialTexturesBindless",
+                            indirect->texture_table.getBackend() ==
+                                MaterialTextureTable::Backend::BindlessHandles);
+    }
+    pipeline.activate();
+
+    for (const auto& batch : indirect->batches) {
+        if (batch.n_commands == 0) { continue; }
+
+        // texture units are same as TextureType, textures of
+        // DrawMode::Bindless are referenced by the material table instead
+        if (mode != DrawMode::Bindless) {
+            const Material material =
+                getResidentMaterial(materials[batch.material_id], textures);
+            for (std::size_t j = 0; j < std::size(material_texture_maps);
+                 ++j) {
+                const auto& map = material.*material_texture_maps[j];
+                if (map) {
+                    textures[map.value()]->bindToTextureUnit(j);
+                } else {
+                    null_texture.bindToTextureUnit(j);
+                }
+            }
+        }
+
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES, batch.index_type,
+            reinterpret_cast<const void*>(
+                command_offset.value() +
+                batch.first_command * sizeof(DrawElementsIndirectCommand)),
+            batch.n_commands, 0);
+    }
+
+    pipeline.deactivate();
+    if (streamed) {
+        frame_data->unbindFromDrawIndirectBuffer();
+    } else {
+        indirect->command_buffer.unbindFromDrawIndirectBuffer();
+    }
+    vao.deactivate();
+}
+
+void Model::loadTextures(const std::vector<TextureReference>& references,
+                         TextureCompression compression,
+                         VirtualTextureCache* virtual_cache,
+                         TextureCache* texture_cache)
+{
+    // virtual textures are split into pages here, and streamed later
+    virtual_textures.clear();
+    if (virtual_cache) {
+        virtual_textures.resize(references.size());
+        for (std::size_t i = 0; i < references.size(); ++i) {
+            if (!virtual_cache->accepts(references[i].type)) { continue; }
+            virtual_textures[i] = virtual_cache->add(references[i].filepath,
+                                                     references[i].type);
+        }
+    }
+
+    const auto is_virtual = [&](std::size_t i) {
+        return i < virtual_textures.size() && virtual_textures[i];
+    };
+
+    // decode images and generate mip chains(and compress them) on worker
+    // threads, KTX2 and DDS files are only mapped
+    const auto decode_start = std::chrono::steady_clock::now();
+
+    struct LoadedImage {
+        std::optional<MipChain> mips;
+        std::optional<CompressedImage> compressed;
+        std::optional<TextureContainer> container;
+        // keys are the same as the ones of ModelLoader, so that textures are
+        // shared with models loaded asynchronously too
+        std::optional<TextureCache::Key> key;
+        // texture is alive in texture_cache, so the image is not decoded
+        bool cached = false;
+    };
+
+    const auto decode = [compression](const TextureReference& reference,
+                                      LoadedImage& image) {
+        const auto container_path = TextureContainer::find(reference.filepath);
+        if (container_path) {
+            image.container = TextureContainer::load(container_path.value(),
+                                                     reference.type);
+            // fall back to the image
+            if (!image.container && image.key) {
+                image.key = TextureCache::makeKey(reference.filepath,
+                                                  reference.type, compression);
+            }
+        }
+        if (!image.container && compression == TextureCompression::BCn) {
+            image.compressed =
+                TextureCompressor::load(reference.filepath, reference.type);
+        }
+        if (!image.container && !image.compressed) {
+            glm::vec2 resolution;
+            const std::vector<uint8_t> pixels =
+                loadImage(reference.filepath, resolution);
+            image.mips = MipGenerator::generate(
+                pixels.data(), glm::uvec2(resolution), reference.type);
+        }
+    };
+
+    ThreadPool& pool = ThreadPool::getGlobal();
+    std::vector<std::future<LoadedImage>> images;
+    for (std::size_t i = 0; i < references.size(); ++i) {
+        if (is_virtual(i)) {
+            images.emplace_back();
+            continue;
+        }
+        const TextureReference& reference = references[i];
+        images.push_back(
+            pool.submit([reference, compression, texture_cache, decode]() {
+                LoadedImage ret;
+                if (texture_cache) {
+                    const auto container_path =
+                        TextureContainer::find(reference.filepath);
+                    ret.key = container_path
+                                  ? TextureCache::makeKey(
+                                        container_path.value(), reference.type)
+                                  : TextureCache::makeKey(reference.filepath,
+                                                          reference.type,
+                                                          compression);
+                    ret.cached =
+                        ret.key && texture_cache->contains(ret.key.value());
+                }
+                if (!ret.cached) { decode(reference, ret); }
+                return ret;
+            }));
+    }
+    for (auto& image : images) {
+        if (image.valid()) { image.wait(); }
+    }
+
+    const auto decode_end = std::chrono::steady_clock::now();
+
+    // create textures on this thread, since it has GL context
+    std::size_t n_shared = 0;
+    for (std::size_t i = 0; i < references.size(); ++i) {
+        if (is_virtual(i)) {
+            textures.push_back(nullptr);
+            continue;
+        }
+        LoadedImage image = images[i].get();
+
+        if (image.cached) {
+            if (auto texture = texture_cache->find(image.key.value())) {
+                textures.push_back(std::move(texture));
+                n_shared++;
+                continue;
+            }
+            // texture was freed after the lookup, decode it here
+            decode(references[i], image);
+        }
+
+        Texture texture;
+        if (image.container) {
+            texture = createTexture(image.container->getImage(),
+                                    image.container->getData());
+        } else if (image.compressed) {
+            texture = createTexture(image.compressed.value(),
+                                    image.compressed->data.data());
+        } else {
+            texture = createTexture(references[i].type, image.mips.value(),
+                                    image.mips->data.data());
+        }
+        textures.push_back(
+            image.key
+                ? texture_cache->insert(image.key.value(), std::move(texture))
+                : std::make_shared<Texture>(std::move(texture)));
+    }
+
+    const auto upload_end = std::chrono::steady_clock::now();
+
+    const std::chrono::duration<float, std::milli> decode_time =
+        decode_end - decode_start;
+    const std::chrono::duration<float, std::milli> upload_time =
+        upload_end - decode_end;
+    spdlog::info("[Model] decoded {} textures in {:.1f} ms with {} threads",
+                 references.size(), decode_time.count(),
+                 pool.getNumberOfThreads());
+    spdlog::info("[Model] uploaded {} textures in {:.1f} ms, {} shared with "
+                 "other models",
+                 references.size() - n_shared, upload_time.count(), n_shared);
 }
 
 void Model::processAssimpNode(const aiNode* node, const aiScene* scene,
-                              const std::filesystem::path& parentPath)
+                              ModelData& data)
 {
     // process all the node's meshes
     for (std::size_t i = 0; i < node->mNumMeshes; ++i) {
         const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processAssimpMesh(mesh, scene, parentPath));
+        data.meshes.push_back(processAssimpMesh(mesh));
     }
 
     // process child nodes
     for (std::size_t i = 0; i < node->mNumChildren; i++) {
-        processAssimpNode(node->mChildren[i], scene, parentPath);
+        processAssimpNode(node->mChildren[i], scene, data);
     }
 }
 
+std::vector<TextureReference> Model::getTexturesFromAssimp(
+    const aiScene* scene, const std::filesystem::path& parent_path,
+    TextureIndex& index)
+{
+    std::vector<TextureReference> ret;
+
+    for (std::size_t i = 0; i < scene->mNumMaterials; ++i) {
+        const aiMaterial* material = scene->mMaterials[i];
+        if (material == nullptr) continue;
+
+        for (const auto& [type, aiTexType] : assimp_texture_mapping) {
+            if (material->GetTextureCount(aiTexType) == 0) continue;
+
+            aiString str;
+            material->GetTexture(aiTexType, 0, &str);
+            const std::filesystem::path texture_path =
+                parent_path / str.C_Str();
+
+            // the same image may be referenced by multiple materials
+            if (index.try_emplace(texture_path.string(), ret.size()).second) {
+                ret.push_back({texture_path, type});
+            }
+        }
+    }
+
+    return ret;
+}
+
 std::vector<Vertex> Model::getVerticesFromAssimp(const aiMesh* mesh)
 {
     std::vector<Vertex> ret;
@@ -201,8 +1237,9 @@ std::vector<uint32_t> Model::getIndicesFromAssimp(const aiMesh* mesh)
     return ret;
 }
 
-Material Model::loadMaterialFromAssimp(const aiMaterial* material,
-                                       const std::filesystem::path& parent_path)
+Material Model::loadMaterialFromAssimp(
+    const aiMaterial* material, const std::filesystem::path& parent_path,
+    const TextureIndex& textures)
 {
     Material ret;
 
@@ -230,41 +1267,45 @@ Material Model::loadMaterialFromAssimp(const aiMaterial* material,
     material->Get(AI_MATKEY_SHININESS, ret.shininess);
 
     // diffuse map
-    ret.diffuse_map = loadTexture(material, TextureType::Diffuse, parent_path);
+    ret.diffuse_map =
+        loadTexture(material, TextureType::Diffuse, parent_path, textures);
 
     // specular map
     ret.specular_map =
-        loadTexture(material, TextureType::Specular, parent_path);
+        loadTexture(material, TextureType::Specular, parent_path, textures);
 
     // ambient map
-    ret.ambient_map = loadTexture(material, TextureType::Ambient, parent_path);
+    ret.ambient_map =
+        loadTexture(material, TextureType::Ambient, parent_path, textures);
 
     // emissive map
     ret.emissive_map =
-        loadTexture(material, TextureType::Emissive, parent_path);
+        loadTexture(material, TextureType::Emissive, parent_path, textures);
 
     // height map
-    ret.height_map = loadTexture(material, TextureType::Height, parent_path);
+    ret.height_map =
+        loadTexture(material, TextureType::Height, parent_path, textures);
 
     // normal map
-    ret.normal_map = loadTexture(material, TextureType::Normal, parent_path);
+    ret.normal_map =
+        loadTexture(material, TextureType::Normal, parent_path, textures);
 
     // shininess map
     ret.shininess_map =
-        loadTexture(material, TextureType::Shininess, parent_path);
+        loadTexture(material, TextureType::Shininess, parent_path, textures);
 
     // displacement map
     ret.displacement_map =
-        loadTexture(material, TextureType::Displacement, parent_path);
+        loadTexture(material, TextureType::Displacement, parent_path, textures);
 
     // light map
-    ret.light_map = loadTexture(material, TextureType::Light, parent_path);
+    ret.light_map =
+        loadTexture(material, TextureType::Light, parent_path, textures);
 
     return ret;
 }
 
-Mesh Model::processAssimpMesh(const aiMesh* mesh, const aiScene* scene,
-                              const std::filesystem::path& parentPath)
+MeshData Model::processAssimpMesh(const aiMesh* mesh)
 {
     spdlog::debug("[Mesh] Processing " + std::string(mesh->mName.C_Str()));
     spdlog::debug("[Mesh] number of vertices " +
@@ -272,57 +1313,13 @@ Mesh Model::processAssimpMesh(const aiMesh* mesh, const aiScene* scene,
     spdlog::debug("[Mesh] number of faces " + std::to_string(mesh->mNumFaces));
 
     std::vector<Vertex> vertices = getVerticesFromAssimp(mesh);
-    const std::vector<uint32_t> indices = getIndicesFromAssimp(mesh);
+    std::vector<uint32_t> indices = getIndicesFromAssimp(mesh);
 
-    // compute dn/dp, dn/dv
-    for (std::size_t i = 0; i < indices.size(); i += 3) {
-        const unsigned int idx1 = indices[i];
-        const unsigned int idx2 = indices[i + 1];
-        const unsigned int idx3 = indices[i + 2];
-
-        const glm::vec3 dn1 = vertices[idx2].normal - vertices[idx1].normal;
-        const glm::vec3 dn2 = vertices[idx3].normal - vertices[idx1].normal;
-        const float du1 =
-            vertices[idx2].texcoords.x - vertices[idx1].texcoords.x;
-        const float du2 =
-            vertices[idx3].texcoords.x - vertices[idx1].texcoords.x;
-        const float dv1 =
-            vertices[idx2].texcoords.y - vertices[idx1].texcoords.y;
-        const float dv2 =
-            vertices[idx3].texcoords.y - vertices[idx1].texcoords.y;
-
-        const float invDeterminant = 1.0f / (du1 * dv2 - dv1 * du2);
-
-        const glm::vec3 dndu = invDeterminant * (dv2 * dn1 - dv1 * dn2);
-        const glm::vec3 dndv = invDeterminant * (-du2 * dn1 + du1 * dn2);
-
-        // TODO: smoothing will give more nice result
-        vertices[idx1].dndu = dndu;
-        vertices[idx2].dndu = dndu;
-        vertices[idx3].dndu = dndu;
-        vertices[idx1].dndv = dndv;
-        vertices[idx2].dndv = dndv;
-        vertices[idx3].dndv = dndv;
-    }
-
-    std::optional<std::size_t> material_index =
-        getMaterialIndex(mesh->mMaterialIndex);
-
-    // load material if it's not loaded yet
-    if (!material_index) {
-        material_index = loadMaterial(scene, mesh->mMaterialIndex, parentPath);
-    }
-
-    return Mesh(vertices, indices, material_index.value());
-}
-
-MaterialID Model::loadMaterial(const aiScene* scene, AssimpMaterialIndex index,
-                               const std::filesystem::path& parent_path)
-{
-    const aiMaterial* m = scene->mMaterials[index];
-    materials.push_back(loadMaterialFromAssimp(m, parent_path));
-    loaded_materials.push_back(index);
-    return materials.size() - 1;
+    MeshData ret;
+    ret.vertices = std::move(vertices);
+    ret.indices = std::move(indices);
+    ret.material_id = mesh->mMaterialIndex;
+    return ret;
 }
 
 std::vector<uint8_t> Model::loadImage(const std::filesystem::path& filepath,
@@ -346,9 +1343,44 @@ std::vector<uint8_t> Model::loadImage(const std::filesystem::path& filepath,
     return ret;
 }
 
+Texture Model::createTexture(const TextureType& type, const MipChain& mips,
+                             const void* data)
+{
+    std::vector<const void*> levels;
+    for (const auto& level : mips.levels) {
+        levels.push_back(static_cast<const uint8_t*>(data) + level.offset);
+    }
+
+    const GLuint internal_format = getTextureInternalFormat(type);
+    return Texture::TextureBuilder(mips.levels.front().resolution)
+        .setInternalFormat(internal_format)
+        .setMagFilter(GL_LINEAR)
+        .setMinFilter(GL_LINEAR_MIPMAP_LINEAR)
+        .setMaxAnisotropy(default_max_anisotropy)
+        .setImageLevels(levels)
+        .build();
+}
+
+Texture Model::createTexture(const CompressedImage& image, const void* data)
+{
+    std::vector<Texture::CompressedLevel> levels;
+    for (const auto& level : image.levels) {
+        levels.push_back({static_cast<const uint8_t*>(data) + level.offset,
+                          static_cast<GLsizei>(level.size)});
+    }
+
+    return Texture::TextureBuilder(image.resolution)
+        .setInternalFormat(image.internal_format)
+        .setMagFilter(GL_LINEAR)
+        .setMinFilter(GL_LINEAR_MIPMAP_LINEAR)
+        .setMaxAnisotropy(default_max_anisotropy)
+        .setCompressedLevels(levels)
+        .build();
+}
+
 std::optional<TextureID> Model::loadTexture(
     const aiMaterial* material, const TextureType& type,
-    const std::filesystem::path& parentPath)
+    const std::filesystem::path& parentPath, const TextureIndex& textures)
 {
     const aiTextureType aiTexType = assimp_texture_mapping.at(type);
 
@@ -360,46 +1392,16 @@ std::optional<TextureID> Model::loadTexture(
     material->GetTexture(aiTexType, 0, &str);
     const std::filesystem::path texturePath = (parentPath / str.C_Str());
 
-    // load texture if it's not loaded
-    const auto index = getTextureIndex(texturePath);
-    if (index) { return index; }
-
-    // load image
-    glm::vec2 resolution;
-    const std::vector<uint8_t> image = loadImage(texturePath, resolution);
-    loaded_textures.emplace_back(texturePath);
-
-    // create texture
-    const GLuint internal_format = getTextureInternalFormat(type);
-    Texture texture = Texture::TextureBuilder(resolution)
-                          .setInternalFormat(internal_format)
-                          .setMagFilter(GL_LINEAR)
-                          .setMinFilter(GL_LINEAR_MIPMAP_LINEAR)
-                          .setGenerateMipmap(true)
-                          .setImage(image.data())
-                          .build();
-
-    textures.emplace_back(std::move(texture));
-
-    return textures.size() - 1;
-}
-
-std::optional<MaterialID> Model::getMaterialIndex(
-    uint32_t assimp_material_index) const
-{
-    for (std::size_t i = 0; i < loaded_materials.size(); ++i) {
-        if (loaded_materials[i] == assimp_material_index) return i;
-    }
-    return std::nullopt;
+    // texture is already collected by getTexturesFromAssimp
+    return getTextureIndex(texturePath, textures);
 }
 
 std::optional<TextureID> Model::getTextureIndex(
-    const std::filesystem::path& filepath) const
+    const std::filesystem::path& filepath, const TextureIndex& textures)
 {
-    for (std::size_t i = 0; i < loaded_textures.size(); ++i) {
-        if (loaded_textures[i] == filepath) return i;
-    }
-    return std::nullopt;
+    const auto it = textures.find(filepath.string());
+    if (it == textures.end()) { return std::nullopt; }
+    return it->second;
 }
 
 }  // namespace ogls
\ No newline at end of file
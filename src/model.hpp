@@ -3,23 +3,100 @@
 #include <assimp/scene.h>
 
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "assimp/material.h"
+#include "assimp/postprocess.h"
+#include "buffer.hpp"
+#include "geometry-arena.hpp"
+#include "material-texture-table.hpp"
+#include "mesh-optimizer.hpp"
 #include "mesh.hpp"
+#include "mip-generator.hpp"
+#include "model-data.hpp"
+#include "ring-buffer.hpp"
 #include "shader.hpp"
+#include "texture-cache.hpp"
+#include "texture-compressor.hpp"
 #include "texture.hpp"
+#include "uniform-blocks.hpp"
+#include "virtual-texture-cache.hpp"
 
 namespace ogls
 {
 
+enum class DrawMode {
+    // one draw call per mesh, material is read from a range of a uniform
+    // buffer bound to MaterialBlock
+    PerMesh,
+    // glMultiDrawElementsIndirect per texture set and index type, material
+    // and position transform are read from shader storage buffers indexed by
+    // gl_BaseInstance
+    MultiDrawIndirect,
+    // glMultiDrawElementsIndirect per index type, same tables as
+    // MultiDrawIndirect but material textures are referenced by the material
+    // table through MaterialTextureTable, so no texture is bound per draw
+    Bindless
+};
+
+enum class CullMode {
+    // draw all meshes
+    None,
+    // skip meshlets and meshes culled by the last Model::cullMeshlets
+    Meshlets
+};
+
+// camera which levels of detail of meshes are selected for
+struct LodView {
+    glm::vec3 camera_position = glm::vec3(0.0f);
+    // vertical field of view[degree], same as Camera::fov
+    float fov = 45.0f;
+    float framebuffer_height = 1.0f;
+    // projected error of simplification allowed[pixel]
+    float pixel_error = 1.0f;
+};
+
+// camera which meshlets are culled for
+struct CullView {
+    glm::vec3 camera_position = glm::vec3(0.0f);
+    glm::mat4 view_projection = glm::mat4(1.0f);
+    // cull meshlets facing away from camera by their normal cones
+    // this should be enabled only if GL_CULL_FACE is enabled
+    bool cull_backfaces = false;
+};
+
 class Model
 {
    public:
+    // GPU memory of vertices and indices, compared with memory they take as
+    // Vertex and 32 bit indices
+    struct GeometrySize {
+        std::size_t vertex_bytes = 0;
+        std::size_t index_bytes = 0;
+        std::size_t unpacked_vertex_bytes = 0;
+        std::size_t unpacked_index_bytes = 0;
+
+        std::size_t getSavedBytes() const;
+    };
+
     Model();
-    Model(const std::filesystem::path& filepath);
+    // meshes are sub-allocated from arena, if arena is not given the model
+    // creates its own arena
+    // vertices are stored in format, and CPU side geometry of meshes is kept
+    // according to retention
+    Model(const std::shared_ptr<GeometryArena>& arena,
+          const VertexFormat& format = VertexFormat(),
+          GeometryRetention retention = GeometryRetention::All);
+    // textures are stored on GPU according to compression
+    Model(const std::filesystem::path& filepath,
+          const std::shared_ptr<GeometryArena>& arena = nullptr,
+          const VertexFormat& format = VertexFormat(),
+          GeometryRetention retention = GeometryRetention::All,
+          TextureCompression compression = TextureCompression::BCn);
     Model(const Model& other) = delete;
     Model(Model&& other);
     ~Model() = default;
@@ -31,53 +108,300 @@ class Model
     operator bool() const;
 
     // load model with assimp
-    void loadModel(const std::filesystem::path& filepath);
+    // diffuse maps accepted by virtual_textures are added to it instead of
+    // being loaded, and meshes set their index as diffuseVirtualTexture
+    // uniform in DrawMode::PerMesh(-1 if the diffuse map is not virtual)
+    // other textures are shared through texture_cache if it's given, e.g.
+    // Scene::getTextureCache, the same as models loaded by ModelLoader
+    void loadModel(const std::filesystem::path& filepath,
+                   TextureCompression compression = TextureCompression::BCn,
+                   VirtualTextureCache* virtual_textures = nullptr,
+                   TextureCache* texture_cache = nullptr);
+
+    // post processing of ogls applied after import, these are a part of the
+    // cache key
+    // reorder triangles and vertices for vertex cache, overdraw and fetch
+    static constexpr uint32_t process_optimize_meshes = 1 << 0;
+    // generate normals, tangents, dndu and dndv by TangentFrameGenerator
+    // instead of assimp
+    static constexpr uint32_t process_generate_tangent_frames = 1 << 1;
+    // build chains of simplified indices by MeshSimplifier
+    static constexpr uint32_t process_generate_lods = 1 << 2;
+    // split meshes into meshlets by MeshletBuilder
+    static constexpr uint32_t process_build_meshlets = 1 << 3;
+    static constexpr uint32_t default_process_flags =
+        process_optimize_meshes | process_generate_tangent_frames |
+        process_generate_lods | process_build_meshlets;
+
+    // load CPU side data of model from cache, or import it with assimp
+    // this doesn't use GL, so it can be called from any thread
+    static std::optional<ModelData> loadModelData(
+        const std::filesystem::path& filepath,
+        uint32_t process_flags = default_process_flags);
+
+    // result of the last cullMeshlets
+    struct CullStats {
+        std::size_t n_meshlets = 0;
+        std::size_t n_frustum_culled = 0;
+        std::size_t n_backface_culled = 0;
+        // triangles of selected levels of detail
+        std::size_t n_triangles = 0;
+        std::size_t n_culled_triangles = 0;
+        // CPU time of culling[ms]
+        float cull_time = 0.0f;
+
+        float getCulledTriangleRatio() const;
+    };
+
+    // time to compute normals, tangents, dndu and dndv of a model file[ms]
+    struct TangentFrameBenchmark {
+        std::size_t n_triangles = 0;
+        // assimp and dndu, dndv of the last triangle of each vertex
+        float assimp_time = 0.0f;
+        // TangentFrameGenerator
+        float generator_time = 0.0f;
+        std::size_t n_threads = 0;
+    };
+
+    // import model file without cache and generate tangent frames in both
+    // ways
+    static std::optional<TangentFrameBenchmark> benchmarkTangentFrames(
+        const std::filesystem::path& filepath);
+
+    // decode image file as RGB8
+    static std::vector<uint8_t> loadImage(const std::filesystem::path& filepath,
+                                          glm::vec2& resolution);
+
+    // anisotropy of textures created by createTexture
+    static constexpr float default_max_anisotropy = 8.0f;
+
+    // textures have full mip chains and default_max_anisotropy
+    // data is mips.data, or an offset in the buffer bound to
+    // GL_PIXEL_UNPACK_BUFFER
+    static Texture createTexture(const TextureType& type, const MipChain& mips,
+                                 const void* data);
+    // data is image.data, or an offset in the buffer bound to
+    // GL_PIXEL_UNPACK_BUFFER
+    static Texture createTexture(const CompressedImage& image,
+                                 const void* data);
+
+    // incremental construction used by asynchronous loading
+    // textures are left empty until setTexture is called
+    void setMaterials(const std::vector<Material>& materials,
+                      uint32_t n_textures);
+    void addMesh(const MeshData& mesh, StagingBuffer* staging = nullptr);
+    // textures may be shared with other models through TextureCache
+    void setTexture(TextureID texture_id,
+                    const std::shared_ptr<Texture>& texture);
 
     uint32_t getNumberOfVertices() const;
     uint32_t getNumberOfFaces() const;
+    // faces of levels of detail selected by selectLods
+    uint32_t getNumberOfSelectedFaces() const;
     uint32_t getNumberOfTextures() const;
+    // indexed by TextureID, nullptr if texture is not uploaded
+    const std::vector<std::shared_ptr<Texture>>& getTextures() const;
+
+    // change sampling of all textures, this affects other models sharing
+    // them through TextureCache too
+    // tables of DrawMode::Bindless are rebuilt, since bindless handles and
+    // texture arrays don't follow sampling of textures
+    void setTextureFiltering(float max_anisotropy, float lod_bias) const;
+
+    const VertexFormat& getVertexFormat() const;
+    GeometrySize getGeometrySize() const;
+
+    GeometryRetention getRetention() const;
+    // bytes of CPU side geometry kept by meshes
+    std::size_t getRetainedGeometrySize() const;
 
-    void draw(const Pipeline& pipeline, const Texture& null_texture) const;
+    // choose level of detail of each mesh whose projected error is below
+    // view.pixel_error
+    // this should be called once per frame with the main camera
+    void selectLods(const LodView& view);
+    // draw all meshes at full resolution
+    void resetLods();
+
+    // fraction of pixel error a coarser level must be below to be selected
+    static constexpr float lod_hysteresis = 0.25f;
+
+    // cull meshes and meshlets of selected levels of detail outside of the
+    // view frustum, and meshlets facing away from camera
+    // meshes whose selected level is not 0 are culled as a whole
+    // this should be called once per frame after selectLods
+    void cullMeshlets(const CullView& view);
+    // draw all meshes and meshlets
+    void resetCulling();
+    const CullStats& getCullStats() const;
+
+    // levels of detail are lod_bias levels coarser than the selected ones,
+    // e.g. for shadow passes
+    // culling results are only valid for the camera they are computed for,
+    // so other views should use CullMode::None
+    // indirect draw commands are streamed through frame_data if it's given
+    // and has space left, instead of being uploaded when they change
+    void draw(const Pipeline& pipeline, const Texture& null_texture,
+              DrawMode mode = DrawMode::PerMesh, uint32_t lod_bias = 0,
+              CullMode cull_mode = CullMode::Meshlets,
+              RingBuffer* frame_data = nullptr) const;
+
+    // binding points of GPUMaterial and GPUDrawData tables in
+    // DrawMode::MultiDrawIndirect and DrawMode::Bindless
+    static constexpr GLuint material_buffer_binding = 0;
+    static constexpr GLuint draw_buffer_binding = 1;
 
    private:
+    std::shared_ptr<GeometryArena> arena;
+    VertexFormat vertex_format;
+    GeometryRetention retention;
     std::vector<Mesh> meshes;
     std::vector<Material> materials;
-    std::vector<Texture> textures;
+    std::vector<std::shared_ptr<Texture>> textures;
+    // index in VirtualTextureCache of each TextureID, empty if no texture is
+    // virtual
+    std::vector<std::optional<uint32_t>> virtual_textures;
+    // selected level of detail of each mesh
+    std::vector<uint32_t> lod_levels;
+
+    // result of cullMeshlets of each mesh
+    struct Visibility {
+        bool visible = true;
+        // merged ranges of visible meshlets if level 0 is selected, empty
+        // means the whole level
+        std::vector<IndexRange> ranges;
+    };
+    std::vector<Visibility> visibility;
+    CullStats cull_stats;
+
+    // GPU side tables of DrawMode::MultiDrawIndirect and DrawMode::Bindless
+    struct IndirectDrawData {
+        // mode tables are built for, batches of DrawMode::Bindless don't
+        // depend on textures
+        DrawMode mode = DrawMode::MultiDrawIndirect;
+
+        // meshes whose materials use same textures and same index type are
+        // drawn by one call, or same index type in DrawMode::Bindless
+        struct Batch {
+            std::size_t first_command = 0;
+            std::size_t n_commands = 0;
+            MaterialID material_id = 0;
+            GLenum index_type = GL_UNSIGNED_INT;
+            std::vector<std::size_t> mesh_indices;
+        };
+
+        // texture references of material_buffer in DrawMode::Bindless
+        MaterialTextureTable texture_table;
+        Buffer material_buffer;
+        Buffer draw_buffer;
+        Buffer command_buffer;
+        std::vector<Batch> batches;
+
+        // index of per draw table of each mesh
+        std::vector<GLuint> base_instances;
+        // commands of the last draw
+        std::vector<DrawElementsIndirectCommand> commands;
+        // command_buffer holds commands, which is not the case if they are
+        // streamed through RingBuffer
+        bool commands_uploaded = false;
+    };
+    // built on first indirect draw, reset when meshes, materials or textures
+    // are changed
+    mutable std::unique_ptr<IndirectDrawData> indirect;
+
+    void buildIndirectDrawData(DrawMode mode) const;
+
+    // MaterialBlock of each material of DrawMode::PerMesh, stride is a
+    // multiple of uniform buffer offset alignment
+    struct MaterialBlockData {
+        Buffer buffer;
+        std::size_t stride = 0;
+    };
+    // built on first draw, reset when materials or textures are changed
+    mutable std::unique_ptr<MaterialBlockData> material_blocks;
+
+    void buildMaterialBlocks() const;
+    // rebuild commands of selected levels and visible meshlets
+    void updateIndirectCommands(uint32_t lod_bias, CullMode cull_mode) const;
+    void drawIndirect(const Pipeline& pipeline, const Texture& null_texture,
+                      DrawMode mode, uint32_t lod_bias, CullMode cull_mode,
+                      RingBuffer* frame_data) const;
+
+    uint32_t getLod(std::size_t mesh_index, uint32_t lod_bias) const;
+    // ranges of indices of a mesh to draw, appended to ranges
+    void getDrawRanges(std::size_t mesh_index, uint32_t lod_bias,
+                       CullMode cull_mode,
+                       std::vector<IndexRange>& ranges) const;
 
-    using AssimpMaterialIndex = uint32_t;
-    std::vector<AssimpMaterialIndex> loaded_materials;
-    std::vector<std::filesystem::path> loaded_textures;
+    // steps of assimp replaced by process_generate_tangent_frames
+    static constexpr uint32_t tangent_frame_flags =
+        aiProcess_GenNormals | aiProcess_CalcTangentSpace;
 
-    void processAssimpNode(const aiNode* node, const aiScene* scene,
-                           const std::filesystem::path& parentPath);
+    // flags of assimp importer, this is also a part of the cache key
+    // tangent_frame_flags are applied after reading the file unless
+    // process_generate_tangent_frames is given
+    static constexpr uint32_t import_flags =
+        aiProcess_Triangulate | aiProcess_FlipUVs | tangent_frame_flags;
 
-    Mesh processAssimpMesh(const aiMesh* mesh, const aiScene* scene,
-                           const std::filesystem::path& parentPath);
+    // import model with assimp
+    static std::optional<ModelData> importModel(
+        const std::filesystem::path& filepath, uint32_t process_flags);
 
-    MaterialID loadMaterial(const aiScene* scene, AssimpMaterialIndex index,
-                            const std::filesystem::path& parent_path);
+    // run MeshOptimizer on all meshes
+    static void optimizeMeshes(ModelData& data);
 
-    std::optional<MaterialID> getMaterialIndex(
-        AssimpMaterialIndex assimp_material_id) const;
+    // run TangentFrameGenerator on meshes in parallel
+    static void generateTangentFrames(ModelData& data);
 
-    Material loadMaterialFromAssimp(const aiMaterial* material,
-                                    const std::filesystem::path& parent_path);
+    // run MeshSimplifier on meshes in parallel
+    static void generateLods(ModelData& data);
 
-    std::optional<TextureID> loadTexture(
+    // run MeshletBuilder on meshes in parallel
+    static void buildMeshlets(ModelData& data);
+
+    // simulated vertex cache of all meshes
+    static MeshOptimizer::CacheStats analyzeVertexCache(const ModelData& data);
+
+    // dndu and dndv of meshes whose normals and tangents are computed by
+    // assimp, each vertex takes the value of the last triangle using it
+    static void computeNormalDerivatives(ModelData& data);
+
+    // decode images on worker threads and create textures of them, textures
+    // alive in texture_cache are not decoded again
+    void loadTextures(const std::vector<TextureReference>& references,
+                      TextureCompression compression,
+                      VirtualTextureCache* virtual_cache,
+                      TextureCache* texture_cache);
+
+    static void processAssimpNode(const aiNode* node, const aiScene* scene,
+                                  ModelData& data);
+
+    static MeshData processAssimpMesh(const aiMesh* mesh);
+
+    // TextureID of texture filepath
+    using TextureIndex = std::unordered_map<std::string, TextureID>;
+
+    static Material loadMaterialFromAssimp(
+        const aiMaterial* material, const std::filesystem::path& parent_path,
+        const TextureIndex& textures);
+
+    static std::optional<TextureID> loadTexture(
         const aiMaterial* material, const TextureType& type,
-        const std::filesystem::path& parentPath);
+        const std::filesystem::path& parentPath, const TextureIndex& textures);
+
+    static std::optional<TextureID> getTextureIndex(
+        const std::filesystem::path& filepath, const TextureIndex& textures);
 
-    std::optional<TextureID> getTextureIndex(
-        const std::filesystem::path& filepath) const;
+    // find all textures referenced by materials, index is filled with their
+    // TextureID
+    static std::vector<TextureReference> getTexturesFromAssimp(
+        const aiScene* scene, const std::filesystem::path& parent_path,
+        TextureIndex& index);
 
     static std::vector<Vertex> getVerticesFromAssimp(const aiMesh* mesh);
     static std::vector<uint32_t> getIndicesFromAssimp(const aiMesh* mesh);
 
     static GLuint getTextureInternalFormat(const TextureType& type);
 
-    static std::vector<uint8_t> loadImage(const std::filesystem::path& filepath,
-                                          glm::vec2& resolution);
-
     static const std::map<TextureType, aiTextureType> assimp_texture_mapping;
 };
 
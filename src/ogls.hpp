@@ -1,12 +1,37 @@
 #pragma once
 
+#include "bindless-texture.hpp"
 #include "buffer.hpp"
 #include "camera.hpp"
 #include "framebuffer.hpp"
+#include "geometry-arena.hpp"
+#include "gl-state.hpp"
+#include "material-texture-table.hpp"
+#include "memory-usage.hpp"
+#include "mesh-optimizer.hpp"
+#include "mesh-simplifier.hpp"
 #include "mesh.hpp"
+#include "meshlet-builder.hpp"
+#include "mip-generator.hpp"
+#include "model-loader.hpp"
 #include "model.hpp"
+#include "parallel-shader-compile.hpp"
+#include "program-cache.hpp"
 #include "quad.hpp"
+#include "ring-buffer.hpp"
 #include "scene.hpp"
+#include "shader-source-cache.hpp"
+#include "shader-watcher.hpp"
 #include "shader.hpp"
+#include "staging-buffer.hpp"
+#include "tangent-frame-generator.hpp"
+#include "texture-cache.hpp"
+#include "texture-compressor.hpp"
+#include "texture-container.hpp"
 #include "texture.hpp"
-#include "vertex-array-object.hpp"
\ No newline at end of file
+#include "thread-pool.hpp"
+#include "tiled-image.hpp"
+#include "uniform-blocks.hpp"
+#include "vertex-array-object.hpp"
+#include "vertex-format.hpp"
+#include "virtual-texture-cache.hpp"
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "parallel-shader-compile.hpp"
+
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+// same values in KHR and ARB extension
+constexpr GLenum max_shader_compiler_threads = 0x91B0;
+constexpr GLenum completion_status = 0x91B1;
+
+using MaxShaderCompilerThreadsProc = void(APIENTRYP)(GLuint);
+
+MaxShaderCompilerThreadsProc max_shader_compiler_threads_proc = nullptr;
+
+bool hasExtension(const char* name)
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i) {
+        const char* extension = reinterpret_cast<const char*>(
+            glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension && std::strcmp(extension, name) == 0) { return true; }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool loadParallelShaderCompile(GLADloadproc load)
+{
+    max_shader_compiler_threads_proc = nullptr;
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+        max_shader_compiler_threads_proc =
+            reinterpret_cast<MaxShaderCompilerThreadsProc>(
+                load("glMaxShaderCompilerThreadsKHR"));
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+        max_shader_compiler_threads_proc =
+            reinterpret_cast<MaxShaderCompilerThreadsProc>(
+                load("glMaxShaderCompilerThreadsARB"));
+    } else {
+        spdlog::info("[ParallelShaderCompile] KHR_parallel_shader_compile is "
+                     "not supported");
+        return false;
+    }
+
+    if (!isParallelShaderCompileSupported()) {
+        spdlog::warn("[ParallelShaderCompile] failed to load "
+                     "KHR_parallel_shader_compile");
+        return false;
+    }
+
+    // let the driver choose the number of threads
+    max_shader_compiler_threads_proc(0xFFFFFFFF);
+    GLint n_threads = 0;
+    glGetIntegerv(max_shader_compiler_threads, &n_threads);
+    spdlog::info("[ParallelShaderCompile] compiling on {} threads",
+                 static_cast<GLuint>(n_threads));
+    return true;
+}
+
+bool isParallelShaderCompileSupported()
+{
+    return max_shader_compiler_threads_proc != nullptr;
+}
+
+bool isProgramCompleted(GLuint program)
+{
+    if (!isParallelShaderCompileSupported()) { return true; }
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program, completion_status, &completed);
+    return completed == GL_TRUE;
+}
+
+}  // namespace ogls
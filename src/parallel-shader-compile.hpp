@@ -0,0 +1,21 @@
+#pragma once
+#include "glad/glad.h"
+
+namespace ogls
+{
+
+// entry points of KHR_parallel_shader_compile, or ARB_parallel_shader_compile
+// which has the same enums, which glad of this repo is generated without
+// loadParallelShaderCompile should be called after gladLoadGLLoader with the
+// same loader. without the extension programs are compiled the way the
+// driver always does, and they are reported as completed
+
+// returns whether the extension is supported by the current context
+bool loadParallelShaderCompile(GLADloadproc load);
+bool isParallelShaderCompileSupported();
+
+// has the driver finished compiling and linking program? querying its link
+// status before this returns true blocks until it's finished
+bool isProgramCompleted(GLuint program);
+
+}  // namespace ogls
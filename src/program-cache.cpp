@@ -0,0 +1,225 @@
+#include "program-cache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "mapped-file.hpp"
+#include "model-cache.hpp"
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+// bump this when layout of the cache file changes
+constexpr uint32_t cache_version = 1;
+constexpr char cache_magic[8] = {'O', 'G', 'L', 'S', 'P', 'R', 'G', '\0'};
+
+// binary follows the header
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t type;
+    uint64_t key;
+    uint32_t binary_format;
+    // time compiling and linking the program took[ms]
+    float compile_time;
+    uint64_t binary_size;
+};
+
+ProgramCache::Stats stats;
+
+// drivers may support no binary format at all
+bool supportsProgramBinaries()
+{
+    static const bool supported = []() {
+        GLint n_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+        if (n_formats == 0) {
+            spdlog::warn("[ProgramCache] program binaries are not supported");
+        }
+        return n_formats > 0;
+    }();
+    return supported;
+}
+
+// binaries are rejected by other drivers, or after driver updates
+const std::string& getDriverString()
+{
+    static const std::string driver = []() {
+        std::string ret;
+        for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte* value = glGetString(name);
+            if (value) { ret += reinterpret_cast<const char*>(value); }
+            ret += '\n';
+        }
+        return ret;
+    }();
+    return driver;
+}
+
+}  // namespace
+
+float ProgramCache::Stats::getHitRate() const
+{
+    const std::size_t n_lookups = n_hits + n_misses;
+    return n_lookups > 0 ? static_cast<float>(n_hits) / n_lookups : 0.0f;
+}
+
+uint64_t ProgramCache::computeKey(GLenum type, const std::string& source)
+{
+    const std::string& driver = getDriverString();
+    uint64_t key = ModelCache::computeHash(source.data(), source.size());
+    key = ModelCache::computeHash(&type, sizeof(type), key);
+    key = ModelCache::computeHash(driver.data(), driver.size(), key);
+    key = ModelCache::computeHash(&cache_version, sizeof(cache_version), key);
+    return key;
+}
+
+std::filesystem::path ProgramCache::getCachePath(
+    const std::filesystem::path& filepath, uint64_t key)
+{
+    return filepath.parent_path() / ".ogls-cache" /
+           fmt::format("{}.{:016x}.bin", filepath.filename().string(), key);
+}
+
+GLuint ProgramCache::load(const std::filesystem::path& filepath, GLenum type,
+                          const std::string& source)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    if (!supportsProgramBinaries()) {
+        stats.n_misses++;
+        return 0;
+    }
+
+    const uint64_t key = computeKey(type, source);
+    const std::filesystem::path cache_path = getCachePath(filepath, key);
+    const MappedFile file(cache_path);
+    if (!file) {
+        stats.n_misses++;
+        return 0;
+    }
+
+    // validate header
+    const uint8_t* base = file.getData();
+    CacheHeader header{};
+    if (file.getSize() >= sizeof(CacheHeader)) {
+        std::memcpy(&header, base, sizeof(CacheHeader));
+    }
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version || header.type != type ||
+        header.key != key ||
+        sizeof(CacheHeader) + header.binary_size != file.getSize()) {
+        spdlog::warn("[ProgramCache] ignoring invalid cache {}",
+                     cache_path.string());
+        stats.n_misses++;
+        return 0;
+    }
+
+    // separable has to be set before the binary is loaded, like before
+    // linking
+    const GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramBinary(program, header.binary_format, base + sizeof(CacheHeader),
+                    header.binary_size);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+        // the driver changed in a way its version string doesn't show, the
+        // cache is overwritten by the program compiled instead
+        spdlog::info("[ProgramCache] driver rejected binary {}",
+                     cache_path.string());
+        glDeleteProgram(program);
+        stats.n_rejected++;
+        stats.n_misses++;
+        return 0;
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    stats.n_hits++;
+    stats.load_time += elapsed.count();
+    stats.saved_time += header.compile_time - elapsed.count();
+
+    spdlog::debug("[ProgramCache] loaded program {:x} from {} in {:.2f} ms, "
+                  "compiling took {:.2f} ms",
+                  program, cache_path.string(), elapsed.count(),
+                  header.compile_time);
+
+    return program;
+}
+
+void ProgramCache::save(const std::filesystem::path& filepath, GLenum type,
+                        const std::string& source, GLuint program,
+                        float compile_time)
+{
+    stats.compile_time += compile_time;
+
+    if (!supportsProgramBinaries()) { return; }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) { return; }
+
+    std::vector<uint8_t> binary(length);
+    GLsizei binary_size = 0;
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, length, &binary_size, &binary_format,
+                       binary.data());
+    if (binary_size <= 0) { return; }
+
+    const uint64_t key = computeKey(type, source);
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.type = type;
+    header.key = key;
+    header.binary_format = binary_format;
+    header.compile_time = compile_time;
+    header.binary_size = binary_size;
+
+    // write to temporary file first, so that readers never see partial file
+    const std::filesystem::path cache_path = getCachePath(filepath, key);
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        spdlog::warn("[ProgramCache] failed to create {}", temp_path.string());
+        return;
+    }
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(binary.data()), binary_size);
+    stream.close();
+
+    if (!stream) {
+        spdlog::warn("[ProgramCache] failed to write {}", temp_path.string());
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        spdlog::warn("[ProgramCache] failed to write {}: {}",
+                     cache_path.string(), ec.message());
+        return;
+    }
+
+    spdlog::debug("[ProgramCache] saved {} ({} bytes)", cache_path.string(),
+                  sizeof(header) + binary_size);
+}
+
+const ProgramCache::Stats& ProgramCache::getStats() { return stats; }
+
+}  // namespace ogls
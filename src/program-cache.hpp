@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+#include "glad/glad.h"
+
+namespace ogls
+{
+
+// on-disk cache of linked separable programs, saved by glGetProgramBinary
+// cache files are stored in .ogls-cache/ next to the shader file and keyed on
+// hash of the preprocessed source, shader stage and vendor, renderer and
+// version string of the driver.
+// binaries are only valid for the driver which created them, so a binary
+// rejected by glProgramBinary is counted and compiled again as usual.
+// NOTE: this must be called on GL thread
+class ProgramCache
+{
+   public:
+    struct Stats {
+        std::size_t n_hits = 0;
+        std::size_t n_misses = 0;
+        // binaries found but rejected by the driver, also counted as misses
+        std::size_t n_rejected = 0;
+        // time spent compiling misses and loading hits in total[ms]
+        float compile_time = 0.0f;
+        float load_time = 0.0f;
+        // compile time recorded with each hit minus its load time[ms]
+        float saved_time = 0.0f;
+
+        float getHitRate() const;
+    };
+
+    // returns linked program, or 0 if there is no valid cache
+    static GLuint load(const std::filesystem::path& filepath, GLenum type,
+                       const std::string& source);
+
+    // save binary of program linked from source in compile_time[ms]
+    static void save(const std::filesystem::path& filepath, GLenum type,
+                     const std::string& source, GLuint program,
+                     float compile_time);
+
+    static const Stats& getStats();
+
+   private:
+    static uint64_t computeKey(GLenum type, const std::string& source);
+
+    static std::filesystem::path getCachePath(
+        const std::filesystem::path& filepath, uint64_t key);
+};
+
+}  // namespace ogls
@@ -0,0 +1,232 @@
+#include "ring-buffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace ogls;
+
+RingBuffer::RingBuffer()
+    : buffer{0},
+      mapped{nullptr},
+      region_size{0},
+      n_regions{0},
+      region{0},
+      head{0},
+      bind_alignment{1}
+{
+}
+
+RingBuffer::RingBuffer(std::size_t region_size, uint32_t n_regions)
+    : RingBuffer()
+{
+    GLint uniform_alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    GLint storage_alignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+                  &storage_alignment);
+    bind_alignment = std::max(std::max(uniform_alignment, storage_alignment),
+                              GLint(1));
+
+    // regions start at bind alignment
+    this->region_size =
+        (region_size + bind_alignment - 1) / bind_alignment * bind_alignment;
+    this->n_regions = std::max(n_regions, 1u);
+    fences.resize(this->n_regions, nullptr);
+
+    const std::size_t capacity = this->region_size * this->n_regions;
+    constexpr GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, capacity, nullptr, flags);
+    mapped = static_cast<uint8_t*>(
+        glMapNamedBufferRange(buffer, 0, capacity, flags));
+
+    spdlog::debug("[RingBuffer] created ring buffer {:x} ({} x {} bytes)",
+                  buffer, this->n_regions, this->region_size);
+}
+
+RingBuffer::RingBuffer(RingBuffer&& other)
+    : buffer(other.buffer),
+      mapped(other.mapped),
+      region_size(other.region_size),
+      n_regions(other.n_regions),
+      region(other.region),
+      head(other.head),
+      fences(std::move(other.fences)),
+      bind_alignment(other.bind_alignment),
+      stats(other.stats)
+{
+    other.buffer = 0;
+    other.mapped = nullptr;
+    other.fences.clear();
+}
+
+RingBuffer::~RingBuffer() { release(); }
+
+RingBuffer& RingBuffer::operator=(RingBuffer&& other)
+{
+    if (this != &other) {
+        release();
+
+        buffer = other.buffer;
+        mapped = other.mapped;
+        region_size = other.region_size;
+        n_regions = other.n_regions;
+        region = other.region;
+        head = other.head;
+        fences = std::move(other.fences);
+        bind_alignment = other.bind_alignment;
+        stats = other.stats;
+
+        other.buffer = 0;
+        other.mapped = nullptr;
+        other.fences.clear();
+    }
+
+    return *this;
+}
+
+void RingBuffer::release()
+{
+    for (auto& fence : fences) {
+        if (fence) { glDeleteSync(fence); }
+    }
+    fences.clear();
+
+    if (buffer) {
+        spdlog::debug("[RingBuffer] release ring buffer {:x}", buffer);
+
+        glUnmapNamedBuffer(buffer);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        mapped = nullptr;
+    }
+}
+
+GLuint RingBuffer::getName() const { return buffer; }
+
+std::size_t RingBuffer::getRegionSize() const { return region_size; }
+
+uint32_t RingBuffer::getNumberOfRegions() const { return n_regions; }
+
+std::size_t RingBuffer::getBindAlignment() const { return bind_alignment; }
+
+void RingBuffer::beginFrame()
+{
+    if (!mapped) { return; }
+
+    stats.n_frames++;
+    stats.frame_bytes = head;
+    stats.peak_frame_bytes = std::max(stats.peak_frame_bytes, head);
+
+    region = (region + 1) % n_regions;
+    head = 0;
+
+    GLsync& fence = fences[region];
+    if (!fence) { return; }
+
+    // GPU is n_regions frames behind, wait until it finished the region
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        stats.n_fence_waits++;
+        const auto start = std::chrono::steady_clock::now();
+        constexpr GLuint64 timeout = 1000000;  // 1 ms
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      timeout);
+        }
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        stats.fence_wait_time += elapsed.count();
+
+        if (status == GL_WAIT_FAILED) {
+            spdlog::warn("[RingBuffer] failed to wait for fence of region {}",
+                         region);
+        }
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+bool RingBuffer::tryBeginFrame()
+{
+    if (!mapped) { return true; }
+
+    const GLsync fence = fences[(region + 1) % n_regions];
+    if (fence && glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    beginFrame();
+    return true;
+}
+
+void RingBuffer::endFrame()
+{
+    // nothing is written
+    if (!mapped || head == 0) { return; }
+
+    if (fences[region]) { glDeleteSync(fences[region]); }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+std::optional<RingBuffer::Allocation> RingBuffer::allocate(
+    std::size_t size, std::size_t alignment)
+{
+    if (alignment == 0) { alignment = bind_alignment; }
+    const std::size_t offset = (head + alignment - 1) / alignment * alignment;
+    if (!mapped || offset + size > region_size) {
+        stats.n_failed_allocations++;
+        return std::nullopt;
+    }
+
+    head = offset + size;
+    const std::size_t base = region_size * region;
+    return Allocation{mapped + base + offset, base + offset};
+}
+
+std::optional<std::size_t> RingBuffer::write(const void* data,
+                                             std::size_t size,
+                                             std::size_t alignment)
+{
+    const auto allocation = allocate(size, alignment);
+    if (!allocation) { return std::nullopt; }
+
+    std::memcpy(allocation->data, data, size);
+    return allocation->offset;
+}
+
+std::size_t RingBuffer::getAvailableSize() const
+{
+    return mapped ? region_size - head : 0;
+}
+
+const RingBuffer::Stats& RingBuffer::getStats() const { return stats; }
+
+void RingBuffer::bindRangeToUniformBuffer(GLuint binding_point_index,
+                                          std::size_t offset,
+                                          std::size_t size) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding_point_index, buffer, offset,
+                      size);
+}
+
+void RingBuffer::bindRangeToShaderStorageBuffer(GLuint binding_point_index,
+                                                std::size_t offset,
+                                                std::size_t size) const
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding_point_index, buffer,
+                      offset, size);
+}
+
+void RingBuffer::bindToDrawIndirectBuffer() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+}
+
+void RingBuffer::unbindFromDrawIndirectBuffer() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <optional>
+#include <vector>
+
+#include "glad/glad.h"
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+// persistently mapped buffer for data written every frame, e.g. matrices,
+// lights or indirect draw commands
+// the buffer is split into n_regions regions, and each frame sub-allocates
+// from the next region. a region is written again after the GPU finished
+// reading it, which is tracked by a fence per region, so writes never
+// reallocate the buffer or synchronize with the GPU unless it's n_regions
+// frames behind.
+class RingBuffer
+{
+   public:
+    struct Stats {
+        std::size_t n_frames = 0;
+        // frames whose region was still being read by the GPU, so
+        // beginFrame waited for its fence. the ring has too few regions if
+        // this keeps growing
+        std::size_t n_fence_waits = 0;
+        // time blocked by fences in total[ms]
+        float fence_wait_time = 0.0f;
+        // bytes allocated in the last frame, and the most in a frame
+        std::size_t frame_bytes = 0;
+        std::size_t peak_frame_bytes = 0;
+        // allocations which didn't fit in the region of their frame, the
+        // regions are too small if this is not 0
+        std::size_t n_failed_allocations = 0;
+    };
+
+    // mapped memory to write and its offset in the whole buffer, which
+    // binding functions take
+    struct Allocation {
+        uint8_t* data = nullptr;
+        std::size_t offset = 0;
+    };
+
+   private:
+    GLuint buffer;
+    uint8_t* mapped;
+    std::size_t region_size;
+    uint32_t n_regions;
+    // region of the current frame and head in it
+    uint32_t region;
+    std::size_t head;
+    // fence of the last frame written to each region
+    std::vector<GLsync> fences;
+    // offset alignment of uniform and shader storage buffer bindings
+    std::size_t bind_alignment;
+    Stats stats;
+
+    void release();
+
+   public:
+    RingBuffer();
+    // region_size is rounded up to bind alignment
+    RingBuffer(std::size_t region_size, uint32_t n_regions = 3);
+    RingBuffer(const RingBuffer& other) = delete;
+    RingBuffer(RingBuffer&& other);
+    ~RingBuffer();
+
+    RingBuffer& operator=(const RingBuffer& other) = delete;
+    RingBuffer& operator=(RingBuffer&& other);
+
+    GLuint getName() const;
+    std::size_t getRegionSize() const;
+    uint32_t getNumberOfRegions() const;
+    std::size_t getBindAlignment() const;
+
+    // start writing to the next region, this waits if the GPU is still
+    // reading it
+    void beginFrame();
+    // same as beginFrame, but returns false instead of waiting
+    bool tryBeginFrame();
+
+    // insert fence after the commands reading data of this frame
+    void endFrame();
+
+    // sub-allocate size bytes in the region of the current frame
+    // alignment 0 is bind alignment
+    // returns std::nullopt if there is not enough space left
+    std::optional<Allocation> allocate(std::size_t size,
+                                       std::size_t alignment = 0);
+
+    // copy data into the region of the current frame, returns its offset
+    // returns std::nullopt if there is not enough space left
+    std::optional<std::size_t> write(const void* data, std::size_t size,
+                                     std::size_t alignment = 0);
+
+    template <typename T>
+    std::optional<std::size_t> write(const std::vector<T>& data,
+                                     std::size_t alignment = 0)
+    {
+        return write(data.data(), sizeof(T) * data.size(), alignment);
+    }
+
+    // remaining space in the region of the current frame
+    std::size_t getAvailableSize() const;
+
+    const Stats& getStats() const;
+
+    void bindRangeToUniformBuffer(GLuint binding_point_index,
+                                  std::size_t offset, std::size_t size) const;
+    void bindRangeToShaderStorageBuffer(GLuint binding_point_index,
+                                        std::size_t offset,
+                                        std::size_t size) const;
+
+    // source of glMultiDrawElementsIndirect commands, their offsets are
+    // offsets in the whole buffer
+    void bindToDrawIndirectBuffer() const;
+    void unbindFromDrawIndirectBuffer() const;
+};
+
+}  // namespace ogls
@@ -15,25 +15,106 @@ void Scene::init()
                        .setType(GL_UNSIGNED_BYTE)
                        .setImage(&black_pixel[0])
                        .build();
+
+    geometry_arena =
+        GeometryArena::create(64 * 1024 * 1024, 16 * 1024 * 1024);
+    staging_buffer = StagingBuffer(32 * 1024 * 1024);
+    frame_data = RingBuffer(4 * 1024 * 1024);
+    texture_cache = std::make_shared<TextureCache>();
 }
 
-void Scene::draw(const Pipeline& pipeline) const
+void Scene::draw(const Pipeline& pipeline, DrawMode mode, uint32_t lod_bias,
+                 CullMode cull_mode) const
 {
-    // set point light
-    pipeline.setUniform("pointLight.ke", pointLight.getKe());
-    pipeline.setUniform("pointLight.position", pointLight.getPosition());
-    pipeline.setUniform("pointLight.radius", pointLight.getRadius());
-
-    // set directional light
-    pipeline.setUniform("directionalLight.ke", directionalLight.getKe());
-    pipeline.setUniform("directionalLight.direction",
-                        directionalLight.getDirection());
+    // bind camera and lights, they are uploaded only when changed
+    camera_block.bind();
+    light_block.update(getLightBlock());
 
     // draw models
-    if (model) { model.draw(pipeline, null_texture); }
+    if (model) {
+        model.draw(pipeline, null_texture, mode, lod_bias, cull_mode,
+                   &frame_data);
+    }
+}
+
+void Scene::selectLods(const Camera& camera, float framebuffer_height,
+                       float pixel_error)
+{
+    LodView view;
+    view.camera_position = camera.cam_pos;
+    view.fov = camera.fov;
+    view.framebuffer_height = framebuffer_height;
+    view.pixel_error = pixel_error;
+    model.selectLods(view);
+}
+
+void Scene::cullMeshlets(const Camera& camera, int width, int height,
+                         bool cull_backfaces)
+{
+    CullView view;
+    view.camera_position = camera.cam_pos;
+    view.view_projection = camera.computeViewProjectionMatrix(width, height);
+    view.cull_backfaces = cull_backfaces;
+    model.cullMeshlets(view);
+}
+
+void Scene::resetCulling() { model.resetCulling(); }
+
+void Scene::setModel(Model&& model)
+{
+    model_loader.reset();
+    this->model = std::move(model);
 }
 
-void Scene::setModel(Model&& model) { this->model = std::move(model); }
+ModelLoadHandle Scene::setModelAsync(const std::filesystem::path& filepath,
+                                     const VertexFormat& format,
+                                     GeometryRetention retention,
+                                     TextureCompression compression)
+{
+    model_loader = std::make_unique<ModelLoader>(filepath, format, retention,
+                                                 compression, texture_cache);
+    return model_loader->getHandle();
+}
+
+void Scene::update(float upload_budget_ms)
+{
+    if (!model_loader) { return; }
+
+    model_loader->processUploads(model, geometry_arena, staging_buffer,
+                                 upload_budget_ms);
+
+    if (model_loader->getHandle().getStatus() != ModelLoadStatus::Loading) {
+        model_loader.reset();
+    }
+}
+
+void Scene::beginFrame() { frame_data.beginFrame(); }
+
+void Scene::endFrame() { frame_data.endFrame(); }
+
+const RingBuffer& Scene::getFrameData() const { return frame_data; }
+
+const std::shared_ptr<GeometryArena>& Scene::getGeometryArena() const
+{
+    return geometry_arena;
+}
+
+const std::shared_ptr<TextureCache>& Scene::getTextureCache() const
+{
+    return texture_cache;
+}
+
+const Model& Scene::getModel() const { return model; }
+
+void Scene::setCamera(const Camera& camera, int width, int height)
+{
+    CameraBlock block;
+    block.view = camera.computeViewMatrix();
+    block.projection = camera.computeProjectionMatrix(width, height);
+    block.view_projection = block.projection * block.view;
+    block.position = camera.cam_pos;
+    camera_block.update(block);
+}
 
 void Scene::setPointLight(const PointLight& light) { pointLight = light; }
 
@@ -42,4 +123,15 @@ void Scene::setDirectionalLight(const DirectionalLight& light)
     directionalLight = light;
 }
 
+LightBlock Scene::getLightBlock() const
+{
+    LightBlock block;
+    block.point_light.ke = pointLight.getKe();
+    block.point_light.position = pointLight.getPosition();
+    block.point_light.radius = pointLight.getRadius();
+    block.directional_light.ke = directionalLight.getKe();
+    block.directional_light.direction = directionalLight.getDirection();
+    return block;
+}
+
 }  // namespace ogls
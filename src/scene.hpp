@@ -1,4 +1,6 @@
 #pragma once
+#include <filesystem>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -6,8 +8,15 @@
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 //
+#include "camera.hpp"
+#include "geometry-arena.hpp"
+#include "model-loader.hpp"
 #include "model.hpp"
+#include "ring-buffer.hpp"
 #include "shader.hpp"
+#include "staging-buffer.hpp"
+#include "texture-cache.hpp"
+#include "uniform-blocks.hpp"
 
 namespace ogls
 {
@@ -63,9 +72,30 @@ class Scene
 
     Texture null_texture;
 
+    // geometry of all models
+    std::shared_ptr<GeometryArena> geometry_arena;
+    // textures shared between models, loaded asynchronously or by
+    // Model::loadModel with getTextureCache()
+    std::shared_ptr<TextureCache> texture_cache;
+
+    // asynchronous model loading
+    std::unique_ptr<ModelLoader> model_loader;
+    StagingBuffer staging_buffer;
+
+    // per frame data such as indirect draw commands, written by const draw
+    mutable RingBuffer frame_data;
+
     PointLight pointLight;
     DirectionalLight directionalLight;
 
+    // uniform blocks shared by all pipelines, uploaded when they change
+    // lights may be set before the GL context exists, so they are uploaded
+    // by const draw
+    UniformBlockBuffer<CameraBlock> camera_block;
+    mutable UniformBlockBuffer<LightBlock> light_block;
+
+    LightBlock getLightBlock() const;
+
    public:
     Scene();
     Scene(const Scene& other) = delete;
@@ -77,10 +107,51 @@ class Scene
 
     void init();
 
-    void draw(const Pipeline& pipeline) const;
+    // lod_bias selects coarser levels of detail, e.g. for shadow passes
+    // passes from other views than the camera should use CullMode::None
+    void draw(const Pipeline& pipeline, DrawMode mode = DrawMode::PerMesh,
+              uint32_t lod_bias = 0,
+              CullMode cull_mode = CullMode::Meshlets) const;
+
+    // select levels of detail of the model seen from camera
+    // pixel_error is projected error of simplification allowed[pixel]
+    void selectLods(const Camera& camera, float framebuffer_height,
+                    float pixel_error = 1.0f);
+
+    // cull meshlets of the model outside of the camera view, and facing away
+    // from it if cull_backfaces is true
+    void cullMeshlets(const Camera& camera, int width, int height,
+                      bool cull_backfaces);
+    void resetCulling();
 
     void setModel(Model&& model);
 
+    // load model on worker threads, its GPU resources are uploaded by update()
+    // loading in progress is cancelled
+    ModelLoadHandle setModelAsync(
+        const std::filesystem::path& filepath,
+        const VertexFormat& format = VertexFormat(),
+        GeometryRetention retention = GeometryRetention::All,
+        TextureCompression compression = TextureCompression::BCn);
+
+    // upload resources of asynchronous model loading within the time
+    // budget[ms]. this should be called once per frame.
+    void update(float upload_budget_ms);
+
+    // start and end a frame of frame data, all draws of a frame should be
+    // between them
+    void beginFrame();
+    void endFrame();
+    const RingBuffer& getFrameData() const;
+
+    const std::shared_ptr<GeometryArena>& getGeometryArena() const;
+    const std::shared_ptr<TextureCache>& getTextureCache() const;
+
+    const Model& getModel() const;
+
+    // update CameraBlock with matrices of camera
+    void setCamera(const Camera& camera, int width, int height);
+
     void setPointLight(const PointLight& light);
 
     void setDirectionalLight(const DirectionalLight& light);
@@ -0,0 +1,179 @@
+#include "shader-source-cache.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+constexpr std::string_view include_identifier = "#include ";
+
+ShaderSourceCache::Stats stats;
+
+}  // namespace
+
+std::unordered_map<std::string, ShaderSourceCache::SourceFile>&
+ShaderSourceCache::getFileMap()
+{
+    static std::unordered_map<std::string, SourceFile> files;
+    return files;
+}
+
+std::filesystem::path ShaderSourceCache::normalize(
+    const std::filesystem::path& filepath)
+{
+    std::error_code error;
+    const std::filesystem::path canonical =
+        std::filesystem::weakly_canonical(filepath, error);
+    return (error ? filepath : canonical).lexically_normal();
+}
+
+ShaderSourceCache::SourceFile& ShaderSourceCache::parse(
+    const std::filesystem::path& filepath)
+{
+    auto& files = getFileMap();
+    const auto [it, inserted] =
+        files.try_emplace(filepath.generic_string(), SourceFile());
+    SourceFile& file = it->second;
+    if (!inserted) { return file; }
+
+    file.chunks.emplace_back();
+    std::ifstream stream(filepath);
+    if (!stream) {
+        spdlog::error("[ShaderSourceCache] failed to open {}",
+                      filepath.string());
+        return file;
+    }
+    stats.n_reads++;
+
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.starts_with(include_identifier)) {
+            file.chunks.back() += line;
+            file.chunks.back() += '\n';
+            continue;
+        }
+
+        std::string include = line.substr(include_identifier.size());
+        include.erase(include.find_last_not_of(" \t\r") + 1);
+        file.includes.push_back(normalize(filepath.parent_path() / include));
+        file.chunks.emplace_back();
+    }
+
+    return file;
+}
+
+const std::string& ShaderSourceCache::expand(
+    const std::filesystem::path& filepath,
+    std::vector<std::filesystem::path>& include_stack)
+{
+    SourceFile& file = parse(filepath);
+    if (file.expanded) {
+        stats.n_hits++;
+        return *file.expanded;
+    }
+
+    include_stack.push_back(filepath);
+    std::string expanded = file.chunks[0];
+    for (std::size_t i = 0; i < file.includes.size(); ++i) {
+        const std::filesystem::path& include = file.includes[i];
+        if (std::find(include_stack.begin(), include_stack.end(), include) !=
+            include_stack.end()) {
+            spdlog::error("[ShaderSourceCache] {} includes itself through {}",
+                          include.string(), filepath.string());
+        } else {
+            expanded += expand(include, include_stack);
+        }
+        expanded += file.chunks[i + 1];
+    }
+    include_stack.pop_back();
+
+    // inserting included files doesn't move elements of the map
+    file.expanded = std::move(expanded);
+    return *file.expanded;
+}
+
+const std::string& ShaderSourceCache::load(
+    const std::filesystem::path& filepath)
+{
+    std::vector<std::filesystem::path> include_stack;
+    return expand(normalize(filepath), include_stack);
+}
+
+std::vector<std::filesystem::path> ShaderSourceCache::invalidate(
+    const std::vector<std::filesystem::path>& filepaths)
+{
+    auto& files = getFileMap();
+
+    std::vector<std::filesystem::path> ret;
+    for (const auto& filepath : filepaths) {
+        const std::filesystem::path normalized = normalize(filepath);
+        if (std::find(ret.begin(), ret.end(), normalized) == ret.end()) {
+            ret.push_back(normalized);
+        }
+    }
+    const std::size_t n_changed = ret.size();
+
+    // files including an invalidated file, until none is added
+    bool added = true;
+    while (added) {
+        added = false;
+        for (const auto& [key, file] : files) {
+            const std::filesystem::path filepath(key);
+            if (std::find(ret.begin(), ret.end(), filepath) != ret.end()) {
+                continue;
+            }
+            const bool includes_invalidated = std::any_of(
+                file.includes.begin(), file.includes.end(),
+                [&](const std::filesystem::path& include) {
+                    return std::find(ret.begin(), ret.end(), include) !=
+                           ret.end();
+                });
+            if (includes_invalidated) {
+                ret.push_back(filepath);
+                added = true;
+            }
+        }
+    }
+
+    // changed files are read again, files including them only expanded
+    // again
+    for (std::size_t i = 0; i < ret.size(); ++i) {
+        const auto it = files.find(ret[i].generic_string());
+        if (it == files.end()) { continue; }
+        if (i < n_changed) {
+            files.erase(it);
+        } else {
+            it->second.expanded.reset();
+        }
+    }
+
+    spdlog::debug("[ShaderSourceCache] invalidated {} files", ret.size());
+
+    return ret;
+}
+
+bool ShaderSourceCache::contains(const std::filesystem::path& filepath)
+{
+    return getFileMap().contains(normalize(filepath).generic_string());
+}
+
+std::vector<std::filesystem::path> ShaderSourceCache::getFiles()
+{
+    std::vector<std::filesystem::path> ret;
+    for (const auto& entry : getFileMap()) { ret.push_back(entry.first); }
+    return ret;
+}
+
+const ShaderSourceCache::Stats& ShaderSourceCache::getStats()
+{
+    return stats;
+}
+
+}  // namespace ogls
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ogls
+{
+
+// preprocessed shader sources, and the graph of files they include
+// "#include path" at the start of a line is replaced by the file at path
+// relative to the including file, the same as Shadinclude does. each file is
+// read once and its expanded source is kept until the file or a file it
+// includes is invalidated.
+// NOTE: this must be called on GL thread, like loading shaders
+class ShaderSourceCache
+{
+   public:
+    struct Stats {
+        // loads whose expanded source was cached
+        std::size_t n_hits = 0;
+        // files read from disk
+        std::size_t n_reads = 0;
+    };
+
+    // returns source of filepath with includes expanded, empty if it can't
+    // be read
+    static const std::string& load(const std::filesystem::path& filepath);
+
+    // forget files which changed on disk, and expanded sources of files
+    // including them
+    // returns normalized paths of the changed files and all files including
+    // them, directly or not
+    static std::vector<std::filesystem::path> invalidate(
+        const std::vector<std::filesystem::path>& filepaths);
+
+    // is filepath loaded, or included by a loaded file? files which can't
+    // be read are included too, so that creating them is noticed
+    static bool contains(const std::filesystem::path& filepath);
+    // normalized paths of all loaded and included files
+    static std::vector<std::filesystem::path> getFiles();
+
+    // key of filepath in the cache
+    static std::filesystem::path normalize(
+        const std::filesystem::path& filepath);
+
+    static const Stats& getStats();
+
+   private:
+    struct SourceFile {
+        // text between include lines, one more than includes
+        std::vector<std::string> chunks;
+        // normalized paths of included files
+        std::vector<std::filesystem::path> includes;
+        // source with includes expanded
+        std::optional<std::string> expanded;
+    };
+
+    static std::unordered_map<std::string, SourceFile>& getFileMap();
+
+    static SourceFile& parse(const std::filesystem::path& filepath);
+    static const std::string& expand(
+        const std::filesystem::path& filepath,
+        std::vector<std::filesystem::path>& include_stack);
+};
+
+}  // namespace ogls
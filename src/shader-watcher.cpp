@@ -0,0 +1,113 @@
+#include "shader-watcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include "shader-source-cache.hpp"
+#include "shader.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace ogls;
+
+ShaderWatcher::ShaderWatcher() : fd{-1}, n_watched_files{0}
+{
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        spdlog::warn("[ShaderWatcher] failed to initialize inotify, errno {}",
+                     errno);
+    }
+#else
+    spdlog::info("[ShaderWatcher] shader hot reload is only supported on "
+                 "Linux");
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    // watches are removed with the instance
+    if (fd >= 0) { close(fd); }
+#endif
+}
+
+void ShaderWatcher::watchFiles()
+{
+#ifdef __linux__
+    const std::vector<std::filesystem::path> files =
+        ShaderSourceCache::getFiles();
+    if (files.size() == n_watched_files) { return; }
+    n_watched_files = files.size();
+
+    // editors often replace files instead of writing them, which only
+    // watches of their directories see
+    for (const auto& file : files) {
+        const std::filesystem::path directory = file.parent_path();
+        const int wd = inotify_add_watch(fd, directory.c_str(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            spdlog::warn("[ShaderWatcher] failed to watch {}, errno {}",
+                         directory.string(), errno);
+            continue;
+        }
+        // adding a watched directory again returns the same descriptor
+        if (directories.try_emplace(wd, directory).second) {
+            spdlog::debug("[ShaderWatcher] watching {}", directory.string());
+        }
+    }
+#endif
+}
+
+std::size_t ShaderWatcher::update()
+{
+    if (fd < 0) { return 0; }
+
+    std::vector<std::filesystem::path> changed;
+
+#ifdef __linux__
+    watchFiles();
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        const ssize_t length = read(fd, buffer, sizeof(buffer));
+        // EAGAIN when there are no more events
+        if (length <= 0) { break; }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event =
+                reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            const auto it = directories.find(event->wd);
+            if (event->len == 0 || it == directories.end()) { continue; }
+
+            const std::filesystem::path filepath = it->second / event->name;
+            if (!ShaderSourceCache::contains(filepath)) { continue; }
+            if (std::find(changed.begin(), changed.end(), filepath) ==
+                changed.end()) {
+                changed.push_back(filepath);
+            }
+        }
+    }
+#endif
+
+    if (changed.empty()) { return 0; }
+
+    for (const auto& filepath : changed) {
+        spdlog::info("[ShaderWatcher] {} changed", filepath.string());
+    }
+    const std::size_t ret = Pipeline::reloadShaders(changed);
+
+    stats.n_changed_files += changed.size();
+    stats.n_reloaded_pipelines += ret;
+
+    return ret;
+}
+
+const ShaderWatcher::Stats& ShaderWatcher::getStats() const { return stats; }
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <unordered_map>
+
+namespace ogls
+{
+
+// hot reload of shaders
+// directories of all files ShaderSourceCache loaded are watched by inotify,
+// and pipelines using files written since the last update() are loaded again
+// by Pipeline::reloadShaders. their stages are attached between frames by
+// Pipeline::updatePending once all of them are compiled, so drawing never
+// waits for the compiler, and a shader which fails to compile keeps the
+// previous stages.
+// NOTE: files are only watched on Linux, update() does nothing elsewhere
+class ShaderWatcher
+{
+   public:
+    struct Stats {
+        // files changed, and pipelines loaded again
+        std::size_t n_changed_files = 0;
+        std::size_t n_reloaded_pipelines = 0;
+    };
+
+    ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher& other) = delete;
+    ~ShaderWatcher();
+
+    ShaderWatcher& operator=(const ShaderWatcher& other) = delete;
+
+    // watch files loaded since the last call, and reload pipelines using
+    // changed files. this doesn't block
+    // returns the number of pipelines reloaded
+    std::size_t update();
+
+    const Stats& getStats() const;
+
+   private:
+    // inotify instance, -1 if there is none
+    int fd;
+    // watched directory of each watch descriptor
+    std::unordered_map<int, std::filesystem::path> directories;
+    // number of files of ShaderSourceCache when they were last watched
+    std::size_t n_watched_files;
+    Stats stats;
+
+    void watchFiles();
+};
+
+}  // namespace ogls
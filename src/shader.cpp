@@ -1,23 +1,79 @@
 #include "shader.hpp"
 
-#include "Shadinclude.hpp"
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string_view>
+
+#include "gl-state.hpp"
+#include "parallel-shader-compile.hpp"
+#include "program-cache.hpp"
+#include "shader-source-cache.hpp"
+#include "uniform-blocks.hpp"
 
 using namespace ogls;
 
+namespace
+{
+
+Pipeline::UniformStats uniform_stats;
+
+// locations of a uniform no stage uses
+constexpr std::array<GLint, 4> inactive_locations = {-1, -1, -1, -1};
+
+// indices of stages in Pipeline::pending_stages
+constexpr std::size_t vertex_stage = 0;
+constexpr std::size_t geometry_stage = 1;
+constexpr std::size_t fragment_stage = 2;
+constexpr std::size_t compute_stage = 3;
+
+// GL_*_SHADER of stages in Pipeline::pending_stages
+constexpr GLenum stage_types[] = {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER,
+                                  GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER};
+
+// pipelines with pending stages, polled by Pipeline::updatePending
+std::vector<Pipeline*> pending_pipelines;
+// all pipelines, searched by Pipeline::reloadShaders
+std::vector<Pipeline*> pipelines;
+
+}  // namespace
+
 Pipeline::Shader::Shader() : program(0) {}
 
-GLuint Pipeline::Shader::createShaderProgram(
-    GLenum type, const std::filesystem::path& filepath)
+GLuint Pipeline::Shader::createShaderProgram(GLuint shader)
 {
-    const std::string shader_source = Shadinclude::load(filepath);
-    const char* shader_source_c = shader_source.c_str();
-    GLuint program = glCreateShaderProgramv(type, 1, &shader_source_c);
+    // same as glCreateShaderProgramv, which links before the binary can be
+    // marked as retrievable, and waits for compilation
+    const GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+
     spdlog::debug("[Shader] program {:x} created", program);
     return program;
 }
 
-void Pipeline::Shader::checkCompileError(GLuint program)
+bool Pipeline::Shader::checkCompileError(GLuint program, GLuint shader)
 {
+    if (shader) {
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (compiled == GL_FALSE) {
+            spdlog::error("[Shader] failed to compile shader of program {:x}",
+                          program);
+
+            GLint logSize = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+            std::vector<GLchar> errorLog(std::max(logSize, 1));
+            glGetShaderInfoLog(shader, errorLog.size(), &logSize,
+                               &errorLog[0]);
+            spdlog::error("[Shader] {}",
+                          std::string(errorLog.data(), logSize));
+            return false;
+        }
+    }
+
     int success = 0;
     glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (success == GL_FALSE) {
@@ -25,24 +81,131 @@ void Pipeline::Shader::checkCompileError(GLuint program)
 
         GLint logSize = 0;
         glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logSize);
-        std::vector<GLchar> errorLog(logSize);
+        std::vector<GLchar> errorLog(std::max(logSize, 1));
         glGetProgramInfoLog(program, logSize, &logSize, &errorLog[0]);
         std::string errorLogStr(errorLog.begin(), errorLog.end());
         spdlog::error("[Shader] {}", errorLogStr);
     }
+    return success != GL_FALSE;
 }
 
 Pipeline::Shader::Shader(GLenum type, const std::filesystem::path& filepath)
+    : Shader(submit(type, filepath))
+{
+    finish();
+}
+
+Pipeline::Shader Pipeline::Shader::submit(
+    GLenum type, const std::filesystem::path& filepath)
+{
+    Shader ret;
+    ret.filepath = filepath;
+
+    Pending pending;
+    pending.type = type;
+    pending.source = ShaderSourceCache::load(filepath);
+    pending.start = std::chrono::steady_clock::now();
+
+    ret.program = ProgramCache::load(filepath, type, pending.source);
+    if (!ret.program) {
+        const char* source_c = pending.source.c_str();
+        pending.shader = glCreateShader(type);
+        glShaderSource(pending.shader, 1, &source_c, nullptr);
+        glCompileShader(pending.shader);
+        ret.program = createShaderProgram(pending.shader);
+    }
+
+    ret.pending = std::move(pending);
+    return ret;
+}
+
+bool Pipeline::Shader::isCompleted() const
+{
+    if (!pending || !pending->shader) { return true; }
+    return isProgramCompleted(program);
+}
+
+bool Pipeline::Shader::finish()
 {
-    program = createShaderProgram(type, filepath);
-    checkCompileError(program);
+    if (!pending) { return true; }
+
+    // blocks until the driver finished the program
+    const bool linked = checkCompileError(program, pending->shader);
+    if (pending->shader) {
+        // time until the program is checked, which is longer than compiling
+        // took if it was polled
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - pending->start;
+        if (linked) {
+            ProgramCache::save(filepath, pending->type, pending->source,
+                               program, elapsed.count());
+        }
+        glDetachShader(program, pending->shader);
+        glDeleteShader(pending->shader);
+    }
+    pending.reset();
+
+    if (linked) {
+        checkUniformBlockLayouts(program);
+        reflectUniforms();
+    }
+    return linked;
+}
+
+void Pipeline::Shader::reflectUniforms()
+{
+    GLint n_uniforms = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES,
+                            &n_uniforms);
+    GLint max_name_length = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH,
+                            &max_name_length);
+
+    std::vector<GLchar> name(std::max(max_name_length, 1));
+    for (GLint i = 0; i < n_uniforms; ++i) {
+        // members of uniform blocks have no location
+        constexpr GLenum props[] = {GL_LOCATION, GL_ARRAY_SIZE};
+        GLint values[2] = {-1, 0};
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 2, props, 2, nullptr,
+                               values);
+        const GLint location = values[0];
+        if (location < 0) { continue; }
+
+        GLsizei length = 0;
+        glGetProgramResourceName(program, GL_UNIFORM, i, name.size(), &length,
+                                 name.data());
+        const std::string uniform_name(name.data(), length);
+        locations[uniform_name] = location;
+
+        // arrays of basic types are one resource named name[0], elements
+        // have consecutive locations
+        constexpr std::string_view first_element = "[0]";
+        if (uniform_name.ends_with(first_element)) {
+            const std::string base = uniform_name.substr(
+                0, uniform_name.size() - first_element.size());
+            locations[base] = location;
+            for (GLint j = 1; j < values[1]; ++j) {
+                locations[base + "[" + std::to_string(j) + "]"] =
+                    location + j;
+            }
+        }
+    }
+
+    spdlog::debug("[Shader] program {:x} has {} uniforms with location",
+                  program, locations.size());
 }
 
 Pipeline::Shader::~Shader() { release(); }
 
-Pipeline::Shader::Shader(Shader&& other) : program(other.program)
+Pipeline::Shader::Shader(Shader&& other)
+    : program(other.program),
+      filepath(std::move(other.filepath)),
+      locations(std::move(other.locations)),
+      pending(std::move(other.pending))
 {
     other.program = 0;
+    other.locations.clear();
+    other.pending.reset();
 }
 
 Pipeline::Shader& Pipeline::Shader::operator=(Shader&& other)
@@ -51,8 +214,13 @@ Pipeline::Shader& Pipeline::Shader::operator=(Shader&& other)
         release();
 
         program = other.program;
+        filepath = std::move(other.filepath);
+        locations = std::move(other.locations);
+        pending = std::move(other.pending);
 
         other.program = 0;
+        other.locations.clear();
+        other.pending.reset();
     }
 
     return *this;
@@ -62,6 +230,9 @@ Pipeline::Shader::operator bool() const { return this->program != 0; }
 
 void Pipeline::Shader::release()
 {
+    if (pending && pending->shader) { glDeleteShader(pending->shader); }
+    pending.reset();
+
     if (program) {
         spdlog::debug("[Shader] release program {:x}", program);
         glDeleteProgram(program);
@@ -70,14 +241,27 @@ void Pipeline::Shader::release()
 
 GLuint Pipeline::Shader::getProgram() const { return program; }
 
-void Pipeline::Shader::setUniform(
-    const std::string& uniform_name,
-    const std::variant<bool, GLint, GLuint, GLfloat, glm::vec2, glm::vec3,
-                       glm::mat4>& value) const
+const std::filesystem::path& Pipeline::Shader::getFilepath() const
+{
+    return filepath;
+}
+
+GLint Pipeline::Shader::getUniformLocation(
+    const std::string& uniform_name) const
 {
-    // get location of uniform variable
-    const GLint location = glGetUniformLocation(program, uniform_name.c_str());
+    const auto it = locations.find(uniform_name);
+    return it != locations.end() ? it->second : -1;
+}
+
+const std::unordered_map<std::string, GLint>&
+Pipeline::Shader::getUniformLocations() const
+{
+    return locations;
+}
 
+void Pipeline::Shader::setUniform(GLint location,
+                                  const UniformValue& value) const
+{
     // set value
     struct Visitor {
         GLuint program;
@@ -144,18 +328,36 @@ Pipeline::Shader Pipeline::Shader::createComputeShader(
     return Shader(GL_COMPUTE_SHADER, filepath);
 }
 
-Pipeline::Pipeline()
+Pipeline::Pipeline() : fallback{nullptr}, generation{0}
 {
     glCreateProgramPipelines(1, &pipeline);
     spdlog::debug("[Pipeline] pipeline {:x} created", pipeline);
+    pipelines.push_back(this);
 }
 
-Pipeline::Pipeline(Pipeline&& other) : pipeline(other.pipeline)
+Pipeline::Pipeline(Pipeline&& other)
+    : pipeline(other.pipeline),
+      vertex_shader(std::move(other.vertex_shader)),
+      fragment_shader(std::move(other.fragment_shader)),
+      geometry_shader(std::move(other.geometry_shader)),
+      compute_shader(std::move(other.compute_shader)),
+      pending_stages(std::move(other.pending_stages)),
+      fallback(other.fallback),
+      generation(other.generation),
+      uniforms(std::move(other.uniforms))
 {
     other.pipeline = 0;
+    other.uniforms.clear();
+    std::replace(pending_pipelines.begin(), pending_pipelines.end(), &other,
+                 this);
+    pipelines.push_back(this);
 }
 
-Pipeline::~Pipeline() { release(); }
+Pipeline::~Pipeline()
+{
+    release();
+    std::erase(pipelines, this);
+}
 
 Pipeline& Pipeline::operator=(Pipeline&& other)
 {
@@ -163,8 +365,20 @@ Pipeline& Pipeline::operator=(Pipeline&& other)
         release();
 
         pipeline = other.pipeline;
+        vertex_shader = std::move(other.vertex_shader);
+        fragment_shader = std::move(other.fragment_shader);
+        geometry_shader = std::move(other.geometry_shader);
+        compute_shader = std::move(other.compute_shader);
+        pending_stages = std::move(other.pending_stages);
+        fallback = other.fallback;
+        // handles of both pipelines must not match this one
+        generation = std::max(generation, other.generation) + 1;
+        uniforms = std::move(other.uniforms);
 
         other.pipeline = 0;
+        other.uniforms.clear();
+        std::replace(pending_pipelines.begin(), pending_pipelines.end(),
+                     &other, this);
     }
 
     return *this;
@@ -172,8 +386,11 @@ Pipeline& Pipeline::operator=(Pipeline&& other)
 
 void Pipeline::release()
 {
+    std::erase(pending_pipelines, this);
+
     if (pipeline) {
         spdlog::debug("[Pipeline] release pipeline {:x}", pipeline);
+        GLState::forgetProgramPipeline(pipeline);
         glDeleteProgramPipelines(1, &pipeline);
     }
 }
@@ -183,6 +400,7 @@ void Pipeline::attachVertexShader(Shader&& shader)
     vertex_shader = std::move(shader);
     glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT,
                        vertex_shader.getProgram());
+    updateUniforms();
 }
 
 void Pipeline::attachGeometryShader(Shader&& shader)
@@ -190,6 +408,7 @@ void Pipeline::attachGeometryShader(Shader&& shader)
     geometry_shader = std::move(shader);
     glUseProgramStages(pipeline, GL_GEOMETRY_SHADER_BIT,
                        geometry_shader.getProgram());
+    updateUniforms();
 }
 
 void Pipeline::attachFragmentShader(Shader&& shader)
@@ -197,6 +416,7 @@ void Pipeline::attachFragmentShader(Shader&& shader)
     fragment_shader = std::move(shader);
     glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT,
                        fragment_shader.getProgram());
+    updateUniforms();
 }
 
 void Pipeline::attachComputeShader(Shader&& shader)
@@ -204,6 +424,7 @@ void Pipeline::attachComputeShader(Shader&& shader)
     compute_shader = std::move(shader);
     glUseProgramStages(pipeline, GL_COMPUTE_SHADER_BIT,
                        compute_shader.getProgram());
+    updateUniforms();
 }
 
 void Pipeline::loadVertexShader(const std::filesystem::path& filepath)
@@ -226,17 +447,217 @@ void Pipeline::loadComputeShader(const std::filesystem::path& filepath)
     attachComputeShader(Shader::createComputeShader(filepath));
 }
 
-void Pipeline::setUniform(
-    const std::string& uniform_name,
-    const std::variant<bool, GLint, GLuint, GLfloat, glm::vec2, glm::vec3,
-                       glm::mat4>& value) const
+void Pipeline::loadShaderAsync(std::size_t stage,
+                               const std::filesystem::path& filepath)
+{
+    pending_stages[stage] = Shader::submit(stage_types[stage], filepath);
+    if (std::find(pending_pipelines.begin(), pending_pipelines.end(), this) ==
+        pending_pipelines.end()) {
+        pending_pipelines.push_back(this);
+    }
+}
+
+void Pipeline::loadVertexShaderAsync(const std::filesystem::path& filepath)
+{
+    loadShaderAsync(vertex_stage, filepath);
+}
+
+void Pipeline::loadGeometryShaderAsync(const std::filesystem::path& filepath)
+{
+    loadShaderAsync(geometry_stage, filepath);
+}
+
+void Pipeline::loadFragmentShaderAsync(const std::filesystem::path& filepath)
+{
+    loadShaderAsync(fragment_stage, filepath);
+}
+
+void Pipeline::loadComputeShaderAsync(const std::filesystem::path& filepath)
+{
+    loadShaderAsync(compute_stage, filepath);
+}
+
+bool Pipeline::attachPendingStages()
+{
+    std::erase(pending_pipelines, this);
+
+    bool linked = true;
+    for (auto& stage : pending_stages) {
+        if (stage) { linked = stage.finish() && linked; }
+    }
+    if (!linked) {
+        spdlog::error("[Pipeline] keeping previous stages of pipeline {:x}",
+                      pipeline);
+        pending_stages = {};
+        return false;
+    }
+
+    if (pending_stages[vertex_stage]) {
+        attachVertexShader(std::move(pending_stages[vertex_stage]));
+    }
+    if (pending_stages[geometry_stage]) {
+        attachGeometryShader(std::move(pending_stages[geometry_stage]));
+    }
+    if (pending_stages[fragment_stage]) {
+        attachFragmentShader(std::move(pending_stages[fragment_stage]));
+    }
+    if (pending_stages[compute_stage]) {
+        attachComputeShader(std::move(pending_stages[compute_stage]));
+    }
+    return true;
+}
+
+bool Pipeline::update()
+{
+    if (!isPending()) { return false; }
+    for (const auto& stage : pending_stages) {
+        if (stage && !stage.isCompleted()) { return false; }
+    }
+    return attachPendingStages();
+}
+
+void Pipeline::wait()
 {
-    if (vertex_shader) { vertex_shader.setUniform(uniform_name, value); }
-    if (geometry_shader) { geometry_shader.setUniform(uniform_name, value); }
-    if (fragment_shader) { fragment_shader.setUniform(uniform_name, value); }
-    if (compute_shader) { compute_shader.setUniform(uniform_name, value); }
+    if (isPending()) { attachPendingStages(); }
 }
 
-void Pipeline::activate() const { glBindProgramPipeline(pipeline); }
+bool Pipeline::isPending() const
+{
+    return std::any_of(pending_stages.begin(), pending_stages.end(),
+                       [](const Shader& stage) { return bool(stage); });
+}
+
+bool Pipeline::isReady() const
+{
+    return vertex_shader || geometry_shader || fragment_shader ||
+           compute_shader;
+}
+
+void Pipeline::setFallback(const Pipeline* fallback)
+{
+    this->fallback = fallback;
+}
+
+bool Pipeline::usesFallback() const { return fallback && !isReady(); }
+
+void Pipeline::updateUniforms()
+{
+    generation++;
+    uniforms.clear();
+
+    const Shader* stages[] = {&vertex_shader, &geometry_shader,
+                              &fragment_shader, &compute_shader};
+    for (std::size_t i = 0; i < std::size(stages); ++i) {
+        for (const auto& [name, location] : stages[i]->getUniformLocations()) {
+            auto& locations =
+                uniforms.try_emplace(name, inactive_locations).first->second;
+            locations[i] = location;
+        }
+    }
+}
+
+const std::array<GLint, 4>* Pipeline::findUniform(
+    const std::string& uniform_name) const
+{
+    const auto it = uniforms.find(uniform_name);
+    return it != uniforms.end() ? &it->second : nullptr;
+}
+
+void Pipeline::setUniform(const std::array<GLint, 4>& locations,
+                          const UniformValue& value) const
+{
+    uniform_stats.n_set_uniform++;
+
+    const Shader* stages[] = {&vertex_shader, &geometry_shader,
+                              &fragment_shader, &compute_shader};
+    for (std::size_t i = 0; i < std::size(stages); ++i) {
+        if (!*stages[i]) { continue; }
+        // glGetUniformLocation and glProgramUniform per attached stage
+        uniform_stats.n_broadcast_calls += 2;
+
+        if (locations[i] < 0) { continue; }
+        stages[i]->setUniform(locations[i], value);
+        uniform_stats.n_uniform_writes++;
+    }
+}
+
+void Pipeline::setUniform(const std::string& uniform_name,
+                          const UniformValue& value) const
+{
+    if (usesFallback()) {
+        fallback->setUniform(uniform_name, value);
+        return;
+    }
+
+    const auto* locations = findUniform(uniform_name);
+    setUniform(locations ? *locations : inactive_locations, value);
+}
+
+void Pipeline::activate() const
+{
+    if (usesFallback()) {
+        fallback->activate();
+        return;
+    }
+    GLState::bindProgramPipeline(pipeline);
+}
+
+void Pipeline::deactivate() const { GLState::bindProgramPipeline(0); }
+
+std::size_t Pipeline::updatePending()
+{
+    // pipelines unregister themselves
+    const std::vector<Pipeline*> pipelines = pending_pipelines;
+    for (Pipeline* pipeline : pipelines) { pipeline->update(); }
+    return pending_pipelines.size();
+}
+
+void Pipeline::waitPending()
+{
+    const std::vector<Pipeline*> pipelines = pending_pipelines;
+    for (Pipeline* pipeline : pipelines) { pipeline->wait(); }
+}
+
+std::size_t Pipeline::reloadShaders(
+    const std::vector<std::filesystem::path>& filepaths)
+{
+    const std::vector<std::filesystem::path> invalidated =
+        ShaderSourceCache::invalidate(filepaths);
+    const std::set<std::filesystem::path> changed(invalidated.begin(),
+                                                  invalidated.end());
+
+    std::size_t ret = 0;
+    for (Pipeline* pipeline : pipelines) {
+        const Shader* stages[] = {
+            &pipeline->vertex_shader, &pipeline->geometry_shader,
+            &pipeline->fragment_shader, &pipeline->compute_shader};
+        bool reloaded = false;
+        for (std::size_t i = 0; i < std::size(stages); ++i) {
+            // a pending stage replaces the attached one
+            const Shader& stage = pipeline->pending_stages[i]
+                                      ? pipeline->pending_stages[i]
+                                      : *stages[i];
+            if (stage.getFilepath().empty() ||
+                !changed.contains(
+                    ShaderSourceCache::normalize(stage.getFilepath()))) {
+                continue;
+            }
+            // copy, submitting replaces the pending stage
+            const std::filesystem::path filepath = stage.getFilepath();
+            pipeline->loadShaderAsync(i, filepath);
+            reloaded = true;
+        }
+        if (reloaded) { ret++; }
+    }
+
+    spdlog::info("[Pipeline] reloading {} pipelines", ret);
+
+    return ret;
+}
+
+const Pipeline::UniformStats& Pipeline::getUniformStats()
+{
+    return uniform_stats;
+}
 
-void Pipeline::deactivate() const { glBindProgramPipeline(0); }
\ No newline at end of file
+void Pipeline::resetUniformStats() { uniform_stats = UniformStats(); }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
@@ -13,21 +20,84 @@
 namespace ogls
 {
 
+using UniformValue = std::variant<bool, GLint, GLuint, GLfloat, glm::vec2,
+                                  glm::vec3, glm::mat4>;
+
+// per stage locations of a uniform variable of Pipeline, resolved once by
+// Pipeline::getUniformHandle
+// a handle of a pipeline whose shaders were loaded again falls back to
+// looking up its name
+template <typename T>
+class UniformHandle
+{
+   private:
+    friend class Pipeline;
+
+    std::string name;
+    // locations in vertex, geometry, fragment and compute shader, -1 if the
+    // stage doesn't use the uniform
+    std::array<GLint, 4> locations = {-1, -1, -1, -1};
+    // Pipeline::generation the locations belong to
+    uint32_t generation = 0;
+
+   public:
+    // false if no stage uses the uniform
+    explicit operator bool() const
+    {
+        for (const auto location : locations) {
+            if (location >= 0) { return true; }
+        }
+        return false;
+    }
+};
+
 class Pipeline
 {
+   public:
+    // GL calls of setUniform, shared by all pipelines
+    struct UniformStats {
+        // calls of setUniform
+        std::size_t n_set_uniform = 0;
+        // glProgramUniform* issued, only to stages using the uniform
+        std::size_t n_uniform_writes = 0;
+        // GL calls per-call glGetUniformLocation and writing to all attached
+        // stages would have issued for the same calls
+        std::size_t n_broadcast_calls = 0;
+    };
+
    private:
     class Shader
     {
        private:
+        // program submitted to the driver which is not checked yet
+        struct Pending {
+            // 0 if the program was loaded from ProgramCache
+            GLuint shader = 0;
+            GLenum type = 0;
+            std::string source;
+            std::chrono::steady_clock::time_point start;
+        };
+
         GLuint program;
+        // file the program was loaded from
+        std::filesystem::path filepath;
+        // location of each active uniform outside of blocks, elements of
+        // arrays are found by name[i] and name
+        std::unordered_map<std::string, GLint> locations;
+        std::optional<Pending> pending;
+
+        // link shader into a separable program without waiting for it
+        static GLuint createShaderProgram(GLuint shader);
+        // returns false if shader failed to compile or program failed to
+        // link, shader is 0 if there is none
+        static bool checkCompileError(GLuint program, GLuint shader);
 
-        static GLuint createShaderProgram(
-            GLenum type, const std::filesystem::path& filepath);
-        static void checkCompileError(GLuint program);
+        void reflectUniforms();
 
        public:
         Shader();
         void extracted(GLenum& type, const std::filesystem::path& filepath);
+        // compile and wait for the program
         Shader(GLenum type, const std::filesystem::path& filepath);
         ~Shader();
         Shader(const Shader& other) = delete;
@@ -41,11 +111,25 @@ class Pipeline
         void release();
 
         GLuint getProgram() const;
+        const std::filesystem::path& getFilepath() const;
+
+        // has the driver finished the program submitted by submit()?
+        bool isCompleted() const;
+        // wait for the program submitted by submit() and check it
+        // returns false if it failed to compile or link
+        bool finish();
+
+        // -1 if the uniform is not active
+        GLint getUniformLocation(const std::string& uniform_name) const;
+        const std::unordered_map<std::string, GLint>& getUniformLocations()
+            const;
 
-        void setUniform(
-            const std::string& uniform_name,
-            const std::variant<bool, GLint, GLuint, GLfloat, glm::vec2,
-                               glm::vec3, glm::mat4>& value) const;
+        void setUniform(GLint location, const UniformValue& value) const;
+
+        // start compiling, finish() has to be called before the program is
+        // used
+        static Shader submit(GLenum type,
+                             const std::filesystem::path& filepath);
 
         static Shader createVertexShader(const std::filesystem::path& filepath);
         static Shader createFragmentShader(
@@ -63,7 +147,30 @@ class Pipeline
     Shader geometry_shader;
     Shader compute_shader;
 
+    // stages submitted by load*ShaderAsync, in order of
+    // UniformHandle::locations
+    std::array<Shader, 4> pending_stages;
+    // activated instead while no stage is attached
+    const Pipeline* fallback;
+
+    // incremented when a shader is attached, which invalidates handles
+    uint32_t generation;
+    // per stage locations of uniforms used by any stage, in order of
+    // UniformHandle::locations
+    std::unordered_map<std::string, std::array<GLint, 4>> uniforms;
+
     void release();
+    void updateUniforms();
+    const std::array<GLint, 4>* findUniform(
+        const std::string& uniform_name) const;
+    void setUniform(const std::array<GLint, 4>& locations,
+                    const UniformValue& value) const;
+    bool usesFallback() const;
+
+    void loadShaderAsync(std::size_t stage,
+                         const std::filesystem::path& filepath);
+    // attach all pending stages, or none if one of them failed
+    bool attachPendingStages();
 
     void attachVertexShader(Shader&& shader);
     void attachGeometryShader(Shader&& shader);
@@ -84,11 +191,77 @@ class Pipeline
     void loadFragmentShader(const std::filesystem::path& filepath);
     void loadComputeShader(const std::filesystem::path& filepath);
 
+    // submit compilation without waiting for it. stages submitted together
+    // are attached together once all of them are completed, previously
+    // attached stages are used until then, and kept if one of them fails.
+    // submitting stages of all pipelines before polling them lets the driver
+    // compile them in parallel
+    void loadVertexShaderAsync(const std::filesystem::path& filepath);
+    void loadGeometryShaderAsync(const std::filesystem::path& filepath);
+    void loadFragmentShaderAsync(const std::filesystem::path& filepath);
+    void loadComputeShaderAsync(const std::filesystem::path& filepath);
+
+    // attach pending stages if all of them are completed, this doesn't block
+    // returns true if stages were attached
+    bool update();
+    // block until pending stages are attached
+    void wait();
+    // are stages submitted which are not attached yet?
+    bool isPending() const;
+    // is any stage attached?
+    bool isReady() const;
+
+    // pipeline activated and set uniforms of instead, while no stage of
+    // this is attached. it must use the same vertex inputs and outlive this
+    void setFallback(const Pipeline* fallback);
+
+    // resolve locations of a uniform in each stage, T is one of the types
+    // of UniformValue
+    template <typename T>
+    UniformHandle<T> getUniformHandle(const std::string& uniform_name) const
+    {
+        UniformHandle<T> handle;
+        handle.name = uniform_name;
+        handle.generation = generation;
+        if (const auto* locations = findUniform(uniform_name)) {
+            handle.locations = *locations;
+        }
+        return handle;
+    }
+
+    // write value only to stages using the uniform, a uniform no stage uses
+    // is ignored
     void setUniform(const std::string& uniform_name,
-                    const std::variant<bool, GLint, GLuint, GLfloat, glm::vec2,
-                                       glm::vec3, glm::mat4>& value) const;
+                    const UniformValue& value) const;
+
+    template <typename T>
+    void setUniform(const UniformHandle<T>& handle,
+                    const std::type_identity_t<T>& value) const
+    {
+        if (handle.generation == generation && !usesFallback()) {
+            setUniform(handle.locations, value);
+        } else {
+            setUniform(handle.name, value);
+        }
+    }
+
     void activate() const;
     void deactivate() const;
+
+    // update() or wait() all pipelines with pending stages, updatePending
+    // returns the number of pipelines still pending
+    static std::size_t updatePending();
+    static void waitPending();
+
+    // load stages of all pipelines which use a file of filepaths, or a file
+    // including one of them, again by load*ShaderAsync. they are attached by
+    // updatePending when all of them are completed
+    // returns the number of pipelines reloaded
+    static std::size_t reloadShaders(
+        const std::vector<std::filesystem::path>& filepaths);
+
+    static const UniformStats& getUniformStats();
+    static void resetUniformStats();
 };
 
 }  // namespace ogls
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "staging-buffer.hpp"
+
+using namespace ogls;
+
+StagingBuffer::StagingBuffer() {}
+
+StagingBuffer::StagingBuffer(std::size_t capacity) : ring(capacity, 1) {}
+
+GLuint StagingBuffer::getName() const { return ring.getName(); }
+
+std::size_t StagingBuffer::getCapacity() const
+{
+    return ring.getRegionSize();
+}
+
+std::size_t StagingBuffer::getAvailableSize() const
+{
+    return ring.getAvailableSize();
+}
+
+bool StagingBuffer::begin()
+{
+    // don't wait, try again in next frame
+    return ring.tryBeginFrame();
+}
+
+void StagingBuffer::end() { ring.endFrame(); }
+
+std::optional<std::size_t> StagingBuffer::write(const void* data,
+                                                std::size_t size,
+                                                std::size_t alignment)
+{
+    return ring.write(data, size, alignment);
+}
+
+bool StagingBuffer::copy(const void* data, std::size_t size, GLuint dst_buffer,
+                         std::size_t dst_offset)
+{
+    const auto offset = write(data, size);
+    if (!offset) { return false; }
+
+    glCopyNamedBufferSubData(ring.getName(), dst_buffer, *offset, dst_offset,
+                             size);
+    return true;
+}
+
+void StagingBuffer::bindToPixelUnpackBuffer() const
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.getName());
+}
+
+void StagingBuffer::unbindFromPixelUnpackBuffer() const
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
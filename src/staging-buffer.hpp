@@ -0,0 +1,48 @@
+#pragma once
+#include <optional>
+
+#include "glad/glad.h"
+#include "ring-buffer.hpp"
+
+namespace ogls
+{
+
+// persistently mapped buffer for copying data to GPU resources
+// data written in a frame can be overwritten after the GPU finished reading
+// it, which is tracked by the fence of a RingBuffer with a single region.
+class StagingBuffer
+{
+   private:
+    RingBuffer ring;
+
+   public:
+    StagingBuffer();
+    StagingBuffer(std::size_t capacity);
+
+    GLuint getName() const;
+    std::size_t getCapacity() const;
+
+    // remaining space until end of the buffer
+    std::size_t getAvailableSize() const;
+
+    // start writing, returns false if the GPU is still reading previous data
+    bool begin();
+
+    // insert fence after the commands reading staged data
+    void end();
+
+    // copy data into the staging buffer, returns offset of the data
+    // returns std::nullopt if there is not enough space left
+    std::optional<std::size_t> write(const void* data, std::size_t size,
+                                     std::size_t alignment = 16);
+
+    // copy data into dst buffer through the staging buffer
+    // returns false if there is not enough space left
+    bool copy(const void* data, std::size_t size, GLuint dst_buffer,
+              std::size_t dst_offset);
+
+    void bindToPixelUnpackBuffer() const;
+    void unbindFromPixelUnpackBuffer() const;
+};
+
+}  // namespace ogls
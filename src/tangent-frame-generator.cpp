@@ -0,0 +1,436 @@
+#include "tangent-frame-generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "thread-pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OGLS_TANGENT_FRAME_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ogls
+{
+
+namespace
+{
+
+// work per chunk of ThreadPool::parallelFor
+constexpr std::size_t triangle_grain_size = 4096;
+constexpr std::size_t vertex_grain_size = 4096;
+
+#ifdef OGLS_TANGENT_FRAME_SSE2
+// 4 floats processed at once
+struct Lanes {
+    static constexpr std::size_t width = 4;
+    __m128 v;
+
+    static Lanes load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Lanes broadcast(float x) { return {_mm_set1_ps(x)}; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    static Lanes sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+    static Lanes max(Lanes a, Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+    static Lanes abs(Lanes a)
+    {
+        return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)};
+    }
+    // a if a > b, otherwise 0
+    static Lanes selectGreater(Lanes a, Lanes b, Lanes value)
+    {
+        return {_mm_and_ps(_mm_cmpgt_ps(a.v, b.v), value.v)};
+    }
+};
+#else
+// scalar fallback
+struct Lanes {
+    static constexpr std::size_t width = 1;
+    float v;
+
+    static Lanes load(const float* p) { return {*p}; }
+    static Lanes broadcast(float x) { return {x}; }
+    void store(float* p) const { *p = v; }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {a.v + b.v}; }
+    friend Lanes operator-(Lanes a, Lanes b) { return {a.v - b.v}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {a.v * b.v}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {a.v / b.v}; }
+
+    static Lanes sqrt(Lanes a) { return {std::sqrt(a.v)}; }
+    static Lanes max(Lanes a, Lanes b) { return {std::max(a.v, b.v)}; }
+    static Lanes abs(Lanes a) { return {std::abs(a.v)}; }
+    static Lanes selectGreater(Lanes a, Lanes b, Lanes value)
+    {
+        return {a.v > b.v ? value.v : 0.0f};
+    }
+};
+#endif
+
+struct Lanes3 {
+    Lanes x, y, z;
+
+    friend Lanes3 operator+(const Lanes3& a, const Lanes3& b)
+    {
+        return {a.x + b.x, a.y + b.y, a.z + b.z};
+    }
+    friend Lanes3 operator-(const Lanes3& a, const Lanes3& b)
+    {
+        return {a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+    friend Lanes3 operator*(const Lanes3& a, Lanes s)
+    {
+        return {a.x * s, a.y * s, a.z * s};
+    }
+};
+
+Lanes dot(const Lanes3& a, const Lanes3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Lanes3 cross(const Lanes3& a, const Lanes3& b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x};
+}
+
+// attributes of a corner of Lanes::width triangles starting from first
+// lanes past the last triangle repeat it
+template <typename Getter>
+Lanes3 gatherCorner(const MeshData& mesh, std::size_t first, uint32_t corner,
+                    Getter get)
+{
+    const std::size_t n_triangles = mesh.indices.size() / 3;
+    std::array<float, Lanes::width> x, y, z;
+    for (std::size_t l = 0; l < Lanes::width; ++l) {
+        const std::size_t t = std::min(first + l, n_triangles - 1);
+        const glm::vec3 v = get(mesh.vertices[mesh.indices[3 * t + corner]]);
+        x[l] = v.x;
+        y[l] = v.y;
+        z[l] = v.z;
+    }
+    return {Lanes::load(x.data()), Lanes::load(y.data()),
+            Lanes::load(z.data())};
+}
+
+// write valid lanes of values to out[first, first + width)
+void scatter(const Lanes3& values, std::size_t first, std::size_t n,
+             std::vector<glm::vec3>& out)
+{
+    std::array<float, Lanes::width> x, y, z;
+    values.x.store(x.data());
+    values.y.store(y.data());
+    values.z.store(z.data());
+    for (std::size_t l = 0; l < Lanes::width && first + l < n; ++l) {
+        out[first + l] = glm::vec3(x[l], y[l], z[l]);
+    }
+}
+
+void scatter(Lanes values, std::size_t first, std::size_t n,
+             std::vector<float>& out)
+{
+    std::array<float, Lanes::width> v;
+    values.store(v.data());
+    for (std::size_t l = 0; l < Lanes::width && first + l < n; ++l) {
+        out[first + l] = v[l];
+    }
+}
+
+// hash of raw bits of N floats, -0 and 0 are treated as different values
+template <std::size_t N>
+struct FloatsHash {
+    std::size_t operator()(const std::array<float, N>& key) const
+    {
+        uint64_t ret = 14695981039346656037ULL;
+        for (const float f : key) {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            ret = (ret ^ bits) * 1099511628211ULL;
+        }
+        return ret;
+    }
+};
+
+template <std::size_t N, typename KeyFunc>
+std::vector<uint32_t> weld(const std::vector<Vertex>& vertices, KeyFunc key,
+                           uint32_t& n_groups)
+{
+    std::unordered_map<std::array<float, N>, uint32_t, FloatsHash<N>> ids;
+    ids.reserve(vertices.size());
+
+    std::vector<uint32_t> ret(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        ret[i] = ids.try_emplace(key(vertices[i]), ids.size()).first->second;
+    }
+    n_groups = ids.size();
+    return ret;
+}
+
+const glm::vec3& getPosition(const Vertex& v) { return v.position; }
+const glm::vec3& getNormal(const Vertex& v) { return v.normal; }
+glm::vec3 getTexcoords(const Vertex& v) { return glm::vec3(v.texcoords, 0); }
+
+// any unit vector perpendicular to n, or x axis if n is zero
+glm::vec3 getPerpendicular(const glm::vec3& n)
+{
+    const glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0)
+                                                : glm::vec3(0, 1, 0);
+    const glm::vec3 ret = glm::cross(n, axis);
+    const float length = glm::length(ret);
+    return length > 0.0f ? ret / length : glm::vec3(1, 0, 0);
+}
+
+}  // namespace
+
+void TangentFrameGenerator::generate(MeshData& mesh, float smoothing_angle)
+{
+    if (mesh.indices.size() < 3) { return; }
+
+    generateNormals(mesh, smoothing_angle);
+    generateTangents(mesh);
+}
+
+TangentFrameGenerator::Adjacency TangentFrameGenerator::buildAdjacency(
+    const MeshData& mesh, bool with_attributes)
+{
+    Adjacency ret;
+
+    uint32_t n_groups = 0;
+    if (with_attributes) {
+        ret.groups = weld<8>(
+            mesh.vertices,
+            [](const Vertex& v) {
+                return std::array<float, 8>{
+                    v.position.x, v.position.y, v.position.z, v.normal.x,
+                    v.normal.y,   v.normal.z,   v.texcoords.x, v.texcoords.y};
+            },
+            n_groups);
+    } else {
+        ret.groups = weld<3>(
+            mesh.vertices,
+            [](const Vertex& v) {
+                return std::array<float, 3>{v.position.x, v.position.y,
+                                            v.position.z};
+            },
+            n_groups);
+    }
+
+    // counting sort of corners by group
+    ret.offsets.assign(n_groups + 1, 0);
+    for (const uint32_t index : mesh.indices) {
+        ret.offsets[ret.groups[index] + 1]++;
+    }
+    for (uint32_t g = 0; g < n_groups; ++g) {
+        ret.offsets[g + 1] += ret.offsets[g];
+    }
+
+    ret.corners.resize(mesh.indices.size());
+    std::vector<uint32_t> cursor(ret.offsets.begin(), ret.offsets.end() - 1);
+    for (std::size_t c = 0; c < mesh.indices.size(); ++c) {
+        ret.corners[cursor[ret.groups[mesh.indices[c]]]++] = c;
+    }
+
+    return ret;
+}
+
+void TangentFrameGenerator::generateNormals(MeshData& mesh,
+                                            float smoothing_angle)
+{
+    const bool missing = std::any_of(
+        mesh.vertices.begin(), mesh.vertices.end(),
+        [](const Vertex& v) { return v.normal == glm::vec3(0.0f); });
+    if (!missing) { return; }
+
+    ThreadPool& pool = ThreadPool::getGlobal();
+    const std::size_t n_triangles = mesh.indices.size() / 3;
+
+    // unit normals of triangles and angles of their corners
+    std::vector<glm::vec3> face_normals(n_triangles);
+    std::vector<float> angles(mesh.indices.size());
+    pool.parallelFor(
+        n_triangles, triangle_grain_size,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t = begin; t < end; t += Lanes::width) {
+                const Lanes3 p0 = gatherCorner(mesh, t, 0, getPosition);
+                const Lanes3 p1 = gatherCorner(mesh, t, 1, getPosition);
+                const Lanes3 p2 = gatherCorner(mesh, t, 2, getPosition);
+
+                const Lanes3 e1 = p1 - p0;
+                const Lanes3 e2 = p2 - p0;
+                const Lanes3 e3 = p2 - p1;
+                const Lanes l1 = Lanes::sqrt(dot(e1, e1));
+                const Lanes l2 = Lanes::sqrt(dot(e2, e2));
+                const Lanes l3 = Lanes::sqrt(dot(e3, e3));
+
+                const Lanes tiny = Lanes::broadcast(1e-20f);
+                const Lanes3 n = cross(e1, e2);
+                const Lanes length = Lanes::sqrt(dot(n, n));
+                scatter(n * (Lanes::broadcast(1.0f) / Lanes::max(length, tiny)),
+                        t, end, face_normals);
+
+                // cosines of corners, angles are taken on scalar
+                Lanes3 cosines;
+                cosines.x = dot(e1, e2) / Lanes::max(l1 * l2, tiny);
+                cosines.y = Lanes::broadcast(0.0f) -
+                            dot(e1, e3) / Lanes::max(l1 * l3, tiny);
+                cosines.z = dot(e2, e3) / Lanes::max(l2 * l3, tiny);
+
+                std::array<float, Lanes::width> x, y, z;
+                cosines.x.store(x.data());
+                cosines.y.store(y.data());
+                cosines.z.store(z.data());
+                for (std::size_t l = 0; l < Lanes::width && t + l < end;
+                     ++l) {
+                    angles[3 * (t + l) + 0] =
+                        std::acos(std::clamp(x[l], -1.0f, 1.0f));
+                    angles[3 * (t + l) + 1] =
+                        std::acos(std::clamp(y[l], -1.0f, 1.0f));
+                    angles[3 * (t + l) + 2] =
+                        std::acos(std::clamp(z[l], -1.0f, 1.0f));
+                }
+            }
+        });
+
+    // accumulate normals of triangles around each vertex
+    const Adjacency adjacency = buildAdjacency(mesh, false);
+    const float cos_smoothing_angle = std::cos(smoothing_angle);
+    pool.parallelFor(
+        mesh.vertices.size(), vertex_grain_size,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t v = begin; v < end; ++v) {
+                Vertex& vertex = mesh.vertices[v];
+                if (vertex.normal != glm::vec3(0.0f)) { continue; }
+
+                const uint32_t g = adjacency.groups[v];
+                const uint32_t* first =
+                    adjacency.corners.data() + adjacency.offsets[g];
+                const uint32_t* last =
+                    adjacency.corners.data() + adjacency.offsets[g + 1];
+
+                // triangles using this vertex decide which side of the
+                // crease it belongs to
+                glm::vec3 reference(0.0f);
+                for (const uint32_t* c = first; c != last; ++c) {
+                    if (mesh.indices[*c] != v) { continue; }
+                    reference += angles[*c] * face_normals[*c / 3];
+                }
+                const float length = glm::length(reference);
+                if (length == 0.0f) { continue; }
+                reference /= length;
+
+                glm::vec3 normal(0.0f);
+                for (const uint32_t* c = first; c != last; ++c) {
+                    const glm::vec3& n = face_normals[*c / 3];
+                    if (glm::dot(n, reference) >= cos_smoothing_angle) {
+                        normal += angles[*c] * n;
+                    }
+                }
+                vertex.normal = glm::normalize(normal);
+            }
+        });
+}
+
+void TangentFrameGenerator::generateTangents(MeshData& mesh)
+{
+    ThreadPool& pool = ThreadPool::getGlobal();
+    const std::size_t n_triangles = mesh.indices.size() / 3;
+
+    // values of triangles weighted by their areas
+    std::vector<glm::vec3> tangents(n_triangles);
+    std::vector<glm::vec3> dndus(n_triangles);
+    std::vector<glm::vec3> dndvs(n_triangles);
+    std::vector<float> weights(n_triangles);
+    pool.parallelFor(
+        n_triangles, triangle_grain_size,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t = begin; t < end; t += Lanes::width) {
+                const Lanes3 p0 = gatherCorner(mesh, t, 0, getPosition);
+                const Lanes3 p1 = gatherCorner(mesh, t, 1, getPosition);
+                const Lanes3 p2 = gatherCorner(mesh, t, 2, getPosition);
+                const Lanes3 n0 = gatherCorner(mesh, t, 0, getNormal);
+                const Lanes3 n1 = gatherCorner(mesh, t, 1, getNormal);
+                const Lanes3 n2 = gatherCorner(mesh, t, 2, getNormal);
+                const Lanes3 uv0 = gatherCorner(mesh, t, 0, getTexcoords);
+                const Lanes3 uv1 = gatherCorner(mesh, t, 1, getTexcoords);
+                const Lanes3 uv2 = gatherCorner(mesh, t, 2, getTexcoords);
+
+                const Lanes3 e1 = p1 - p0;
+                const Lanes3 e2 = p2 - p0;
+                const Lanes3 dn1 = n1 - n0;
+                const Lanes3 dn2 = n2 - n0;
+                const Lanes du1 = uv1.x - uv0.x;
+                const Lanes du2 = uv2.x - uv0.x;
+                const Lanes dv1 = uv1.y - uv0.y;
+                const Lanes dv2 = uv2.y - uv0.y;
+
+                // triangles with degenerate texcoords get zero weight
+                const Lanes determinant = du1 * dv2 - dv1 * du2;
+                const Lanes3 area = cross(e1, e2);
+                const Lanes weight = Lanes::selectGreater(
+                    Lanes::abs(determinant), Lanes::broadcast(1e-12f),
+                    Lanes::broadcast(0.5f) * Lanes::sqrt(dot(area, area)));
+                const Lanes inv_determinant = Lanes::selectGreater(
+                    Lanes::abs(determinant), Lanes::broadcast(1e-12f),
+                    Lanes::broadcast(1.0f) / determinant);
+
+                const Lanes3 tangent =
+                    (e1 * dv2 - e2 * dv1) * inv_determinant;
+                const Lanes tangent_length = Lanes::max(
+                    Lanes::sqrt(dot(tangent, tangent)),
+                    Lanes::broadcast(1e-20f));
+                scatter(tangent * (weight / tangent_length), t, end,
+                        tangents);
+
+                const Lanes scale = inv_determinant * weight;
+                scatter((dn1 * dv2 - dn2 * dv1) * scale, t, end, dndus);
+                scatter((dn2 * du1 - dn1 * du2) * scale, t, end, dndvs);
+                scatter(weight, t, end, weights);
+            }
+        });
+
+    // accumulate values of triangles sharing each vertex
+    const Adjacency adjacency = buildAdjacency(mesh, true);
+    pool.parallelFor(
+        mesh.vertices.size(), vertex_grain_size,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t v = begin; v < end; ++v) {
+                const uint32_t g = adjacency.groups[v];
+
+                glm::vec3 tangent(0.0f);
+                glm::vec3 dndu(0.0f);
+                glm::vec3 dndv(0.0f);
+                float weight = 0.0f;
+                for (uint32_t i = adjacency.offsets[g];
+                     i < adjacency.offsets[g + 1]; ++i) {
+                    const uint32_t t = adjacency.corners[i] / 3;
+                    tangent += tangents[t];
+                    dndu += dndus[t];
+                    dndv += dndvs[t];
+                    weight += weights[t];
+                }
+
+                Vertex& vertex = mesh.vertices[v];
+
+                // Gram-Schmidt orthogonalization against normal
+                const glm::vec3 n = vertex.normal;
+                tangent -= n * glm::dot(n, tangent);
+                const float length = glm::length(tangent);
+                vertex.tangent =
+                    length > 1e-12f ? tangent / length : getPerpendicular(n);
+
+                vertex.dndu = weight > 0.0f ? dndu / weight : glm::vec3(0.0f);
+                vertex.dndv = weight > 0.0f ? dndv / weight : glm::vec3(0.0f);
+            }
+        });
+}
+
+}  // namespace ogls
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+//
+#include "model-data.hpp"
+
+namespace ogls
+{
+
+// generate smoothed normals, tangents, dndu and dndv of meshes, in place of
+// aiProcess_GenNormals and aiProcess_CalcTangentSpace of assimp
+// meshes are not indexed without aiProcess_JoinIdenticalVertices, so vertices
+// are smoothed over triangles which share their attributes, not their indices
+// 1. normals: angle weighted normals of triangles sharing position, only for
+//    vertices whose normal is zero(missing in the file)
+// 2. tangents, dndu and dndv: area weighted values of triangles sharing
+//    position, normal and texcoords
+// per triangle values are computed by SIMD kernels, and both passes are split
+// across threads of the global ThreadPool
+class TangentFrameGenerator
+{
+   public:
+    // triangles whose normals differ more than smoothing_angle[rad] are not
+    // smoothed together
+    static void generate(MeshData& mesh,
+                         float smoothing_angle = glm::radians(80.0f));
+
+   private:
+    // corners of triangles sharing welded vertices, in CSR layout
+    // corner is 3 * triangle + [0, 3)
+    struct Adjacency {
+        // welded vertex of each vertex
+        std::vector<uint32_t> groups;
+        // corners of group g are corners[offsets[g], offsets[g + 1])
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> corners;
+    };
+
+    // if with_attributes is false, vertices are welded by position only
+    static Adjacency buildAdjacency(const MeshData& mesh,
+                                    bool with_attributes);
+
+    static void generateNormals(MeshData& mesh, float smoothing_angle);
+    static void generateTangents(MeshData& mesh);
+};
+
+}  // namespace ogls
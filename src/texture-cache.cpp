@@ -0,0 +1,118 @@
+#include "texture-cache.hpp"
+
+#include <functional>
+
+#include "mapped-file.hpp"
+#include "model-cache.hpp"
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+float TextureCache::Stats::getHitRate() const
+{
+    const std::size_t n_lookups = n_hits + n_misses;
+    return n_lookups > 0 ? static_cast<float>(n_hits) / n_lookups : 0.0f;
+}
+
+std::size_t TextureCache::KeyHash::operator()(const Key& key) const
+{
+    std::size_t ret = std::hash<std::string>()(key.path);
+    ret ^= std::hash<uint64_t>()(key.hash) + 0x9e3779b97f4a7c15ULL +
+           (ret << 6) + (ret >> 2);
+    ret ^= static_cast<std::size_t>(key.type) + 0x9e3779b97f4a7c15ULL +
+           (ret << 6) + (ret >> 2);
+    ret ^= static_cast<std::size_t>(key.compression) + 0x9e3779b97f4a7c15ULL +
+           (ret << 6) + (ret >> 2);
+    return ret;
+}
+
+TextureCache::TextureCache() : n_hits{0}, n_misses{0} {}
+
+std::optional<TextureCache::Key> TextureCache::makeKey(
+    const std::filesystem::path& filepath, TextureType type,
+    TextureCompression compression)
+{
+    const MappedFile file(filepath);
+    if (!file) { return std::nullopt; }
+
+    std::error_code error;
+    const std::filesystem::path canonical =
+        std::filesystem::weakly_canonical(filepath, error);
+
+    Key ret;
+    ret.path = (error ? filepath : canonical).generic_string();
+    ret.hash = ModelCache::computeHash(file.getData(), file.getSize());
+    ret.type = type;
+    ret.compression = compression;
+    return ret;
+}
+
+TextureCache::Shard& TextureCache::getShard(const Key& key)
+{
+    return shards[KeyHash()(key) % n_shards];
+}
+
+bool TextureCache::contains(const Key& key)
+{
+    Shard& shard = getShard(key);
+    bool ret = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.entries.find(key);
+        ret = it != shard.entries.end() && !it->second.expired();
+    }
+
+    if (ret) {
+        n_hits++;
+    } else {
+        n_misses++;
+    }
+    return ret;
+}
+
+std::shared_ptr<Texture> TextureCache::find(const Key& key)
+{
+    Shard& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) { return nullptr; }
+    return it->second.lock();
+}
+
+std::shared_ptr<Texture> TextureCache::insert(const Key& key,
+                                              Texture&& texture)
+{
+    Shard& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // drop entries of freed textures
+    std::erase_if(shard.entries,
+                  [](const auto& entry) { return entry.second.expired(); });
+
+    auto& entry = shard.entries[key];
+    if (auto existing = entry.lock()) { return existing; }
+
+    auto ret = std::make_shared<Texture>(std::move(texture));
+    entry = ret;
+
+    spdlog::debug("[TextureCache] added {}", key.path);
+
+    return ret;
+}
+
+TextureCache::Stats TextureCache::getStats() const
+{
+    Stats ret;
+    ret.n_hits = n_hits;
+    ret.n_misses = n_misses;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [key, texture] : shard.entries) {
+            if (!texture.expired()) { ret.n_entries++; }
+        }
+    }
+    return ret;
+}
+
+}  // namespace ogls
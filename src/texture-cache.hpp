@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "texture-compressor.hpp"
+#include "texture.hpp"
+
+namespace ogls
+{
+
+// textures shared between models, keyed by canonical path, content hash, type
+// and compression of image file.
+// the cache doesn't own textures, they are freed when the last model using
+// them is destroyed.
+// entries are split into shards with their own locks, so that loader threads
+// can query the cache concurrently.
+class TextureCache
+{
+   public:
+    struct Key {
+        std::string path;
+        uint64_t hash = 0;
+        TextureType type = TextureType::Diffuse;
+        TextureCompression compression = TextureCompression::None;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct Stats {
+        std::size_t n_hits = 0;
+        std::size_t n_misses = 0;
+        // number of textures alive
+        std::size_t n_entries = 0;
+
+        float getHitRate() const;
+    };
+
+    TextureCache();
+    TextureCache(const TextureCache& other) = delete;
+
+    TextureCache& operator=(const TextureCache& other) = delete;
+
+    // this reads the whole file, so it should be called on worker threads
+    // returns std::nullopt if the file can't be read
+    static std::optional<Key> makeKey(
+        const std::filesystem::path& filepath, TextureType type,
+        TextureCompression compression = TextureCompression::None);
+
+    // is texture of key alive? this is counted as hit or miss
+    // reference count is not touched, so this is safe to call on any thread
+    bool contains(const Key& key);
+
+    // returns nullptr if texture is already freed
+    // this must be called on GL thread, since the returned reference may be
+    // the last one
+    std::shared_ptr<Texture> find(const Key& key);
+
+    // register texture created for key, if another texture is already
+    // registered it's returned instead
+    // this must be called on GL thread
+    std::shared_ptr<Texture> insert(const Key& key, Texture&& texture);
+
+    Stats getStats() const;
+
+   private:
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<Key, std::weak_ptr<Texture>, KeyHash> entries;
+    };
+
+    static constexpr std::size_t n_shards = 16;
+    std::array<Shard, n_shards> shards;
+
+    std::atomic<std::size_t> n_hits;
+    std::atomic<std::size_t> n_misses;
+
+    Shard& getShard(const Key& key);
+};
+
+}  // namespace ogls
@@ -0,0 +1,652 @@
+#include "texture-compressor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <thread>
+
+#include "mapped-file.hpp"
+#include "mip-generator.hpp"
+#include "model-cache.hpp"
+#include "model.hpp"
+#include "spdlog/spdlog.h"
+#include "thread-pool.hpp"
+
+namespace ogls
+{
+
+namespace
+{
+
+// bump this when the encoders or the cache layout change
+constexpr uint32_t cache_version = 2;
+constexpr char cache_magic[8] = {'O', 'G', 'L', 'S', 'B', 'C', 'N', '\0'};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t internal_format;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_levels;
+    uint32_t padding;
+    uint64_t data_size;
+};
+
+struct LevelRecord {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// refinements of endpoints by least squares
+constexpr int n_refinements = 2;
+
+// weights of BC7 palette with 4 bit indices
+constexpr int bc7_weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                 34, 38, 43, 47, 51, 55, 60, 64};
+
+std::size_t getBlockSize(GLenum internal_format)
+{
+    switch (internal_format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+// levels of a full mip chain down to 1x1
+uint32_t getMaxLevels(uint32_t width, uint32_t height)
+{
+    uint32_t ret = 1;
+    while (ret < 32 && (std::max(width, height) >> ret) > 0) { ret++; }
+    return ret;
+}
+
+// endpoints of the principal axis of colors
+void fitPrincipalAxis(const std::array<glm::vec3, 16>& colors, glm::vec3& e0,
+                      glm::vec3& e1)
+{
+    glm::vec3 mean(0.0f);
+    for (const auto& c : colors) { mean += c; }
+    mean /= 16.0f;
+
+    // covariance, xx xy xz yy yz zz
+    float cov[6] = {};
+    for (const auto& c : colors) {
+        const glm::vec3 d = c - mean;
+        cov[0] += d.x * d.x;
+        cov[1] += d.x * d.y;
+        cov[2] += d.x * d.z;
+        cov[3] += d.y * d.y;
+        cov[4] += d.y * d.z;
+        cov[5] += d.z * d.z;
+    }
+
+    // power iteration
+    glm::vec3 axis(1.0f);
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 next(
+            cov[0] * axis.x + cov[1] * axis.y + cov[2] * axis.z,
+            cov[1] * axis.x + cov[3] * axis.y + cov[4] * axis.z,
+            cov[2] * axis.x + cov[4] * axis.y + cov[5] * axis.z);
+        const float length = std::max({std::abs(next.x), std::abs(next.y),
+                                       std::abs(next.z)});
+        if (length == 0.0f) {
+            e0 = e1 = mean;
+            return;
+        }
+        axis = next / length;
+    }
+    axis = glm::normalize(axis);
+
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = std::numeric_limits<float>::lowest();
+    for (const auto& c : colors) {
+        const float t = glm::dot(c - mean, axis);
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+    e0 = glm::clamp(mean + t_min * axis, 0.0f, 255.0f);
+    e1 = glm::clamp(mean + t_max * axis, 0.0f, 255.0f);
+}
+
+// endpoints minimizing squared error of colors interpolated by weights
+// returns false if weights are degenerate
+bool fitLeastSquares(const std::array<glm::vec3, 16>& colors,
+                     const std::array<float, 16>& weights, glm::vec3& e0,
+                     glm::vec3& e1)
+{
+    float a = 0.0f;
+    float b = 0.0f;
+    float c = 0.0f;
+    glm::vec3 x0(0.0f);
+    glm::vec3 x1(0.0f);
+    for (std::size_t i = 0; i < 16; ++i) {
+        const float t = weights[i];
+        a += (1.0f - t) * (1.0f - t);
+        b += t * (1.0f - t);
+        c += t * t;
+        x0 += (1.0f - t) * colors[i];
+        x1 += t * colors[i];
+    }
+
+    const float det = a * c - b * b;
+    if (std::abs(det) < 1e-6f) { return false; }
+
+    e0 = glm::clamp((c * x0 - b * x1) / det, 0.0f, 255.0f);
+    e1 = glm::clamp((a * x1 - b * x0) / det, 0.0f, 255.0f);
+    return true;
+}
+
+float squaredDistance(const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 d = a - b;
+    return glm::dot(d, d);
+}
+
+uint16_t quantize565(const glm::vec3& c)
+{
+    const uint16_t r = static_cast<uint16_t>(c.x * 31.0f / 255.0f + 0.5f);
+    const uint16_t g = static_cast<uint16_t>(c.y * 63.0f / 255.0f + 0.5f);
+    const uint16_t b = static_cast<uint16_t>(c.z * 31.0f / 255.0f + 0.5f);
+    return (r << 11) | (g << 5) | b;
+}
+
+glm::vec3 expand565(uint16_t c)
+{
+    const uint32_t r = (c >> 11) & 31;
+    const uint32_t g = (c >> 5) & 63;
+    const uint32_t b = c & 31;
+    return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                     (b << 3) | (b >> 2));
+}
+
+// little endian bit stream of BC7 blocks
+class BitWriter
+{
+   public:
+    BitWriter(uint8_t* dst) : dst(dst), position(0) { std::memset(dst, 0, 16); }
+
+    void write(uint32_t value, int n_bits)
+    {
+        for (int i = 0; i < n_bits; ++i, ++position) {
+            if ((value >> i) & 1) {
+                dst[position / 8] |= 1 << (position % 8);
+            }
+        }
+    }
+
+   private:
+    uint8_t* dst;
+    int position;
+};
+
+}  // namespace
+
+GLenum TextureCompressor::getInternalFormat(TextureType type)
+{
+    switch (type) {
+        case TextureType::Diffuse:
+        case TextureType::Ambient:
+        case TextureType::Emissive:
+            return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+        case TextureType::Height:
+        case TextureType::Shininess:
+        case TextureType::Displacement:
+            return GL_COMPRESSED_RED_RGTC1;
+        case TextureType::Normal:
+            return GL_COMPRESSED_RG_RGTC2;
+        default:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+}
+
+CompressedImage TextureCompressor::compress(const uint8_t* image,
+                                            const glm::uvec2& resolution,
+                                            TextureType type)
+{
+    CompressedImage ret;
+    ret.internal_format = getInternalFormat(type);
+    ret.resolution = resolution;
+    const std::size_t block_size = getBlockSize(ret.internal_format);
+
+    const MipChain chain = MipGenerator::generate(image, resolution, type);
+    for (const auto& mip : chain.levels) {
+        const glm::uvec2 level_resolution = mip.resolution;
+        const uint8_t* level = chain.data.data() + mip.offset;
+        const glm::uvec2 n_blocks((level_resolution.x + 3) / 4,
+                                      (level_resolution.y + 3) / 4);
+
+        CompressedImage::Level range;
+        range.offset = ret.data.size();
+        range.size = block_size * n_blocks.x * n_blocks.y;
+        ret.levels.push_back(range);
+        ret.data.resize(range.offset + range.size);
+
+        uint8_t* dst = ret.data.data() + range.offset;
+        ThreadPool::getGlobal().parallelFor(
+            n_blocks.y, 1, [&](std::size_t begin, std::size_t end) {
+                Block block;
+                for (std::size_t by = begin; by < end; ++by) {
+                    for (uint32_t bx = 0; bx < n_blocks.x; ++bx) {
+                        // edge pixels are repeated in partial blocks
+                        for (uint32_t i = 0; i < 16; ++i) {
+                            const uint32_t x = std::min(
+                                4 * bx + (i & 3), level_resolution.x - 1);
+                            const uint32_t y = std::min(
+                                4 * static_cast<uint32_t>(by) + (i >> 2),
+                                level_resolution.y - 1);
+                            const uint8_t* p =
+                                &level[3 * (y * level_resolution.x + x)];
+                            block[i] = glm::vec3(p[0], p[1], p[2]);
+                        }
+
+                        uint8_t* block_dst =
+                            dst + block_size * (by * n_blocks.x + bx);
+                        switch (ret.internal_format) {
+                            case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                                encodeBC7(block, block_dst);
+                                break;
+                            case GL_COMPRESSED_RED_RGTC1:
+                                encodeBC4(block, 0, block_dst);
+                                break;
+                            case GL_COMPRESSED_RG_RGTC2:
+                                encodeBC5(block, block_dst);
+                                break;
+                            default:
+                                encodeBC1(block, block_dst);
+                                break;
+                        }
+                    }
+                }
+            });
+    }
+
+    return ret;
+}
+
+std::optional<CompressedImage> TextureCompressor::load(
+    const std::filesystem::path& filepath, TextureType type)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    uint64_t key = 0;
+    {
+        const MappedFile file(filepath);
+        if (!file) { return std::nullopt; }
+        key = ModelCache::computeHash(file.getData(), file.getSize());
+    }
+    const GLenum internal_format = getInternalFormat(type);
+    key = ModelCache::computeHash(&internal_format, sizeof(internal_format),
+                                  key);
+    key = ModelCache::computeHash(&cache_version, sizeof(cache_version), key);
+
+    const std::filesystem::path cache_path =
+        filepath.parent_path() / ".ogls-cache" /
+        fmt::format("{}.{:016x}.bcn", filepath.filename().string(), key);
+    if (auto cached = loadCache(cache_path, key, internal_format)) {
+        return cached;
+    }
+
+    glm::vec2 resolution;
+    std::vector<uint8_t> image;
+    try {
+        image = Model::loadImage(filepath, resolution);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    CompressedImage ret = compress(image.data(), resolution, type);
+    saveCache(cache_path, key, ret);
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::debug("[TextureCompressor] compressed {} ({} -> {} bytes) in "
+                  "{:.1f} ms",
+                  filepath.string(), image.size(), ret.data.size(),
+                  elapsed.count());
+
+    return ret;
+}
+
+std::optional<CompressedImage> TextureCompressor::loadCache(
+    const std::filesystem::path& cache_path, uint64_t key,
+    GLenum internal_format)
+{
+    const MappedFile file(cache_path);
+    if (!file || file.getSize() < sizeof(CacheHeader)) { return std::nullopt; }
+
+    const uint8_t* base = file.getData();
+    CacheHeader header;
+    std::memcpy(&header, base, sizeof(CacheHeader));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version || header.key != key ||
+        header.internal_format != internal_format) {
+        spdlog::warn("[TextureCompressor] ignoring invalid cache {}",
+                     cache_path.string());
+        return std::nullopt;
+    }
+
+    // nothing else read from the file is trusted, levels have to be the full
+    // chain which compress writes, back to back
+    const auto reject = [&]() {
+        spdlog::warn("[TextureCompressor] ignoring corrupted cache {}",
+                     cache_path.string());
+        return std::nullopt;
+    };
+    if (header.width == 0 || header.height == 0 ||
+        header.n_levels != getMaxLevels(header.width, header.height)) {
+        return reject();
+    }
+    const std::size_t levels_size = sizeof(LevelRecord) * header.n_levels;
+    if (file.getSize() - sizeof(CacheHeader) < levels_size ||
+        header.data_size !=
+            file.getSize() - sizeof(CacheHeader) - levels_size) {
+        return reject();
+    }
+
+    CompressedImage ret;
+    ret.internal_format = header.internal_format;
+    ret.resolution = glm::uvec2(header.width, header.height);
+    ret.levels.resize(header.n_levels);
+    const std::size_t block_size = getBlockSize(internal_format);
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < header.n_levels; ++i) {
+        LevelRecord record;
+        std::memcpy(&record,
+                    base + sizeof(CacheHeader) + sizeof(LevelRecord) * i,
+                    sizeof(LevelRecord));
+
+        // blocks of the level are compared with the remaining data first,
+        // since their size may not fit in 64 bits
+        const uint64_t n_blocks_x =
+            (uint64_t(std::max(header.width >> i, 1u)) + 3) / 4;
+        const uint64_t n_blocks_y =
+            (uint64_t(std::max(header.height >> i, 1u)) + 3) / 4;
+        if (record.offset != offset ||
+            n_blocks_y >
+                (header.data_size - offset) / block_size / n_blocks_x ||
+            record.size != block_size * n_blocks_x * n_blocks_y) {
+            return reject();
+        }
+        offset += record.size;
+
+        ret.levels[i].offset = record.offset;
+        ret.levels[i].size = record.size;
+    }
+    if (offset != header.data_size) { return reject(); }
+
+    const uint8_t* data = base + sizeof(CacheHeader) + levels_size;
+    ret.data.assign(data, data + header.data_size);
+    return ret;
+}
+
+void TextureCompressor::saveCache(const std::filesystem::path& cache_path,
+                                  uint64_t key, const CompressedImage& image)
+{
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.internal_format = image.internal_format;
+    header.key = key;
+    header.width = image.resolution.x;
+    header.height = image.resolution.y;
+    header.n_levels = image.levels.size();
+    header.data_size = image.data.size();
+
+    std::vector<LevelRecord> records;
+    for (const auto& level : image.levels) {
+        records.push_back({level.offset, level.size});
+    }
+
+    // write to temporary file first, so that readers never see partial file
+    // file name is unique per thread, since the same image may be compressed
+    // by several loaders at once
+    std::filesystem::path temp_path = cache_path;
+    temp_path += fmt::format(".{}.tmp", std::hash<std::thread::id>()(
+                                            std::this_thread::get_id()));
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        spdlog::warn("[TextureCompressor] failed to create {}",
+                     temp_path.string());
+        return;
+    }
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(records.data()),
+                 sizeof(LevelRecord) * records.size());
+    stream.write(reinterpret_cast<const char*>(image.data.data()),
+                 image.data.size());
+    stream.close();
+
+    if (!stream) {
+        spdlog::warn("[TextureCompressor] failed to write {}",
+                     temp_path.string());
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        spdlog::warn("[TextureCompressor] failed to write {}: {}",
+                     cache_path.string(), ec.message());
+        std::filesystem::remove(temp_path, ec);
+    }
+}
+
+void TextureCompressor::encodeBC1(const Block& block, uint8_t* dst)
+{
+    glm::vec3 e0;
+    glm::vec3 e1;
+    fitPrincipalAxis(block, e0, e1);
+
+    // palette order of BC1 and weights of its entries
+    constexpr float palette_weights[4] = {0.0f, 1.0f, 1.0f / 3.0f,
+                                          2.0f / 3.0f};
+
+    uint16_t best_c0 = 0;
+    uint16_t best_c1 = 0;
+    uint32_t best_indices = 0;
+    float best_error = std::numeric_limits<float>::max();
+    for (int iteration = 0; iteration <= n_refinements; ++iteration) {
+        uint16_t c0 = quantize565(e1);
+        uint16_t c1 = quantize565(e0);
+        // c0 > c1 selects 4 color mode
+        if (c0 < c1) { std::swap(c0, c1); }
+
+        const glm::vec3 p0 = expand565(c0);
+        const glm::vec3 p1 = expand565(c1);
+        glm::vec3 palette[4];
+        for (int i = 0; i < 4; ++i) {
+            palette[i] = glm::mix(p0, p1, palette_weights[i]);
+        }
+
+        uint32_t indices = 0;
+        float error = 0.0f;
+        std::array<float, 16> weights;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            float best_distance = std::numeric_limits<float>::max();
+            // equal endpoints select 3 color mode, only index 0 is safe
+            for (int j = 0; j < (c0 == c1 ? 1 : 4); ++j) {
+                const float distance = squaredDistance(block[i], palette[j]);
+                if (distance < best_distance) {
+                    best = j;
+                    best_distance = distance;
+                }
+            }
+            indices |= best << (2 * i);
+            error += best_distance;
+            weights[i] = palette_weights[best];
+        }
+
+        if (error < best_error) {
+            best_c0 = c0;
+            best_c1 = c1;
+            best_indices = indices;
+            best_error = error;
+        }
+        if (error == 0.0f || c0 == c1) { break; }
+
+        // weights are relative to c0, which is the larger endpoint
+        glm::vec3 next0;
+        glm::vec3 next1;
+        if (!fitLeastSquares(block, weights, next0, next1)) { break; }
+        // quantize565(e1) is c0 in the next iteration
+        e1 = next0;
+        e0 = next1;
+    }
+
+    std::memcpy(dst, &best_c0, 2);
+    std::memcpy(dst + 2, &best_c1, 2);
+    std::memcpy(dst + 4, &best_indices, 4);
+}
+
+void TextureCompressor::encodeBC4(const Block& block, int channel,
+                                  uint8_t* dst)
+{
+    float v_min = 255.0f;
+    float v_max = 0.0f;
+    for (const auto& c : block) {
+        v_min = std::min(v_min, c[channel]);
+        v_max = std::max(v_max, c[channel]);
+    }
+
+    // r0 > r1 selects 8 values mode
+    const uint8_t r0 = static_cast<uint8_t>(v_max + 0.5f);
+    const uint8_t r1 = static_cast<uint8_t>(v_min + 0.5f);
+
+    uint64_t bits = r0 | (static_cast<uint64_t>(r1) << 8);
+    if (r0 > r1) {
+        for (int i = 0; i < 16; ++i) {
+            // steps from r0 to r1 are indices 0, 2, 3, ..., 7, 1
+            const int step = static_cast<int>(
+                (r0 - block[i][channel]) * 7.0f / (r0 - r1) + 0.5f);
+            const int clamped = std::clamp(step, 0, 7);
+            const uint64_t index =
+                clamped == 0 ? 0 : (clamped == 7 ? 1 : clamped + 1);
+            bits |= index << (16 + 3 * i);
+        }
+    }
+
+    std::memcpy(dst, &bits, 8);
+}
+
+void TextureCompressor::encodeBC5(const Block& block, uint8_t* dst)
+{
+    encodeBC4(block, 0, dst);
+    encodeBC4(block, 1, dst + 8);
+}
+
+void TextureCompressor::encodeBC7(const Block& block, uint8_t* dst)
+{
+    glm::vec3 e0;
+    glm::vec3 e1;
+    fitPrincipalAxis(block, e0, e1);
+
+    // 7 bit endpoints with a p bit per endpoint, alpha is 127 with p bit
+    struct Endpoint {
+        glm::uvec3 color = glm::uvec3(0);
+        uint32_t p = 1;
+
+        glm::vec3 expand() const
+        {
+            return glm::vec3(2 * color.x + p, 2 * color.y + p,
+                             2 * color.z + p);
+        }
+    };
+    const auto quantize = [](const glm::vec3& c) {
+        Endpoint ret;
+        float best_error = std::numeric_limits<float>::max();
+        for (uint32_t p = 0; p < 2; ++p) {
+            Endpoint candidate;
+            candidate.p = p;
+            for (int i = 0; i < 3; ++i) {
+                candidate.color[i] = static_cast<uint32_t>(std::clamp(
+                    (c[i] - p) / 2.0f + 0.5f, 0.0f, 127.0f));
+            }
+            // alpha of p = 0 is 254, which is negligible as alpha is unused
+            const float error =
+                squaredDistance(candidate.expand(), c) + (p == 0 ? 1.0f : 0.0f);
+            if (error < best_error) {
+                ret = candidate;
+                best_error = error;
+            }
+        }
+        return ret;
+    };
+
+    Endpoint best_endpoints[2];
+    std::array<uint32_t, 16> best_indices{};
+    float best_error = std::numeric_limits<float>::max();
+    for (int iteration = 0; iteration <= n_refinements; ++iteration) {
+        const Endpoint endpoints[2] = {quantize(e0), quantize(e1)};
+        const glm::vec3 p0 = endpoints[0].expand();
+        const glm::vec3 p1 = endpoints[1].expand();
+        glm::vec3 palette[16];
+        for (int i = 0; i < 16; ++i) {
+            const float w = bc7_weights[i];
+            palette[i] =
+                glm::floor(((64.0f - w) * p0 + w * p1 + 32.0f) / 64.0f);
+        }
+
+        std::array<uint32_t, 16> indices;
+        std::array<float, 16> weights;
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            uint32_t best = 0;
+            float best_distance = std::numeric_limits<float>::max();
+            for (uint32_t j = 0; j < 16; ++j) {
+                const float distance = squaredDistance(block[i], palette[j]);
+                if (distance < best_distance) {
+                    best = j;
+                    best_distance = distance;
+                }
+            }
+            indices[i] = best;
+            weights[i] = bc7_weights[best] / 64.0f;
+            error += best_distance;
+        }
+
+        if (error < best_error) {
+            best_endpoints[0] = endpoints[0];
+            best_endpoints[1] = endpoints[1];
+            best_indices = indices;
+            best_error = error;
+        }
+        if (error == 0.0f) { break; }
+        if (!fitLeastSquares(block, weights, e0, e1)) { break; }
+    }
+
+    // MSB of the first index is implicitly 0
+    if (best_indices[0] >= 8) {
+        std::swap(best_endpoints[0], best_endpoints[1]);
+        for (auto& index : best_indices) { index = 15 - index; }
+    }
+
+    BitWriter writer(dst);
+    // mode 6
+    writer.write(1 << 6, 7);
+    for (int i = 0; i < 3; ++i) {
+        writer.write(best_endpoints[0].color[i], 7);
+        writer.write(best_endpoints[1].color[i], 7);
+    }
+    writer.write(127, 7);
+    writer.write(127, 7);
+    writer.write(best_endpoints[0].p, 1);
+    writer.write(best_endpoints[1].p, 1);
+    writer.write(best_indices[0], 3);
+    for (int i = 1; i < 16; ++i) { writer.write(best_indices[i], 4); }
+}
+
+}  // namespace ogls
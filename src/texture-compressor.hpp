@@ -0,0 +1,100 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+//
+#include "texture.hpp"
+
+// S3TC is not a part of core profile, so glad doesn't define it, but every
+// desktop driver supports it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace ogls
+{
+
+// how textures of models are stored on GPU
+enum class TextureCompression {
+    // RGB8 or SRGB8, mipmaps are generated by GL
+    None,
+    // block compressed by TextureCompressor
+    BCn
+};
+
+// mip chain of a block compressed image
+struct CompressedImage {
+    struct Level {
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    GLenum internal_format = 0;
+    glm::uvec2 resolution = glm::uvec2(0);
+    // blocks of all levels, level 0 first
+    std::vector<uint8_t> data;
+    std::vector<Level> levels;
+};
+
+// CPU encoder of block compressed textures, formats are chosen by texture
+// type
+// - BC7(sRGB): diffuse, ambient and emissive maps
+// - BC1: specular and light maps
+// - BC4: height, shininess and displacement maps(red channel)
+// - BC5: normal maps(red and green channels, z is reconstructed in shaders)
+// BC7 blocks use mode 6 only, which is a single subset with 4 bit indices and
+// suits opaque images well
+// blocks of each level are encoded in parallel on the global ThreadPool
+class TextureCompressor
+{
+   public:
+    static GLenum getInternalFormat(TextureType type);
+
+    // compress RGB8 image with a full mip chain, which is generated by
+    // MipGenerator
+    static CompressedImage compress(const uint8_t* image,
+                                    const glm::uvec2& resolution,
+                                    TextureType type);
+
+    // compressed image of file from on-disk cache, the file is decoded and
+    // compressed if it's not cached yet
+    // cache files are stored in .ogls-cache/ next to the image and keyed on
+    // its content hash and the format
+    // returns std::nullopt if the file can't be decoded
+    static std::optional<CompressedImage> load(
+        const std::filesystem::path& filepath, TextureType type);
+
+   private:
+    // returns std::nullopt unless the file holds the full chain of
+    // internal_format
+    static std::optional<CompressedImage> loadCache(
+        const std::filesystem::path& cache_path, uint64_t key,
+        GLenum internal_format);
+    static void saveCache(const std::filesystem::path& cache_path,
+                          uint64_t key, const CompressedImage& image);
+
+    // RGB pixels of a 4x4 block in [0, 255], row major order
+    using Block = std::array<glm::vec3, 16>;
+
+    static void encodeBC1(const Block& block, uint8_t* dst);
+    // channel of block
+    static void encodeBC4(const Block& block, int channel, uint8_t* dst);
+    static void encodeBC5(const Block& block, uint8_t* dst);
+    static void encodeBC7(const Block& block, uint8_t* dst);
+};
+
+}  // namespace ogls
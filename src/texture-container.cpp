@@ -0,0 +1,354 @@
+#include "texture-container.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+constexpr std::array<uint8_t, 12> ktx2_identifier = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr std::size_t ktx2_header_size = 80;
+constexpr std::size_t ktx2_level_size = 24;
+
+constexpr uint32_t dds_magic = 0x20534444;  // "DDS "
+constexpr std::size_t dds_header_size = 128;
+constexpr std::size_t dds_dx10_header_size = 20;
+constexpr uint32_t dds_pixel_format_fourcc = 0x4;
+constexpr uint32_t dds_caps2_cubemap = 0x200;
+constexpr uint32_t dds_resource_dimension_2d = 3;
+constexpr uint32_t dds_misc_cubemap = 0x4;
+
+// length of the full mip chain down to 1x1, levels smaller than that are
+// rejected by glTextureStorage2D
+uint32_t getMaxLevels(uint32_t width, uint32_t height)
+{
+    uint32_t ret = 1;
+    while (ret < 32 && (std::max(width, height) >> ret) > 0) { ret++; }
+    return ret;
+}
+
+template <typename T>
+T read(const uint8_t* data, std::size_t offset)
+{
+    T ret;
+    std::memcpy(&ret, data + offset, sizeof(T));
+    return ret;
+}
+
+constexpr uint32_t makeFourCC(const char (&code)[5])
+{
+    return static_cast<uint32_t>(code[0]) |
+           (static_cast<uint32_t>(code[1]) << 8) |
+           (static_cast<uint32_t>(code[2]) << 16) |
+           (static_cast<uint32_t>(code[3]) << 24);
+}
+
+// GL format of VkFormat, 0 if not supported
+GLenum getFormatOfVkFormat(uint32_t vk_format)
+{
+    switch (vk_format) {
+        case 131:  // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case 132:  // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+            return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+        case 133:  // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+            return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case 134:  // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+        case 135:  // VK_FORMAT_BC2_UNORM_BLOCK
+            return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case 136:  // VK_FORMAT_BC2_SRGB_BLOCK
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+        case 137:  // VK_FORMAT_BC3_UNORM_BLOCK
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case 138:  // VK_FORMAT_BC3_SRGB_BLOCK
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        case 139:  // VK_FORMAT_BC4_UNORM_BLOCK
+            return GL_COMPRESSED_RED_RGTC1;
+        case 141:  // VK_FORMAT_BC5_UNORM_BLOCK
+            return GL_COMPRESSED_RG_RGTC2;
+        case 143:  // VK_FORMAT_BC6H_UFLOAT_BLOCK
+            return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        case 144:  // VK_FORMAT_BC6H_SFLOAT_BLOCK
+            return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+        case 145:  // VK_FORMAT_BC7_UNORM_BLOCK
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case 146:  // VK_FORMAT_BC7_SRGB_BLOCK
+            return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+        default:
+            return 0;
+    }
+}
+
+// GL format of DXGI_FORMAT, 0 if not supported
+GLenum getFormatOfDXGIFormat(uint32_t dxgi_format)
+{
+    switch (dxgi_format) {
+        case 71:  // DXGI_FORMAT_BC1_UNORM
+            return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case 72:  // DXGI_FORMAT_BC1_UNORM_SRGB
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+        case 74:  // DXGI_FORMAT_BC2_UNORM
+            return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case 75:  // DXGI_FORMAT_BC2_UNORM_SRGB
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+        case 77:  // DXGI_FORMAT_BC3_UNORM
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case 78:  // DXGI_FORMAT_BC3_UNORM_SRGB
+            return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        case 80:  // DXGI_FORMAT_BC4_UNORM
+            return GL_COMPRESSED_RED_RGTC1;
+        case 83:  // DXGI_FORMAT_BC5_UNORM
+            return GL_COMPRESSED_RG_RGTC2;
+        case 95:  // DXGI_FORMAT_BC6H_UF16
+            return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        case 96:  // DXGI_FORMAT_BC6H_SF16
+            return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+        case 98:  // DXGI_FORMAT_BC7_UNORM
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case 99:  // DXGI_FORMAT_BC7_UNORM_SRGB
+            return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+        default:
+            return 0;
+    }
+}
+
+// GL format of legacy DDS FourCC, 0 if not supported
+GLenum getFormatOfFourCC(uint32_t fourcc, bool srgb)
+{
+    if (fourcc == makeFourCC("DXT1")) {
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    } else if (fourcc == makeFourCC("DXT3")) {
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    } else if (fourcc == makeFourCC("DXT5")) {
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    } else if (fourcc == makeFourCC("ATI1") || fourcc == makeFourCC("BC4U")) {
+        return GL_COMPRESSED_RED_RGTC1;
+    } else if (fourcc == makeFourCC("ATI2") || fourcc == makeFourCC("BC5U")) {
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+    return 0;
+}
+
+std::size_t getBlockSize(GLenum internal_format)
+{
+    switch (internal_format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+}  // namespace
+
+TextureContainer::TextureContainer() : data_offset{0}, data_size{0} {}
+
+std::optional<std::filesystem::path> TextureContainer::find(
+    const std::filesystem::path& image_path)
+{
+    std::string extension = image_path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (extension == ".ktx2" || extension == ".dds") { return image_path; }
+
+    std::error_code ec;
+    for (const auto container_extension : {".ktx2", ".dds"}) {
+        std::filesystem::path ret = image_path;
+        ret.replace_extension(container_extension);
+        if (std::filesystem::is_regular_file(ret, ec)) { return ret; }
+    }
+    return std::nullopt;
+}
+
+std::optional<TextureContainer> TextureContainer::load(
+    const std::filesystem::path& filepath, TextureType type)
+{
+    TextureContainer ret;
+    ret.file = MappedFile(filepath);
+    if (!ret.file) { return std::nullopt; }
+
+    const bool srgb = type == TextureType::Diffuse ||
+                      type == TextureType::Ambient ||
+                      type == TextureType::Emissive;
+
+    const uint8_t* data = ret.file.getData();
+    const std::size_t size = ret.file.getSize();
+    bool parsed = false;
+    if (size >= ktx2_identifier.size() &&
+        std::memcmp(data, ktx2_identifier.data(), ktx2_identifier.size()) ==
+            0) {
+        parsed = ret.parseKTX2();
+    } else if (size >= dds_header_size &&
+               read<uint32_t>(data, 0) == dds_magic) {
+        parsed = ret.parseDDS(srgb);
+    }
+
+    if (!parsed || !ret.finishLevels()) {
+        spdlog::warn("[TextureContainer] unsupported or invalid file {}",
+                     filepath.string());
+        return std::nullopt;
+    }
+
+    spdlog::debug("[TextureContainer] mapped {} ({}x{}, {} levels)",
+                  filepath.string(), ret.image.resolution.x,
+                  ret.image.resolution.y, ret.image.levels.size());
+
+    return ret;
+}
+
+const CompressedImage& TextureContainer::getImage() const { return image; }
+
+const uint8_t* TextureContainer::getData() const
+{
+    return file.getData() + data_offset;
+}
+
+std::size_t TextureContainer::getSize() const { return data_size; }
+
+bool TextureContainer::parseKTX2()
+{
+    const uint8_t* data = file.getData();
+    if (file.getSize() < ktx2_header_size) { return false; }
+
+    const uint32_t vk_format = read<uint32_t>(data, 12);
+    const uint32_t width = read<uint32_t>(data, 20);
+    const uint32_t height = read<uint32_t>(data, 24);
+    const uint32_t depth = read<uint32_t>(data, 28);
+    const uint32_t n_layers = read<uint32_t>(data, 32);
+    const uint32_t n_faces = read<uint32_t>(data, 36);
+    const uint32_t n_levels = std::max(read<uint32_t>(data, 40), 1u);
+    const uint32_t supercompression = read<uint32_t>(data, 44);
+
+    // only plain 2D textures
+    if (depth != 0 || n_layers > 1 || n_faces != 1 || supercompression != 0) {
+        return false;
+    }
+
+    image.internal_format = getFormatOfVkFormat(vk_format);
+    if (image.internal_format == 0) { return false; }
+    image.resolution = glm::uvec2(width, height);
+
+    if (file.getSize() < ktx2_header_size + ktx2_level_size * n_levels) {
+        return false;
+    }
+    for (uint32_t i = 0; i < n_levels; ++i) {
+        const std::size_t record = ktx2_header_size + ktx2_level_size * i;
+        CompressedImage::Level level;
+        level.offset = read<uint64_t>(data, record);
+        level.size = read<uint64_t>(data, record + 8);
+        image.levels.push_back(level);
+    }
+
+    return true;
+}
+
+bool TextureContainer::parseDDS(bool srgb)
+{
+    const uint8_t* data = file.getData();
+
+    const uint32_t height = read<uint32_t>(data, 12);
+    const uint32_t width = read<uint32_t>(data, 16);
+    const uint32_t n_levels = std::max(read<uint32_t>(data, 28), 1u);
+    const uint32_t pixel_format_flags = read<uint32_t>(data, 80);
+    const uint32_t fourcc = read<uint32_t>(data, 84);
+    const uint32_t caps2 = read<uint32_t>(data, 112);
+
+    if (!(pixel_format_flags & dds_pixel_format_fourcc) ||
+        (caps2 & dds_caps2_cubemap)) {
+        return false;
+    }
+
+    std::size_t offset = dds_header_size;
+    if (fourcc == makeFourCC("DX10")) {
+        if (file.getSize() < dds_header_size + dds_dx10_header_size) {
+            return false;
+        }
+        const uint32_t dxgi_format = read<uint32_t>(data, 128);
+        const uint32_t dimension = read<uint32_t>(data, 132);
+        const uint32_t misc_flags = read<uint32_t>(data, 136);
+        const uint32_t array_size = read<uint32_t>(data, 140);
+        if (dimension != dds_resource_dimension_2d ||
+            (misc_flags & dds_misc_cubemap) || array_size > 1) {
+            return false;
+        }
+
+        image.internal_format = getFormatOfDXGIFormat(dxgi_format);
+        offset += dds_dx10_header_size;
+    } else {
+        image.internal_format = getFormatOfFourCC(fourcc, srgb);
+    }
+    if (image.internal_format == 0) { return false; }
+    image.resolution = glm::uvec2(width, height);
+
+    // mipMapCount is not trusted, it bounds the loop and the shifts below
+    if (width == 0 || height == 0 || n_levels > getMaxLevels(width, height)) {
+        return false;
+    }
+
+    // levels are tightly packed after the header, level 0 first
+    const std::size_t block_size = getBlockSize(image.internal_format);
+    for (uint32_t i = 0; i < n_levels; ++i) {
+        const std::size_t n_blocks_x =
+            std::max<std::size_t>(std::size_t(width >> i) + 3, 4) / 4;
+        const std::size_t n_blocks_y =
+            std::max<std::size_t>(std::size_t(height >> i) + 3, 4) / 4;
+
+        CompressedImage::Level level;
+        level.offset = offset;
+        level.size = block_size * n_blocks_x * n_blocks_y;
+        if (level.size > file.getSize() - offset) { return false; }
+        image.levels.push_back(level);
+
+        offset += level.size;
+    }
+
+    return true;
+}
+
+bool TextureContainer::finishLevels()
+{
+    if (image.resolution.x == 0 || image.resolution.y == 0 ||
+        image.levels.empty()) {
+        return false;
+    }
+
+    if (image.levels.size() >
+        getMaxLevels(image.resolution.x, image.resolution.y)) {
+        return false;
+    }
+
+    std::size_t begin = std::numeric_limits<std::size_t>::max();
+    std::size_t end = 0;
+    for (const auto& level : image.levels) {
+        if (level.size == 0 || level.offset > file.getSize() ||
+            level.size > file.getSize() - level.offset) {
+            return false;
+        }
+        begin = std::min(begin, level.offset);
+        end = std::max(end, level.offset + level.size);
+    }
+
+    data_offset = begin;
+    data_size = end - begin;
+    for (auto& level : image.levels) { level.offset -= data_offset; }
+    return true;
+}
+
+}  // namespace ogls
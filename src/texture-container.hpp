@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "glad/glad.h"
+//
+#include "mapped-file.hpp"
+#include "texture-compressor.hpp"
+#include "texture.hpp"
+
+namespace ogls
+{
+
+// precompressed image with its mip chain in a KTX2 or DDS file
+// the file is memory mapped, and levels are uploaded straight from the
+// mapping without decoding or generating mipmaps
+// supported formats are BC1-BC7(UNORM and sRGB) of 2D textures, KTX2 files
+// must not be supercompressed
+class TextureContainer
+{
+   public:
+    TextureContainer();
+
+    // KTX2 or DDS file to load instead of image, which is the image itself
+    // if it's a container, or a file with the same stem next to it
+    // returns std::nullopt if there is no such file
+    static std::optional<std::filesystem::path> find(
+        const std::filesystem::path& image_path);
+
+    // map and parse container, legacy DDS formats without sRGB variants are
+    // treated as sRGB for color textures
+    // returns std::nullopt if the file can't be read or its format is not
+    // supported
+    static std::optional<TextureContainer> load(
+        const std::filesystem::path& filepath, TextureType type);
+
+    // levels are offsets from getData(), and image.data is empty
+    const CompressedImage& getImage() const;
+
+    // range of the mapped file containing all levels
+    const uint8_t* getData() const;
+    std::size_t getSize() const;
+
+   private:
+    MappedFile file;
+    CompressedImage image;
+    // range of levels in file
+    std::size_t data_offset;
+    std::size_t data_size;
+
+    bool parseKTX2();
+    bool parseDDS(bool srgb);
+
+    // compute range of levels and make offsets relative to it
+    // returns false if levels are not in the file
+    bool finishLevels();
+};
+
+}  // namespace ogls
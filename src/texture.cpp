@@ -1,8 +1,29 @@
 #include "texture.hpp"
 
+#include <algorithm>
+
+#include "gl-state.hpp"
+
 using namespace ogls;
 
-Texture::Texture() {}
+Texture::Texture()
+    : resolution{0, 0},
+      texture{0},
+      internalFormat{GL_SRGB8},
+      format{GL_RGB},
+      type{GL_UNSIGNED_BYTE},
+      wrap_s{GL_REPEAT},
+      wrap_t{GL_REPEAT},
+      mag_filter{GL_LINEAR},
+      min_filter{GL_LINEAR},
+      generate_mipmap{false},
+      depth_compare_mode{false},
+      levels{1},
+      layers{0},
+      max_anisotropy{1.0f},
+      lod_bias{0.0f}
+{
+}
 
 Texture::Texture(const TextureBuilder& builder)
 {
@@ -16,9 +37,29 @@ Texture::Texture(const TextureBuilder& builder)
     min_filter = builder.min_filter;
     generate_mipmap = builder.generate_mipmap;
     depth_compare_mode = builder.depth_compare_mode;
+    if (!builder.compressed_levels.empty()) {
+        levels = builder.compressed_levels.size();
+    } else if (!builder.image_levels.empty()) {
+        levels = builder.image_levels.size();
+    } else if (builder.levels > 0) {
+        levels = std::min(builder.levels, computeNumberOfLevels(resolution));
+    } else {
+        levels = generate_mipmap ? computeNumberOfLevels(resolution) : 1;
+    }
+    layers = builder.layers;
+    max_anisotropy = builder.max_anisotropy;
+    lod_bias = builder.lod_bias;
 
     createTexture();
-    setImage(builder.image);
+    if (layers > 0) {
+        setArrayStorage();
+    } else if (!builder.compressed_levels.empty()) {
+        setCompressedImage(builder.compressed_levels);
+    } else if (!builder.image_levels.empty()) {
+        setImageLevels(builder.image_levels);
+    } else {
+        setImage(builder.image);
+    }
 
     spdlog::debug("[Texture] texture {:x} created", this->texture);
 }
@@ -28,7 +69,11 @@ Texture::Texture(Texture&& other)
       texture(other.texture),
       internalFormat(other.internalFormat),
       format(other.format),
-      type(other.type)
+      type(other.type),
+      levels(other.levels),
+      layers(other.layers),
+      max_anisotropy(other.max_anisotropy),
+      lod_bias(other.lod_bias)
 {
     other.texture = 0;
 }
@@ -45,6 +90,10 @@ Texture& Texture::operator=(Texture&& other)
         internalFormat = other.internalFormat;
         format = other.format;
         type = other.type;
+        levels = other.levels;
+        layers = other.layers;
+        max_anisotropy = other.max_anisotropy;
+        lod_bias = other.lod_bias;
 
         other.texture = 0;
     }
@@ -62,9 +111,46 @@ GLenum Texture::getFormat() const { return this->format; }
 
 GLenum Texture::getType() const { return this->type; }
 
+GLsizei Texture::getNumberOfLevels() const { return this->levels; }
+
+GLsizei Texture::getNumberOfLayers() const { return this->layers; }
+
+float Texture::getMaxAnisotropy() const { return this->max_anisotropy; }
+
+float Texture::getLodBias() const { return this->lod_bias; }
+
+void Texture::setMaxAnisotropy(float max_anisotropy)
+{
+    static const float supported = []() {
+        GLfloat ret = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &ret);
+        return ret;
+    }();
+
+    this->max_anisotropy = std::clamp(max_anisotropy, 1.0f, supported);
+    glTextureParameterf(texture, GL_TEXTURE_MAX_ANISOTROPY,
+                        this->max_anisotropy);
+}
+
+void Texture::setLodBias(float lod_bias)
+{
+    this->lod_bias = lod_bias;
+    glTextureParameterf(texture, GL_TEXTURE_LOD_BIAS, lod_bias);
+}
+
+GLsizei Texture::computeNumberOfLevels(const glm::uvec2& resolution)
+{
+    GLsizei ret = 1;
+    while ((std::max(resolution.x, resolution.y) >> ret) > 0) { ret++; }
+    return ret;
+}
+
+Texture::operator bool() const { return this->texture != 0; }
+
 void Texture::createTexture()
 {
-    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glCreateTextures(layers > 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 1,
+                     &texture);
     glTextureParameteri(texture, GL_TEXTURE_WRAP_S, wrap_s);
     glTextureParameteri(texture, GL_TEXTURE_WRAP_T, wrap_t);
     glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, mag_filter);
@@ -73,19 +159,64 @@ void Texture::createTexture()
         glTextureParameteri(texture, GL_TEXTURE_COMPARE_MODE,
                             GL_COMPARE_REF_TO_TEXTURE);
     }
+    if (max_anisotropy > 1.0f) { setMaxAnisotropy(max_anisotropy); }
+    if (lod_bias != 0.0f) { setLodBias(lod_bias); }
 }
 
+// NOTE: if a buffer is bound to GL_PIXEL_UNPACK_BUFFER, image is an offset in
+// that buffer
 void Texture::setImage(const void* image) const
 {
-    glTextureStorage2D(texture, 1, internalFormat, resolution.x, resolution.y);
+    glTextureStorage2D(texture, levels, internalFormat, resolution.x,
+                       resolution.y);
     glTextureSubImage2D(texture, 0, 0, 0, resolution.x, resolution.y, format,
                         type, image);
-    if (generate_mipmap) { glGenerateTextureMipmap(texture); }
+    if (generate_mipmap && levels > 1) { glGenerateTextureMipmap(texture); }
+}
+
+void Texture::setArrayStorage() const
+{
+    glTextureStorage3D(texture, levels, internalFormat, resolution.x,
+                       resolution.y, layers);
+}
+
+// NOTE: if a buffer is bound to GL_PIXEL_UNPACK_BUFFER, levels are offsets in
+// that buffer
+void Texture::setImageLevels(const std::vector<const void*>& image_levels) const
+{
+    glTextureStorage2D(texture, levels, internalFormat, resolution.x,
+                       resolution.y);
+    // rows of small levels are not 4 byte aligned, e.g. 2x2 RGB8 has 6 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (std::size_t level = 0; level < image_levels.size(); ++level) {
+        const GLsizei width = std::max(resolution.x >> level, 1u);
+        const GLsizei height = std::max(resolution.y >> level, 1u);
+        glTextureSubImage2D(texture, level, 0, 0, width, height, format, type,
+                            image_levels[level]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// NOTE: if a buffer is bound to GL_PIXEL_UNPACK_BUFFER, data of levels are
+// offsets in that buffer
+void Texture::setCompressedImage(
+    const std::vector<CompressedLevel>& compressed_levels) const
+{
+    glTextureStorage2D(texture, levels, internalFormat, resolution.x,
+                       resolution.y);
+    for (std::size_t level = 0; level < compressed_levels.size(); ++level) {
+        const GLsizei width = std::max(resolution.x >> level, 1u);
+        const GLsizei height = std::max(resolution.y >> level, 1u);
+        glCompressedTextureSubImage2D(texture, level, 0, 0, width, height,
+                                      internalFormat,
+                                      compressed_levels[level].size,
+                                      compressed_levels[level].data);
+    }
 }
 
 void Texture::bindToTextureUnit(GLuint texture_unit_number) const
 {
-    glBindTextureUnit(texture_unit_number, texture);
+    GLState::bindTextureUnit(texture_unit_number, texture);
 }
 
 void Texture::bindToImageUnit(GLuint image_unit_number, GLenum access) const
@@ -99,6 +230,7 @@ void Texture::release()
     if (texture) {
         spdlog::debug("[Texture] release texture {:x}", this->texture);
 
+        GLState::forgetTexture(this->texture);
         glDeleteTextures(1, &this->texture);
         this->texture = 0;
     }
@@ -24,6 +24,14 @@ enum class TextureType {
 class Texture
 {
    public:
+    // a mip level of block compressed image
+    // NOTE: if a buffer is bound to GL_PIXEL_UNPACK_BUFFER, data is an offset
+    // in that buffer
+    struct CompressedLevel {
+        const void* data = nullptr;
+        GLsizei size = 0;
+    };
+
     class TextureBuilder
     {
        private:
@@ -38,8 +46,17 @@ class Texture
         GLenum min_filter = GL_LINEAR;
         bool generate_mipmap = false;
         bool depth_compare_mode = false;
+        // 0 allocates the full mip chain if mipmaps are generated, otherwise
+        // a single level
+        GLsizei levels = 0;
+        // 0 creates a 2D texture, otherwise a 2D texture array
+        GLsizei layers = 0;
+        float max_anisotropy = 1.0f;
+        float lod_bias = 0.0f;
 
         const void* image = nullptr;
+        std::vector<const void*> image_levels;
+        std::vector<CompressedLevel> compressed_levels;
 
        public:
         TextureBuilder(const glm::vec2& resolution) : resolution(resolution) {}
@@ -92,12 +109,59 @@ class Texture
             return *this;
         }
 
+        // number of levels of immutable storage, clamped to the full chain
+        TextureBuilder setLevels(GLsizei levels)
+        {
+            this->levels = levels;
+            return *this;
+        }
+
+        // allocate a 2D texture array of layers instead of a 2D texture
+        // images are not uploaded, layers are filled by copies of other
+        // textures, e.g. glCopyImageSubData
+        TextureBuilder setLayers(GLsizei layers)
+        {
+            this->layers = layers;
+            return *this;
+        }
+
+        // clamped to GL_MAX_TEXTURE_MAX_ANISOTROPY
+        TextureBuilder setMaxAnisotropy(float max_anisotropy)
+        {
+            this->max_anisotropy = max_anisotropy;
+            return *this;
+        }
+
+        TextureBuilder setLodBias(float lod_bias)
+        {
+            this->lod_bias = lod_bias;
+            return *this;
+        }
+
         TextureBuilder setImage(const void* image)
         {
             this->image = image;
             return *this;
         }
 
+        // upload mip levels generated on the CPU instead of image, level 0
+        // first, each level is half the size of the previous one
+        TextureBuilder setImageLevels(
+            const std::vector<const void*>& image_levels)
+        {
+            this->image_levels = image_levels;
+            return *this;
+        }
+
+        // upload block compressed mip levels instead of image, level 0 first
+        // internal format must be a compressed format
+        TextureBuilder setCompressedLevels(
+            const std::vector<CompressedLevel>& compressed_levels)
+        {
+            this->compressed_levels = compressed_levels;
+            return *this;
+        }
+
         TextureBuilder setDepthCompareMode(bool depth_compare_mode)
         {
             this->depth_compare_mode = depth_compare_mode;
@@ -122,6 +186,21 @@ class Texture
     GLint getInternalFormat() const;
     GLenum getFormat() const;
     GLenum getType() const;
+    GLsizei getNumberOfLevels() const;
+    // 0 if texture is not a texture array
+    GLsizei getNumberOfLayers() const;
+    float getMaxAnisotropy() const;
+    float getLodBias() const;
+
+    // change sampling of texture after creation
+    void setMaxAnisotropy(float max_anisotropy);
+    void setLodBias(float lod_bias);
+
+    // levels of the full mip chain down to 1x1
+    static GLsizei computeNumberOfLevels(const glm::uvec2& resolution);
+
+    // does texture have GL texture object?
+    operator bool() const;
 
     // bind texture to the specified texture unit
     void bindToTextureUnit(GLuint texture_unit_number) const;
@@ -135,6 +214,10 @@ class Texture
     void createTexture();
 
     void setImage(const void* image) const;
+    void setArrayStorage() const;
+    void setImageLevels(const std::vector<const void*>& image_levels) const;
+    void setCompressedImage(
+        const std::vector<CompressedLevel>& compressed_levels) const;
 
     glm::uvec2 resolution;
 
@@ -148,6 +231,10 @@ class Texture
     GLenum min_filter;
     bool generate_mipmap;
     bool depth_compare_mode;
+    GLsizei levels;
+    GLsizei layers;
+    float max_anisotropy;
+    float lod_bias;
 
     void release();
 };
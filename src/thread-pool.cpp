@@ -0,0 +1,100 @@
+#include "thread-pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "spdlog/spdlog.h"
+
+using namespace ogls;
+
+ThreadPool::ThreadPool(std::size_t n_threads) : stop{false}
+{
+    // hardware_concurrency may return 0
+    n_threads = std::max(n_threads, std::size_t(1));
+
+    for (std::size_t i = 0; i < n_threads; ++i) {
+        workers.emplace_back([this]() { work(); });
+    }
+
+    spdlog::debug("[ThreadPool] created {} worker threads", n_threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+
+    for (auto& worker : workers) { worker.join(); }
+}
+
+std::size_t ThreadPool::getNumberOfThreads() const { return workers.size(); }
+
+void ThreadPool::parallelFor(
+    std::size_t n, std::size_t grain_size,
+    const std::function<void(std::size_t, std::size_t)>& f)
+{
+    grain_size = std::max(grain_size, std::size_t(1));
+    const std::size_t n_chunks = (n + grain_size - 1) / grain_size;
+    if (n_chunks <= 1 || workers.size() <= 1) {
+        if (n > 0) { f(0, n); }
+        return;
+    }
+
+    // helpers may start after all chunks are done, so they only touch f after
+    // claiming a chunk
+    struct State {
+        std::atomic<std::size_t> next_chunk{0};
+        std::size_t n_done_chunks = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    const auto state = std::make_shared<State>();
+
+    const auto run = [state, n, n_chunks, grain_size, &f]() {
+        while (true) {
+            const std::size_t chunk = state->next_chunk++;
+            if (chunk >= n_chunks) { return; }
+
+            const std::size_t begin = chunk * grain_size;
+            f(begin, std::min(begin + grain_size, n));
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->n_done_chunks == n_chunks) {
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    const std::size_t n_helpers = std::min(workers.size(), n_chunks - 1);
+    for (std::size_t i = 0; i < n_helpers; ++i) { submit(run); }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(
+        lock, [&]() { return state->n_done_chunks == n_chunks; });
+}
+
+ThreadPool& ThreadPool::getGlobal()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::work()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stop || !tasks.empty(); });
+            if (stop && tasks.empty()) { return; }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
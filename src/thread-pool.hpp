@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ogls
+{
+
+// fixed size pool of worker threads for CPU side loading work
+// NOTE: tasks must not block on other tasks of the same pool
+class ThreadPool
+{
+   public:
+    ThreadPool(std::size_t n_threads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool& other) = delete;
+    ~ThreadPool();
+
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    std::size_t getNumberOfThreads() const;
+
+    // run task on a worker thread
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& f)
+    {
+        using R = std::invoke_result_t<F>;
+        auto task =
+            std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> ret = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return ret;
+    }
+
+    // split [0, n) into chunks of grain_size and run f(begin, end) on them
+    // in parallel
+    // the calling thread also runs chunks and only waits for chunks which are
+    // already running, so this can be called from tasks of this pool
+    // NOTE: f must not throw
+    void parallelFor(std::size_t n, std::size_t grain_size,
+                     const std::function<void(std::size_t, std::size_t)>& f);
+
+    // pool shared by all loaders
+    static ThreadPool& getGlobal();
+
+   private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop;
+
+    void work();
+};
+
+}  // namespace ogls
@@ -0,0 +1,278 @@
+#include "tiled-image.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include "mip-generator.hpp"
+#include "model-cache.hpp"
+#include "model.hpp"
+#include "spdlog/spdlog.h"
+#include "thread-pool.hpp"
+
+namespace ogls
+{
+
+namespace
+{
+
+// bump this when the layout of pages changes
+constexpr uint32_t cache_version = 1;
+constexpr char cache_magic[8] = {'O', 'G', 'L', 'S', 'T', 'I', 'L', 'E'};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_levels;
+    uint32_t page_border;
+};
+
+struct LevelRecord {
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_pages_x;
+    uint32_t n_pages_y;
+    uint64_t first_page;
+};
+
+// levels down to the first one fitting in a page
+std::vector<TiledImage::Level> computeLevels(const glm::uvec2& resolution,
+                                             uint32_t page_size)
+{
+    std::vector<TiledImage::Level> ret;
+    glm::uvec2 level_resolution = resolution;
+    std::size_t n_pages = 0;
+    while (true) {
+        TiledImage::Level level;
+        level.resolution = level_resolution;
+        level.n_pages = glm::uvec2((level_resolution.x + page_size - 1) /
+                                       page_size,
+                                   (level_resolution.y + page_size - 1) /
+                                       page_size);
+        level.first_page = n_pages;
+        ret.push_back(level);
+        n_pages += level.n_pages.x * level.n_pages.y;
+
+        if (level.n_pages == glm::uvec2(1)) { break; }
+        level_resolution = glm::uvec2(std::max(level_resolution.x / 2, 1u),
+                                      std::max(level_resolution.y / 2, 1u));
+    }
+    return ret;
+}
+
+}  // namespace
+
+TiledImage::TiledImage() : page_size{default_page_size}, pages_offset{0} {}
+
+std::optional<TiledImage> TiledImage::load(
+    const std::filesystem::path& filepath, TextureType type,
+    uint32_t page_size)
+{
+    uint64_t key = 0;
+    {
+        const MappedFile file(filepath);
+        if (!file) { return std::nullopt; }
+        key = ModelCache::computeHash(file.getData(), file.getSize());
+    }
+    key = ModelCache::computeHash(&type, sizeof(type), key);
+    key = ModelCache::computeHash(&page_size, sizeof(page_size), key);
+    key = ModelCache::computeHash(&cache_version, sizeof(cache_version), key);
+
+    const std::filesystem::path cache_path =
+        filepath.parent_path() / ".ogls-cache" /
+        fmt::format("{}.{:016x}.tiles", filepath.filename().string(), key);
+
+    TiledImage ret;
+    ret.file = MappedFile(cache_path);
+    if (ret.file && ret.parse(key)) { return ret; }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    glm::vec2 resolution;
+    std::vector<uint8_t> image;
+    try {
+        image = Model::loadImage(filepath, resolution);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    // the file may have been written by another loader in the meantime
+    ret.file = MappedFile();
+    save(cache_path, key, image.data(), glm::uvec2(resolution), type,
+         page_size);
+    ret.file = MappedFile(cache_path);
+    if (!ret.file || !ret.parse(key)) { return std::nullopt; }
+
+    const std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    spdlog::debug("[TiledImage] split {} into {} levels in {:.1f} ms",
+                  filepath.string(), ret.levels.size(), elapsed.count());
+
+    return ret;
+}
+
+glm::uvec2 TiledImage::getResolution() const
+{
+    return levels.empty() ? glm::uvec2(0) : levels.front().resolution;
+}
+
+uint32_t TiledImage::getPageSize() const { return page_size; }
+
+uint32_t TiledImage::getPaddedPageSize() const
+{
+    return page_size + 2 * page_border;
+}
+
+const std::vector<TiledImage::Level>& TiledImage::getLevels() const
+{
+    return levels;
+}
+
+const uint8_t* TiledImage::getPage(uint32_t level,
+                                   const glm::uvec2& page) const
+{
+    const Level& l = levels.at(level);
+    const std::size_t index = l.first_page + page.y * l.n_pages.x + page.x;
+    return file.getData() + pages_offset + getPageBytes() * index;
+}
+
+std::size_t TiledImage::getPageBytes() const
+{
+    return 3 * getPaddedPageSize() * getPaddedPageSize();
+}
+
+bool TiledImage::parse(uint64_t key)
+{
+    if (file.getSize() < sizeof(CacheHeader)) { return false; }
+
+    const uint8_t* base = file.getData();
+    CacheHeader header;
+    std::memcpy(&header, base, sizeof(CacheHeader));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version || header.key != key ||
+        header.page_border != page_border || header.page_size == 0) {
+        return false;
+    }
+    page_size = header.page_size;
+
+    const std::vector<Level> expected =
+        computeLevels(glm::uvec2(header.width, header.height), page_size);
+    if (header.n_levels != expected.size()) { return false; }
+
+    pages_offset =
+        sizeof(CacheHeader) + sizeof(LevelRecord) * header.n_levels;
+    const Level& last = expected.back();
+    const std::size_t n_pages =
+        last.first_page + last.n_pages.x * last.n_pages.y;
+    if (file.getSize() != pages_offset + getPageBytes() * n_pages) {
+        spdlog::warn("[TiledImage] ignoring corrupted cache of key {:016x}",
+                     key);
+        return false;
+    }
+
+    levels = expected;
+    return true;
+}
+
+void TiledImage::save(const std::filesystem::path& cache_path, uint64_t key,
+                      const uint8_t* image, const glm::uvec2& resolution,
+                      TextureType type, uint32_t page_size)
+{
+    const std::vector<Level> levels = computeLevels(resolution, page_size);
+    const MipChain chain = MipGenerator::generate(image, resolution, type);
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.page_size = page_size;
+    header.key = key;
+    header.width = resolution.x;
+    header.height = resolution.y;
+    header.n_levels = levels.size();
+    header.page_border = page_border;
+
+    std::vector<LevelRecord> records;
+    for (const auto& level : levels) {
+        records.push_back({level.resolution.x, level.resolution.y,
+                           level.n_pages.x, level.n_pages.y,
+                           level.first_page});
+    }
+
+    // write to temporary file first, so that readers never see partial file
+    std::filesystem::path temp_path = cache_path;
+    temp_path += fmt::format(".{}.tmp", std::hash<std::thread::id>()(
+                                            std::this_thread::get_id()));
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        spdlog::warn("[TiledImage] failed to create {}", temp_path.string());
+        return;
+    }
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(records.data()),
+                 sizeof(LevelRecord) * records.size());
+
+    // pages of each level are cut in parallel, and written in order
+    const uint32_t padded_size = page_size + 2 * page_border;
+    const std::size_t page_bytes = 3 * padded_size * padded_size;
+    std::vector<uint8_t> pages;
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+        const Level& level = levels[l];
+        const uint8_t* src = chain.data.data() + chain.levels[l].offset;
+        pages.resize(page_bytes * level.n_pages.x * level.n_pages.y);
+
+        ThreadPool::getGlobal().parallelFor(
+            level.n_pages.y, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t py = begin; py < end; ++py) {
+                    for (uint32_t px = 0; px < level.n_pages.x; ++px) {
+                        uint8_t* dst =
+                            pages.data() +
+                            page_bytes * (py * level.n_pages.x + px);
+                        const int64_t x0 =
+                            int64_t(px) * page_size - page_border;
+                        const int64_t y0 =
+                            int64_t(py) * page_size - page_border;
+                        for (uint32_t y = 0; y < padded_size; ++y) {
+                            // wrap around as textures are usually repeated
+                            const int64_t h = level.resolution.y;
+                            const int64_t sy = ((y0 + y) % h + h) % h;
+                            for (uint32_t x = 0; x < padded_size; ++x) {
+                                const int64_t w = level.resolution.x;
+                                const int64_t sx = ((x0 + x) % w + w) % w;
+                                std::memcpy(dst + 3 * (y * padded_size + x),
+                                            src + 3 * (sy * w + sx), 3);
+                            }
+                        }
+                    }
+                }
+            });
+
+        stream.write(reinterpret_cast<const char*>(pages.data()),
+                     pages.size());
+    }
+    stream.close();
+
+    if (!stream) {
+        spdlog::warn("[TiledImage] failed to write {}", temp_path.string());
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        spdlog::warn("[TiledImage] failed to write {}: {}",
+                     cache_path.string(), ec.message());
+        std::filesystem::remove(temp_path, ec);
+    }
+}
+
+}  // namespace ogls
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "glm/glm.hpp"
+//
+#include "mapped-file.hpp"
+#include "texture.hpp"
+
+namespace ogls
+{
+
+// RGB8 image and its mip chain split into square pages, which are read on
+// demand by VirtualTextureCache
+// alpha of the image is discarded
+// pages are stored in .ogls-cache/ next to the image and the file is memory
+// mapped, so only pages which are read are loaded from disk
+// each page has a border of texels of its neighbours(wrapped around at image
+// edges), so that filtering inside a page never reads other pages
+// levels go down until a level fits in a single page
+class TiledImage
+{
+   public:
+    // texels of a page without its border
+    static constexpr uint32_t default_page_size = 120;
+    static constexpr uint32_t page_border = 4;
+
+    struct Level {
+        glm::uvec2 resolution = glm::uvec2(0);
+        glm::uvec2 n_pages = glm::uvec2(0);
+        // index of the first page of this level in file
+        std::size_t first_page = 0;
+    };
+
+    TiledImage();
+
+    // tiled file of image, the image is decoded and split if it's not cached
+    // yet
+    // returns std::nullopt if the image can't be decoded
+    static std::optional<TiledImage> load(
+        const std::filesystem::path& filepath, TextureType type,
+        uint32_t page_size = default_page_size);
+
+    glm::uvec2 getResolution() const;
+    uint32_t getPageSize() const;
+    // page size with borders on both sides
+    uint32_t getPaddedPageSize() const;
+    const std::vector<Level>& getLevels() const;
+
+    // row major RGB8 texels of a page including its border
+    const uint8_t* getPage(uint32_t level, const glm::uvec2& page) const;
+    std::size_t getPageBytes() const;
+
+   private:
+    MappedFile file;
+    uint32_t page_size;
+    std::vector<Level> levels;
+    // offset of the first page in file
+    std::size_t pages_offset;
+
+    // parse header of mapped file
+    // returns false if the file is not a tiled image of key
+    bool parse(uint64_t key);
+
+    static void save(const std::filesystem::path& cache_path, uint64_t key,
+                     const uint8_t* image, const glm::uvec2& resolution,
+                     TextureType type, uint32_t page_size);
+};
+
+}  // namespace ogls
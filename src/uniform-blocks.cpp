@@ -0,0 +1,125 @@
+#include "uniform-blocks.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+namespace ogls
+{
+
+namespace
+{
+
+struct BlockMember {
+    std::string name;
+    std::size_t offset;
+};
+
+struct BlockLayout {
+    std::string name;
+    GLuint binding;
+    std::size_t size;
+    std::vector<BlockMember> members;
+};
+
+// names are names of program interface queries, members of structs are
+// prefixed by the variable name
+const std::vector<BlockLayout>& getBlockLayouts()
+{
+    static const std::vector<BlockLayout> layouts = {
+        {"CameraBlock",
+         CameraBlock::binding,
+         sizeof(CameraBlock),
+         {
+             {"view", offsetof(CameraBlock, view)},
+             {"projection", offsetof(CameraBlock, projection)},
+             {"viewProjection", offsetof(CameraBlock, view_projection)},
+             {"cameraPosition", offsetof(CameraBlock, position)},
+         }},
+        {"LightBlock",
+         LightBlock::binding,
+         sizeof(LightBlock),
+         {
+             {"pointLight.ke",
+              offsetof(LightBlock, point_light) + offsetof(GPUPointLight, ke)},
+             {"pointLight.position", offsetof(LightBlock, point_light) +
+                                         offsetof(GPUPointLight, position)},
+             {"pointLight.radius", offsetof(LightBlock, point_light) +
+                                       offsetof(GPUPointLight, radius)},
+             {"directionalLight.ke", offsetof(LightBlock, directional_light) +
+                                         offsetof(GPUDirectionalLight, ke)},
+             {"directionalLight.direction",
+              offsetof(LightBlock, directional_light) +
+                  offsetof(GPUDirectionalLight, direction)},
+         }},
+        {"MaterialBlock",
+         MaterialBlock::binding,
+         sizeof(MaterialBlock),
+         {
+             {"material.kd", offsetof(MaterialBlock, kd)},
+             {"material.ks", offsetof(MaterialBlock, ks)},
+             {"material.ka", offsetof(MaterialBlock, ka)},
+             {"material.ke", offsetof(MaterialBlock, ke)},
+             {"material.shininess", offsetof(MaterialBlock, shininess)},
+             {"material.hasHeightMap", offsetof(MaterialBlock, has_height_map)},
+             {"material.hasNormalMap", offsetof(MaterialBlock, has_normal_map)},
+             {"material.hasDisplacementMap",
+              offsetof(MaterialBlock, has_displacement_map)},
+             {"material.hasLightMap", offsetof(MaterialBlock, has_light_map)},
+             {"material.textureMaps[0]",
+              offsetof(MaterialBlock, texture_maps)},
+         }},
+    };
+    return layouts;
+}
+
+}  // namespace
+
+void checkUniformBlockLayouts(GLuint program)
+{
+    for (const auto& layout : getBlockLayouts()) {
+        const GLuint block = glGetProgramResourceIndex(
+            program, GL_UNIFORM_BLOCK, layout.name.c_str());
+        if (block == GL_INVALID_INDEX) { continue; }
+
+        constexpr GLenum block_props[] = {GL_BUFFER_BINDING,
+                                          GL_BUFFER_DATA_SIZE};
+        GLint block_values[2] = {0, 0};
+        glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, block, 2,
+                               block_props, 2, nullptr, block_values);
+        if (static_cast<GLuint>(block_values[0]) != layout.binding) {
+            spdlog::error("[UniformBlocks] {} of program {:x} is bound to {}, "
+                          "expected {}",
+                          layout.name, program, block_values[0],
+                          layout.binding);
+        }
+        // size of the block may not be rounded up to 16 bytes
+        if (static_cast<std::size_t>(block_values[1]) > layout.size) {
+            spdlog::error("[UniformBlocks] {} of program {:x} is {} bytes, "
+                          "larger than {} bytes",
+                          layout.name, program, block_values[1],
+                          layout.size);
+        }
+
+        for (const auto& member : layout.members) {
+            const GLuint uniform = glGetProgramResourceIndex(
+                program, GL_UNIFORM, member.name.c_str());
+            if (uniform == GL_INVALID_INDEX) { continue; }
+
+            constexpr GLenum offset_prop = GL_OFFSET;
+            GLint offset = -1;
+            glGetProgramResourceiv(program, GL_UNIFORM, uniform, 1,
+                                   &offset_prop, 1, nullptr, &offset);
+            if (static_cast<std::size_t>(offset) != member.offset) {
+                spdlog::error("[UniformBlocks] {} of {} in program {:x} is at "
+                              "offset {}, expected {}",
+                              member.name, layout.name, program, offset,
+                              member.offset);
+            }
+        }
+    }
+}
+
+}  // namespace ogls
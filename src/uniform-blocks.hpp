@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+//
+#include "buffer.hpp"
+
+namespace ogls
+{
+
+// C++ side of std140 uniform blocks of camera.glsl and uniforms.glsl
+// members are laid out by hand as std140 does, vec3 takes 16 bytes unless a
+// scalar follows it. checkUniformBlockLayouts compares them with offsets
+// the linker assigned
+
+// CameraBlock of camera.glsl
+struct CameraBlock {
+    static constexpr GLuint binding = 0;
+
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 view_projection = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    float padding = 0.0f;
+};
+static_assert(sizeof(CameraBlock) == 208);
+
+// PointLight of uniforms.glsl
+struct GPUPointLight {
+    glm::vec3 ke = glm::vec3(0.0f);
+    float padding = 0.0f;
+    glm::vec3 position = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+static_assert(sizeof(GPUPointLight) == 32);
+
+// DirectionalLight of uniforms.glsl
+struct GPUDirectionalLight {
+    glm::vec3 ke = glm::vec3(0.0f);
+    float padding0 = 0.0f;
+    glm::vec3 direction = glm::vec3(0.0f);
+    float padding1 = 0.0f;
+};
+static_assert(sizeof(GPUDirectionalLight) == 32);
+
+// LightBlock of uniforms.glsl
+struct LightBlock {
+    static constexpr GLuint binding = 1;
+
+    GPUPointLight point_light;
+    GPUDirectionalLight directional_light;
+};
+static_assert(sizeof(LightBlock) == 64);
+
+// MaterialBlock of uniforms.glsl, Material of material.glsl
+// same values as GPUMaterial, but std140 pads elements of arrays to 16 bytes
+struct MaterialBlock {
+    static constexpr GLuint binding = 2;
+
+    glm::vec3 kd = glm::vec3(0.0f);
+    float padding0 = 0.0f;
+    glm::vec3 ks = glm::vec3(0.0f);
+    float padding1 = 0.0f;
+    glm::vec3 ka = glm::vec3(0.0f);
+    float padding2 = 0.0f;
+    glm::vec3 ke = glm::vec3(0.0f);
+    float shininess = 0.0f;
+    uint32_t has_height_map = 0;
+    uint32_t has_normal_map = 0;
+    uint32_t has_displacement_map = 0;
+    uint32_t has_light_map = 0;
+    // only xy is used, MaterialTextureTable references of DrawMode::Bindless
+    glm::uvec4 texture_maps[9] = {};
+};
+static_assert(sizeof(MaterialBlock) == 224);
+
+// log an error for each uniform block of program whose binding, size or
+// member offsets differ from the struct above of the same name
+// blocks and members which are not active in program are not checked
+void checkUniformBlockLayouts(GLuint program);
+
+// buffer holding one uniform block T, bound to T::binding
+// the buffer is created by the first update, so this can be a member of
+// objects constructed before the GL context
+template <typename T>
+class UniformBlockBuffer
+{
+   private:
+    std::unique_ptr<Buffer> buffer;
+    T value;
+
+   public:
+    // upload value if it differs from the last one, and bind the buffer
+    void update(const T& value)
+    {
+        if (!buffer) {
+            buffer = std::make_unique<Buffer>();
+            buffer->setStorage(&value, 1, GL_DYNAMIC_STORAGE_BIT);
+            this->value = value;
+        } else if (std::memcmp(&this->value, &value, sizeof(T)) != 0) {
+            buffer->setSubData(&value, 0, 1);
+            this->value = value;
+        }
+        bind();
+    }
+
+    // bind the buffer to T::binding, shaders of other passes may have
+    // bound other buffers to it in between
+    void bind() const
+    {
+        if (buffer) { buffer->bindToUniformBuffer(T::binding); }
+    }
+
+    const T& get() const { return value; }
+};
+
+}  // namespace ogls
@@ -1,5 +1,7 @@
 #include "vertex-array-object.hpp"
 
+#include "gl-state.hpp"
+
 using namespace ogls;
 
 VertexArrayObject::VertexArrayObject()
@@ -43,21 +45,28 @@ void VertexArrayObject::bindElementBuffer(const Buffer& buffer) const
 
 void VertexArrayObject::activateVertexAttribution(GLuint binding, GLuint attrib,
                                                   GLint size, GLenum type,
-                                                  GLsizei offset) const
+                                                  GLsizei offset,
+                                                  GLboolean normalized) const
 {
     glEnableVertexArrayAttrib(array, attrib);
     glVertexArrayAttribBinding(array, attrib, binding);
-    glVertexArrayAttribFormat(array, attrib, size, type, GL_FALSE, offset);
+    glVertexArrayAttribFormat(array, attrib, size, type, normalized, offset);
+}
+
+void VertexArrayObject::deactivateVertexAttribution(GLuint attrib) const
+{
+    glDisableVertexArrayAttrib(array, attrib);
 }
 
-void VertexArrayObject::activate() const { glBindVertexArray(array); }
+void VertexArrayObject::activate() const { GLState::bindVertexArray(array); }
 
-void VertexArrayObject::deactivate() const { glBindVertexArray(0); }
+void VertexArrayObject::deactivate() const { GLState::bindVertexArray(0); }
 
 void VertexArrayObject::release()
 {
     if (array) {
         spdlog::debug("[VertexArrayObject] release VAO {:x}", array);
+        GLState::forgetVertexArray(array);
         glDeleteVertexArrays(1, &array);
     }
 }
\ No newline at end of file
@@ -27,8 +27,13 @@ class VertexArrayObject
 
     void bindElementBuffer(const Buffer& buffer) const;
 
+    // integer types are mapped to [0, 1] or [-1, 1] if normalized is true
     void activateVertexAttribution(GLuint binding, GLuint attrib, GLint size,
-                                   GLenum type, GLsizei offset) const;
+                                   GLenum type, GLsizei offset,
+                                   GLboolean normalized = GL_FALSE) const;
+
+    // disabled attribute is read as (0, 0, 0, 1)
+    void deactivateVertexAttribution(GLuint attrib) const;
 
     void activate() const;
 
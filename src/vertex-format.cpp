@@ -0,0 +1,191 @@
+#include "vertex-format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "glm/gtc/packing.hpp"
+
+namespace ogls
+{
+
+glm::vec2 encodeOctahedral(const glm::vec3& v)
+{
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (l1 == 0.0f) { return glm::vec2(0.0f); }
+
+    const glm::vec3 n = v / l1;
+    if (n.z >= 0.0f) { return glm::vec2(n.x, n.y); }
+
+    // fold lower hemisphere over the diagonals
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+uint32_t VertexFormat::getKey() const
+{
+    return quantized_positions | packed_normals << 1 | half_texcoords << 2 |
+           normal_derivatives << 3;
+}
+
+GLuint VertexFormat::getShaderFlags() const
+{
+    return packed_normals ? octahedral_normals_bit : 0;
+}
+
+GLsizei VertexFormat::getPositionSize() const
+{
+    // 16 bit padding keeps attributes 4 byte aligned
+    return quantized_positions ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+}
+
+GLsizei VertexFormat::getNormalSize() const
+{
+    return packed_normals ? 2 * sizeof(int16_t) : sizeof(glm::vec3);
+}
+
+GLsizei VertexFormat::getTexcoordsSize() const
+{
+    return half_texcoords ? 2 * sizeof(uint16_t) : sizeof(glm::vec2);
+}
+
+GLsizei VertexFormat::getNormalDerivativeSize() const
+{
+    if (!normal_derivatives) { return 0; }
+    return packed_normals ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+}
+
+GLsizei VertexFormat::getStride() const
+{
+    return getPositionSize() + 2 * getNormalSize() + getTexcoordsSize() +
+           2 * getNormalDerivativeSize();
+}
+
+void VertexFormat::setupVertexArrayObject(const VertexArrayObject& vao,
+                                          const Buffer& buffer) const
+{
+    vao.bindVertexBuffer(buffer, 0, 0, getStride());
+
+    GLsizei offset = 0;
+
+    // position
+    if (quantized_positions) {
+        vao.activateVertexAttribution(0, 0, 3, GL_UNSIGNED_SHORT, offset,
+                                      GL_TRUE);
+    } else {
+        vao.activateVertexAttribution(0, 0, 3, GL_FLOAT, offset);
+    }
+    offset += getPositionSize();
+
+    // normal and tangent
+    const auto setup_direction = [&](GLuint attrib) {
+        if (packed_normals) {
+            vao.activateVertexAttribution(0, attrib, 2, GL_SHORT, offset,
+                                          GL_TRUE);
+        } else {
+            vao.activateVertexAttribution(0, attrib, 3, GL_FLOAT, offset);
+        }
+        offset += getNormalSize();
+    };
+    setup_direction(1);
+
+    // texcoords
+    if (half_texcoords) {
+        vao.activateVertexAttribution(0, 2, 2, GL_HALF_FLOAT, offset);
+    } else {
+        vao.activateVertexAttribution(0, 2, 2, GL_FLOAT, offset);
+    }
+    offset += getTexcoordsSize();
+
+    setup_direction(3);
+
+    // dndu, dndv
+    for (const GLuint attrib : {4, 5}) {
+        if (!normal_derivatives) {
+            vao.deactivateVertexAttribution(attrib);
+        } else if (packed_normals) {
+            vao.activateVertexAttribution(0, attrib, 3, GL_HALF_FLOAT, offset);
+        } else {
+            vao.activateVertexAttribution(0, attrib, 3, GL_FLOAT, offset);
+        }
+        offset += getNormalDerivativeSize();
+    }
+}
+
+std::vector<uint8_t> VertexFormat::pack(const std::vector<Vertex>& vertices,
+                                        glm::vec3& position_offset,
+                                        glm::vec3& position_scale) const
+{
+    position_offset = glm::vec3(0.0f);
+    position_scale = glm::vec3(1.0f);
+
+    // bounding box of mesh is mapped to [0, 1]^3
+    if (quantized_positions && !vertices.empty()) {
+        glm::vec3 p_min(std::numeric_limits<float>::max());
+        glm::vec3 p_max(std::numeric_limits<float>::lowest());
+        for (const auto& vertex : vertices) {
+            p_min = glm::min(p_min, vertex.position);
+            p_max = glm::max(p_max, vertex.position);
+        }
+        position_offset = p_min;
+        position_scale = glm::max(p_max - p_min, glm::vec3(1e-8f));
+    }
+
+    std::vector<uint8_t> ret(getStride() * vertices.size());
+    uint8_t* dst = ret.data();
+
+    const auto write = [&dst](const auto& value) {
+        std::memcpy(dst, &value, sizeof(value));
+        dst += sizeof(value);
+    };
+    const auto write_direction = [&](const glm::vec3& v) {
+        if (packed_normals) {
+            const glm::vec2 e = encodeOctahedral(v);
+            write(glm::packSnorm1x16(e.x));
+            write(glm::packSnorm1x16(e.y));
+        } else {
+            write(v);
+        }
+    };
+    const auto write_derivative = [&](const glm::vec3& v) {
+        if (!normal_derivatives) { return; }
+        if (packed_normals) {
+            write(glm::packHalf1x16(v.x));
+            write(glm::packHalf1x16(v.y));
+            write(glm::packHalf1x16(v.z));
+            write(uint16_t(0));
+        } else {
+            write(v);
+        }
+    };
+
+    for (const auto& vertex : vertices) {
+        if (quantized_positions) {
+            const glm::vec3 q =
+                (vertex.position - position_offset) / position_scale;
+            write(glm::packUnorm1x16(q.x));
+            write(glm::packUnorm1x16(q.y));
+            write(glm::packUnorm1x16(q.z));
+            write(uint16_t(0));
+        } else {
+            write(vertex.position);
+        }
+
+        write_direction(vertex.normal);
+
+        if (half_texcoords) {
+            write(glm::packHalf1x16(vertex.texcoords.x));
+            write(glm::packHalf1x16(vertex.texcoords.y));
+        } else {
+            write(vertex.texcoords);
+        }
+
+        write_direction(vertex.tangent);
+        write_derivative(vertex.dndu);
+        write_derivative(vertex.dndv);
+    }
+
+    return ret;
+}
+
+}  // namespace ogls
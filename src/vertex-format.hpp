@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+//
+#include "buffer.hpp"
+#include "vertex-array-object.hpp"
+
+namespace ogls
+{
+
+struct Vertex {
+    glm::vec3 position = glm::vec3(0.0f);   // vertex position
+    glm::vec3 normal = glm::vec3(0.0f);     // vertex normal
+    glm::vec2 texcoords = glm::vec3(0.0f);  // texture coordinates
+    glm::vec3 tangent = glm::vec3(0.0f);    // tangent vector(dp/du)
+    glm::vec3 dndu = glm::vec3(0.0f);  // differential of normal by texcoords
+    glm::vec3 dndv = glm::vec3(0.0f);  // differential of normal by texcoords
+
+    Vertex() {}
+};
+
+// layout of vertices in GPU buffer, default value is the same layout as Vertex
+// attribute locations are 0: position, 1: normal, 2: texcoords, 3: tangent,
+// 4: dndu, 5: dndv
+struct VertexFormat {
+    // positions as 3x16 bit unorm in bounding box of mesh
+    bool quantized_positions = false;
+    // normals and tangents as octahedral encoded 2x16 bit snorm, dndu and dndv
+    // as 3x16 bit half float
+    bool packed_normals = false;
+    // texcoords as 2x16 bit half float
+    bool half_texcoords = false;
+    // if false, dndu and dndv are not stored and read as zero in shaders
+    bool normal_derivatives = true;
+
+    // bits of vertexFlags uniform
+    static constexpr GLuint octahedral_normals_bit = 1;
+
+    bool operator==(const VertexFormat& other) const = default;
+
+    // identifies layout, used as a key of VAOs
+    uint32_t getKey() const;
+
+    GLuint getShaderFlags() const;
+
+    GLsizei getStride() const;
+
+    // set vertex attributes of VAO, vertices are read from binding 0
+    void setupVertexArrayObject(const VertexArrayObject& vao,
+                                const Buffer& buffer) const;
+
+    // encode vertices in this layout
+    // positions in shaders are position_offset + position_scale * position
+    std::vector<uint8_t> pack(const std::vector<Vertex>& vertices,
+                              glm::vec3& position_offset,
+                              glm::vec3& position_scale) const;
+
+   private:
+    GLsizei getPositionSize() const;
+    GLsizei getNormalSize() const;
+    GLsizei getTexcoordsSize() const;
+    GLsizei getNormalDerivativeSize() const;
+};
+
+// octahedral encoding of unit vector into [-1, 1]^2
+glm::vec2 encodeOctahedral(const glm::vec3& v);
+
+}  // namespace ogls
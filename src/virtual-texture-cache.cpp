@@ -0,0 +1,489 @@
+#include "virtual-texture-cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gl-state.hpp"
+#include "spdlog/spdlog.h"
+#include "thread-pool.hpp"
+
+namespace ogls
+{
+
+namespace
+{
+
+// layout of page keys and feedback
+// bits 0-8: page x, 9-17: page y, 18-21: level, 22-31: texture
+constexpr uint32_t page_bits = 9;
+constexpr uint32_t level_bits = 4;
+constexpr uint32_t page_mask = (1u << page_bits) - 1;
+constexpr uint32_t level_mask = (1u << level_bits) - 1;
+constexpr uint32_t level_shift = 2 * page_bits;
+constexpr uint32_t texture_shift = level_shift + level_bits;
+// cleared value of feedback, fragments without virtual textures
+constexpr uint32_t no_feedback = 0xffffffff;
+
+// layout of entries of indirection tables
+// bits 0-15: slot, 16-19: level of resident page, 31: valid
+constexpr uint32_t entry_level_shift = 16;
+constexpr uint32_t entry_valid_bit = 1u << 31;
+constexpr uint32_t max_slots = 1u << entry_level_shift;
+
+constexpr std::size_t n_readbacks = 3;
+
+uint32_t makeKey(uint32_t texture_id, uint32_t level, const glm::uvec2& page)
+{
+    return (texture_id << texture_shift) | (level << level_shift) |
+           (page.y << page_bits) | page.x;
+}
+
+uint32_t getTextureID(uint32_t key) { return key >> texture_shift; }
+
+uint32_t getLevel(uint32_t key) { return (key >> level_shift) & level_mask; }
+
+glm::uvec2 getPage(uint32_t key)
+{
+    return glm::uvec2(key & page_mask, (key >> page_bits) & page_mask);
+}
+
+uint32_t packEntry(uint32_t slot, uint32_t level)
+{
+    return entry_valid_bit | (level << entry_level_shift) | slot;
+}
+
+bool isSRGBFormat(GLint internal_format)
+{
+    return internal_format == GL_SRGB8 || internal_format == GL_SRGB8_ALPHA8;
+}
+
+}  // namespace
+
+VirtualTextureCache::VirtualTextureCache(GLint internal_format,
+                                         uint32_t n_pages, uint32_t page_size)
+    : internal_format{internal_format},
+      n_pages{n_pages},
+      page_size{page_size},
+      stream_state{std::make_shared<StreamState>()},
+      frame{0},
+      resized{true},
+      feedback_framebuffer({GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT}),
+      readbacks(n_readbacks),
+      next_readback{0},
+      saved_viewport{0}
+{
+    // slots are indexed by 16 bits in indirection tables
+    while (this->n_pages * this->n_pages > max_slots) { this->n_pages /= 2; }
+    slots.resize(this->n_pages * this->n_pages);
+
+    const uint32_t padded_size = page_size + 2 * TiledImage::page_border;
+    physical_texture =
+        Texture::TextureBuilder(glm::vec2(this->n_pages * padded_size))
+            .setInternalFormat(internal_format)
+            .setFormat(GL_RGB)
+            .setType(GL_UNSIGNED_BYTE)
+            .setWrapS(GL_CLAMP_TO_EDGE)
+            .setWrapT(GL_CLAMP_TO_EDGE)
+            .setMagFilter(GL_LINEAR)
+            .setMinFilter(GL_LINEAR)
+            .build();
+
+    feedback_framebuffer.setDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    stats.n_physical_pages = slots.size();
+    stats.physical_bytes = 3 * std::size_t(this->n_pages * padded_size) *
+                           (this->n_pages * padded_size);
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+    for (auto& readback : readbacks) {
+        if (readback.fence) { glDeleteSync(readback.fence); }
+    }
+}
+
+bool VirtualTextureCache::accepts(TextureType type) const
+{
+    // other maps would be dropped from materials, as shaders only sample
+    // diffuseVirtualTexture
+    return type == TextureType::Diffuse && isSRGBFormat(internal_format);
+}
+
+std::optional<uint32_t> VirtualTextureCache::add(
+    const std::filesystem::path& filepath, TextureType type)
+{
+    if (textures.size() >= max_textures) {
+        spdlog::warn("[VirtualTextureCache] too many textures, {} is skipped",
+                     filepath.string());
+        return std::nullopt;
+    }
+
+    std::optional<TiledImage> image =
+        TiledImage::load(filepath, type, page_size);
+    if (!image) { return std::nullopt; }
+
+    const std::vector<TiledImage::Level>& levels = image->getLevels();
+    if (levels.size() > max_levels ||
+        levels.front().n_pages.x > max_pages_per_side ||
+        levels.front().n_pages.y > max_pages_per_side) {
+        spdlog::warn("[VirtualTextureCache] {} is too large",
+                     filepath.string());
+        return std::nullopt;
+    }
+
+    const uint32_t texture_id = textures.size();
+    VirtualTexture texture;
+    texture.first_level = level_table.size();
+    texture.first_entry = entry_table.size();
+    std::size_t n_bytes = 0;
+    for (const auto& level : levels) {
+        level_table.push_back(glm::uvec4(level.n_pages.x, level.n_pages.y,
+                                         entry_table.size(), 0));
+        entry_table.resize(entry_table.size() +
+                           level.n_pages.x * level.n_pages.y);
+        n_bytes += 3 * std::size_t(level.resolution.x) * level.resolution.y;
+    }
+    texture.n_entries = entry_table.size() - texture.first_entry;
+    texture.image = std::make_shared<const TiledImage>(std::move(*image));
+    textures.push_back(std::move(texture));
+    resized = true;
+
+    // coarsest level is the fallback of all pages
+    const TiledImage& tiled = *textures.back().image;
+    const uint32_t last_level = tiled.getLevels().size() - 1;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const std::optional<uint32_t> slot =
+        uploadPage(makeKey(texture_id, last_level, glm::uvec2(0)),
+                   tiled.getPage(last_level, glm::uvec2(0)), true);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (!slot) {
+        spdlog::warn("[VirtualTextureCache] no page left for {}",
+                     filepath.string());
+        level_table.resize(textures.back().first_level);
+        entry_table.resize(textures.back().first_entry);
+        textures.pop_back();
+        return std::nullopt;
+    }
+
+    stats.n_textures = textures.size();
+    stats.virtual_bytes += n_bytes;
+
+    return texture_id;
+}
+
+void VirtualTextureCache::beginFeedback(const glm::uvec2& resolution)
+{
+    if (feedback_texture.getResolution() != resolution) {
+        feedback_texture = Texture::TextureBuilder(resolution)
+                               .setInternalFormat(GL_R32UI)
+                               .setFormat(GL_RED_INTEGER)
+                               .setType(GL_UNSIGNED_INT)
+                               .setMagFilter(GL_NEAREST)
+                               .setMinFilter(GL_NEAREST)
+                               .build();
+        feedback_depth = Texture::TextureBuilder(resolution)
+                             .setInternalFormat(GL_DEPTH_COMPONENT32F)
+                             .setFormat(GL_DEPTH_COMPONENT)
+                             .setType(GL_FLOAT)
+                             .setMagFilter(GL_NEAREST)
+                             .setMinFilter(GL_NEAREST)
+                             .build();
+        feedback_framebuffer.bindTexture(feedback_texture, 0);
+        feedback_framebuffer.bindTexture(feedback_depth, 1);
+    }
+
+    saved_viewport = GLState::getViewport();
+    feedback_framebuffer.activate();
+    GLState::setViewport(0, 0, resolution.x, resolution.y);
+
+    const GLuint clear_value[4] = {no_feedback, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, clear_value);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTextureCache::endFeedback()
+{
+    feedback_framebuffer.deactivate();
+    GLState::setViewport(saved_viewport.x, saved_viewport.y,
+                         saved_viewport.z, saved_viewport.w);
+
+    // drop feedback if GPU is so far behind that all readbacks are in use
+    Readback& readback = readbacks[next_readback];
+    if (readback.fence) { return; }
+
+    const glm::uvec2 resolution = feedback_texture.getResolution();
+    const uint32_t n = resolution.x * resolution.y;
+    if (readback.resolution != resolution) {
+        readback.buffer = Buffer();
+        readback.buffer.setStorage<uint32_t>(nullptr, n, GL_MAP_READ_BIT);
+        readback.resolution = resolution;
+    }
+
+    readback.buffer.bindToPixelPackBuffer();
+    glGetTextureImage(feedback_texture.getTextureName(), 0, GL_RED_INTEGER,
+                      GL_UNSIGNED_INT, sizeof(uint32_t) * n, nullptr);
+    readback.buffer.unbindFromPixelPackBuffer();
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    next_readback = (next_readback + 1) % readbacks.size();
+}
+
+float VirtualTextureCache::getFeedbackLodBias(
+    const glm::uvec2& framebuffer_resolution) const
+{
+    const glm::uvec2 resolution = feedback_texture.getResolution();
+    if (resolution.y == 0 || framebuffer_resolution.y == 0) { return 0.0f; }
+    return std::log2(static_cast<float>(resolution.y) /
+                     framebuffer_resolution.y);
+}
+
+void VirtualTextureCache::update()
+{
+    frame++;
+
+    // read feedback in the order it was rendered, without waiting
+    for (std::size_t i = 0; i < readbacks.size(); ++i) {
+        Readback& readback =
+            readbacks[(next_readback + i) % readbacks.size()];
+        if (!readback.fence) { continue; }
+
+        const GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED &&
+            status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        const std::size_t n = readback.resolution.x * readback.resolution.y;
+        const void* feedback =
+            glMapNamedBufferRange(readback.buffer.getName(), 0,
+                                  sizeof(uint32_t) * n, GL_MAP_READ_BIT);
+        if (feedback) {
+            processFeedback(static_cast<const uint32_t*>(feedback), n);
+            glUnmapNamedBuffer(readback.buffer.getName());
+        }
+    }
+
+    // upload pages loaded by worker threads
+    std::vector<LoadedPage> loaded;
+    {
+        std::lock_guard<std::mutex> lock(stream_state->mutex);
+        while (!stream_state->loaded.empty() &&
+               loaded.size() < max_uploads_per_frame) {
+            loaded.push_back(std::move(stream_state->loaded.front()));
+            stream_state->loaded.pop_front();
+        }
+    }
+
+    stats.n_uploaded_pages = 0;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const auto& page : loaded) {
+        pending.erase(page.key);
+        if (resident.count(page.key)) { continue; }
+        // pages which don't fit are requested again by later feedback
+        if (uploadPage(page.key, page.texels.data(), false)) {
+            stats.n_uploaded_pages++;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // indirection tables of textures whose pages changed
+    for (uint32_t i = 0; i < textures.size(); ++i) {
+        VirtualTexture& texture = textures[i];
+        if (!texture.dirty) { continue; }
+        updateIndirection(i);
+        if (!resized) {
+            entry_buffer.setSubData(
+                entry_table.data() + texture.first_entry,
+                texture.first_entry, texture.n_entries);
+        }
+    }
+    if (resized) { uploadTables(); }
+
+    stats.n_resident_pages = resident.size();
+    stats.n_pending_pages = pending.size();
+}
+
+void VirtualTextureCache::bind() const
+{
+    physical_texture.bindToTextureUnit(physical_texture_unit);
+    texture_buffer.bindToShaderStorageBuffer(texture_buffer_binding);
+    level_buffer.bindToShaderStorageBuffer(level_buffer_binding);
+    entry_buffer.bindToShaderStorageBuffer(entry_buffer_binding);
+}
+
+const VirtualTextureCache::Stats& VirtualTextureCache::getStats() const
+{
+    return stats;
+}
+
+void VirtualTextureCache::processFeedback(const uint32_t* feedback,
+                                          std::size_t n)
+{
+    std::vector<uint32_t> keys(feedback, feedback + n);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (!keys.empty() && keys.back() == no_feedback) { keys.pop_back(); }
+    stats.n_requested_pages = keys.size();
+
+    // requested pages and their coarser pages, which are sampled until the
+    // requested ones are resident
+    std::vector<uint32_t> missing;
+    for (const uint32_t key : keys) {
+        const uint32_t texture_id = getTextureID(key);
+        if (texture_id >= textures.size()) { continue; }
+        const std::vector<TiledImage::Level>& levels =
+            textures[texture_id].image->getLevels();
+
+        glm::uvec2 page = getPage(key);
+        for (uint32_t level = getLevel(key); level < levels.size();
+             ++level, page /= 2u) {
+            page = glm::min(page, levels[level].n_pages - 1u);
+            const uint32_t k = makeKey(texture_id, level, page);
+            if (const auto it = resident.find(k); it != resident.end()) {
+                slots[it->second].last_used = frame;
+            } else if (!pending.count(k)) {
+                missing.push_back(k);
+            }
+        }
+    }
+
+    // coarser pages first, since they cover more
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()),
+                  missing.end());
+    std::stable_sort(missing.begin(), missing.end(),
+                     [](uint32_t a, uint32_t b) {
+                         return getLevel(a) > getLevel(b);
+                     });
+    for (const uint32_t key : missing) {
+        if (pending.size() >= max_pending_pages) { break; }
+        requestPage(key);
+    }
+}
+
+void VirtualTextureCache::requestPage(PageKey key)
+{
+    pending.insert(key);
+
+    ThreadPool::getGlobal().submit(
+        [state = stream_state, image = textures[getTextureID(key)].image,
+         key]() {
+            LoadedPage loaded;
+            loaded.key = key;
+            // reading mapped file loads the page from disk
+            const uint8_t* texels = image->getPage(getLevel(key), getPage(key));
+            loaded.texels.assign(texels, texels + image->getPageBytes());
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->loaded.push_back(std::move(loaded));
+        });
+}
+
+std::optional<uint32_t> VirtualTextureCache::uploadPage(PageKey key,
+                                                        const uint8_t* texels,
+                                                        bool pin)
+{
+    // free slot, or the least recently used one not used in this frame
+    std::optional<uint32_t> index;
+    uint64_t oldest = frame;
+    for (uint32_t i = 0; i < slots.size(); ++i) {
+        if (!slots[i].page) {
+            index = i;
+            break;
+        }
+        if (!slots[i].pinned && slots[i].last_used < oldest) {
+            oldest = slots[i].last_used;
+            index = i;
+        }
+    }
+    if (!index) { return std::nullopt; }
+
+    Slot& slot = slots[index.value()];
+    if (slot.page) {
+        resident.erase(slot.page.value());
+        textures[getTextureID(slot.page.value())].dirty = true;
+        stats.n_evicted_pages++;
+    }
+
+    const uint32_t padded_size = page_size + 2 * TiledImage::page_border;
+    glTextureSubImage2D(physical_texture.getTextureName(), 0,
+                        (index.value() % n_pages) * padded_size,
+                        (index.value() / n_pages) * padded_size, padded_size,
+                        padded_size, GL_RGB, GL_UNSIGNED_BYTE, texels);
+
+    slot.page = key;
+    slot.last_used = frame;
+    slot.pinned = pin;
+    resident[key] = index.value();
+    textures[getTextureID(key)].dirty = true;
+
+    return index;
+}
+
+void VirtualTextureCache::updateIndirection(uint32_t texture_id)
+{
+    VirtualTexture& texture = textures[texture_id];
+    const std::vector<TiledImage::Level>& levels =
+        texture.image->getLevels();
+
+    // from the coarsest level, missing pages point to the entry of their
+    // coarser page
+    for (uint32_t level = levels.size(); level-- > 0;) {
+        const glm::uvec2 n = levels[level].n_pages;
+        uint32_t* entries =
+            entry_table.data() + level_table[texture.first_level + level].z;
+        const uint32_t* coarser_entries =
+            level + 1 < levels.size()
+                ? entry_table.data() +
+                      level_table[texture.first_level + level + 1].z
+                : nullptr;
+        const glm::uvec2 n_coarser =
+            level + 1 < levels.size() ? levels[level + 1].n_pages
+                                      : glm::uvec2(0);
+
+        for (uint32_t y = 0; y < n.y; ++y) {
+            for (uint32_t x = 0; x < n.x; ++x) {
+                uint32_t& entry = entries[y * n.x + x];
+                const auto it =
+                    resident.find(makeKey(texture_id, level, {x, y}));
+                if (it != resident.end()) {
+                    entry = packEntry(it->second, level);
+                } else if (coarser_entries) {
+                    const uint32_t cx = std::min(x / 2, n_coarser.x - 1);
+                    const uint32_t cy = std::min(y / 2, n_coarser.y - 1);
+                    entry = coarser_entries[cy * n_coarser.x + cx];
+                } else {
+                    entry = 0;
+                }
+            }
+        }
+    }
+
+    texture.dirty = false;
+}
+
+void VirtualTextureCache::uploadTables()
+{
+    // parameters of cache, followed by resolution, number of levels and
+    // first level of each texture
+    std::vector<glm::uvec4> texture_table;
+    texture_table.push_back(glm::uvec4(page_size,
+                                       page_size + 2 * TiledImage::page_border,
+                                       TiledImage::page_border, n_pages));
+    for (const auto& texture : textures) {
+        const glm::uvec2 resolution = texture.image->getResolution();
+        texture_table.push_back(
+            glm::uvec4(resolution.x, resolution.y,
+                       texture.image->getLevels().size(),
+                       texture.first_level));
+    }
+
+    texture_buffer.setData(texture_table, GL_DYNAMIC_DRAW);
+    level_buffer.setData(level_table, GL_DYNAMIC_DRAW);
+    entry_buffer.setData(entry_table, GL_DYNAMIC_DRAW);
+    resized = false;
+}
+
+}  // namespace ogls
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+//
+#include "buffer.hpp"
+#include "framebuffer.hpp"
+#include "texture.hpp"
+#include "tiled-image.hpp"
+
+namespace ogls
+{
+
+// software virtual texturing, which doesn't need sparse textures
+// pages of many large textures share one physical texture, and only pages
+// seen by the camera are resident
+// - a low resolution feedback pass writes the page each fragment samples
+// - update() reads the feedback of a previous frame back, requests missing
+//   pages from worker threads and uploads pages they have loaded, evicting
+//   the least recently used ones
+// - indirection tables map every page of every level to the resident page
+//   covering it, which may be a coarser one while finer pages are streamed
+// the coarsest level of each texture is always resident, so that textures
+// never sample missing pages
+// all textures share the internal format of the cache. only diffuse maps are
+// virtual, since shaders sample a single diffuseVirtualTexture, so models use
+// an sRGB cache
+// pages are RGB8 like images loaded by Model::loadImage, alpha is discarded
+// even with GL_SRGB8_ALPHA8 and alpha tested maps lose their mask
+class VirtualTextureCache
+{
+   public:
+    // counters shown by sandboxes
+    struct Stats {
+        std::size_t n_textures = 0;
+        std::size_t n_resident_pages = 0;
+        std::size_t n_physical_pages = 0;
+        // distinct pages in the last feedback
+        std::size_t n_requested_pages = 0;
+        std::size_t n_pending_pages = 0;
+        std::size_t n_uploaded_pages = 0;
+        std::size_t n_evicted_pages = 0;
+        // GPU memory of physical texture, and what all levels of all
+        // textures would take
+        std::size_t physical_bytes = 0;
+        std::size_t virtual_bytes = 0;
+    };
+
+    // physical texture holds n_pages x n_pages pages
+    VirtualTextureCache(GLint internal_format = GL_SRGB8,
+                        uint32_t n_pages = 32,
+                        uint32_t page_size = TiledImage::default_page_size);
+    VirtualTextureCache(const VirtualTextureCache& other) = delete;
+    VirtualTextureCache(VirtualTextureCache&& other) = default;
+    ~VirtualTextureCache();
+
+    VirtualTextureCache& operator=(const VirtualTextureCache& other) = delete;
+    VirtualTextureCache& operator=(VirtualTextureCache&& other) = default;
+
+    // is TextureType sampled virtually? only diffuse maps of an sRGB cache
+    bool accepts(TextureType type) const;
+
+    // register image, it's split into pages on the first use
+    // returns index of the texture in shaders, or std::nullopt if the image
+    // can't be loaded or the cache can't hold its coarsest level
+    std::optional<uint32_t> add(const std::filesystem::path& filepath,
+                                TextureType type);
+
+    // render feedback of virtual textures to a framebuffer of resolution
+    // until endFeedback
+    // shaders write packVirtualTextureFeedback of virtual-texture.glsl with
+    // lod bias getFeedbackLodBias, and the framebuffer has a depth buffer
+    void beginFeedback(const glm::uvec2& resolution);
+    // read feedback back asynchronously, it's processed by a later update
+    void endFeedback();
+    // feedback is rendered at lower resolution, so that its derivatives are
+    // larger than the ones of the main pass
+    float getFeedbackLodBias(const glm::uvec2& framebuffer_resolution) const;
+
+    // process feedback, request missing pages, upload up to
+    // max_uploads_per_frame loaded pages and update indirection tables
+    // this should be called once per frame
+    void update();
+
+    // bind physical texture and tables
+    void bind() const;
+
+    const Stats& getStats() const;
+
+    // pages uploaded by update at most, which bounds its cost
+    uint32_t max_uploads_per_frame = 16;
+    // pages being loaded by worker threads at most, coarser pages are
+    // requested first
+    uint32_t max_pending_pages = 64;
+
+    // limits of packed page keys
+    static constexpr uint32_t max_textures = 1023;
+    static constexpr uint32_t max_levels = 16;
+    static constexpr uint32_t max_pages_per_side = 512;
+
+    // bindings used by virtual-texture.glsl
+    static constexpr GLuint physical_texture_unit = 9;
+    static constexpr GLuint texture_buffer_binding = 2;
+    static constexpr GLuint level_buffer_binding = 3;
+    static constexpr GLuint entry_buffer_binding = 4;
+
+   private:
+    // identifies a page of a level of a texture, same as packed feedback
+    using PageKey = uint32_t;
+
+    struct VirtualTexture {
+        std::shared_ptr<const TiledImage> image;
+        // first element of this texture in level and entry tables
+        uint32_t first_level = 0;
+        uint32_t first_entry = 0;
+        uint32_t n_entries = 0;
+        // indirection tables need to be uploaded again
+        bool dirty = true;
+    };
+
+    // a page slot of physical texture
+    struct Slot {
+        std::optional<PageKey> page;
+        // frame the page was requested last time
+        uint64_t last_used = 0;
+        // coarsest level, never evicted
+        bool pinned = false;
+    };
+
+    // page loaded by a worker thread
+    struct LoadedPage {
+        PageKey key;
+        std::vector<uint8_t> texels;
+    };
+
+    // shared with worker threads, which may outlive the cache
+    struct StreamState {
+        std::mutex mutex;
+        std::deque<LoadedPage> loaded;
+    };
+
+    // feedback read back through a pixel pack buffer, and fence of the copy
+    struct Readback {
+        Buffer buffer;
+        glm::uvec2 resolution = glm::uvec2(0);
+        GLsync fence = nullptr;
+    };
+
+    GLint internal_format;
+    uint32_t n_pages;
+    uint32_t page_size;
+    Texture physical_texture;
+
+    std::vector<VirtualTexture> textures;
+    std::vector<Slot> slots;
+    std::unordered_map<PageKey, uint32_t> resident;
+    std::unordered_set<PageKey> pending;
+    std::shared_ptr<StreamState> stream_state;
+    uint64_t frame;
+
+    // CPU side indirection tables, uploaded if textures are dirty
+    std::vector<glm::uvec4> level_table;
+    std::vector<uint32_t> entry_table;
+    Buffer texture_buffer;
+    Buffer level_buffer;
+    Buffer entry_buffer;
+    // tables are uploaded as a whole if textures are added
+    bool resized;
+
+    FrameBuffer feedback_framebuffer;
+    Texture feedback_texture;
+    Texture feedback_depth;
+    // ring of readbacks, so that reading never waits for GPU
+    std::vector<Readback> readbacks;
+    std::size_t next_readback;
+    // viewport restored by endFeedback
+    glm::ivec4 saved_viewport;
+
+    Stats stats;
+
+    // request pages of feedback, and touch resident ones
+    void processFeedback(const uint32_t* feedback, std::size_t n);
+    // load page on a worker thread
+    void requestPage(PageKey key);
+    // copy texels to a free or the least recently used slot
+    // returns std::nullopt if all slots are in use this frame
+    std::optional<uint32_t> uploadPage(PageKey key, const uint8_t* texels,
+                                       bool pin);
+
+    void updateIndirection(uint32_t texture_id);
+    void uploadTables();
+};
+
+}  // namespace ogls